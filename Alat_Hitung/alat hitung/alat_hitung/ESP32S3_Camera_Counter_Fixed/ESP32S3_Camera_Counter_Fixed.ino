@@ -19,9 +19,13 @@ const char *ap_ssid = "ESP32_CAMERA_COUNT";
 const char *ap_pass = "12345678"; // minimal 8 karakter
 
 // Default processing parameters
-int g_threshold = 70;  // 0-255, ambang biner
-int g_minArea = 30;    // piksel, minimal blob dihitung
-int g_maxArea = 20000; // piksel, maksimal blob dihitung
+int g_threshold = 70;   // 0-255, ambang biner
+int g_threshMode = 0;   // 0 = manual, 1 = otsu, 2 = adaptive (THRESH_*)
+int g_adaptRadius = 8;  // radius jendela mean lokal (mode adaptive)
+int g_adaptOffset = 10; // persen lebih gelap dari mean lokal (mode adaptive)
+int g_minArea = 30;     // piksel, minimal blob dihitung
+int g_maxArea = 20000;  // piksel, maksimal blob dihitung
+int g_splitMode = 0;    // blob > g_maxArea: 0 = dibuang, 1 = distance transform, 2 = area/median (SPLIT_*)
 
 // ==== Pin kamera ESP32-S3 + OV5640 ====
 // Pin mapping sesuai dengan board ESP32S3 + OV5640 Anda
@@ -43,9 +47,8 @@ int g_maxArea = 20000; // piksel, maksimal blob dihitung
 #define HREF_GPIO_NUM 7  // Horizontal reference
 #define PCLK_GPIO_NUM 13 // Pixel clock
 
-// Resolusi untuk penghitungan (cepat)
-#define PROC_FRAMESIZE FRAMESIZE_QQVGA // 160x120
-#define PROC_PIXELFORMAT PIXFORMAT_RGB565
+// Resolusi untuk penghitungan: profil "count" di camera_profiles.h (RGB565 QQVGA 160x120)
+#include "camera_profiles.h"
 
 httpd_handle_t camera_httpd = NULL;
 
@@ -54,117 +57,38 @@ void startCameraServer();
 bool initCamera();
 bool setupWiFiAP();
 
-// Minimal helper: convert RGB565 -> grayscale
-static inline uint8_t rgb565_to_gray(uint16_t c)
-{
-    uint8_t r = (c >> 11) & 0x1F;
-    uint8_t g = (c >> 5) & 0x3F;
-    uint8_t b = c & 0x1F;
-    // expand to 8-bit
-    uint8_t R = (r * 255) / 31;
-    uint8_t G = (g * 255) / 63;
-    uint8_t B = (b * 255) / 31;
-    return (uint8_t)((R * 299 + G * 587 + B * 114) / 1000);
-}
+// RGB565 -> grayscale / mask biner berbasis lookup table (rgb565_to_gray, rgb565ToMask)
+#include "rgb565_mask.h"
 
-// Simple connected-component labeling via BFS; returns vector of areas
-#include <vector>
-struct Blob
-{
-    int area;
-    int minx, miny, maxx, maxy;
-};
+// Region of interest (persen frame, tersimpan di EEPROM)
+#include "roi.h"
 
-std::vector<Blob> detect_blobs(uint8_t *gray, int w, int h, int threshold, int minArea, int maxArea)
-{
-    std::vector<Blob> blobs;
-    // labels: 0 unlabeled, 1 labeled
-    uint8_t *vis = (uint8_t *)malloc(w * h);
-    if (!vis)
-        return blobs;
-    memset(vis, 0, w * h);
-
-    // stack for BFS (store index)
-    int maxStack = w * h;
-    int *stack = (int *)malloc(sizeof(int) * maxStack);
-    if (!stack)
-    {
-        free(vis);
-        return blobs;
-    }
+// Run-length blob detector (detect_blobs, struct Blob)
+#include "blob_rle.h"
 
-    for (int y = 0; y < h; y++)
-    {
-        for (int x = 0; x < w; x++)
-        {
-            int idx = y * w + x;
-            if (vis[idx])
-                continue;
-            if (gray[idx] < threshold)
-            { // foreground = dark (adjust if background dark)
-                // BFS
-                int sp = 0;
-                stack[sp++] = idx;
-                vis[idx] = 1;
-                int area = 0;
-                int minx = x, miny = y, maxx = x, maxy = y;
-                while (sp > 0)
-                {
-                    int cur = stack[--sp];
-                    int cy = cur / w;
-                    int cx = cur % w;
-                    area++;
-                    if (cx < minx)
-                        minx = cx;
-                    if (cx > maxx)
-                        maxx = cx;
-                    if (cy < miny)
-                        miny = cy;
-                    if (cy > maxy)
-                        maxy = cy;
-                    // 4-neighbors
-                    const int dx[4] = {-1, 1, 0, 0};
-                    const int dy[4] = {0, 0, -1, 1};
-                    for (int k = 0; k < 4; k++)
-                    {
-                        int nx = cx + dx[k];
-                        int ny = cy + dy[k];
-                        if (nx < 0 || nx >= w || ny < 0 || ny >= h)
-                            continue;
-                        int nidx = ny * w + nx;
-                        if (vis[nidx])
-                            continue;
-                        if (gray[nidx] < threshold)
-                        {
-                            vis[nidx] = 1;
-                            stack[sp++] = nidx;
-                        }
-                        else
-                        {
-                            vis[nidx] = 1; // mark background too so we skip later (optional)
-                        }
-                    }
-                }
-                if (area >= minArea && area <= maxArea)
-                {
-                    Blob b;
-                    b.area = area;
-                    b.minx = minx;
-                    b.miny = miny;
-                    b.maxx = maxx;
-                    b.maxy = maxy;
-                    blobs.push_back(b);
-                }
-            }
-            else
-            {
-                vis[idx] = 1; // background
-            }
-        }
-    }
-    free(stack);
-    free(vis);
-    return blobs;
+// Pemisahan objek bersentuhan untuk blob di atas g_maxArea
+#include "blob_split.h"
+
+// Threshold otomatis (Otsu / adaptif integral image)
+#include "auto_threshold.h"
+
+#define MAX_BLOBS 256
+#define RLE_MAX_RUNS 4096
+
+// Pipeline counting kontinu di core 1 (capture -> convert -> label -> publish)
+#include "count_pipeline.h"
+static CountResult g_result; // salinan hasil terakhir untuk handler /count
+
+// Respons JSON streaming dengan buffer tetap (ChunkWriter / JsonWriter)
+#include "json_writer.h"
+
+// Push hasil counting biner ke klien WebSocket /ws
+#include "ws_push.h"
+
+// Sink ChunkWriter: setiap flush dikirim sebagai satu HTTP chunk
+static bool httpdChunkSink(void *ctx, const char *data, size_t len)
+{
+    return httpd_resp_send_chunk((httpd_req_t *)ctx, data, len) == ESP_OK;
 }
 
 // Serve main HTML UI (futuristic, lightweight)
@@ -206,18 +130,47 @@ const char index_html[] PROGMEM = R"rawliteral(
           <button onclick="doCount()">Count</button>
           <button onclick="save()">Save Snapshot</button>
         </div>
+        <div style="display:flex;gap:8px;margin-top:8px;align-items:center">
+          <label>Profile:</label>
+          <select id="profile" onchange="setProfile(this.value)"></select>
+        </div>
       </div>
       <div class="controls">
         <label>Threshold: <span id="thVal">70</span></label>
         <input id="th" type="range" min="10" max="250" value="70" oninput="document.getElementById('thVal').innerText=this.value">
+        <label>Threshold Mode:</label>
+        <select id="thMode">
+          <option value="manual">Manual</option>
+          <option value="otsu">Otomatis (Otsu)</option>
+          <option value="adaptive">Adaptif lokal</option>
+        </select>
         <label>Min Area (px): <span id="minVal">30</span></label>
         <input id="minA" type="range" min="1" max="1000" value="30" oninput="document.getElementById('minVal').innerText=this.value">
         <label>Max Area (px): <span id="maxVal">20000</span></label>
         <input id="maxA" type="range" min="100" max="50000" value="20000" oninput="document.getElementById('maxVal').innerText=this.value">
+        <label>Objek Bersentuhan (&gt; Max Area):</label>
+        <select id="split">
+          <option value="off">Buang</option>
+          <option value="dt">Pisahkan (distance transform)</option>
+          <option value="area">Taksir area / median</option>
+        </select>
+        <label><input id="pipe" type="checkbox" checked> Hitung kontinu (pipeline)</label>
+        <label>ROI (% frame): x / y / w / h</label>
+        <div style="display:flex;gap:4px">
+          <input id="roiX" type="number" min="0" max="95" value="0" style="width:48px">
+          <input id="roiY" type="number" min="0" max="95" value="0" style="width:48px">
+          <input id="roiW" type="number" min="5" max="100" value="100" style="width:48px">
+          <input id="roiH" type="number" min="5" max="100" value="100" style="width:48px">
+        </div>
+        <div style="display:flex;gap:8px">
+          <button onclick="setRoi()">Set ROI</button>
+          <button onclick="fetchRoi('/roi?reset=1')">Full Frame</button>
+        </div>
         <div style="margin-top:6px">
           <div class="small">Detected:</div>
           <div id="count" class="result">—</div>
           <div id="sizes" class="small"></div>
+          <div id="live" class="small">live: —</div>
         </div>
       </div>
     </div>
@@ -227,21 +180,69 @@ const char index_html[] PROGMEM = R"rawliteral(
 
 <script>
 function refresh(){ document.getElementById('snap').src = '/snapshot?ts='+Date.now(); }
+function settingsQuery(){
+  const v = id => document.getElementById(id).value;
+  const pipe = document.getElementById('pipe').checked ? 'on' : 'off';
+  return `threshold=${v('th')}&min=${v('minA')}&max=${v('maxA')}&mode=${v('thMode')}&split=${v('split')}&pipeline=${pipe}`;
+}
 async function doCount(){
-  const th = document.getElementById('th').value;
-  const minA = document.getElementById('minA').value;
-  const maxA = document.getElementById('maxA').value;
-  const res = await fetch(`/count?threshold=${th}&min=${minA}&max=${maxA}`);
+  const res = await fetch('/count?' + settingsQuery());
   const j = await res.json();
+  if (j.error) { document.getElementById('count').innerText = '—'; document.getElementById('sizes').innerText = j.error; return; }
   document.getElementById('count').innerText = j.count;
-  document.getElementById('sizes').innerText = j.sizes.join(', ');
+  document.getElementById('sizes').innerText = j.sizes.join(', ') + (j.split.merged ? ` + ${j.split.added} dari ${j.split.merged} blob gabungan` : '');
+  if (j.thresh_mode !== 'manual') document.getElementById('thVal').innerText = j.threshold + ' (' + j.thresh_mode + ')';
+}
+function showRoi(j){ ['x','y','w','h'].forEach(k => document.getElementById('roi' + k.toUpperCase()).value = j[k]); }
+async function fetchRoi(url){ const res = await fetch(url); showRoi(await res.json()); }
+function setRoi(){
+  const v = k => document.getElementById('roi' + k).value;
+  fetchRoi(`/roi?x=${v('X')}&y=${v('Y')}&w=${v('W')}&h=${v('H')}`);
 }
 async function save(){
   const res = await fetch('/save_snapshot');
   const j = await res.json();
   alert(j.message);
 }
+// Profil kamera: count (RGB565, pipeline jalan) atau JPEG untuk snapshot
+function showProfile(j){
+  const sel = document.getElementById('profile');
+  sel.innerHTML = j.profiles.map(p => `<option>${p}</option>`).join('');
+  sel.value = j.profile;
+}
+async function setProfile(name){
+  const res = await fetch('/camera_profile?name=' + name);
+  const j = await res.json();
+  showProfile(j);
+  document.getElementById('sizes').innerText = j.success ? `profile ${j.profile}: ${j.switch_ms} ms${j.reinit ? ' (re-init)' : ''}` : 'profile switch failed';
+  refresh();
+}
+// Hasil live lewat WebSocket /ws (frame biner dari ws_push.h), /count tetap untuk detail ukuran
+let ws = null;
+function sendSettings(){ if (ws && ws.readyState === WebSocket.OPEN) ws.send(settingsQuery()); }
+function showLive(buf){
+  const d = new DataView(buf);
+  if (d.getUint8(0) !== 1) return;
+  const modes = ['manual', 'otsu', 'adaptive'];
+  const count = d.getUint16(8, true), added = d.getUint16(10, true), boxes = d.getUint16(22, true);
+  document.getElementById('count').innerText = count;
+  document.getElementById('live').innerText = `live: frame #${d.getUint32(4, true)}, ${boxes} kotak` +
+    (added ? `, +${added} pecahan` : '') + `, ${d.getUint16(20, true)} ms`;
+  const mode = d.getUint8(1);
+  if (mode !== 0) document.getElementById('thVal').innerText = d.getUint8(2) + ' (' + modes[mode] + ')';
+}
+function connectWs(){
+  ws = new WebSocket('ws://' + location.host + '/ws');
+  ws.binaryType = 'arraybuffer';
+  ws.onopen = sendSettings;
+  ws.onmessage = e => { if (e.data instanceof ArrayBuffer) showLive(e.data); };
+  ws.onclose = () => { document.getElementById('live').innerText = 'live: terputus'; setTimeout(connectWs, 2000); };
+}
+['th', 'thMode', 'minA', 'maxA', 'split', 'pipe'].forEach(id => document.getElementById(id).addEventListener('change', sendSettings));
+connectWs();
 setInterval(refresh, 4000);
+fetchRoi('/roi');
+fetch('/camera_profile').then(r => r.json()).then(showProfile);
 </script>
 </body>
 </html>
@@ -252,7 +253,7 @@ bool initCamera()
 {
     Serial.println("🔧 Initializing camera with verified pin mapping...");
 
-    camera_config_t config;
+    camera_config_t config = {};
     config.ledc_channel = LEDC_CHANNEL_0;
     config.ledc_timer = LEDC_TIMER_0;
     config.pin_d0 = Y2_GPIO_NUM;         // GPIO 11
@@ -273,17 +274,14 @@ bool initCamera()
     config.pin_reset = RESET_GPIO_NUM;   // -1 (not used)
 
     config.xclk_freq_hz = 20000000;
-    config.pixel_format = PROC_PIXELFORMAT; // RGB565
-    config.frame_size = PROC_FRAMESIZE;     // QQVGA 160x120
-    config.jpeg_quality = 12;
-    config.fb_count = 1;
+    config.fb_count = 2;                   // capture frame berikutnya saat frame ini diproses
+    config.fb_location = psramFound() ? CAMERA_FB_IN_PSRAM : CAMERA_FB_IN_DRAM;
+    config.grab_mode = CAMERA_GRAB_LATEST; // pipeline selalu ambil frame terbaru
 
-    esp_err_t err = esp_camera_init(&config);
-    if (err != ESP_OK)
-    {
-        Serial.printf("❌ Camera init failed with error 0x%x\n", err);
+    // Format & ukuran dari profil "count" (RGB565 QQVGA);
+    // /camera_profile bisa pindah ke JPEG untuk snapshot tanpa reflash
+    if (!cameraInitProfile(config, CAM_PROFILE_COUNT, NULL))
         return false;
-    }
 
     Serial.println("✅ Camera initialized successfully!");
     return true;
@@ -356,12 +354,26 @@ static esp_err_t index_handler(httpd_req_t *req)
 
 static esp_err_t snapshot_handler(httpd_req_t *req)
 {
-    camera_fb_t *fb = esp_camera_fb_get();
+    int64_t t0 = esp_timer_get_time();
+    camera_fb_t *fb = camFbGet();
     if (!fb)
     {
         httpd_resp_send_500(req);
         return ESP_FAIL;
     }
+    metricObserveSince(STAGE_FB_GET, t0);
+
+    if (fb->format == PIXFORMAT_JPEG)
+    {
+        // Profil stream / capture_hires: frame sudah JPEG, kirim apa adanya
+        httpd_resp_set_type(req, "image/jpeg");
+        httpd_resp_set_hdr(req, "Content-Disposition", "inline; filename=snapshot.jpg");
+        t0 = esp_timer_get_time();
+        esp_err_t err = httpd_resp_send(req, (const char *)fb->buf, fb->len);
+        camFbReturn(fb);
+        metricObserveSince(STAGE_SEND, t0);
+        return err;
+    }
 
     int w = fb->width;
     int h = fb->height;
@@ -393,6 +405,7 @@ static esp_err_t snapshot_handler(httpd_req_t *req)
     bmpHeader[26] = 1;
     bmpHeader[28] = 24;
 
+    t0 = esp_timer_get_time();
     httpd_resp_send_chunk(req, (const char *)bmpHeader, 54);
 
     // pixel data
@@ -421,73 +434,244 @@ static esp_err_t snapshot_handler(httpd_req_t *req)
     }
 
     httpd_resp_send_chunk(req, NULL, 0);
-    esp_camera_fb_return(fb);
+    camFbReturn(fb);
+    metricObserveSince(STAGE_SEND, t0); // konversi BMP + kirim seluruh body
     return ESP_OK;
 }
 
+// Setting counting dari query string, dipakai /count dan pesan teks /ws
+static void applyCountSettings(const char *query)
+{
+    char param[32];
+    if (httpd_query_key_value(query, "threshold", param, sizeof(param)) == ESP_OK)
+        g_threshold = atoi(param);
+    if (httpd_query_key_value(query, "min", param, sizeof(param)) == ESP_OK)
+        g_minArea = atoi(param);
+    if (httpd_query_key_value(query, "max", param, sizeof(param)) == ESP_OK)
+        g_maxArea = atoi(param);
+    if (httpd_query_key_value(query, "mode", param, sizeof(param)) == ESP_OK)
+        g_threshMode = threshModeFromName(param);
+    if (httpd_query_key_value(query, "radius", param, sizeof(param)) == ESP_OK)
+        g_adaptRadius = atoi(param);
+    if (httpd_query_key_value(query, "offset", param, sizeof(param)) == ESP_OK)
+        g_adaptOffset = atoi(param);
+    if (httpd_query_key_value(query, "split", param, sizeof(param)) == ESP_OK)
+        g_splitMode = splitModeFromName(param);
+    // pipeline=off menghentikan capture; /count dan /ws tetap memberi hasil terakhir
+    if (httpd_query_key_value(query, "pipeline", param, sizeof(param)) == ESP_OK)
+        g_pipelineEnabled = strcmp(param, "off") != 0 && strcmp(param, "0") != 0;
+}
+
 static esp_err_t count_handler(httpd_req_t *req)
 {
     char query[200];
     if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK)
-    {
-        char param[32];
-        if (httpd_query_key_value(query, "threshold", param, sizeof(param)) == ESP_OK)
-            g_threshold = atoi(param);
-        if (httpd_query_key_value(query, "min", param, sizeof(param)) == ESP_OK)
-            g_minArea = atoi(param);
-        if (httpd_query_key_value(query, "max", param, sizeof(param)) == ESP_OK)
-            g_maxArea = atoi(param);
-    }
+        applyCountSettings(query);
 
-    camera_fb_t *fb = esp_camera_fb_get();
-    if (!fb)
+    // Hanya baca hasil terakhir dari pipeline, tidak ada capture di task httpd
+    if (!pipelineReadLatest(g_result))
     {
-        httpd_resp_send_500(req);
-        return ESP_FAIL;
+        const char *resp = "{\"error\":\"no frame processed yet\"}";
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        httpd_resp_set_type(req, "application/json");
+        httpd_resp_send(req, resp, strlen(resp));
+        return ESP_OK;
     }
 
-    int w = fb->width;
-    int h = fb->height;
-    uint8_t *gray = (uint8_t *)malloc(w * h);
-    if (!gray)
+    char buf[512];
+    httpd_resp_set_type(req, "application/json");
+    ChunkWriter out(buf, sizeof(buf), httpdChunkSink, req);
+    JsonWriter json(out);
+    json.beginObject();
+    json.field("count", g_result.count);
+    json.key("sizes");
+    json.beginArray();
+    for (int i = 0; i < g_result.stored; i++)
+        json.value(g_result.blobs[i].area);
+    json.endArray();
+    json.field("w", g_result.w);
+    json.field("h", g_result.h);
+    json.key("roi");
+    json.beginArray();
+    json.value(g_result.offX);
+    json.value(g_result.offY);
+    json.value(g_result.w);
+    json.value(g_result.h);
+    json.endArray();
+    json.field("threshold", g_result.threshold);
+    json.field("thresh_mode", threshModeName(g_result.threshMode));
+    json.key("split");
+    json.beginObject();
+    json.field("mode", splitModeName(g_splitMode));
+    json.field("merged", g_result.split.merged);
+    json.field("added", g_result.split.added);
+    json.field("median_area", g_result.split.medianArea);
+    json.endObject();
+    json.field("frame", g_result.seq);
+    json.field("latency_ms", g_result.frameUs / 1000.0, 1);
+    json.field("age_ms", millis() - g_result.timestampMs);
+    json.field("dropped", pipeDroppedFrames);
+    json.field("pipeline", (bool)g_pipelineEnabled);
+    json.endObject();
+    out.finish();
+    httpd_resp_send_chunk(req, NULL, 0);
+    return ESP_OK;
+}
+
+// WebSocket /ws: handshake mendaftarkan klien ke ws_push.h, pesan teks dari klien
+// adalah setting berformat query /count. Hasil dikirim oleh task ws_push, bukan di sini.
+static esp_err_t ws_handler(httpd_req_t *req)
+{
+    if (req->method == HTTP_GET)
     {
-        esp_camera_fb_return(fb);
-        httpd_resp_send_500(req);
-        return ESP_FAIL;
+        if (!wsAddClient(httpd_req_to_sockfd(req)))
+        {
+            Serial.println("⚠️  WebSocket penuh, klien ditolak");
+            return ESP_FAIL;
+        }
+        Serial.printf("🔌 WebSocket tersambung (%d klien)\n", wsClientCount.load());
+        return ESP_OK;
     }
 
-    uint8_t *buf = fb->buf;
-    for (int y = 0; y < h; y++)
+    char query[200];
+    httpd_ws_frame_t frame = {};
+    esp_err_t err = httpd_ws_recv_frame(req, &frame, 0); // panjang payload saja
+    if (err != ESP_OK)
+        return err;
+    if (frame.len >= sizeof(query))
+        return ESP_ERR_INVALID_SIZE;
+    frame.payload = (uint8_t *)query;
+    err = httpd_ws_recv_frame(req, &frame, frame.len);
+    if (err != ESP_OK)
+        return err;
+    query[frame.len] = '\0';
+    if (frame.type == HTTPD_WS_TYPE_TEXT)
+        applyCountSettings(query);
+    return ESP_OK;
+}
+
+// /roi?x=&y=&w=&h= (persen) mengubah dan menyimpan ROI, /roi?reset=1 kembali ke full frame
+static esp_err_t roi_handler(httpd_req_t *req)
+{
+    char query[100];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK)
     {
-        for (int x = 0; x < w; x++)
+        char px[8], py[8], pw[8], ph[8];
+        if (httpd_query_key_value(query, "reset", px, sizeof(px)) == ESP_OK)
         {
-            int i = y * w + x;
-            int idx = i * 2;
-            uint16_t px = buf[idx] | (buf[idx + 1] << 8);
-            gray[i] = rgb565_to_gray(px);
+            roiCurrent = {0, 0, 100, 100};
+            roiSave();
+        }
+        else if (httpd_query_key_value(query, "x", px, sizeof(px)) == ESP_OK &&
+                 httpd_query_key_value(query, "y", py, sizeof(py)) == ESP_OK &&
+                 httpd_query_key_value(query, "w", pw, sizeof(pw)) == ESP_OK &&
+                 httpd_query_key_value(query, "h", ph, sizeof(ph)) == ESP_OK)
+        {
+            CountRoi r;
+            r.x = constrain(atoi(px), 0, 100);
+            r.y = constrain(atoi(py), 0, 100);
+            r.w = constrain(atoi(pw), 0, 100);
+            r.h = constrain(atoi(ph), 0, 100);
+            roiSanitize(r);
+            roiCurrent = r;
+            roiSave();
+            Serial.printf("🎯 ROI: x=%d%% y=%d%% w=%d%% h=%d%%\n", r.x, r.y, r.w, r.h);
         }
     }
 
-    std::vector<Blob> blobs = detect_blobs(gray, w, h, g_threshold, g_minArea, g_maxArea);
+    char json[64];
+    snprintf(json, sizeof(json), "{\"x\":%d,\"y\":%d,\"w\":%d,\"h\":%d}",
+             roiCurrent.x, roiCurrent.y, roiCurrent.w, roiCurrent.h);
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send(req, json, strlen(json));
+    return ESP_OK;
+}
 
-    String json = "{";
-    json += "\"count\":" + String((int)blobs.size()) + ",";
-    json += "\"sizes\":[";
-    for (size_t i = 0; i < blobs.size(); i++)
+static esp_err_t send_saved_response(httpd_req_t *req, const String &fn)
+{
+    char buf[128];
+    httpd_resp_set_type(req, "application/json");
+    ChunkWriter out(buf, sizeof(buf), httpdChunkSink, req);
+    JsonWriter json(out);
+    json.beginObject();
+    json.field("message", ("saved as " + fn).c_str());
+    json.endObject();
+    out.finish();
+    httpd_resp_send_chunk(req, NULL, 0);
+    return ESP_OK;
+}
+
+// /camera_profile?name=stream|count|capture_hires mengganti profil; tanpa name hanya status
+static esp_err_t camera_profile_handler(httpd_req_t *req)
+{
+    char query[64];
+    char name[24];
+    bool ok = true;
+    bool switched = false;
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+        httpd_query_key_value(query, "name", name, sizeof(name)) == ESP_OK)
     {
-        json += String(blobs[i].area);
-        if (i + 1 < blobs.size())
-            json += ",";
+        int id = cameraProfileFind(name);
+        if (id < 0)
+        {
+            const char *resp = "{\"success\":false,\"error\":\"unknown profile\"}";
+            httpd_resp_set_status(req, "400 Bad Request");
+            httpd_resp_set_type(req, "application/json");
+            httpd_resp_send(req, resp, strlen(resp));
+            return ESP_OK;
+        }
+        ok = cameraSetProfile(id);
+        switched = true;
     }
-    json += "],";
-    json += "\"w\":" + String(w) + ",\"h\":" + String(h);
-    json += "}";
-
-    free(gray);
-    esp_camera_fb_return(fb);
 
+    char buf[384];
+    if (!ok)
+        httpd_resp_set_status(req, "503 Service Unavailable");
     httpd_resp_set_type(req, "application/json");
-    httpd_resp_send(req, json.c_str(), json.length());
+    ChunkWriter out(buf, sizeof(buf), httpdChunkSink, req);
+    JsonWriter json(out);
+    json.beginObject();
+    json.field("success", ok);
+    json.field("profile", cameraProfileName());
+    if (switched)
+    {
+        json.field("reinit", (bool)camLastSwitchReinit);
+        json.field("switch_ms", camLastSwitchUs / 1000.0, 1);
+    }
+    json.key("profiles");
+    json.beginArray();
+    for (int i = 0; i < CAM_PROFILE_NUM; i++)
+        json.value(cameraProfiles[i].name);
+    json.endArray();
+    json.endObject();
+    out.finish();
+    httpd_resp_send_chunk(req, NULL, 0);
+    return ESP_OK;
+}
+
+// Metrik Prometheus: latensi tiap tahap pipeline, frame drop, heap/PSRAM
+static esp_err_t metrics_handler(httpd_req_t *req)
+{
+    char buf[512];
+    httpd_resp_set_type(req, METRICS_CONTENT_TYPE);
+    ChunkWriter out(buf, sizeof(buf), httpdChunkSink, req);
+    bool haveFrame = pipelineReadLatest(g_result);
+    metricsWriteCommon(out);
+    metricsCounter(out, "camera_frames_processed_total", "Frames counted by the pipeline", haveFrame ? g_result.seq : 0);
+    metricsHeader(out, "camera_frames_dropped_total", "counter", "Frames dropped before counting");
+    out.printf("camera_frames_dropped_total{reason=\"pipeline\"} %u\n", (unsigned)pipeDroppedFrames);
+    metricsGauge(out, "camera_pipeline_enabled", "1 if continuous counting is running", g_pipelineEnabled ? 1 : 0);
+    if (haveFrame)
+        metricsGauge(out, "camera_count_latency_seconds", "Capture to publish latency of the last frame", g_result.frameUs / 1e6);
+    metricsHeader(out, "camera_frame_arena_bytes", "gauge", "Boot-time image buffer arena");
+    out.printf("camera_frame_arena_bytes{state=\"capacity\"} %u\n", (unsigned)arenaCap);
+    out.printf("camera_frame_arena_bytes{state=\"used\"} %u\n", (unsigned)arenaUsed);
+    metricsCounter(out, "camera_frame_arena_alloc_failures_total", "Image buffer requests that did not fit the arena", arenaFailures);
+    metricsGauge(out, "camera_ws_clients", "Connected /ws result push clients", wsClientCount.load());
+    metricsCounter(out, "camera_ws_frames_sent_total", "Binary result frames pushed over /ws", wsFramesSent);
+    cameraProfileWriteMetrics(out);
+    out.finish();
+    httpd_resp_send_chunk(req, NULL, 0);
     return ESP_OK;
 }
 
@@ -501,7 +685,7 @@ static esp_err_t save_snapshot_handler(httpd_req_t *req)
         return ESP_FAIL;
     }
 
-    camera_fb_t *fb = esp_camera_fb_get();
+    camera_fb_t *fb = camFbGet();
     if (!fb)
     {
         const char *resp = "{\"error\":\"camera capture failed\"}";
@@ -511,17 +695,28 @@ static esp_err_t save_snapshot_handler(httpd_req_t *req)
     }
 
     int w = fb->width, h = fb->height;
-    String fn = "/snapshot_" + String(millis()) + ".bmp";
+    bool isJpeg = fb->format == PIXFORMAT_JPEG;
+    String fn = "/snapshot_" + String(millis()) + (isJpeg ? ".jpg" : ".bmp");
     File f = SD_MMC.open(fn, FILE_WRITE);
     if (!f)
     {
-        esp_camera_fb_return(fb);
+        camFbReturn(fb);
         const char *resp = "{\"error\":\"SD open failed\"}";
         httpd_resp_set_type(req, "application/json");
         httpd_resp_send(req, resp, strlen(resp));
         return ESP_FAIL;
     }
 
+    int64_t t0 = esp_timer_get_time();
+    if (isJpeg)
+    {
+        f.write(fb->buf, fb->len);
+        f.close();
+        camFbReturn(fb);
+        metricObserveSince(STAGE_SD_WRITE, t0);
+        return send_saved_response(req, fn);
+    }
+
     int rowSize = ((w * 3 + 3) / 4) * 4;
     int imgSize = rowSize * h;
     int fileSize = 54 + imgSize;
@@ -572,23 +767,25 @@ static esp_err_t save_snapshot_handler(httpd_req_t *req)
     }
 
     f.close();
-    esp_camera_fb_return(fb);
-
-    String resp = "{\"message\":\"saved as " + fn + "\"}";
-    httpd_resp_set_type(req, "application/json");
-    httpd_resp_send(req, resp.c_str(), resp.length());
-    return ESP_OK;
+    camFbReturn(fb);
+    metricObserveSince(STAGE_SD_WRITE, t0);
+    return send_saved_response(req, fn);
 }
 
 void startCameraServer()
 {
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
     config.server_port = 80;
+    config.max_uri_handlers = 10;
 
     httpd_uri_t index_uri = {.uri = "/", .method = HTTP_GET, .handler = index_handler, .user_ctx = NULL};
     httpd_uri_t snapshot_uri = {.uri = "/snapshot", .method = HTTP_GET, .handler = snapshot_handler, .user_ctx = NULL};
     httpd_uri_t count_uri = {.uri = "/count", .method = HTTP_GET, .handler = count_handler, .user_ctx = NULL};
     httpd_uri_t save_uri = {.uri = "/save_snapshot", .method = HTTP_GET, .handler = save_snapshot_handler, .user_ctx = NULL};
+    httpd_uri_t roi_uri = {.uri = "/roi", .method = HTTP_GET, .handler = roi_handler, .user_ctx = NULL};
+    httpd_uri_t metrics_uri = {.uri = "/metrics", .method = HTTP_GET, .handler = metrics_handler, .user_ctx = NULL};
+    httpd_uri_t profile_uri = {.uri = "/camera_profile", .method = HTTP_GET, .handler = camera_profile_handler, .user_ctx = NULL};
+    httpd_uri_t ws_uri = {.uri = "/ws", .method = HTTP_GET, .handler = ws_handler, .user_ctx = NULL, .is_websocket = true};
 
     if (httpd_start(&camera_httpd, &config) == ESP_OK)
     {
@@ -596,7 +793,13 @@ void startCameraServer()
         httpd_register_uri_handler(camera_httpd, &snapshot_uri);
         httpd_register_uri_handler(camera_httpd, &count_uri);
         httpd_register_uri_handler(camera_httpd, &save_uri);
+        httpd_register_uri_handler(camera_httpd, &roi_uri);
+        httpd_register_uri_handler(camera_httpd, &metrics_uri);
+        httpd_register_uri_handler(camera_httpd, &profile_uri);
+        httpd_register_uri_handler(camera_httpd, &ws_uri);
         Serial.println("✅ Web server started successfully!");
+        if (!startWsPush(camera_httpd))
+            Serial.println("⚠️  WebSocket push task failed to start");
     }
     else
     {
@@ -625,12 +828,55 @@ void setup()
         Serial.println("⚠️  WiFi AP failed, but continuing with camera init...");
     }
 
+    // ROI tersimpan dari sesi sebelumnya
+    if (roiLoad())
+    {
+        Serial.printf("🎯 ROI dimuat: x=%d%% y=%d%% w=%d%% h=%d%%\n", roiCurrent.x, roiCurrent.y, roiCurrent.w, roiCurrent.h);
+    }
+
+    // Semua buffer gambar dari satu arena seukuran frame profil count, dialokasikan
+    // sekali di sini: setelah setup() tidak ada malloc/free di jalur counting
+    const resolution_info_t &countRes = resolution[camProfileSize(cameraProfiles[CAM_PROFILE_COUNT])];
+    int countW = countRes.width, countH = countRes.height;
+    size_t arenaBytes = blobRleArenaBytes(RLE_MAX_RUNS) + adaptiveThresholdArenaBytes(countW, countH) +
+                        blobSplitArenaBytes(countW, countH) + countPipelineArenaBytes(countW, countH);
+    if (frameArenaBegin(arenaBytes))
+    {
+        Serial.printf("🧱 Frame arena: %u bytes untuk %dx%d\n", (unsigned)arenaBytes, countW, countH);
+    }
+    else
+    {
+        Serial.println("⚠️  Frame arena allocation failed, buffers fall back to heap");
+    }
+
+    // Run-length blob detector, dialokasikan sekali sebelum pipeline jalan
+    if (!blobRleInit(RLE_MAX_RUNS))
+    {
+        Serial.println("⚠️  Blob detector buffer allocation failed");
+    }
+
+    // Integral image untuk threshold adaptif
+    if (!adaptiveThresholdInit(countW, countH))
+    {
+        Serial.println("⚠️  Adaptive threshold buffer allocation failed, fallback ke Otsu");
+    }
+
+    // Buffer distance transform untuk blob gabungan sebesar seluruh frame count
+    if (!blobSplitInit(countW, countH))
+    {
+        Serial.println("⚠️  Blob split buffer allocation failed, split=dt fallback ke area/median");
+    }
+
     // Step 2: Initialize camera
     delay(1000);
     if (!initCamera())
     {
         Serial.println("⚠️  Camera init failed, continuing with web server only...");
     }
+    else if (!startCountPipeline(countW, countH))
+    {
+        Serial.println("⚠️  Counting pipeline failed to start");
+    }
 
     // Step 3: Start web server
     Serial.println("🌐 Starting web server...");
@@ -0,0 +1,162 @@
+// auto_threshold.h - Threshold otomatis
+// Otsu: histogram 256 bin diisi oleh pass konversi gray yang sudah ada, lalu
+// threshold dicari dalam O(256). Adaptif: mean lokal jendela (2r+1)^2 dari
+// integral image, sehingga biaya per piksel konstan berapa pun radiusnya.
+#ifndef AUTO_THRESHOLD_H
+#define AUTO_THRESHOLD_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "frame_arena.h"
+
+#define THRESH_MANUAL 0
+#define THRESH_OTSU 1
+#define THRESH_ADAPTIVE 2
+
+#define ADAPTIVE_MAX_RADIUS 64 // (2r+1)^2 * 255 * 200 masih muat uint32_t
+
+static const char *threshModeName(int mode)
+{
+    switch (mode)
+    {
+    case THRESH_OTSU:
+        return "otsu";
+    case THRESH_ADAPTIVE:
+        return "adaptive";
+    default:
+        return "manual";
+    }
+}
+
+static int threshModeFromName(const char *name)
+{
+    if (strcmp(name, "otsu") == 0)
+        return THRESH_OTSU;
+    if (strcmp(name, "adaptive") == 0)
+        return THRESH_ADAPTIVE;
+    return THRESH_MANUAL;
+}
+
+// Threshold Otsu: kelas gelap = gray <= t, kelas terang = gray > t.
+// Return -1 jika histogram kosong atau hanya berisi satu nilai.
+static int otsuThreshold(const uint32_t *hist)
+{
+    uint32_t total = 0;
+    uint64_t sumAll = 0;
+    for (int i = 0; i < 256; i++)
+    {
+        total += hist[i];
+        sumAll += (uint64_t)i * hist[i];
+    }
+    if (total == 0)
+        return -1;
+
+    uint32_t w0 = 0;
+    uint64_t sum0 = 0;
+    float bestVar = -1.0f;
+    int best = -1;
+    for (int t = 0; t < 255; t++)
+    {
+        w0 += hist[t];
+        if (w0 == 0)
+            continue;
+        uint32_t w1 = total - w0;
+        if (w1 == 0)
+            break;
+        sum0 += (uint64_t)t * hist[t];
+        float m0 = (float)sum0 / w0;
+        float m1 = (float)(sumAll - sum0) / w1;
+        float d = m0 - m1;
+        float var = (float)w0 * (float)w1 * d * d;
+        if (var > bestVar)
+        {
+            bestVar = var;
+            best = t;
+        }
+    }
+    return best;
+}
+
+static uint32_t *adaptIntegral = nullptr; // (w+1) x (h+1)
+static int adaptMaxPixels = 0;
+
+size_t adaptiveThresholdArenaBytes(int maxW, int maxH)
+{
+    return FRAME_ARENA_ROUND(sizeof(uint32_t) * (maxW + 1) * (maxH + 1));
+}
+
+bool adaptiveThresholdInit(int maxW, int maxH)
+{
+    if (adaptIntegral)
+        return true;
+    adaptMaxPixels = (maxW + 1) * (maxH + 1);
+    adaptIntegral = (uint32_t *)frameArenaAlloc(sizeof(uint32_t) * adaptMaxPixels);
+    if (!adaptIntegral)
+    {
+        adaptMaxPixels = 0;
+        return false;
+    }
+    return true;
+}
+
+// mask[i] = fgValue jika piksel lebih gelap (darkFg) / lebih terang dari mean
+// lokal sebesar offsetPct persen, selain itu 0. mask boleh sama dengan gray
+// (in-place), karena integral image sudah selesai dibangun sebelum ditulis.
+// Return false jika buffer integral belum dialokasikan / terlalu kecil.
+static bool adaptiveThresholdMask(const uint8_t *gray, int w, int h, int radius, int offsetPct,
+                                  bool darkFg, uint8_t *mask, uint8_t fgValue)
+{
+    const int stride = w + 1;
+    if (!adaptIntegral || stride * (h + 1) > adaptMaxPixels)
+        return false;
+    if (radius < 1)
+        radius = 1;
+    if (radius > ADAPTIVE_MAX_RADIUS)
+        radius = ADAPTIVE_MAX_RADIUS;
+    if (offsetPct < 0)
+        offsetPct = 0;
+    if (offsetPct > 99)
+        offsetPct = 99;
+
+    uint32_t *I = adaptIntegral;
+    memset(I, 0, sizeof(uint32_t) * stride);
+    for (int y = 0; y < h; y++)
+    {
+        const uint8_t *row = gray + y * w;
+        uint32_t *cur = I + (y + 1) * stride;
+        const uint32_t *up = cur - stride;
+        uint32_t rowSum = 0;
+        cur[0] = 0;
+        for (int x = 0; x < w; x++)
+        {
+            rowSum += row[x];
+            cur[x + 1] = up[x + 1] + rowSum;
+        }
+    }
+
+    const uint32_t scale = darkFg ? 100 - offsetPct : 100 + offsetPct;
+    for (int y = 0; y < h; y++)
+    {
+        int y0 = y - radius < 0 ? 0 : y - radius;
+        int y1 = y + radius + 1 > h ? h : y + radius + 1;
+        const uint32_t *top = I + y0 * stride;
+        const uint32_t *bot = I + y1 * stride;
+        const uint8_t *row = gray + y * w;
+        uint8_t *out = mask + y * w;
+        for (int x = 0; x < w; x++)
+        {
+            int x0 = x - radius < 0 ? 0 : x - radius;
+            int x1 = x + radius + 1 > w ? w : x + radius + 1;
+            uint32_t area = (uint32_t)(x1 - x0) * (y1 - y0);
+            uint32_t sum = bot[x1] - bot[x0] - top[x1] + top[x0];
+            uint32_t v = (uint32_t)row[x] * area * 100;
+            bool fg = darkFg ? v < sum * scale : v > sum * scale;
+            out[x] = fg ? fgValue : 0;
+        }
+    }
+    return true;
+}
+
+#endif
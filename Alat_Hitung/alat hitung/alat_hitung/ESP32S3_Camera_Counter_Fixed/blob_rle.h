@@ -0,0 +1,208 @@
+// blob_rle.h - Run-length blob detector
+// Setiap baris dipecah menjadi run foreground [x0..x1], run yang overlap dengan
+// run baris sebelumnya digabung lewat union-find atas ID run. Memori kerja
+// sebanding jumlah run, bukan jumlah piksel, dan dialokasikan sekali di init.
+#ifndef BLOB_RLE_H
+#define BLOB_RLE_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "frame_arena.h"
+
+struct Blob
+{
+    int area;
+    int minx, miny, maxx, maxy;
+};
+
+struct BlobRun
+{
+    uint16_t x0, x1, y;
+};
+
+struct BlobRunStats
+{
+    int32_t area;
+    uint16_t minx, miny, maxx, maxy;
+};
+
+static BlobRun *rleRuns = nullptr;
+static uint16_t *rleParent = nullptr;
+static BlobRunStats *rleStats = nullptr;
+static int rleMaxRuns = 0;
+static bool rleOverflow = false; // true jika run habis pada frame terakhir
+static int rleRunCount = 0;      // run frame terakhir, dibaca blob_split.h
+
+size_t blobRleArenaBytes(int maxRuns)
+{
+    return FRAME_ARENA_ROUND(sizeof(BlobRun) * maxRuns) + FRAME_ARENA_ROUND(sizeof(uint16_t) * maxRuns) +
+           FRAME_ARENA_ROUND(sizeof(BlobRunStats) * maxRuns);
+}
+
+// maxRuns maksimal 65535 (ID run disimpan sebagai uint16_t)
+bool blobRleInit(int maxRuns)
+{
+    if (rleRuns)
+        return true;
+    if (maxRuns > 65535)
+        maxRuns = 65535;
+    rleRuns = (BlobRun *)frameArenaAlloc(sizeof(BlobRun) * maxRuns);
+    rleParent = (uint16_t *)frameArenaAlloc(sizeof(uint16_t) * maxRuns);
+    rleStats = (BlobRunStats *)frameArenaAlloc(sizeof(BlobRunStats) * maxRuns);
+    if (!rleRuns || !rleParent || !rleStats)
+    {
+        frameArenaFree(rleRuns);
+        frameArenaFree(rleParent);
+        frameArenaFree(rleStats);
+        rleRuns = nullptr;
+        rleParent = nullptr;
+        rleStats = nullptr;
+        return false;
+    }
+    rleMaxRuns = maxRuns;
+    return true;
+}
+
+static inline uint16_t rleFind(uint16_t i)
+{
+    while (rleParent[i] != i)
+    {
+        rleParent[i] = rleParent[rleParent[i]];
+        i = rleParent[i];
+    }
+    return i;
+}
+
+static inline void rleUnion(uint16_t a, uint16_t b)
+{
+    a = rleFind(a);
+    b = rleFind(b);
+    if (a == b)
+        return;
+    if (a < b)
+        rleParent[b] = a;
+    else
+        rleParent[a] = b;
+}
+
+// Inti detektor: isFg(row, x) menentukan piksel foreground, konektivitas 4 arah.
+// Blob dengan minArea <= area <= maxArea ditulis ke out (maks maxOut).
+// Return jumlah blob yang lolos filter (bisa > maxOut), -1 jika belum init.
+template <typename IsFg>
+static int blobRleDetect(const uint8_t *img, int w, int h, IsFg isFg, int minArea, int maxArea,
+                         Blob *out, int maxOut)
+{
+    if (!rleRuns)
+        return -1;
+
+    int nRuns = 0;
+    int prevStart = 0, prevEnd = 0; // run baris sebelumnya: [prevStart, prevEnd)
+    rleOverflow = false;
+
+    for (int y = 0; y < h && !rleOverflow; y++)
+    {
+        const uint8_t *row = img + y * w;
+        int curStart = nRuns;
+        int x = 0;
+        while (x < w)
+        {
+            while (x < w && !isFg(row, x))
+                x++;
+            if (x >= w)
+                break;
+            int x0 = x;
+            while (x < w && isFg(row, x))
+                x++;
+            if (nRuns >= rleMaxRuns)
+            {
+                rleOverflow = true;
+                break;
+            }
+            BlobRun &r = rleRuns[nRuns];
+            r.x0 = x0;
+            r.x1 = x - 1;
+            r.y = y;
+            rleParent[nRuns] = nRuns;
+            nRuns++;
+        }
+
+        // Gabungkan run yang overlap dengan baris atas (dua pointer, keduanya terurut x)
+        int p = prevStart;
+        for (int c = curStart; c < nRuns; c++)
+        {
+            const BlobRun &cr = rleRuns[c];
+            while (p < prevEnd && rleRuns[p].x1 < cr.x0)
+                p++;
+            for (int q = p; q < prevEnd && rleRuns[q].x0 <= cr.x1; q++)
+                rleUnion(q, c);
+        }
+        prevStart = curStart;
+        prevEnd = nRuns;
+    }
+    rleRunCount = nRuns;
+
+    // Akumulasi statistik ke root; root selalu punya ID lebih kecil dari anggotanya
+    for (int i = 0; i < nRuns; i++)
+    {
+        const BlobRun &r = rleRuns[i];
+        uint16_t root = rleFind(i);
+        BlobRunStats &s = rleStats[root];
+        int len = r.x1 - r.x0 + 1;
+        if (root == i)
+        {
+            s.area = len;
+            s.minx = r.x0;
+            s.maxx = r.x1;
+            s.miny = s.maxy = r.y;
+            continue;
+        }
+        s.area += len;
+        if (r.x0 < s.minx)
+            s.minx = r.x0;
+        if (r.x1 > s.maxx)
+            s.maxx = r.x1;
+        if (r.y > s.maxy)
+            s.maxy = r.y;
+    }
+
+    int count = 0;
+    for (int i = 0; i < nRuns; i++)
+    {
+        if (rleParent[i] != i)
+            continue;
+        const BlobRunStats &s = rleStats[i];
+        if (s.area < minArea || s.area > maxArea)
+            continue;
+        if (count < maxOut)
+        {
+            Blob &b = out[count];
+            b.area = s.area;
+            b.minx = s.minx;
+            b.miny = s.miny;
+            b.maxx = s.maxx;
+            b.maxy = s.maxy;
+        }
+        count++;
+    }
+    return count;
+}
+
+// Foreground = gray < threshold (objek gelap di latar terang)
+int detect_blobs(const uint8_t *gray, int w, int h, int threshold, int minArea, int maxArea,
+                 Blob *out, int maxOut)
+{
+    return blobRleDetect(gray, w, h, [threshold](const uint8_t *row, int x)
+                         { return row[x] < threshold; }, minArea, maxArea, out, maxOut);
+}
+
+// Foreground = mask != 0 (mis. output rgb565ToMask)
+int detect_blobs_mask(const uint8_t *mask, int w, int h, int minArea, int maxArea,
+                      Blob *out, int maxOut)
+{
+    return blobRleDetect(mask, w, h, [](const uint8_t *row, int x)
+                         { return row[x] != 0; }, minArea, maxArea, out, maxOut);
+}
+
+#endif
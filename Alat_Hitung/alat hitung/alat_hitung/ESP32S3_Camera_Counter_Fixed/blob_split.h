@@ -0,0 +1,273 @@
+// blob_split.h - Pisahkan blob gabungan (objek bersentuhan) di atas maxArea
+// Hanya blob yang dibuang blob_rle.h karena area > maxArea yang diproses, dan
+// hanya di dalam bounding box-nya: run milik blob digambar ulang ke buffer kerja,
+// sehingga biaya sebanding luas blob gabungan, bukan ukuran frame.
+//   SPLIT_DT   : distance transform chamfer 3-4 (dua sapuan), jumlah objek =
+//                jumlah puncak jarak yang dipisahkan lembah >= SPLIT_PEAK_DEPTH
+//                (puncak = seed watershed, region-nya sendiri tidak perlu dibentuk)
+//   SPLIT_AREA : area / median area objek tunggal di frame-frame terakhir
+// Butuh: blob_rle.h (dipanggil langsung sesudah detect_blobs*, run masih utuh)
+#ifndef BLOB_SPLIT_H
+#define BLOB_SPLIT_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+#define SPLIT_OFF 0
+#define SPLIT_DT 1
+#define SPLIT_AREA 2
+
+#define SPLIT_PEAK_DEPTH 3     // unit chamfer (3 = 1 piksel): lembah minimal antar dua puncak
+#define SPLIT_MIN_RADIUS 6     // unit chamfer: puncak dengan jari-jari < 2 piksel diabaikan
+#define SPLIT_MAX_PEAKS 64     // kandidat puncak per blob
+#define SPLIT_MEDIAN_SAMPLES 64
+#define SPLIT_VISITED 0x8000   // bit penanda BFS di splitDist (jarak maksimal jauh di bawahnya)
+#define SPLIT_INF 0x7FFF
+
+struct BlobSplitStats
+{
+    int merged;     // blob di atas maxArea yang diproses
+    int added;      // objek hasil pemecahan (sudah termasuk di count)
+    int medianArea; // median area objek tunggal yang dipakai, 0 = belum ada
+};
+
+static uint16_t *splitDist = nullptr;  // (w + 2) * (h + 2), tepi selalu 0 (background)
+static uint16_t *splitQueue = nullptr; // antrian BFS, sekaligus daftar piksel yang ditandai
+static int splitMaxPixels = 0;
+static int splitMedianArea = 0; // dihaluskan antar frame, tetap ada saat semua part bersentuhan
+
+static const char *splitModeName(int mode)
+{
+    switch (mode)
+    {
+    case SPLIT_DT:
+        return "dt";
+    case SPLIT_AREA:
+        return "area";
+    default:
+        return "off";
+    }
+}
+
+static int splitModeFromName(const char *name)
+{
+    if (strcmp(name, "dt") == 0)
+        return SPLIT_DT;
+    if (strcmp(name, "area") == 0)
+        return SPLIT_AREA;
+    return SPLIT_OFF;
+}
+
+size_t blobSplitArenaBytes(int w, int h)
+{
+    return 2 * FRAME_ARENA_ROUND(sizeof(uint16_t) * (w + 2) * (h + 2));
+}
+
+// Buffer untuk blob gabungan terbesar (bounding box = seluruh ROI w x h).
+// Indeks BFS uint16_t: (w + 2) * (h + 2) maksimal 65535.
+bool blobSplitInit(int w, int h)
+{
+    if (splitDist)
+        return true;
+    int pixels = (w + 2) * (h + 2);
+    if (pixels > 65535)
+        return false;
+    splitDist = (uint16_t *)frameArenaAlloc(sizeof(uint16_t) * pixels);
+    splitQueue = (uint16_t *)frameArenaAlloc(sizeof(uint16_t) * pixels);
+    if (!splitDist || !splitQueue)
+    {
+        frameArenaFree(splitDist);
+        frameArenaFree(splitQueue);
+        splitDist = nullptr;
+        splitQueue = nullptr;
+        return false;
+    }
+    splitMaxPixels = pixels;
+    return true;
+}
+
+// Median area dari blob tunggal frame ini (minimal 3), dihaluskan ke splitMedianArea
+static void splitUpdateMedian(const Blob *singles, int n)
+{
+    if (n < 3)
+        return;
+    if (n > SPLIT_MEDIAN_SAMPLES)
+        n = SPLIT_MEDIAN_SAMPLES;
+    int areas[SPLIT_MEDIAN_SAMPLES];
+    for (int i = 0; i < n; i++)
+        areas[i] = singles[i].area;
+    std::nth_element(areas, areas + n / 2, areas + n);
+    int med = areas[n / 2];
+    splitMedianArea = splitMedianArea ? (3 * splitMedianArea + med) / 4 : med;
+}
+
+// Distance transform chamfer 3-4 di buffer ber-padding (stride = bw + 2)
+static void splitChamfer(int bw, int bh)
+{
+    int stride = bw + 2;
+    for (int y = 1; y <= bh; y++)
+    {
+        uint16_t *d = splitDist + y * stride;
+        for (int x = 1; x <= bw; x++)
+        {
+            if (!d[x])
+                continue;
+            int v = d[x];
+            v = std::min(v, d[x - 1] + 3);
+            v = std::min(v, d[x - stride] + 3);
+            v = std::min(v, d[x - stride - 1] + 4);
+            v = std::min(v, d[x - stride + 1] + 4);
+            d[x] = v;
+        }
+    }
+    for (int y = bh; y >= 1; y--)
+    {
+        uint16_t *d = splitDist + y * stride;
+        for (int x = bw; x >= 1; x--)
+        {
+            if (!d[x])
+                continue;
+            int v = d[x];
+            v = std::min(v, d[x + 1] + 3);
+            v = std::min(v, d[x + stride] + 3);
+            v = std::min(v, d[x + stride + 1] + 4);
+            v = std::min(v, d[x + stride - 1] + 4);
+            d[x] = v;
+        }
+    }
+}
+
+// Puncak c valid jika dari c tidak ada jalan ke piksel yang lebih tinggi
+// (urutan total: jarak, lalu indeks lebih kecil) tanpa turun >= SPLIT_PEAK_DEPTH.
+// BFS dibatasi piksel dengan jarak > d(c) - depth, tanda dibersihkan sesudahnya.
+static bool splitIsPeak(int c, int stride)
+{
+    int dc = splitDist[c];
+    int floor = dc - SPLIT_PEAK_DEPTH;
+    int head = 0, tail = 0;
+    bool peak = true;
+    splitDist[c] |= SPLIT_VISITED;
+    splitQueue[tail++] = c;
+    static const int dx[8] = {-1, 1, 0, 0, -1, 1, -1, 1};
+    static const int dy[8] = {0, 0, -1, 1, -1, -1, 1, 1};
+    while (head < tail && peak)
+    {
+        int p = splitQueue[head++];
+        for (int k = 0; k < 8; k++)
+        {
+            int q = p + dx[k] + dy[k] * stride;
+            int dq = splitDist[q];
+            if ((dq & SPLIT_VISITED) || dq <= floor)
+                continue;
+            if (dq > dc || (dq == dc && q < c))
+            {
+                peak = false;
+                break;
+            }
+            splitDist[q] = dq | SPLIT_VISITED;
+            splitQueue[tail++] = q;
+        }
+    }
+    for (int i = 0; i < tail; i++)
+        splitDist[splitQueue[i]] &= ~SPLIT_VISITED;
+    return peak;
+}
+
+// Jumlah puncak jarak di blob dengan root run 'root'. -1 jika bbox tidak muat.
+static int splitCountPeaks(int root)
+{
+    const BlobRunStats &s = rleStats[root];
+    int bw = s.maxx - s.minx + 1, bh = s.maxy - s.miny + 1;
+    int stride = bw + 2;
+    if (stride * (bh + 2) > splitMaxPixels)
+        return -1;
+    memset(splitDist, 0, sizeof(uint16_t) * stride * (bh + 2));
+
+    // Run milik blob ini: root adalah run pertamanya dan run terurut per baris,
+    // jadi cukup menyapu run dari root sampai baris maxy
+    for (int i = root; i < rleRunCount && rleRuns[i].y <= s.maxy; i++)
+    {
+        if (rleFind(i) != root)
+            continue;
+        const BlobRun &r = rleRuns[i];
+        uint16_t *d = splitDist + (r.y - s.miny + 1) * stride + (r.x0 - s.minx + 1);
+        for (int x = r.x0; x <= r.x1; x++)
+            *d++ = SPLIT_INF;
+    }
+    splitChamfer(bw, bh);
+
+    // Kandidat: maksimum lokal 8 arah, plateau diwakili piksel pertamanya
+    // (lebih tinggi dari tetangga yang indeksnya lebih kecil)
+    uint16_t cand[SPLIT_MAX_PEAKS];
+    int nCand = 0;
+    for (int y = 1; y <= bh; y++)
+    {
+        for (int x = 1; x <= bw; x++)
+        {
+            int c = y * stride + x;
+            const uint16_t *d = splitDist + c;
+            int v = *d;
+            if (v < SPLIT_MIN_RADIUS)
+                continue;
+            if (v <= d[-1] || v <= d[-stride - 1] || v <= d[-stride] || v <= d[-stride + 1] ||
+                v < d[1] || v < d[stride - 1] || v < d[stride] || v < d[stride + 1])
+                continue;
+            if (nCand < SPLIT_MAX_PEAKS)
+                cand[nCand++] = c;
+            else
+            {
+                // Penuh: ganti kandidat terendah, puncak kecil paling mungkin ditolak
+                int low = 0;
+                for (int i = 1; i < nCand; i++)
+                    if (splitDist[cand[i]] < splitDist[cand[low]])
+                        low = i;
+                if (v > splitDist[cand[low]])
+                    cand[low] = c;
+            }
+        }
+    }
+
+    int peaks = 0;
+    for (int i = 0; i < nCand; i++)
+        if (splitIsPeak(cand[i], stride))
+            peaks++;
+    return peaks;
+}
+
+// Panggil langsung sesudah detect_blobs* dengan maxArea yang sama. singles = blob
+// yang lolos filter (untuk median area), frameArea = w * h frame yang dilabel.
+// Return jumlah objek dari blob gabungan.
+int blobSplitMerged(int mode, int maxArea, int frameArea, const Blob *singles, int nSingles,
+                    BlobSplitStats &st)
+{
+    st.merged = 0;
+    st.added = 0;
+    splitUpdateMedian(singles, nSingles);
+    st.medianArea = splitMedianArea;
+    if (mode == SPLIT_OFF || !rleRuns || rleOverflow)
+        return 0;
+
+    for (int i = 0; i < rleRunCount; i++)
+    {
+        if (rleParent[i] != i || rleStats[i].area <= maxArea)
+            continue;
+        int area = rleStats[i].area;
+        if (area > frameArea / 2)
+            continue; // lebih dari separuh frame: latar / bayangan / tepi tray, bukan tumpukan part
+
+        int n = -1;
+        if (mode == SPLIT_DT && splitDist)
+            n = splitCountPeaks(i);
+        if (n < 0 && splitMedianArea)
+            n = (area + splitMedianArea / 2) / splitMedianArea;
+        if (n < 0)
+            continue; // mode area tanpa median: belum bisa ditaksir
+        st.merged++;
+        st.added += n < 1 ? 1 : n;
+    }
+    return st.added;
+}
+
+#endif
@@ -0,0 +1,323 @@
+// camera_profiles.h - Profil kamera bernama yang bisa diganti saat runtime
+// Profil dengan format piksel yang sama cukup diganti lewat register sensor
+// (set_framesize / set_quality). Untuk JPEG, driver di-init sekali pada ukuran
+// JPEG terbesar sehingga buffer frame cukup untuk semua profil JPEG. Hanya
+// perubahan format piksel (JPEG <-> RGB565) yang butuh esp_camera_deinit/init;
+// sebelum itu semua frame yang dipegang task lain ditunggu kembali lewat
+// camFbGet()/camFbReturn(). Latensi ganti profil diukur sampai frame pertama
+// dengan ukuran baru keluar dari driver.
+#ifndef CAMERA_PROFILES_H
+#define CAMERA_PROFILES_H
+
+#include <atomic>
+#include "esp_camera.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "frame_arena.h"
+#include "jpeg_encoder.h"
+#include "metrics.h"
+
+#define CAM_SWITCH_TIMEOUT_MS 2000
+#define CAM_ENCODE_QUALITY 80 // jpegEncode (0-100) untuk frame non-JPEG
+
+enum CameraProfileId
+{
+    CAM_PROFILE_STREAM,        // JPEG SVGA untuk dilihat manusia
+    CAM_PROFILE_COUNT,         // RGB565 QQVGA untuk pipeline counting
+    CAM_PROFILE_CAPTURE_HIRES, // JPEG UXGA untuk foto dataset / dokumentasi
+    CAM_PROFILE_NUM
+};
+
+struct CameraProfile
+{
+    const char *name;
+    pixformat_t format;
+    framesize_t frameSize;
+    int quality; // kualitas JPEG sensor 0-63, lebih kecil = lebih bagus
+};
+
+static const CameraProfile cameraProfiles[CAM_PROFILE_NUM] = {
+    {"stream", PIXFORMAT_JPEG, FRAMESIZE_SVGA, 10},
+    {"count", PIXFORMAT_RGB565, FRAMESIZE_QQVGA, 12},
+    {"capture_hires", PIXFORMAT_JPEG, FRAMESIZE_UXGA, 8},
+};
+
+typedef void (*CameraSensorSetup)(sensor_t *s);
+
+static camera_config_t camConfig; // pin & buffer dari sketch, format/ukuran dari profil
+static CameraSensorSetup camSensorSetup = NULL;
+static volatile int camProfile = -1;
+static std::atomic<int> camFbOutstanding{0}; // frame di tangan task lain (termasuk yang sedang menunggu fb_get)
+static std::atomic<bool> camSwitching{false};
+
+// Hasil ganti profil terakhir, untuk respons HTTP dan /metrics
+static volatile uint32_t camSwitchCount = 0;
+static volatile uint32_t camReinitCount = 0;
+static volatile uint32_t camLastSwitchUs = 0;
+static volatile bool camLastSwitchReinit = false;
+
+// Hasil encode frame non-JPEG (profil count). Encoder dan satu buffer output dari
+// arena, dipakai bergantian oleh task stream, loop() dan handler: camFrameToJpeg()
+// memegang camJpegMutex sampai pemanggil selesai menyalin dan memanggil camJpegRelease().
+static JpegEncoder *camJpegEnc = nullptr;
+static uint8_t *camJpegBuf = nullptr;
+static size_t camJpegCap = 0;
+static size_t camJpegLen = 0;
+static SemaphoreHandle_t camJpegMutex = NULL;
+static volatile uint32_t camJpegFailures = 0; // encode gagal atau JPEG melebihi buffer
+
+// Ukuran JPEG terbesar yang muat di buffer frame
+static inline framesize_t camMaxJpegSize()
+{
+    return psramFound() ? FRAMESIZE_UXGA : FRAMESIZE_VGA;
+}
+
+static inline framesize_t camProfileSize(const CameraProfile &p)
+{
+    return p.format == PIXFORMAT_JPEG && p.frameSize > camMaxJpegSize() ? camMaxJpegSize() : p.frameSize;
+}
+
+int cameraProfileFind(const char *name)
+{
+    for (int i = 0; i < CAM_PROFILE_NUM; i++)
+        if (strcmp(cameraProfiles[i].name, name) == 0)
+            return i;
+    return -1;
+}
+
+const char *cameraProfileName()
+{
+    return camProfile >= 0 ? cameraProfiles[camProfile].name : "none";
+}
+
+// Pengganti esp_camera_fb_get(): NULL selama driver di-init ulang
+camera_fb_t *camFbGet()
+{
+    camFbOutstanding++;
+    if (camSwitching.load())
+    {
+        camFbOutstanding--;
+        return NULL;
+    }
+    camera_fb_t *fb = esp_camera_fb_get();
+    if (!fb)
+        camFbOutstanding--;
+    return fb;
+}
+
+void camFbReturn(camera_fb_t *fb)
+{
+    if (!fb)
+        return;
+    esp_camera_fb_return(fb);
+    camFbOutstanding--;
+}
+
+// Buffer encode seukuran RGB565 mentah profil non-JPEG terbesar; JPEG kualitas
+// CAM_ENCODE_QUALITY dari frame itu selalu jauh lebih kecil
+static size_t camJpegBufBytes()
+{
+    size_t maxPixels = 0;
+    for (int i = 0; i < CAM_PROFILE_NUM; i++)
+    {
+        const CameraProfile &p = cameraProfiles[i];
+        size_t px = (size_t)resolution[p.frameSize].width * resolution[p.frameSize].height;
+        if (p.format != PIXFORMAT_JPEG && px > maxPixels)
+            maxPixels = px;
+    }
+    return maxPixels * 2;
+}
+
+size_t camJpegArenaBytes()
+{
+    return FRAME_ARENA_ROUND(camJpegBufBytes()) + jpegEncArenaBytes();
+}
+
+// Panggil sekali di setup() setelah frameArenaBegin()
+bool camJpegInit()
+{
+    if (camJpegBuf)
+        return true;
+    camJpegMutex = xSemaphoreCreateMutex();
+    camJpegEnc = jpegEncCreate();
+    camJpegCap = camJpegBufBytes();
+    camJpegBuf = (uint8_t *)frameArenaAlloc(camJpegCap);
+    return camJpegMutex && camJpegEnc && camJpegBuf;
+}
+
+static size_t camJpegOut(void *, size_t index, const void *data, size_t len)
+{
+    if (index + len > camJpegCap)
+        return 0; // encoder berhenti, jpegEncode return false
+    memcpy(camJpegBuf + index, data, len);
+    camJpegLen = index + len;
+    return len;
+}
+
+// JPEG dari frame: fb->buf apa adanya, atau hasil encode di camJpegBuf tanpa
+// alokasi heap per frame (RGB565 dan grayscale). Setelah true, panggil
+// camJpegRelease(*buf) begitu JPEG selesai disalin (untuk fb JPEG tidak melakukan apa-apa).
+bool camFrameToJpeg(camera_fb_t *fb, uint8_t **buf, size_t *len)
+{
+    if (fb->format == PIXFORMAT_JPEG)
+    {
+        *buf = fb->buf;
+        *len = fb->len;
+        return true;
+    }
+    if (!camJpegBuf || !camJpegMutex)
+        return false;
+    if (fb->format != PIXFORMAT_RGB565 && fb->format != PIXFORMAT_GRAYSCALE)
+    {
+        camJpegFailures++;
+        return false;
+    }
+    JpegEncFormat fmt = fb->format == PIXFORMAT_RGB565 ? JPEG_ENC_RGB565 : JPEG_ENC_GRAY;
+    xSemaphoreTake(camJpegMutex, portMAX_DELAY);
+    int64_t t0 = esp_timer_get_time();
+    camJpegLen = 0;
+    if (!jpegEncode(camJpegEnc, fb->buf, fb->width, fb->height, fmt, CAM_ENCODE_QUALITY, camJpegOut, NULL))
+    {
+        camJpegFailures++;
+        xSemaphoreGive(camJpegMutex);
+        return false;
+    }
+    metricObserveSince(STAGE_ENCODE, t0);
+    *buf = camJpegBuf;
+    *len = camJpegLen;
+    return true;
+}
+
+void camJpegRelease(const uint8_t *buf)
+{
+    if (camJpegBuf && buf == camJpegBuf)
+        xSemaphoreGive(camJpegMutex);
+}
+
+static bool camInitDriver(int id)
+{
+    const CameraProfile &p = cameraProfiles[id];
+    camera_config_t config = camConfig;
+    config.pixel_format = p.format;
+    config.frame_size = p.format == PIXFORMAT_JPEG ? camMaxJpegSize() : p.frameSize;
+    config.jpeg_quality = p.quality;
+    esp_err_t err = esp_camera_init(&config);
+    if (err != ESP_OK)
+    {
+        Serial.printf("❌ Camera init (%s) failed with error 0x%x\n", p.name, err);
+        return false;
+    }
+    sensor_t *s = esp_camera_sensor_get();
+    if (s)
+    {
+        if (camSensorSetup)
+            camSensorSetup(s);
+        s->set_framesize(s, camProfileSize(p));
+        s->set_quality(s, p.quality);
+    }
+    camProfile = id;
+    return true;
+}
+
+// Init pertama. base berisi pin, xclk, fb_count, fb_location dan grab_mode.
+bool cameraInitProfile(const camera_config_t &base, int id, CameraSensorSetup setup)
+{
+    camConfig = base;
+    camSensorSetup = setup;
+    return camInitDriver(id);
+}
+
+// Tunggu frame pertama berukuran profil baru; frame lama di antrian driver dibuang
+static bool camWaitNewFrame(const CameraProfile &p, int64_t t0)
+{
+    uint16_t w = resolution[camProfileSize(p)].width;
+    while (esp_timer_get_time() - t0 < CAM_SWITCH_TIMEOUT_MS * 1000LL)
+    {
+        camera_fb_t *fb = camFbGet();
+        if (!fb)
+        {
+            vTaskDelay(pdMS_TO_TICKS(5));
+            continue;
+        }
+        bool match = fb->width == w && fb->format == p.format;
+        camFbReturn(fb);
+        if (match)
+            return true;
+    }
+    return false;
+}
+
+// Ganti profil. Return false jika profil tidak valid, sedang ganti, atau driver gagal.
+bool cameraSetProfile(int id)
+{
+    if (id < 0 || id >= CAM_PROFILE_NUM)
+        return false;
+    if (id == camProfile)
+    {
+        camLastSwitchUs = 0;
+        camLastSwitchReinit = false;
+        return true;
+    }
+    if (camSwitching.exchange(true))
+        return false;
+
+    const CameraProfile &p = cameraProfiles[id];
+    int64_t t0 = esp_timer_get_time();
+    bool reinit = camProfile < 0 || cameraProfiles[camProfile].format != p.format;
+    bool ok;
+    if (reinit)
+    {
+        // Format piksel berubah: tunggu semua frame kembali, lalu init ulang driver
+        while (camFbOutstanding.load() > 0 && esp_timer_get_time() - t0 < CAM_SWITCH_TIMEOUT_MS * 1000LL)
+            vTaskDelay(pdMS_TO_TICKS(2));
+        if (camFbOutstanding.load() > 0)
+        {
+            Serial.println("⚠️ Camera profile switch aborted: frames still in use");
+            camSwitching = false;
+            return false;
+        }
+        int prev = camProfile;
+        esp_camera_deinit();
+        ok = camInitDriver(id);
+        if (!ok && prev >= 0)
+            camInitDriver(prev); // kembali ke profil lama agar kamera tetap jalan
+        camReinitCount++;
+        camSwitching = false;
+    }
+    else
+    {
+        // Format sama: cukup register sensor, task lain tetap mengambil frame
+        camSwitching = false;
+        sensor_t *s = esp_camera_sensor_get();
+        ok = s && s->set_framesize(s, camProfileSize(p)) == 0;
+        if (ok && p.format == PIXFORMAT_JPEG)
+            s->set_quality(s, p.quality);
+        if (ok)
+            camProfile = id;
+    }
+
+    if (ok && !camWaitNewFrame(p, t0))
+        Serial.printf("⚠️ Camera profile %s: no frame at the new size yet\n", p.name);
+    camLastSwitchUs = (uint32_t)(esp_timer_get_time() - t0);
+    camLastSwitchReinit = reinit;
+    if (ok)
+        camSwitchCount++;
+    Serial.printf("%s Camera profile %s (%s) in %lu ms\n", ok ? "📷" : "❌", p.name,
+                  reinit ? "re-init" : "registers", (unsigned long)(camLastSwitchUs / 1000));
+    return ok;
+}
+
+// Bagian /metrics milik modul ini
+void cameraProfileWriteMetrics(ChunkWriter &out)
+{
+    metricsHeader(out, "camera_profile_info", "gauge", "Active camera profile");
+    out.printf("camera_profile_info{profile=\"%s\"} 1\n", cameraProfileName());
+    metricsCounter(out, "camera_profile_switches_total", "Successful camera profile switches", camSwitchCount);
+    metricsCounter(out, "camera_profile_reinits_total", "Profile switches that re-initialised the driver", camReinitCount);
+    metricsGauge(out, "camera_profile_switch_seconds", "Duration of the last profile switch until the first new frame", camLastSwitchUs / 1e6);
+    metricsCounter(out, "camera_jpeg_encode_failures_total", "Non-JPEG frames that failed to encode into the JPEG buffer", camJpegFailures);
+}
+
+#endif
@@ -0,0 +1,82 @@
+// count_frame.h - Algoritma counting satu frame RGB565 tanpa kamera / FreeRTOS
+// Dipakai tahap convert & label di count_pipeline.h, dan di-compile apa adanya
+// oleh tools/count_replay di PC sehingga hasil replay sama dengan di ESP32.
+// Butuh: rgb565_mask.h, auto_threshold.h, blob_rle.h, blob_split.h
+#ifndef COUNT_FRAME_H
+#define COUNT_FRAME_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+struct CountFrameParams
+{
+    int threshMode; // THRESH_MANUAL / THRESH_OTSU / THRESH_ADAPTIVE
+    int threshold;  // manual, juga cadangan jika Otsu gagal
+    int adaptRadius;
+    int adaptOffset;
+    int minArea, maxArea;
+    int splitMode; // SPLIT_OFF / SPLIT_DT / SPLIT_AREA untuk blob di atas maxArea
+};
+
+struct CountFrame
+{
+    uint8_t *mask; // mask biner (isMask) atau gray yang di-threshold saat labeling
+    int w, h;
+    bool isMask;
+    int threshMode;
+    int threshold; // foreground = gray < threshold (untuk mode adaptif: nilai Otsu acuan)
+};
+
+// Tahap 1, satu-satunya yang membaca frame: src = piksel kiri atas ROI,
+// stride = byte per baris frame penuh. Mode manual langsung jadi mask biner,
+// mode lain jadi gray + histogram (hist[256] diisi ulang di sini).
+// f.mask harus muat w * h byte.
+void countFrameConvert(const uint8_t *src, size_t stride, int w, int h,
+                       const CountFrameParams &p, uint32_t *hist, CountFrame &f)
+{
+    f.w = w;
+    f.h = h;
+    f.threshMode = p.threshMode;
+    if (p.threshMode == THRESH_MANUAL)
+    {
+        f.threshold = p.threshold;
+        f.isMask = true;
+        for (int y = 0; y < h; y++)
+            rgb565ToMask(src + y * stride, f.mask + y * w, w, f.threshold);
+        return;
+    }
+    f.isMask = false;
+    memset(hist, 0, sizeof(uint32_t) * 256);
+    for (int y = 0; y < h; y++)
+        rgb565ToGrayHist(src + y * stride, f.mask + y * w, w, hist);
+}
+
+// Tahap 2, frame sudah boleh dikembalikan: Otsu O(256) dari histogram,
+// mode adaptif menimpa gray menjadi mask in-place.
+void countFrameThreshold(const CountFrameParams &p, const uint32_t *hist, CountFrame &f)
+{
+    if (f.isMask)
+        return;
+    int t = otsuThreshold(hist);
+    f.threshold = t < 0 ? p.threshold : t + 1;
+    f.isMask = f.threshMode == THRESH_ADAPTIVE &&
+               adaptiveThresholdMask(f.mask, f.w, f.h, p.adaptRadius, p.adaptOffset, true, f.mask, 1);
+    if (!f.isMask)
+        f.threshMode = THRESH_OTSU; // buffer integral tidak ada: pakai Otsu
+}
+
+// Tahap 3: labeling run-length, lalu blob gabungan di atas maxArea dipecah
+// (blob_split.h). Return jumlah objek = blob lolos filter (bisa > maxOut) +
+// split.added, -1 jika blob_rle belum di-init. Blob hasil pecahan tidak masuk out.
+int countFrameLabel(const CountFrame &f, const CountFrameParams &p, Blob *out, int maxOut,
+                    BlobSplitStats &split)
+{
+    int n = f.isMask ? detect_blobs_mask(f.mask, f.w, f.h, p.minArea, p.maxArea, out, maxOut)
+                     : detect_blobs(f.mask, f.w, f.h, f.threshold, p.minArea, p.maxArea, out, maxOut);
+    if (n < 0)
+        return -1;
+    return n + blobSplitMerged(p.splitMode, p.maxArea, f.w * f.h, out, n < maxOut ? n : maxOut, split);
+}
+
+#endif
@@ -0,0 +1,279 @@
+// count_pipeline.h - Pipeline counting kontinu di core 1
+// Tahap: capture -> convert (RGB565 -> mask) -> label (run-length blob) -> publish.
+// Antar tahap dihubungkan SpscQueue lock-free; consumer dibangunkan lewat task
+// notification. Handler HTTP hanya membaca hasil terakhir (seqlock), tidak
+// pernah mengambil frame sendiri.
+// Algoritma per frame ada di count_frame.h (tanpa hardware, ikut diuji tools/count_replay).
+// Butuh: g_threshold, g_threshMode, g_adaptRadius, g_adaptOffset, g_minArea, g_maxArea,
+//        g_splitMode, Blob, MAX_BLOBS, rgb565_mask.h, auto_threshold.h, blob_rle.h,
+//        blob_split.h, roi.h
+#ifndef COUNT_PIPELINE_H
+#define COUNT_PIPELINE_H
+
+#include <atomic>
+#include "esp_camera.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "spsc_queue.h"
+#include "frame_arena.h"
+#include "metrics.h"
+#include "camera_profiles.h"
+#include "count_frame.h"
+
+#define PIPE_CORE 1
+#define PIPE_SLOTS 2 // jumlah buffer mask / hasil yang berputar
+
+struct MaskSlot
+{
+    CountFrame f;   // mask/gray + mode threshold, lihat count_frame.h
+    CountFrameParams params; // setting saat convert, dipakai lagi saat label
+    size_t cap;
+    int offX, offY; // posisi ROI dalam frame
+    uint32_t seq;
+    int64_t tCaptureUs;
+};
+
+// Frame dari driver beserta waktu capture, supaya frameUs mencakup antrian ke convert
+struct CapturedFrame
+{
+    camera_fb_t *fb;
+    int64_t tCaptureUs;
+};
+
+struct CountResult
+{
+    uint32_t seq;   // nomor frame
+    int count;      // jumlah objek: blob lolos filter + hasil pecahan blob gabungan
+    int stored;     // jumlah blob di array blobs (hanya blob tunggal)
+    BlobSplitStats split;
+    Blob blobs[MAX_BLOBS];
+    int w, h;       // ukuran ROI; koordinat blob relatif terhadap ROI
+    int offX, offY; // posisi ROI dalam frame
+    int threshMode;
+    int threshold;
+    uint32_t frameUs;     // latensi capture -> publish
+    uint32_t timestampMs; // millis() saat publish
+};
+
+static MaskSlot pipeMasks[PIPE_SLOTS];
+static CountResult pipeResults[PIPE_SLOTS];
+
+static SpscQueue<CapturedFrame, 1> qCaptured;   // capture -> convert
+static SpscQueue<int, PIPE_SLOTS> qMaskReady;   // convert -> label
+static SpscQueue<int, PIPE_SLOTS> qMaskFree;    // label -> convert
+static SpscQueue<int, PIPE_SLOTS> qResultReady; // label -> publish
+static SpscQueue<int, PIPE_SLOTS> qResultFree;  // publish -> label
+
+static TaskHandle_t pipeCaptureTask = NULL;
+static TaskHandle_t pipeConvertTask = NULL;
+static TaskHandle_t pipeLabelTask = NULL;
+static TaskHandle_t pipePublishTask = NULL;
+
+volatile bool g_pipelineEnabled = true;      // false = capture berhenti, hasil terakhir tetap dibaca (?pipeline=off)
+static TaskHandle_t pipeResultWatcher = NULL; // dibangunkan setiap hasil baru dipublish (ws_push.h)
+static uint32_t pipeHist[256]; // histogram gray, hanya dipakai tahap convert
+static volatile uint32_t pipeDroppedFrames = 0;
+
+// Hasil terakhir, dibaca handler lewat seqlock (seq ganjil = sedang ditulis)
+static CountResult pipeLatest;
+static std::atomic<uint32_t> pipeLatestSeq{0};
+
+static void pipePublishLatest(const CountResult &r)
+{
+    pipeLatestSeq.fetch_add(1, std::memory_order_acq_rel);
+    pipeLatest = r;
+    pipeLatestSeq.fetch_add(1, std::memory_order_release);
+}
+
+// Salin hasil terakhir; false jika belum ada frame yang diproses
+bool pipelineReadLatest(CountResult &out)
+{
+    for (;;)
+    {
+        uint32_t s1 = pipeLatestSeq.load(std::memory_order_acquire);
+        if (s1 == 0)
+            return false;
+        if (s1 & 1)
+        {
+            taskYIELD();
+            continue;
+        }
+        out = pipeLatest;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (pipeLatestSeq.load(std::memory_order_relaxed) == s1)
+            return true;
+    }
+}
+
+// Snapshot setting dari handler web untuk satu frame
+static CountFrameParams pipeParams()
+{
+    return {g_threshMode, g_threshold, g_adaptRadius, g_adaptOffset, g_minArea, g_maxArea, g_splitMode};
+}
+
+// Pop dengan menunggu notifikasi dari producer
+template <typename Q, typename T>
+static void pipeWaitPop(Q &q, T &item)
+{
+    while (!q.pop(item))
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(20));
+}
+
+static void pipeCaptureLoop(void *)
+{
+    for (;;)
+    {
+        if (!g_pipelineEnabled)
+        {
+            vTaskDelay(pdMS_TO_TICKS(100));
+            continue;
+        }
+        int64_t t0 = esp_timer_get_time();
+        camera_fb_t *fb = camFbGet();
+        if (!fb)
+        {
+            vTaskDelay(pdMS_TO_TICKS(10));
+            continue;
+        }
+        metricObserveSince(STAGE_FB_GET, t0);
+        if (fb->format != PIXFORMAT_RGB565)
+        {
+            // Profil JPEG (stream / capture_hires) aktif: pipeline diam sampai profil count
+            camFbReturn(fb);
+            vTaskDelay(pdMS_TO_TICKS(100));
+            continue;
+        }
+        if (!qCaptured.push({fb, t0}))
+        {
+            // Tahap convert masih sibuk: buang frame, jangan menahan buffer driver
+            camFbReturn(fb);
+            pipeDroppedFrames++;
+            vTaskDelay(1);
+            continue;
+        }
+        xTaskNotifyGive(pipeConvertTask);
+    }
+}
+
+static void pipeConvertLoop(void *)
+{
+    uint32_t seq = 0;
+    int slot = -1; // slot mask yang sedang dipegang tahap ini
+    for (;;)
+    {
+        CapturedFrame cf;
+        pipeWaitPop(qCaptured, cf);
+        camera_fb_t *fb = cf.fb;
+        if (slot < 0)
+            pipeWaitPop(qMaskFree, slot);
+
+        int64_t t0 = esp_timer_get_time();
+        MaskSlot &m = pipeMasks[slot];
+        // Crop ROI (x dan w genap agar tiap baris tetap align 32-bit)
+        RoiRect rc = {0, 0, (int)fb->width, (int)fb->height};
+        CountRoi roi = roiCurrent;
+        if (!roiIsFull(roi))
+            rc = roiToRect(roi, fb->width, fb->height, 2);
+        if ((size_t)rc.w * rc.h > m.cap)
+        {
+            // Frame lebih besar dari profil count saat boot: buffer tidak ditumbuhkan
+            camFbReturn(fb);
+            pipeDroppedFrames++;
+            continue; // slot tetap dipegang untuk frame berikutnya
+        }
+
+        m.offX = rc.x;
+        m.offY = rc.y;
+        const uint8_t *src = fb->buf + ((size_t)rc.y * fb->width + rc.x) * 2;
+        m.seq = ++seq;
+        m.tCaptureUs = cf.tCaptureUs;
+        m.params = pipeParams();
+        countFrameConvert(src, (size_t)fb->width * 2, rc.w, rc.h, m.params, pipeHist, m.f);
+        camFbReturn(fb);
+        countFrameThreshold(m.params, pipeHist, m.f);
+        metricObserveSince(STAGE_CONVERT, t0);
+
+        qMaskReady.push(slot);
+        slot = -1;
+        xTaskNotifyGive(pipeLabelTask);
+    }
+}
+
+static void pipeLabelLoop(void *)
+{
+    for (;;)
+    {
+        int slot, rslot;
+        pipeWaitPop(qMaskReady, slot);
+        pipeWaitPop(qResultFree, rslot);
+
+        const MaskSlot &m = pipeMasks[slot];
+        CountResult &r = pipeResults[rslot];
+        int64_t t0 = esp_timer_get_time();
+        // Setting yang sama dengan saat mask dibuat, walau handler web sudah menggantinya
+        int count = countFrameLabel(m.f, m.params, r.blobs, MAX_BLOBS, r.split);
+        metricObserveSince(STAGE_LABEL, t0);
+        if (count < 0)
+            r.split = {};
+        r.count = count < 0 ? 0 : count;
+        int singles = r.count - r.split.added;
+        r.stored = singles < MAX_BLOBS ? singles : MAX_BLOBS;
+        r.seq = m.seq;
+        r.w = m.f.w;
+        r.h = m.f.h;
+        r.offX = m.offX;
+        r.offY = m.offY;
+        r.threshMode = m.f.threshMode;
+        r.threshold = m.f.threshold;
+        r.frameUs = (uint32_t)(esp_timer_get_time() - m.tCaptureUs);
+
+        qMaskFree.push(slot);
+        xTaskNotifyGive(pipeConvertTask);
+        qResultReady.push(rslot);
+        xTaskNotifyGive(pipePublishTask);
+    }
+}
+
+static void pipePublishLoop(void *)
+{
+    for (;;)
+    {
+        int rslot;
+        pipeWaitPop(qResultReady, rslot);
+        CountResult &r = pipeResults[rslot];
+        r.timestampMs = millis();
+        pipePublishLatest(r);
+        if (pipeResultWatcher)
+            xTaskNotifyGive(pipeResultWatcher);
+        qResultFree.push(rslot);
+        xTaskNotifyGive(pipeLabelTask);
+    }
+}
+
+size_t countPipelineArenaBytes(int maxW, int maxH)
+{
+    return PIPE_SLOTS * FRAME_ARENA_ROUND((size_t)maxW * maxH);
+}
+
+// Slot mask dari arena seukuran frame terbesar (maxW x maxH), tidak pernah dibebaskan
+bool startCountPipeline(int maxW, int maxH)
+{
+    for (int i = 0; i < PIPE_SLOTS; i++)
+    {
+        pipeMasks[i].f.mask = (uint8_t *)frameArenaAlloc((size_t)maxW * maxH);
+        if (!pipeMasks[i].f.mask)
+            return false;
+        pipeMasks[i].cap = (size_t)maxW * maxH;
+        qMaskFree.push(i);
+        qResultFree.push(i);
+    }
+    // Urutan dibuat dari hilir ke hulu agar handle notifikasi sudah valid
+    bool ok = xTaskCreatePinnedToCore(pipePublishLoop, "cnt_publish", 4096, NULL, 3, &pipePublishTask, PIPE_CORE) == pdPASS;
+    ok = ok && xTaskCreatePinnedToCore(pipeLabelLoop, "cnt_label", 4096, NULL, 3, &pipeLabelTask, PIPE_CORE) == pdPASS;
+    ok = ok && xTaskCreatePinnedToCore(pipeConvertLoop, "cnt_convert", 4096, NULL, 3, &pipeConvertTask, PIPE_CORE) == pdPASS;
+    ok = ok && xTaskCreatePinnedToCore(pipeCaptureLoop, "cnt_capture", 4096, NULL, 2, &pipeCaptureTask, PIPE_CORE) == pdPASS;
+    return ok;
+}
+
+#endif
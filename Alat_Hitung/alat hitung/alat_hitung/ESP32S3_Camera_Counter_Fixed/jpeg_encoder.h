@@ -0,0 +1,470 @@
+// jpeg_encoder.h - Encoder JPEG baseline tanpa alokasi per frame
+// Pengganti fmt2jpg_cb() di jalur per frame: esp32-camera membuat encoder jpge
+// dan buffer baris di heap lalu membebaskannya di setiap panggilan. Di sini
+// semua memori kerja (tabel kuantisasi dan Huffman, blok MCU, buffer output)
+// ada di satu JpegEncoder yang diambil sekali dari frame arena, dan stack yang
+// dipakai jpegEncode() hanya beberapa ratus byte.
+// Gray di-encode Y saja, warna YCbCr 4:2:0 dengan tabel Huffman standar (Annex K)
+// dan skala kualitas IJG seperti jpge. Output lewat callback bersignature sama
+// dengan jpg_out_cb milik fmt2jpg_cb, jadi sink yang ada tetap dipakai.
+// Satu JpegEncoder hanya boleh dipakai satu task pada satu waktu.
+#ifndef JPEG_ENCODER_H
+#define JPEG_ENCODER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "frame_arena.h"
+
+#define JPEG_ENC_OUT_BUF 512 // byte per panggilan callback
+
+enum JpegEncFormat
+{
+    JPEG_ENC_GRAY,   // 1 byte per piksel
+    JPEG_ENC_RGB565, // 2 byte per piksel, byte tinggi dulu (urutan sensor, sama dengan fmt2jpg)
+    JPEG_ENC_RGB888, // 3 byte per piksel, R G B
+};
+
+// Signature sama dengan jpg_out_cb (img_converters.h): return len jika diterima
+typedef size_t (*JpegEncOut)(void *arg, size_t index, const void *data, size_t len);
+
+struct JpegEncoder
+{
+    // Kode Huffman per simbol: 0 DC luma, 1 AC luma, 2 DC chroma, 3 AC chroma
+    uint16_t huffCode[4][256];
+    uint8_t huffLen[4][256];
+    // Tabel kuantisasi kualitas terakhir: natural order untuk DQT, dan pembagi
+    // yang sudah digabung dengan faktor skala DCT AAN
+    int quality;
+    uint8_t qt[2][64];
+    float fdtbl[2][64];
+    // Blok satu MCU (4 Y + Cb + Cr untuk 4:2:0)
+    float block[6][64];
+    // Bit writer dan buffer output
+    uint32_t bitBuf;
+    int bitCnt;
+    uint8_t out[JPEG_ENC_OUT_BUF];
+    size_t outLen;
+    size_t written;
+    bool failed;
+    JpegEncOut cb;
+    void *cbArg;
+};
+
+static const uint8_t jpegEncZigzag[64] = {
+    0, 1, 8, 16, 9, 2, 3, 10,
+    17, 24, 32, 25, 18, 11, 4, 5,
+    12, 19, 26, 33, 40, 48, 41, 34,
+    27, 20, 13, 6, 7, 14, 21, 28,
+    35, 42, 49, 56, 57, 50, 43, 36,
+    29, 22, 15, 23, 30, 37, 44, 51,
+    58, 59, 52, 45, 38, 31, 39, 46,
+    53, 60, 61, 54, 47, 55, 62, 63};
+
+static const uint8_t jpegEncStdQt[2][64] = {
+    {16, 11, 10, 16, 24, 40, 51, 61,
+     12, 12, 14, 19, 26, 58, 60, 55,
+     14, 13, 16, 24, 40, 57, 69, 56,
+     14, 17, 22, 29, 51, 87, 80, 62,
+     18, 22, 37, 56, 68, 109, 103, 77,
+     24, 35, 55, 64, 81, 104, 113, 92,
+     49, 64, 78, 87, 103, 121, 120, 101,
+     72, 92, 95, 98, 112, 100, 103, 99},
+    {17, 18, 24, 47, 99, 99, 99, 99,
+     18, 21, 26, 66, 99, 99, 99, 99,
+     24, 26, 56, 99, 99, 99, 99, 99,
+     47, 66, 99, 99, 99, 99, 99, 99,
+     99, 99, 99, 99, 99, 99, 99, 99,
+     99, 99, 99, 99, 99, 99, 99, 99,
+     99, 99, 99, 99, 99, 99, 99, 99,
+     99, 99, 99, 99, 99, 99, 99, 99}};
+
+// Tabel Huffman standar: 16 jumlah kode per panjang, lalu simbol
+static const uint8_t jpegEncDcLumBits[16] = {0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0};
+static const uint8_t jpegEncDcChromBits[16] = {0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0};
+static const uint8_t jpegEncDcVals[12] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+static const uint8_t jpegEncAcLumBits[16] = {0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d};
+static const uint8_t jpegEncAcLumVals[162] = {
+    0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+    0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0,
+    0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+    0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+    0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+    0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+    0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5,
+    0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2,
+    0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+    0xf9, 0xfa};
+static const uint8_t jpegEncAcChromBits[16] = {0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77};
+static const uint8_t jpegEncAcChromVals[162] = {
+    0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71,
+    0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0,
+    0x15, 0x62, 0x72, 0xd1, 0x0a, 0x16, 0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26,
+    0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+    0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+    0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+    0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5,
+    0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3,
+    0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda,
+    0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+    0xf9, 0xfa};
+
+// Faktor skala output DCT AAN per baris/kolom
+static const float jpegEncAanScale[8] = {1.0f, 1.387039845f, 1.306562965f, 1.175875602f,
+                                         1.0f, 0.785694958f, 0.541196100f, 0.275899379f};
+
+static void jpegEncBuildHuffman(JpegEncoder &e, int t, const uint8_t *bits, const uint8_t *vals)
+{
+    int code = 0, k = 0;
+    for (int l = 1; l <= 16; l++)
+    {
+        for (int i = 0; i < bits[l - 1]; i++, k++, code++)
+        {
+            e.huffCode[t][vals[k]] = (uint16_t)code;
+            e.huffLen[t][vals[k]] = (uint8_t)l;
+        }
+        code <<= 1;
+    }
+}
+
+size_t jpegEncArenaBytes()
+{
+    return FRAME_ARENA_ROUND(sizeof(JpegEncoder));
+}
+
+// Panggil sekali saat init modul; tabel Huffman dibangun di sini, bukan per frame
+JpegEncoder *jpegEncCreate()
+{
+    JpegEncoder *e = (JpegEncoder *)frameArenaAlloc(sizeof(JpegEncoder));
+    if (!e)
+        return nullptr;
+    memset(e, 0, sizeof(JpegEncoder));
+    e->quality = -1; // tabel kuantisasi dihitung di jpegEncode() pertama
+    jpegEncBuildHuffman(*e, 0, jpegEncDcLumBits, jpegEncDcVals);
+    jpegEncBuildHuffman(*e, 1, jpegEncAcLumBits, jpegEncAcLumVals);
+    jpegEncBuildHuffman(*e, 2, jpegEncDcChromBits, jpegEncDcVals);
+    jpegEncBuildHuffman(*e, 3, jpegEncAcChromBits, jpegEncAcChromVals);
+    return e;
+}
+
+// Skala IJG: 50 = tabel standar, 100 = semua 1
+static void jpegEncSetQuality(JpegEncoder &e, int quality)
+{
+    int q = quality < 1 ? 1 : (quality > 100 ? 100 : quality);
+    if (q == e.quality)
+        return;
+    int scale = q < 50 ? 5000 / q : 200 - q * 2;
+    for (int t = 0; t < 2; t++)
+    {
+        for (int i = 0; i < 64; i++)
+        {
+            int v = (jpegEncStdQt[t][i] * scale + 50) / 100;
+            v = v < 1 ? 1 : (v > 255 ? 255 : v);
+            e.qt[t][i] = (uint8_t)v;
+            e.fdtbl[t][i] = 1.0f / (v * jpegEncAanScale[i >> 3] * jpegEncAanScale[i & 7] * 8.0f);
+        }
+    }
+    e.quality = q;
+}
+
+// Setelah sink menolak, data berikutnya dibuang (buffer tetap dikosongkan)
+static void jpegEncFlush(JpegEncoder &e)
+{
+    if (e.outLen && !e.failed && e.cb(e.cbArg, e.written, e.out, e.outLen) != e.outLen)
+        e.failed = true;
+    e.written += e.outLen;
+    e.outLen = 0;
+}
+
+static inline void jpegEncByte(JpegEncoder &e, uint8_t b)
+{
+    e.out[e.outLen++] = b;
+    if (e.outLen == JPEG_ENC_OUT_BUF)
+        jpegEncFlush(e);
+}
+
+static void jpegEncBytes(JpegEncoder &e, const uint8_t *p, size_t n)
+{
+    while (n--)
+        jpegEncByte(e, *p++);
+}
+
+static void jpegEncMarker(JpegEncoder &e, uint8_t marker, uint16_t segLen)
+{
+    jpegEncByte(e, 0xFF);
+    jpegEncByte(e, marker);
+    jpegEncByte(e, segLen >> 8);
+    jpegEncByte(e, segLen & 0xFF);
+}
+
+// n bit terbawah dari code, MSB dulu; 0xFF di data entropy diikuti 0x00
+static inline void jpegEncBits(JpegEncoder &e, uint32_t code, int n)
+{
+    e.bitBuf = (e.bitBuf << n) | (code & ((1u << n) - 1));
+    e.bitCnt += n;
+    while (e.bitCnt >= 8)
+    {
+        uint8_t b = (uint8_t)(e.bitBuf >> (e.bitCnt - 8));
+        jpegEncByte(e, b);
+        if (b == 0xFF)
+            jpegEncByte(e, 0);
+        e.bitCnt -= 8;
+    }
+}
+
+static void jpegEncHuffTable(JpegEncoder &e, uint8_t id, const uint8_t *bits, const uint8_t *vals, int count)
+{
+    jpegEncByte(e, id);
+    jpegEncBytes(e, bits, 16);
+    jpegEncBytes(e, vals, count);
+}
+
+static void jpegEncHeaders(JpegEncoder &e, int w, int h, bool color)
+{
+    static const uint8_t jfif[14] = {'J', 'F', 'I', 'F', 0, 1, 1, 0, 0, 1, 0, 1, 0, 0};
+    int comps = color ? 3 : 1;
+    jpegEncByte(e, 0xFF);
+    jpegEncByte(e, 0xD8); // SOI
+    jpegEncMarker(e, 0xE0, 2 + sizeof(jfif));
+    jpegEncBytes(e, jfif, sizeof(jfif));
+
+    jpegEncMarker(e, 0xDB, color ? 2 + 2 * 65 : 2 + 65);
+    for (int t = 0; t < (color ? 2 : 1); t++)
+    {
+        jpegEncByte(e, t);
+        for (int i = 0; i < 64; i++)
+            jpegEncByte(e, e.qt[t][jpegEncZigzag[i]]);
+    }
+
+    jpegEncMarker(e, 0xC0, 8 + 3 * comps); // SOF0
+    jpegEncByte(e, 8);
+    jpegEncByte(e, h >> 8);
+    jpegEncByte(e, h & 0xFF);
+    jpegEncByte(e, w >> 8);
+    jpegEncByte(e, w & 0xFF);
+    jpegEncByte(e, comps);
+    for (int c = 0; c < comps; c++)
+    {
+        jpegEncByte(e, c + 1);
+        jpegEncByte(e, c == 0 && color ? 0x22 : 0x11); // Y 2x2 untuk 4:2:0
+        jpegEncByte(e, c == 0 ? 0 : 1);
+    }
+
+    jpegEncMarker(e, 0xC4, color ? 2 + 2 * (17 + 12) + 2 * (17 + 162) : 2 + (17 + 12) + (17 + 162));
+    jpegEncHuffTable(e, 0x00, jpegEncDcLumBits, jpegEncDcVals, 12);
+    jpegEncHuffTable(e, 0x10, jpegEncAcLumBits, jpegEncAcLumVals, 162);
+    if (color)
+    {
+        jpegEncHuffTable(e, 0x01, jpegEncDcChromBits, jpegEncDcVals, 12);
+        jpegEncHuffTable(e, 0x11, jpegEncAcChromBits, jpegEncAcChromVals, 162);
+    }
+
+    jpegEncMarker(e, 0xDA, 6 + 2 * comps); // SOS
+    jpegEncByte(e, comps);
+    for (int c = 0; c < comps; c++)
+    {
+        jpegEncByte(e, c + 1);
+        jpegEncByte(e, c == 0 ? 0x00 : 0x11);
+    }
+    jpegEncByte(e, 0);
+    jpegEncByte(e, 63);
+    jpegEncByte(e, 0);
+}
+
+// DCT float AAN in-place (baris lalu kolom); output masih berskala jpegEncAanScale * 8
+static void jpegEncFdct(float *d)
+{
+    for (int pass = 0; pass < 2; pass++)
+    {
+        int step = pass ? 8 : 1;    // jarak antar elemen dalam satu vektor
+        int stride = pass ? 1 : 8;  // jarak antar vektor
+        for (int i = 0; i < 8; i++)
+        {
+            float *p = d + i * stride;
+            float t0 = p[0] + p[7 * step], t7 = p[0] - p[7 * step];
+            float t1 = p[step] + p[6 * step], t6 = p[step] - p[6 * step];
+            float t2 = p[2 * step] + p[5 * step], t5 = p[2 * step] - p[5 * step];
+            float t3 = p[3 * step] + p[4 * step], t4 = p[3 * step] - p[4 * step];
+
+            float t10 = t0 + t3, t13 = t0 - t3;
+            float t11 = t1 + t2, t12 = t1 - t2;
+            p[0] = t10 + t11;
+            p[4 * step] = t10 - t11;
+            float z1 = (t12 + t13) * 0.707106781f;
+            p[2 * step] = t13 + z1;
+            p[6 * step] = t13 - z1;
+
+            t10 = t4 + t5;
+            t11 = t5 + t6;
+            t12 = t6 + t7;
+            float z5 = (t10 - t12) * 0.382683433f;
+            float z2 = 0.541196100f * t10 + z5;
+            float z4 = 1.306562965f * t12 + z5;
+            float z3 = t11 * 0.707106781f;
+            float z11 = t7 + z3, z13 = t7 - z3;
+            p[5 * step] = z13 + z2;
+            p[3 * step] = z13 - z2;
+            p[step] = z11 + z4;
+            p[7 * step] = z11 - z4;
+        }
+    }
+}
+
+// Kategori (jumlah bit) nilai v != 0
+static inline int jpegEncCategory(int v)
+{
+    unsigned a = v < 0 ? -v : v;
+    int n = 0;
+    while (a)
+    {
+        n++;
+        a >>= 1;
+    }
+    return n;
+}
+
+// DCT + kuantisasi + Huffman satu blok; t = 0 luma, 1 chroma
+static void jpegEncBlock(JpegEncoder &e, float *blk, int t, int &pred)
+{
+    jpegEncFdct(blk);
+    const float *fd = e.fdtbl[t];
+    const uint16_t *dcCode = e.huffCode[t * 2], *acCode = e.huffCode[t * 2 + 1];
+    const uint8_t *dcLen = e.huffLen[t * 2], *acLen = e.huffLen[t * 2 + 1];
+
+    int zz[64];
+    for (int i = 0; i < 64; i++)
+    {
+        int k = jpegEncZigzag[i];
+        float v = blk[k] * fd[k];
+        zz[i] = (int)(v < 0 ? v - 0.5f : v + 0.5f);
+    }
+
+    int diff = zz[0] - pred;
+    pred = zz[0];
+    int s = diff ? jpegEncCategory(diff) : 0;
+    jpegEncBits(e, dcCode[s], dcLen[s]);
+    if (s)
+        jpegEncBits(e, diff < 0 ? diff - 1 : diff, s);
+
+    int last = 63;
+    while (last > 0 && zz[last] == 0)
+        last--;
+    int run = 0;
+    for (int i = 1; i <= last; i++)
+    {
+        if (zz[i] == 0)
+        {
+            run++;
+            continue;
+        }
+        while (run >= 16)
+        {
+            jpegEncBits(e, acCode[0xF0], acLen[0xF0]); // ZRL
+            run -= 16;
+        }
+        s = jpegEncCategory(zz[i]);
+        int rs = (run << 4) | s;
+        jpegEncBits(e, acCode[rs], acLen[rs]);
+        jpegEncBits(e, zz[i] < 0 ? zz[i] - 1 : zz[i], s);
+        run = 0;
+    }
+    if (last < 63)
+        jpegEncBits(e, acCode[0x00], acLen[0x00]); // EOB
+}
+
+static inline void jpegEncRgb(const uint8_t *p, JpegEncFormat fmt, int &r, int &g, int &b)
+{
+    if (fmt == JPEG_ENC_RGB565)
+    {
+        r = p[0] & 0xF8;
+        g = ((p[0] & 0x07) << 5) | ((p[1] & 0xE0) >> 3);
+        b = (p[1] & 0x1F) << 3;
+    }
+    else
+    {
+        r = p[0];
+        g = p[1];
+        b = p[2];
+    }
+}
+
+// Encode w x h piksel src (baris rapat tanpa padding). Tepi kanan/bawah diisi
+// ulang piksel terakhir agar blok parsial tidak membawa artefak.
+// Return false jika format/ukuran tidak valid atau callback menolak data.
+bool jpegEncode(JpegEncoder *enc, const uint8_t *src, int w, int h, JpegEncFormat fmt, int quality,
+                JpegEncOut cb, void *arg)
+{
+    if (!enc || !src || w <= 0 || h <= 0 || w > 65535 || h > 65535)
+        return false;
+    JpegEncoder &e = *enc;
+    bool color = fmt != JPEG_ENC_GRAY;
+    int bpp = fmt == JPEG_ENC_RGB565 ? 2 : (fmt == JPEG_ENC_RGB888 ? 3 : 1);
+    jpegEncSetQuality(e, quality);
+    e.cb = cb;
+    e.cbArg = arg;
+    e.bitBuf = 0;
+    e.bitCnt = 0;
+    e.outLen = 0;
+    e.written = 0;
+    e.failed = false;
+
+    jpegEncHeaders(e, w, h, color);
+    int predY = 0, predCb = 0, predCr = 0;
+    int mcu = color ? 16 : 8;
+    for (int my = 0; my < h && !e.failed; my += mcu)
+    {
+        for (int mx = 0; mx < w && !e.failed; mx += mcu)
+        {
+            if (!color)
+            {
+                float *blk = e.block[0];
+                for (int y = 0; y < 8; y++)
+                {
+                    const uint8_t *row = src + (size_t)(my + y < h ? my + y : h - 1) * w;
+                    for (int x = 0; x < 8; x++)
+                        blk[y * 8 + x] = row[mx + x < w ? mx + x : w - 1] - 128.0f;
+                }
+                jpegEncBlock(e, blk, 0, predY);
+                continue;
+            }
+
+            float *cb = e.block[4], *cr = e.block[5];
+            memset(cb, 0, sizeof(float) * 128);
+            for (int y = 0; y < 16; y++)
+            {
+                const uint8_t *row = src + (size_t)(my + y < h ? my + y : h - 1) * w * bpp;
+                float *yBlk = e.block[(y >> 3) * 2];
+                for (int x = 0; x < 16; x++)
+                {
+                    int r, g, b;
+                    jpegEncRgb(row + (size_t)(mx + x < w ? mx + x : w - 1) * bpp, fmt, r, g, b);
+                    int i = (y & 7) * 8 + (x & 7);
+                    yBlk[(x >> 3) * 64 + i] = 0.299f * r + 0.587f * g + 0.114f * b - 128.0f;
+                    int c = (y >> 1) * 8 + (x >> 1);
+                    cb[c] += -0.168736f * r - 0.331264f * g + 0.5f * b;
+                    cr[c] += 0.5f * r - 0.418688f * g - 0.081312f * b;
+                }
+            }
+            for (int i = 0; i < 64; i++)
+            {
+                cb[i] *= 0.25f; // rata-rata 2x2, sudah berpusat di 0
+                cr[i] *= 0.25f;
+            }
+            for (int k = 0; k < 4; k++)
+                jpegEncBlock(e, e.block[k], 0, predY);
+            jpegEncBlock(e, cb, 1, predCb);
+            jpegEncBlock(e, cr, 1, predCr);
+        }
+    }
+
+    // Sisa bit diisi 1 (F.1.2.3), lalu EOI
+    if (e.bitCnt)
+        jpegEncBits(e, 0x7F, 8 - e.bitCnt);
+    jpegEncByte(e, 0xFF);
+    jpegEncByte(e, 0xD9);
+    jpegEncFlush(e);
+    return !e.failed;
+}
+
+#endif
@@ -0,0 +1,120 @@
+// rgb565_mask.h - Kernel RGB565 -> mask biner (gray < threshold) dalam satu pass
+// Bobot luminance per kanal 5/6/5 bit di-lookup dari tabel, dan perbandingan
+// floor(sum / 1000) < threshold diganti sum < threshold * 1000, sehingga tidak
+// ada pembagian per piksel tetapi hasil tetap bit-exact dengan rgb565_to_gray().
+#ifndef RGB565_MASK_H
+#define RGB565_MASK_H
+
+#include <stdint.h>
+#include <string.h>
+
+// lutR[r] = ((r * 255) / 31) * 299, dst. untuk G (587) dan B (114)
+static uint32_t rgb565LutR[32];
+static uint32_t rgb565LutG[64];
+static uint32_t rgb565LutB[32];
+static bool rgb565LutReady = false;
+
+static void rgb565MaskInit()
+{
+    if (rgb565LutReady)
+        return;
+    for (int i = 0; i < 32; i++)
+    {
+        rgb565LutR[i] = ((i * 255) / 31) * 299;
+        rgb565LutB[i] = ((i * 255) / 31) * 114;
+    }
+    for (int i = 0; i < 64; i++)
+        rgb565LutG[i] = ((i * 255) / 63) * 587;
+    rgb565LutReady = true;
+}
+
+static inline uint32_t rgb565WeightedSum(uint32_t c)
+{
+    return rgb565LutR[(c >> 11) & 0x1F] + rgb565LutG[(c >> 5) & 0x3F] + rgb565LutB[c & 0x1F];
+}
+
+// floor(sum / 1000) tanpa pembagian: (sum >> 3) / 125 lewat perkalian magic,
+// exact untuk seluruh rentang sum (0..255000)
+static inline uint32_t rgb565SumToGray(uint32_t sum)
+{
+    return ((sum >> 3) * 33555) >> 22;
+}
+
+// Konversi satu piksel RGB565 -> grayscale (0-255)
+static inline uint8_t rgb565_to_gray(uint16_t c)
+{
+    rgb565MaskInit();
+    return (uint8_t)(rgb565WeightedSum(c) / 1000);
+}
+
+// src: buffer RGB565 little-endian (byte rendah dulu), pixels: jumlah piksel.
+// mask[i] = 1 untuk foreground (gray < threshold), 0 untuk background.
+static void rgb565ToMask(const uint8_t *src, uint8_t *mask, int pixels, int threshold)
+{
+    rgb565MaskInit();
+    const uint32_t limit = (uint32_t)(threshold < 0 ? 0 : threshold) * 1000;
+    int i = 0;
+
+    // Jalur utama: satu word 32-bit = dua piksel
+    if (((uintptr_t)src & 3) == 0)
+    {
+        const uint32_t *words = (const uint32_t *)src;
+        int pairs = pixels >> 1;
+        for (int p = 0; p < pairs; p++)
+        {
+            uint32_t w = words[p];
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+            w = __builtin_bswap32(w);
+#endif
+            mask[i] = rgb565WeightedSum(w & 0xFFFF) < limit;
+            mask[i + 1] = rgb565WeightedSum(w >> 16) < limit;
+            i += 2;
+        }
+    }
+
+    // Sisa piksel / buffer tidak ter-align: jalur skalar
+    for (; i < pixels; i++)
+    {
+        uint16_t c = src[i * 2] | (src[i * 2 + 1] << 8);
+        mask[i] = rgb565WeightedSum(c) < limit;
+    }
+}
+
+// src -> gray (bit-exact dengan rgb565_to_gray) sekaligus menambah hist[256]
+// dalam pass yang sama, untuk threshold otomatis tanpa pass tambahan.
+// hist tidak di-reset di sini agar bisa diakumulasi per baris (crop ROI).
+static void rgb565ToGrayHist(const uint8_t *src, uint8_t *gray, int pixels, uint32_t *hist)
+{
+    rgb565MaskInit();
+    int i = 0;
+
+    if (((uintptr_t)src & 3) == 0)
+    {
+        const uint32_t *words = (const uint32_t *)src;
+        int pairs = pixels >> 1;
+        for (int p = 0; p < pairs; p++)
+        {
+            uint32_t w = words[p];
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+            w = __builtin_bswap32(w);
+#endif
+            uint32_t g0 = rgb565SumToGray(rgb565WeightedSum(w & 0xFFFF));
+            uint32_t g1 = rgb565SumToGray(rgb565WeightedSum(w >> 16));
+            gray[i] = g0;
+            gray[i + 1] = g1;
+            hist[g0]++;
+            hist[g1]++;
+            i += 2;
+        }
+    }
+
+    for (; i < pixels; i++)
+    {
+        uint16_t c = src[i * 2] | (src[i * 2 + 1] << 8);
+        uint32_t g = rgb565SumToGray(rgb565WeightedSum(c));
+        gray[i] = g;
+        hist[g]++;
+    }
+}
+
+#endif
@@ -0,0 +1,155 @@
+// ws_push.h - Push hasil counting ke klien WebSocket (/ws) tanpa polling
+// Setiap hasil baru dari pipeline dikodekan sekali ke frame biner kecil lalu
+// dikirim ke semua klien lewat httpd_queue_work(), sehingga semua penulisan
+// socket terjadi di task httpd. Jika pengiriman sebelumnya belum selesai,
+// hasil tersebut dilewati (klien lambat tidak menumpuk antrian).
+//
+// Frame server -> klien (biner, little-endian), versi 1:
+//   0  u8   WS_MSG_RESULT        1  u8  thresh mode (THRESH_*)
+//   2  u8   threshold            3  u8  split mode (SPLIT_*)
+//   4  u32  seq frame            8  u16 count     10 u16 hasil pecahan (split added)
+//   12 u16  roi x  14 u16 roi y  16 u16 roi w     18 u16 roi h
+//   20 u16  latensi ms           22 u16 jumlah kotak n
+//   24 n x {u16 minx, miny, maxx, maxy} relatif terhadap ROI
+// Klien -> server: frame teks berformat query /count, mis. "threshold=80&mode=otsu".
+// Butuh: count_pipeline.h (CountResult, pipelineReadLatest, pipeResultWatcher), g_splitMode
+#ifndef WS_PUSH_H
+#define WS_PUSH_H
+
+#include <atomic>
+#include "esp_http_server.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define WS_MAX_CLIENTS 4
+#define WS_MSG_RESULT 1
+#define WS_HEADER_BYTES 24
+#define WS_MAX_BOXES 128
+
+static httpd_handle_t wsServer = NULL;
+static int wsFds[WS_MAX_CLIENTS]; // hanya diakses dari task httpd
+static std::atomic<int> wsClientCount{0};
+static std::atomic<bool> wsInFlight{false}; // wsBuf sedang dikirim oleh task httpd
+static uint8_t wsBuf[WS_HEADER_BYTES + WS_MAX_BOXES * 8];
+static size_t wsLen = 0;
+static CountResult wsResult; // salinan hasil untuk dikodekan, milik task push
+static TaskHandle_t wsPushTask = NULL;
+static volatile uint32_t wsFramesSent = 0;
+
+static inline void wsPut16(uint8_t *p, uint32_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+}
+
+static inline void wsPut32(uint8_t *p, uint32_t v)
+{
+    wsPut16(p, v & 0xFFFF);
+    wsPut16(p + 2, v >> 16);
+}
+
+static size_t wsEncodeResult(const CountResult &r, int splitMode, uint8_t *out)
+{
+    int n = r.stored < WS_MAX_BOXES ? r.stored : WS_MAX_BOXES;
+    out[0] = WS_MSG_RESULT;
+    out[1] = r.threshMode;
+    out[2] = r.threshold > 255 ? 255 : r.threshold;
+    out[3] = splitMode;
+    wsPut32(out + 4, r.seq);
+    wsPut16(out + 8, r.count > 0xFFFF ? 0xFFFF : r.count);
+    wsPut16(out + 10, r.split.added);
+    wsPut16(out + 12, r.offX);
+    wsPut16(out + 14, r.offY);
+    wsPut16(out + 16, r.w);
+    wsPut16(out + 18, r.h);
+    uint32_t ms = r.frameUs / 1000;
+    wsPut16(out + 20, ms > 0xFFFF ? 0xFFFF : ms);
+    wsPut16(out + 22, n);
+    uint8_t *p = out + WS_HEADER_BYTES;
+    for (int i = 0; i < n; i++, p += 8)
+    {
+        wsPut16(p, r.blobs[i].minx);
+        wsPut16(p + 2, r.blobs[i].miny);
+        wsPut16(p + 4, r.blobs[i].maxx);
+        wsPut16(p + 6, r.blobs[i].maxy);
+    }
+    return p - out;
+}
+
+// Dipanggil handler /ws saat handshake (task httpd). false jika klien penuh.
+bool wsAddClient(int fd)
+{
+    int n = wsClientCount.load();
+    for (int i = 0; i < n; i++)
+        if (wsFds[i] == fd)
+            return true;
+    if (n >= WS_MAX_CLIENTS)
+        return false;
+    wsFds[n] = fd;
+    wsClientCount.store(n + 1);
+    return true;
+}
+
+static void wsRemoveAt(int i)
+{
+    int n = wsClientCount.load() - 1;
+    wsFds[i] = wsFds[n];
+    wsClientCount.store(n);
+}
+
+// Berjalan di task httpd lewat httpd_queue_work()
+static void wsSendAll(void *)
+{
+    httpd_ws_frame_t frame = {};
+    frame.final = true;
+    frame.type = HTTPD_WS_TYPE_BINARY;
+    frame.payload = wsBuf;
+    frame.len = wsLen;
+    for (int i = wsClientCount.load() - 1; i >= 0; i--)
+    {
+        int fd = wsFds[i];
+        if (httpd_ws_get_fd_info(wsServer, fd) != HTTPD_WS_CLIENT_WEBSOCKET)
+        {
+            wsRemoveAt(i); // socket sudah ditutup klien
+            continue;
+        }
+        if (httpd_ws_send_frame_async(wsServer, fd, &frame) != ESP_OK)
+        {
+            wsRemoveAt(i);
+            httpd_sess_trigger_close(wsServer, fd);
+            continue;
+        }
+        wsFramesSent++;
+    }
+    wsInFlight.store(false, std::memory_order_release);
+}
+
+static void wsPushLoop(void *)
+{
+    uint32_t lastSeq = 0;
+    for (;;)
+    {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1000));
+        if (wsClientCount.load() == 0 || wsInFlight.load(std::memory_order_acquire))
+            continue;
+        if (!pipelineReadLatest(wsResult) || wsResult.seq == lastSeq)
+            continue;
+        lastSeq = wsResult.seq;
+        wsLen = wsEncodeResult(wsResult, g_splitMode, wsBuf);
+        wsInFlight.store(true, std::memory_order_release);
+        if (httpd_queue_work(wsServer, wsSendAll, NULL) != ESP_OK)
+            wsInFlight.store(false, std::memory_order_release);
+    }
+}
+
+// Dibangunkan pipeline setiap publish (pipeResultWatcher); jalan di core 0 bersama httpd
+bool startWsPush(httpd_handle_t server)
+{
+    wsServer = server;
+    if (xTaskCreatePinnedToCore(wsPushLoop, "ws_push", 4096, NULL, 2, &wsPushTask, 0) != pdPASS)
+        return false;
+    pipeResultWatcher = wsPushTask;
+    return true;
+}
+
+#endif
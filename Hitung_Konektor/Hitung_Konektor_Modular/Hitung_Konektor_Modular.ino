@@ -13,8 +13,11 @@
 #include "config.h"
 #include "camera_functions.h"
 #include "sd_functions.h"
+#include "sd_monitor.h"
 #include "web_interface.h"
+#include "sd_writer.h"
 #include "web_handlers.h"
+#include "stream_server.h"
 
 // External variable declaration
 extern bool usingSPIMode;
@@ -40,6 +43,27 @@ void setup()
 
     delay(2000); // Wait for camera to stabilize
 
+    // Buffer gambar (thumbnail, frame stream, encode JPEG profil count) dari arena
+    // seukuran frame JPEG terbesar, dialokasikan sekali
+    const resolution_info_t &maxRes = resolution[camMaxJpegSize()];
+    if (!frameArenaBegin(thumbArenaBytes(maxRes.width, maxRes.height) + streamArenaBytes(maxRes.width, maxRes.height) +
+                         camJpegArenaBytes()))
+    {
+        Serial.println("⚠️ Frame arena allocation failed, image buffers fall back to heap");
+    }
+    if (!thumbInit(maxRes.width, maxRes.height))
+    {
+        Serial.println("⚠️ Thumbnail buffer allocation failed, /thumb disabled");
+    }
+    if (!camJpegInit())
+    {
+        Serial.println("⚠️ JPEG encode buffer allocation failed, count profile cannot be streamed or saved");
+    }
+    if (!downloadBufInit())
+    {
+        Serial.println("⚠️ Download buffer allocation failed, /download and /thumb disabled");
+    }
+
     if (!initializeSDCard())
     {
         Serial.println("⚠️ SD Card not available, some features may not work");
@@ -49,6 +73,13 @@ void setup()
         printSDCardInfo();
     }
 
+    // Cek kesehatan & mount ulang kartu di task latar, bukan di handler
+    startSdMonitor();
+
+    // Penyimpanan gambar lewat antrian, ditulis task terpisah
+    fileIndexInit();
+    startSdWriter();
+
     // Start WiFi Access Point
     WiFi.softAP(ssid, password);
     Serial.println("✅ WiFi AP started");
@@ -59,9 +90,16 @@ void setup()
     Serial.print("🔐 Password: ");
     Serial.println(password);
 
+    // MJPEG stream di task sendiri (port 81), tidak memblok WebServer
+    startStreamServer(maxRes.width, maxRes.height);
+
     // Setup web routes
     setupWebRoutes();
 
+    // WebServer hanya menyimpan header yang didaftarkan; dipakai /download
+    static const char *downloadHeaders[] = {"Range", "If-None-Match"};
+    server.collectHeaders(downloadHeaders, 2);
+
     // Start web server
     server.begin();
     Serial.println("✅ Web server started");
@@ -73,6 +111,7 @@ void setup()
 void loop()
 {
     server.handleClient();
+    datasetTick(); // satu frame burst dataset per putaran, jika ada
     delay(2); // Small delay for stability
 }
 
@@ -91,18 +130,39 @@ void setupWebRoutes()
     server.on("/system_info", HTTP_GET, []()
               { handleSystemInfo(server); });
 
+    // Metrik Prometheus (latensi per tahap, drop, heap, FPS viewer)
+    server.on("/metrics", HTTP_GET, []()
+              { handleMetrics(server); });
+
     // SD Card reconnect
     server.on("/sd_reconnect", HTTP_POST, []()
               { handleSDCardReconnect(server); });
 
+    server.on("/sd_status", HTTP_GET, []()
+              { handleSDStatus(server); });
+
     // Image capture
     server.on("/capture", HTTP_POST, []()
               { handleCapture(server); });
 
+    // Dataset burst capture ke container .hkd
+    server.on("/dataset", HTTP_GET, []()
+              { handleDataset(server); });
+
+    server.on("/dataset", HTTP_POST, []()
+              { handleDataset(server); });
+
     // Camera test endpoint
     server.on("/camera_test", HTTP_GET, []()
               { handleCameraTest(server); });
 
+    // Profil kamera runtime (stream / count / capture_hires)
+    server.on("/camera_profile", HTTP_GET, []()
+              { handleCameraProfile(server); });
+
+    server.on("/camera_profile", HTTP_POST, []()
+              { handleCameraProfile(server); });
+
     // File operations
     server.on("/files", HTTP_GET, []()
               { handleFileList(server); });
@@ -110,6 +170,9 @@ void setupWebRoutes()
     server.on("/download", HTTP_GET, []()
               { handleFileDownload(server); });
 
+    server.on("/thumb", HTTP_GET, []()
+              { handleThumbnail(server); });
+
     server.on("/upload", HTTP_POST, []()
               { handleFileUploadResponse(server); }, []()
               { handleFileUpload(server); });
@@ -130,6 +193,12 @@ void setupWebRoutes()
     server.on("/capture", HTTP_OPTIONS, []()
               { handleOptions(server); });
 
+    server.on("/dataset", HTTP_OPTIONS, []()
+              { handleOptions(server); });
+
+    server.on("/camera_profile", HTTP_OPTIONS, []()
+              { handleOptions(server); });
+
     server.on("/upload", HTTP_OPTIONS, []()
               { handleOptions(server); });
 
@@ -142,6 +211,9 @@ void setupWebRoutes()
     server.on("/sd_reconnect", HTTP_OPTIONS, []()
               { handleOptions(server); });
 
+    server.on("/sd_status", HTTP_OPTIONS, []()
+              { handleOptions(server); });
+
     // 404 handler
     server.onNotFound([]()
                       { server.send(404, "text/plain", "404: Not Found"); });
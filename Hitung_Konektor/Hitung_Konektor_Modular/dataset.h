@@ -0,0 +1,124 @@
+// dataset.h - Mode capture dataset (burst ke container .hkd)
+// datasetStart() membuka container baru, datasetBurst() menjadwalkan N frame,
+// dan datasetTick() di loop() mengambil satu frame per putaran lalu menyalinnya
+// ke antrian SD writer. Semua berjalan di task loop() sehingga antrian tetap
+// single-producer, dan WebServer tetap dilayani di antara frame. Laju capture
+// dibatasi sensor; task writer menambahkan frame ke file yang sudah terbuka.
+// Open dikerjakan task writer secara asinkron: handler langsung kembali (container
+// "opening"), frame baru diambil setelah writer melaporkan DS_CONTAINER_OPEN, dan
+// burst dihentikan jika FAILED. UI mengikuti statusnya lewat GET /dataset.
+#ifndef DATASET_H
+#define DATASET_H
+
+#include "esp_camera.h"
+#include "sd_functions.h"
+#include "sd_writer.h"
+#include "metrics.h"
+#include "camera_profiles.h"
+
+#define DATASET_MAX_BURST 1000
+
+static bool dsActive = false;
+static String dsPath;
+static uint32_t dsFirstSeq = 0;
+static uint32_t dsQueuedFrames = 0;  // frame yang masuk antrian di container ini
+static uint32_t dsDroppedFrames = 0; // antrian penuh
+static int dsBurstLeft = 0;
+static uint32_t dsIntervalMs = 0;
+static uint32_t dsLastShotMs = 0;
+
+bool datasetStart()
+{
+    if (dsActive)
+        return true;
+    if (!isSDCardAvailable())
+        return false;
+
+    dsFirstSeq = nextCaptureSeq();
+    char path[40];
+    snprintf(path, sizeof(path), DATASET_DIR "/DS_%08u.hkd", (unsigned)dsFirstSeq);
+    int prev = dsContainerState.exchange(DS_CONTAINER_OPENING);
+    if (!sdWriterDatasetOpen(path, dsFirstSeq))
+    {
+        dsContainerState.store(prev);
+        return false;
+    }
+
+    dsPath = path;
+    dsActive = true;
+    dsQueuedFrames = 0;
+    dsDroppedFrames = 0;
+    dsBurstLeft = 0;
+    return true;
+}
+
+// Writer gagal membuka container: container dianggap tidak aktif dan burst
+// dihentikan. Return false jika itu terjadi.
+static bool datasetCheckOpen()
+{
+    if (!dsActive || dsContainerState.load() != DS_CONTAINER_FAILED)
+        return true;
+    Serial.printf("❌ Dataset: cannot open %s, burst stopped (%d frames not taken)\n", dsPath.c_str(), dsBurstLeft);
+    dsActive = false;
+    dsBurstLeft = 0;
+    return false;
+}
+
+// Jadwalkan count frame dengan jeda minimal intervalMs (0 = secepat sensor).
+// Boleh dipanggil saat container masih dibuka; datasetTick() menunggu OPEN.
+bool datasetBurst(int count, uint32_t intervalMs)
+{
+    if (!dsActive || count <= 0)
+        return false;
+    dsBurstLeft = min(count, DATASET_MAX_BURST);
+    dsIntervalMs = intervalMs;
+    dsLastShotMs = millis() - intervalMs;
+    Serial.printf("🎞️ Dataset burst: %d frames into %s\n", dsBurstLeft, dsPath.c_str());
+    return true;
+}
+
+bool datasetStop()
+{
+    if (!dsActive)
+        return false;
+    dsBurstLeft = 0;
+    if (!sdWriterDatasetClose())
+        return false; // antrian penuh: coba lagi, container tetap terbuka
+    dsActive = false;
+    return true;
+}
+
+// Dipanggil dari loop(); satu frame per panggilan agar handleClient() tetap jalan
+void datasetTick()
+{
+    if (!datasetCheckOpen() || dsBurstLeft <= 0 || millis() - dsLastShotMs < dsIntervalMs)
+        return;
+    if (dsContainerState.load() != DS_CONTAINER_OPEN)
+        return; // writer belum selesai membuka container
+
+    int64_t t0 = esp_timer_get_time();
+    camera_fb_t *fb = camFbGet();
+    if (!fb)
+        return;
+    metricObserveSince(STAGE_FB_GET, t0);
+    dsLastShotMs = millis();
+
+    uint8_t *jpg;
+    size_t len;
+    if (camFrameToJpeg(fb, &jpg, &len))
+    {
+        if (sdWriterEnqueueFrame(jpg, len, nextCaptureSeq()))
+            dsQueuedFrames++;
+        else
+            dsDroppedFrames++;
+        camJpegRelease(jpg);
+    }
+    else
+        dsDroppedFrames++;
+    camFbReturn(fb);
+
+    if (--dsBurstLeft == 0)
+        Serial.printf("✅ Dataset burst queued: %u frames, %u dropped\n", (unsigned)dsQueuedFrames, (unsigned)dsDroppedFrames);
+}
+
+#endif
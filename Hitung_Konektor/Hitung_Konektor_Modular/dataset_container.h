@@ -0,0 +1,190 @@
+// dataset_container.h - Format file container dataset (.hkd)
+// Satu file berisi banyak JPEG: header, record [magic, len, seq, ms, JPEG,
+// padding 4 byte], lalu index di akhir. File dialokasikan DATASET_PREALLOC
+// sekaligus saat dibuka sehingga penulisan frame tidak menyentuh FAT maupun
+// entri direktori; metadata hanya diperbarui saat antrian kosong dan saat tutup.
+// Hanya dipakai dari task SD writer. Dibaca di PC dengan tools/extract_dataset.py.
+#ifndef DATASET_CONTAINER_H
+#define DATASET_CONTAINER_H
+
+#include <unistd.h>
+#include <atomic>
+#include "sd_functions.h"
+
+#define DATASET_DIR "/dataset"
+#define DATASET_PREALLOC (64UL * 1024 * 1024)
+#define DATASET_MAX_FRAMES 8192 // kapasitas index di RAM per container
+#define DATASET_VERSION 1
+
+// Semua field little-endian (native ESP32)
+struct DatasetHeader
+{
+    char magic[4];        // "HKDS"
+    uint16_t version;
+    uint16_t headerSize;  // sizeof(DatasetHeader)
+    uint32_t firstSeq;
+    uint32_t frameCount;  // diperbarui saat sync / tutup
+    uint32_t indexOffset; // 0 sampai container ditutup
+    uint32_t dataEnd;     // akhir record terakhir yang sudah di-sync
+    uint32_t reserved[2];
+};
+
+struct DatasetRecord
+{
+    char magic[4]; // "HKFR"
+    uint32_t len;  // panjang JPEG, tanpa padding
+    uint32_t seq;
+    uint32_t timestampMs;
+};
+
+struct DatasetIndexEntry
+{
+    uint32_t offset; // posisi DatasetRecord
+    uint32_t seq;
+};
+
+// Status container untuk task lain: OPENING diset pemanggil sebelum perintah
+// open masuk antrian, OPEN/FAILED/CLOSED hanya diset task SD writer
+enum DatasetContainerState
+{
+    DS_CONTAINER_CLOSED,
+    DS_CONTAINER_OPENING,
+    DS_CONTAINER_OPEN,
+    DS_CONTAINER_FAILED
+};
+
+static std::atomic<int> dsContainerState{DS_CONTAINER_CLOSED};
+
+const char *datasetContainerStateName(int state)
+{
+    static const char *const names[] = {"closed", "opening", "open", "failed"};
+    return state >= DS_CONTAINER_CLOSED && state <= DS_CONTAINER_FAILED ? names[state] : "unknown";
+}
+
+static File dsFile;
+static String dsFilePath;
+static DatasetHeader dsHeader;
+static DatasetIndexEntry *dsIndex = NULL;
+static uint32_t dsPos = 0;   // posisi tulis berikutnya
+static bool dsDirty = false; // ada frame yang belum masuk header
+
+static bool dsWriteAt(uint32_t pos, const void *data, size_t len)
+{
+    return dsFile.seek(pos) && dsFile.write((const uint8_t *)data, len) == len;
+}
+
+bool datasetContainerOpen(const char *path, uint32_t firstSeq)
+{
+    fs::FS &fs = usingSPIMode ? (fs::FS &)SD : (fs::FS &)SD_MMC;
+    if (!fs.exists(DATASET_DIR))
+        fs.mkdir(DATASET_DIR);
+    if (!dsIndex)
+    {
+        size_t n = sizeof(DatasetIndexEntry) * DATASET_MAX_FRAMES;
+        dsIndex = (DatasetIndexEntry *)(psramFound() ? ps_malloc(n) : malloc(n));
+        if (!dsIndex)
+            return false;
+    }
+
+    dsFile = fs.open(path, FILE_WRITE);
+    if (!dsFile)
+    {
+        Serial.printf("❌ Dataset: failed to create %s\n", path);
+        return false;
+    }
+
+    // Alokasikan rantai cluster sekali di depan; byte terakhir memaksa FATFS mengalokasikan semuanya
+    uint8_t zero = 0;
+    if (!dsWriteAt(DATASET_PREALLOC - 1, &zero, 1))
+        Serial.println("⚠️ Dataset: preallocation failed, container grows on demand");
+
+    dsHeader = DatasetHeader();
+    memcpy(dsHeader.magic, "HKDS", 4);
+    dsHeader.version = DATASET_VERSION;
+    dsHeader.headerSize = sizeof(DatasetHeader);
+    dsHeader.firstSeq = firstSeq;
+    dsPos = sizeof(DatasetHeader);
+    dsHeader.dataEnd = dsPos;
+    if (!dsWriteAt(0, &dsHeader, sizeof(dsHeader)))
+    {
+        dsFile.close();
+        return false;
+    }
+    dsFile.flush();
+    dsFilePath = path;
+    dsDirty = false;
+    Serial.printf("🎞️ Dataset container opened: %s\n", path);
+    return true;
+}
+
+bool datasetContainerIsOpen()
+{
+    return (bool)dsFile;
+}
+
+bool datasetContainerAppend(const uint8_t *jpeg, uint32_t len, uint32_t seq, uint32_t timestampMs)
+{
+    if (!dsFile || dsHeader.frameCount >= DATASET_MAX_FRAMES)
+        return false;
+
+    DatasetRecord rec;
+    memcpy(rec.magic, "HKFR", 4);
+    rec.len = len;
+    rec.seq = seq;
+    rec.timestampMs = timestampMs;
+    static const uint8_t pad[4] = {0, 0, 0, 0};
+    uint32_t padLen = (4 - (len & 3)) & 3;
+
+    if (!dsFile.seek(dsPos) ||
+        dsFile.write((const uint8_t *)&rec, sizeof(rec)) != sizeof(rec) ||
+        dsFile.write(jpeg, len) != len ||
+        (padLen && dsFile.write(pad, padLen) != padLen))
+        return false;
+
+    dsIndex[dsHeader.frameCount++] = {dsPos, seq};
+    dsPos += sizeof(rec) + len + padLen;
+    dsDirty = true;
+    return true;
+}
+
+// Perbarui header dan flush; dipanggil saat antrian writer kosong (akhir burst)
+void datasetContainerSync()
+{
+    if (!dsFile || !dsDirty)
+        return;
+    dsHeader.dataEnd = dsPos;
+    dsWriteAt(0, &dsHeader, sizeof(dsHeader));
+    dsFile.flush();
+    dsDirty = false;
+}
+
+// Tulis index, header final, lalu potong sisa pre-alokasi. Return ukuran akhir.
+uint32_t datasetContainerClose()
+{
+    if (!dsFile)
+        return 0;
+
+    uint32_t indexOffset = dsPos;
+    uint32_t count = dsHeader.frameCount;
+    bool ok = dsWriteAt(indexOffset, "HKIX", 4) &&
+              dsFile.write((const uint8_t *)&count, sizeof(count)) == sizeof(count) &&
+              dsFile.write((const uint8_t *)dsIndex, sizeof(DatasetIndexEntry) * count) == sizeof(DatasetIndexEntry) * count;
+    uint32_t end = indexOffset + 8 + sizeof(DatasetIndexEntry) * count;
+
+    if (ok)
+        dsHeader.indexOffset = indexOffset;
+    dsHeader.dataEnd = dsPos;
+    dsWriteAt(0, &dsHeader, sizeof(dsHeader));
+    dsFile.close();
+
+    // File API Arduino tidak punya truncate: lewat VFS dengan prefix mount point
+    String vfsPath = String(usingSPIMode ? "/sd" : "/sdcard") + dsFilePath;
+    if (truncate(vfsPath.c_str(), end) != 0)
+        Serial.println("⚠️ Dataset: truncate failed, container keeps preallocated size");
+
+    Serial.printf("✅ Dataset container closed: %s (%u frames, %u bytes)\n", dsFilePath.c_str(), (unsigned)count, (unsigned)end);
+    dsDirty = false;
+    return end;
+}
+
+#endif
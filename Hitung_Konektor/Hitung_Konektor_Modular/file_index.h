@@ -0,0 +1,337 @@
+// file_index.h - Indeks direktori SD di memori untuk file manager
+// Direktori dibaca dari kartu sekali (openNextFile), lalu diperbarui langsung
+// oleh capture, upload, delete, dan create_folder. /files dilayani dari indeks
+// dengan paging (offset/limit) lewat JsonWriter, tanpa String sebesar respons.
+#ifndef FILE_INDEX_H
+#define FILE_INDEX_H
+
+#include "sd_functions.h"
+#include "json_writer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#define FILE_INDEX_MAX_DIRS 4 // direktori yang di-cache (LRU)
+#define FILE_INDEX_DEFAULT_LIMIT 200
+
+struct FileIndexEntry
+{
+    uint32_t nameOff; // offset di pool nama
+    uint32_t size;
+    uint8_t nameLen;  // nama LFN FAT maks 255
+    bool isDir;
+    bool deleted;     // tombstone, dipadatkan saat jumlahnya besar
+};
+
+struct FileIndexDir
+{
+    String path;         // tanpa '/' di akhir kecuali root; kosong = slot bebas
+    uint32_t mountCount; // sdMountCount saat dibangun
+    uint32_t lastUse;
+    FileIndexEntry *entries;
+    int count, cap, live, dead;
+    char *names;
+    uint32_t namesLen, namesCap;
+};
+
+static FileIndexDir fileIndexDirs[FILE_INDEX_MAX_DIRS];
+static SemaphoreHandle_t fileIndexMutex = NULL;
+static uint32_t fileIndexClock = 0;
+
+// Dipanggil sekali dari setup(), sebelum task SD writer berjalan
+void fileIndexInit()
+{
+    if (!fileIndexMutex)
+        fileIndexMutex = xSemaphoreCreateMutex();
+}
+
+static inline void fileIndexLock()
+{
+    xSemaphoreTake(fileIndexMutex, portMAX_DELAY);
+}
+
+static inline void fileIndexUnlock()
+{
+    xSemaphoreGive(fileIndexMutex);
+}
+
+static void *fileIndexRealloc(void *p, size_t n)
+{
+    return psramFound() ? ps_realloc(p, n) : realloc(p, n);
+}
+
+static void fileIndexFree(FileIndexDir &d)
+{
+    free(d.entries);
+    free(d.names);
+    d = FileIndexDir();
+}
+
+static String fileIndexNormalize(String path)
+{
+    if (!path.startsWith("/"))
+        path = "/" + path;
+    while (path.length() > 1 && path.endsWith("/"))
+        path.remove(path.length() - 1);
+    return path;
+}
+
+// Pisahkan "/a/b.jpg" menjadi direktori "/a" dan nama "b.jpg"
+static void fileIndexSplit(const String &fullPath, String &dir, String &name)
+{
+    String p = fileIndexNormalize(fullPath);
+    int slash = p.lastIndexOf('/');
+    dir = slash <= 0 ? String("/") : p.substring(0, slash);
+    name = p.substring(slash + 1);
+}
+
+static bool fileIndexAppend(FileIndexDir &d, const char *name, size_t len, uint32_t size, bool isDir)
+{
+    if (len == 0 || len > 255)
+        return false;
+    if (d.count == d.cap)
+    {
+        int cap = d.cap ? d.cap * 2 : 64;
+        FileIndexEntry *e = (FileIndexEntry *)fileIndexRealloc(d.entries, sizeof(FileIndexEntry) * cap);
+        if (!e)
+            return false;
+        d.entries = e;
+        d.cap = cap;
+    }
+    if (d.namesLen + len > d.namesCap)
+    {
+        uint32_t cap = d.namesCap ? d.namesCap * 2 : 2048;
+        while (cap < d.namesLen + len)
+            cap *= 2;
+        char *n = (char *)fileIndexRealloc(d.names, cap);
+        if (!n)
+            return false;
+        d.names = n;
+        d.namesCap = cap;
+    }
+    memcpy(d.names + d.namesLen, name, len);
+    d.entries[d.count++] = {d.namesLen, size, (uint8_t)len, isDir, false};
+    d.namesLen += len;
+    d.live++;
+    return true;
+}
+
+static int fileIndexLookup(const FileIndexDir &d, const char *name, size_t len)
+{
+    for (int i = 0; i < d.count; i++)
+    {
+        const FileIndexEntry &e = d.entries[i];
+        if (!e.deleted && e.nameLen == len && memcmp(d.names + e.nameOff, name, len) == 0)
+            return i;
+    }
+    return -1;
+}
+
+// Buang tombstone dan nama yang tidak terpakai lagi
+static void fileIndexCompact(FileIndexDir &d)
+{
+    char *names = (char *)fileIndexRealloc(NULL, d.namesCap);
+    if (!names)
+        return;
+    int keep = 0;
+    uint32_t len = 0;
+    for (int i = 0; i < d.count; i++)
+    {
+        FileIndexEntry e = d.entries[i];
+        if (e.deleted)
+            continue;
+        memcpy(names + len, d.names + e.nameOff, e.nameLen);
+        e.nameOff = len;
+        len += e.nameLen;
+        d.entries[keep++] = e;
+    }
+    free(d.names);
+    d.names = names;
+    d.namesLen = len;
+    d.count = keep;
+    d.dead = 0;
+}
+
+static FileIndexDir *fileIndexFind(const String &path)
+{
+    for (int i = 0; i < FILE_INDEX_MAX_DIRS; i++)
+    {
+        FileIndexDir &d = fileIndexDirs[i];
+        if (d.path.length() && d.path == path)
+        {
+            if (d.mountCount != sdMountCount)
+            {
+                fileIndexFree(d); // kartu di-mount ulang, isi mungkin berubah
+                return NULL;
+            }
+            d.lastUse = ++fileIndexClock;
+            return &d;
+        }
+    }
+    return NULL;
+}
+
+// Baca direktori dari kartu ke slot LRU. status: 404 / 500 jika gagal.
+static FileIndexDir *fileIndexBuild(const String &path, int &status)
+{
+    File root = usingSPIMode ? SD.open(path) : SD_MMC.open(path);
+    if (!root || !root.isDirectory())
+    {
+        if (root)
+            root.close();
+        status = 404;
+        return NULL;
+    }
+
+    FileIndexDir *slot = &fileIndexDirs[0];
+    for (int i = 0; i < FILE_INDEX_MAX_DIRS; i++)
+    {
+        if (!fileIndexDirs[i].path.length())
+        {
+            slot = &fileIndexDirs[i];
+            break;
+        }
+        if (fileIndexDirs[i].lastUse < slot->lastUse)
+            slot = &fileIndexDirs[i];
+    }
+    fileIndexFree(*slot);
+
+    unsigned long t0 = millis();
+    File file = root.openNextFile();
+    while (file)
+    {
+        const char *name = file.name();
+        const char *slash = strrchr(name, '/');
+        if (slash)
+            name = slash + 1;
+        if (name[0] != '.' && !fileIndexAppend(*slot, name, strlen(name), file.size(), file.isDirectory()))
+        {
+            file.close();
+            root.close();
+            fileIndexFree(*slot);
+            status = 500;
+            return NULL;
+        }
+        file.close();
+        file = root.openNextFile();
+    }
+    root.close();
+
+    slot->path = path;
+    slot->mountCount = sdMountCount;
+    slot->lastUse = ++fileIndexClock;
+    Serial.printf("📂 Indexed %s: %d entries in %lu ms\n", path.c_str(), slot->live, millis() - t0);
+    return slot;
+}
+
+// Catat file/folder baru atau ukuran baru (overwrite). Direktori yang belum
+// di-cache diabaikan; akan dibaca lengkap saat pertama kali dibuka.
+void fileIndexAdd(const String &fullPath, uint32_t size, bool isDir)
+{
+    String dir, name;
+    fileIndexSplit(fullPath, dir, name);
+    fileIndexLock();
+    FileIndexDir *d = fileIndexFind(dir);
+    if (d && !name.startsWith("."))
+    {
+        int i = fileIndexLookup(*d, name.c_str(), name.length());
+        if (i >= 0)
+            d->entries[i].size = size;
+        else if (!fileIndexAppend(*d, name.c_str(), name.length(), size, isDir))
+            fileIndexFree(*d); // kehabisan memori: baca ulang dari kartu nanti
+    }
+    fileIndexUnlock();
+}
+
+void fileIndexRemove(const String &fullPath)
+{
+    String dir, name;
+    fileIndexSplit(fullPath, dir, name);
+    String self = fileIndexNormalize(fullPath);
+    fileIndexLock();
+    FileIndexDir *d = fileIndexFind(dir);
+    if (d)
+    {
+        int i = fileIndexLookup(*d, name.c_str(), name.length());
+        if (i >= 0)
+        {
+            d->entries[i].deleted = true;
+            d->live--;
+            if (++d->dead > 64 && d->dead > d->live)
+                fileIndexCompact(*d);
+        }
+    }
+    d = fileIndexFind(self);
+    if (d)
+        fileIndexFree(*d);
+    fileIndexUnlock();
+}
+
+// Pastikan direktori path (sudah dinormalisasi) ada di indeks.
+// Return 0 dan jumlah entri di total, atau status HTTP 404/500 jika gagal.
+int fileIndexPrepare(const String &path, int &total)
+{
+    fileIndexLock();
+    int status = 0;
+    FileIndexDir *d = fileIndexFind(path);
+    if (!d)
+        d = fileIndexBuild(path, status);
+    total = d ? d->live : 0;
+    fileIndexUnlock();
+    return d ? 0 : status;
+}
+
+// Tulis maksimal limit entri mulai dari offset sebagai elemen array JSON.
+// Lock dilepas setiap kali buffer perlu dikirim ke socket; posisi raw tetap
+// valid karena task lain hanya menambah entri di akhir. Return jumlah entri.
+int fileIndexWriteEntries(JsonWriter &json, const String &path, int offset, int limit)
+{
+    if (offset < 0)
+        offset = 0;
+    if (limit <= 0)
+        limit = FILE_INDEX_DEFAULT_LIMIT;
+
+    int raw = 0, skipped = 0, sent = 0;
+    bool done = false;
+    while (!done)
+    {
+        fileIndexLock();
+        FileIndexDir *d = fileIndexFind(path);
+        done = !d; // di-invalidasi saat mount ulang: listing berhenti di sini
+        bool first = true; // entri pertama tiap putaran selalu ditulis agar listing maju
+        while (d && sent < limit)
+        {
+            if (raw >= d->count)
+            {
+                done = true;
+                break;
+            }
+            const FileIndexEntry &e = d->entries[raw];
+            if (e.deleted || skipped < offset)
+            {
+                skipped += !e.deleted;
+                raw++;
+                continue;
+            }
+            // Escape terburuk 6x panjang nama + field lain
+            if (!first && json.out().space() < e.nameLen * 6u + 48)
+                break;
+            first = false;
+            json.beginObject();
+            json.key("name");
+            json.value(d->names + e.nameOff, e.nameLen);
+            json.field("isDir", e.isDir);
+            json.field("size", e.size);
+            json.endObject();
+            sent++;
+            raw++;
+        }
+        if (sent >= limit)
+            done = true;
+        fileIndexUnlock();
+        if (!done)
+            json.out().flush();
+    }
+    return sent;
+}
+
+#endif
@@ -0,0 +1,73 @@
+// frame_arena.h - Arena buffer gambar: satu blok, dialokasikan sekali saat boot
+// Sketch menghitung ukuran arena dari resolusi profil kamera aktif (jumlah
+// *ArenaBytes() tiap modul), lalu semua init modul gambar mengambil potongan
+// lewat frameArenaAlloc(). Potongan tidak pernah dibebaskan satu per satu:
+// buffer per frame dipakai ulang per slot pipeline dan ditimpa, jadi setelah
+// setup() tidak ada malloc/free di jalur gambar dan heap tidak terfragmentasi
+// walau alat berjalan berhari-hari.
+// Tanpa frameArenaBegin() (replay di PC, atau arena gagal dialokasikan)
+// frameArenaAlloc() jatuh ke malloc biasa seperti sebelumnya.
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+#ifdef ARDUINO
+#include "esp32-hal-psram.h"
+#define FRAME_ARENA_HEAP_ALLOC(sz) (psramFound() ? ps_malloc(sz) : malloc(sz))
+#else
+#define FRAME_ARENA_HEAP_ALLOC(sz) malloc(sz)
+#endif
+
+#define FRAME_ARENA_ALIGN 8 // cukup untuk int64_t (CclShapeStats)
+#define FRAME_ARENA_ROUND(sz) (((size_t)(sz) + FRAME_ARENA_ALIGN - 1) & ~(size_t)(FRAME_ARENA_ALIGN - 1))
+
+static uint8_t *arenaBase = nullptr;
+static size_t arenaCap = 0;
+static size_t arenaUsed = 0;
+static uint32_t arenaFailures = 0; // permintaan yang tidak muat (ukuran arena kurang)
+
+// Alokasi blok arena; panggil sekali di setup() sebelum init modul gambar
+bool frameArenaBegin(size_t bytes)
+{
+    if (arenaBase)
+        return true;
+    bytes = FRAME_ARENA_ROUND(bytes);
+    arenaBase = (uint8_t *)FRAME_ARENA_HEAP_ALLOC(bytes);
+    if (!arenaBase)
+        return false;
+    arenaCap = bytes;
+    arenaUsed = 0;
+    return true;
+}
+
+// Potongan arena selaras FRAME_ARENA_ALIGN; nullptr jika arena penuh.
+// Tidak menyentuh heap selama arena aktif, juga saat penuh.
+void *frameArenaAlloc(size_t bytes)
+{
+    if (!arenaBase)
+        return FRAME_ARENA_HEAP_ALLOC(bytes);
+    bytes = FRAME_ARENA_ROUND(bytes);
+    if (bytes > arenaCap - arenaUsed)
+    {
+        arenaFailures++;
+        return nullptr;
+    }
+    void *p = arenaBase + arenaUsed;
+    arenaUsed += bytes;
+    return p;
+}
+
+// Untuk jalur gagal di init modul: potongan arena tidak bisa dikembalikan,
+// hanya pointer dari fallback malloc yang di-free
+void frameArenaFree(void *p)
+{
+    uint8_t *b = (uint8_t *)p;
+    if (arenaBase && b >= arenaBase && b < arenaBase + arenaCap)
+        return;
+    free(p);
+}
+
+#endif
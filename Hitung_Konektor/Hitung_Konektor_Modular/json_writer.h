@@ -0,0 +1,278 @@
+// json_writer.h - Penulis respons HTTP streaming dengan buffer tetap
+// ChunkWriter menampung teks di buffer milik pemanggil (biasanya di stack) dan
+// mengirimnya lewat sink setiap kali penuh, jadi memori respons tetap berapa
+// pun panjangnya. JsonWriter di atasnya menangani koma, nesting, dan escape.
+// Sink dipasang oleh sketch: WebServer::sendContent atau httpd_resp_send_chunk.
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define JSON_MAX_DEPTH 16
+#define JSON_PRINTF_MAX 128
+
+// Kirim len byte, return false jika koneksi gagal
+typedef bool (*ChunkSink)(void *ctx, const char *data, size_t len);
+
+class ChunkWriter
+{
+public:
+    ChunkWriter(char *buf, size_t cap, ChunkSink sink, void *ctx)
+        : buf_(buf), cap_(cap), len_(0), sink_(sink), ctx_(ctx), failed_(false) {}
+
+    bool flush()
+    {
+        if (len_ > 0 && !failed_ && !sink_(ctx_, buf_, len_))
+            failed_ = true;
+        len_ = 0;
+        return !failed_;
+    }
+
+    void write(const char *data, size_t n)
+    {
+        while (n > 0)
+        {
+            if (len_ == cap_)
+                flush();
+            size_t k = cap_ - len_ < n ? cap_ - len_ : n;
+            memcpy(buf_ + len_, data, k);
+            len_ += k;
+            data += k;
+            n -= k;
+        }
+    }
+
+    void write(const char *s)
+    {
+        write(s, strlen(s));
+    }
+
+    void put(char c)
+    {
+        if (len_ == cap_)
+            flush();
+        buf_[len_++] = c;
+    }
+
+    // Teks terformat (maks JSON_PRINTF_MAX karakter jika lebih panjang dari buffer)
+    void printf(const char *fmt, ...)
+    {
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vsnprintf(buf_ + len_, cap_ - len_, fmt, ap);
+        va_end(ap);
+        if (n < 0)
+            return;
+        if ((size_t)n < cap_ - len_)
+        {
+            len_ += n;
+            return;
+        }
+        // Tidak muat di sisa buffer tapi muat di buffer kosong: kirim dulu, format ulang di awal
+        if ((size_t)n < cap_)
+        {
+            flush();
+            va_start(ap, fmt);
+            vsnprintf(buf_, cap_, fmt, ap);
+            va_end(ap);
+            len_ = n;
+            return;
+        }
+        // Lebih panjang dari buffer: format ulang ke stack lalu salin per potongan
+        char tmp[JSON_PRINTF_MAX];
+        va_start(ap, fmt);
+        n = vsnprintf(tmp, sizeof(tmp), fmt, ap);
+        va_end(ap);
+        write(tmp, (size_t)n < sizeof(tmp) ? n : sizeof(tmp) - 1);
+    }
+
+    // Kirim sisa buffer; true jika semua chunk terkirim
+    bool finish()
+    {
+        return flush();
+    }
+
+    size_t space() const { return cap_ - len_; }
+    bool failed() const { return failed_; }
+
+private:
+    char *buf_;
+    size_t cap_;
+    size_t len_;
+    ChunkSink sink_;
+    void *ctx_;
+    bool failed_;
+};
+
+class JsonWriter
+{
+public:
+    explicit JsonWriter(ChunkWriter &out) : out_(out), depth_(0), afterKey_(false)
+    {
+        first_[0] = true;
+    }
+
+    void beginObject() { open('{'); }
+    void endObject() { close('}'); }
+    void beginArray() { open('['); }
+    void endArray() { close(']'); }
+
+    void key(const char *k)
+    {
+        separator();
+        string(k, strlen(k));
+        out_.put(':');
+        afterKey_ = true;
+    }
+
+    void value(const char *s)
+    {
+        separator();
+        string(s, strlen(s));
+    }
+
+    void value(const char *s, size_t len)
+    {
+        separator();
+        string(s, len);
+    }
+
+    void value(bool b)
+    {
+        separator();
+        out_.write(b ? "true" : "false");
+    }
+
+    void value(int v) { integer(v < 0, v < 0 ? 0ULL - (unsigned long long)v : (unsigned long long)v); }
+    void value(unsigned v) { integer(false, v); }
+    void value(long v) { integer(v < 0, v < 0 ? 0ULL - (unsigned long long)v : (unsigned long long)v); }
+    void value(unsigned long v) { integer(false, v); }
+    void value(long long v) { integer(v < 0, v < 0 ? 0ULL - (unsigned long long)v : (unsigned long long)v); }
+    void value(unsigned long long v) { integer(false, v); }
+
+    // Bilangan pecahan dengan jumlah desimal tetap
+    void value(double v, int decimals)
+    {
+        separator();
+        if (v != v || v > 1e300 || v < -1e300)
+            out_.write("null"); // NaN / inf tidak valid di JSON
+        else
+            out_.printf("%.*f", decimals, v);
+    }
+
+    void null()
+    {
+        separator();
+        out_.write("null");
+    }
+
+    template <typename T>
+    void field(const char *k, T v)
+    {
+        key(k);
+        value(v);
+    }
+
+    void field(const char *k, double v, int decimals)
+    {
+        key(k);
+        value(v, decimals);
+    }
+
+    ChunkWriter &out() { return out_; }
+
+private:
+    void separator()
+    {
+        if (afterKey_)
+        {
+            afterKey_ = false;
+            return;
+        }
+        if (!first_[depth_])
+            out_.put(',');
+        first_[depth_] = false;
+    }
+
+    void open(char c)
+    {
+        separator();
+        out_.put(c);
+        if (depth_ + 1 < JSON_MAX_DEPTH)
+            depth_++;
+        first_[depth_] = true;
+    }
+
+    void close(char c)
+    {
+        out_.put(c);
+        if (depth_ > 0)
+            depth_--;
+    }
+
+    // Konversi integer tanpa printf (jalur terpanas: array ukuran blob, dsb.)
+    void integer(bool negative, unsigned long long mag)
+    {
+        separator();
+        char tmp[21];
+        int i = sizeof(tmp);
+        do
+        {
+            tmp[--i] = '0' + (char)(mag % 10);
+            mag /= 10;
+        } while (mag);
+        if (negative)
+            tmp[--i] = '-';
+        out_.write(tmp + i, sizeof(tmp) - i);
+    }
+
+    void string(const char *s, size_t len)
+    {
+        static const char hex[] = "0123456789abcdef";
+        out_.put('"');
+        size_t start = 0;
+        for (size_t i = 0; i < len; i++)
+        {
+            uint8_t c = (uint8_t)s[i];
+            if (c >= 0x20 && c != '"' && c != '\\')
+                continue;
+            out_.write(s + start, i - start);
+            start = i + 1;
+            out_.put('\\');
+            switch (c)
+            {
+            case '"':
+                out_.put('"');
+                break;
+            case '\\':
+                out_.put('\\');
+                break;
+            case '\n':
+                out_.put('n');
+                break;
+            case '\r':
+                out_.put('r');
+                break;
+            case '\t':
+                out_.put('t');
+                break;
+            default:
+                out_.write("u00");
+                out_.put(hex[c >> 4]);
+                out_.put(hex[c & 0xF]);
+            }
+        }
+        out_.write(s + start, len - start);
+        out_.put('"');
+    }
+
+    ChunkWriter &out_;
+    int depth_;
+    bool afterKey_;
+    bool first_[JSON_MAX_DEPTH];
+};
+
+#endif
@@ -6,93 +6,105 @@
 #include <SD.h>
 #include <SD_MMC.h>
 #include <SPI.h>
+#include <Preferences.h>
+#include <atomic>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 #include "config.h" // Include for SD pin definitions
 
 // Function declarations
 bool initializeSDCard();
-bool forceReinitializeSDCard();
-bool checkSDCardStatus();
+bool mountSDCard(int attempts);
+void unmountSDCard();
+bool sdProbeCard();
 bool isSDCardAvailable();
 bool saveImageToSD(uint8_t *buffer, size_t length, String filepath);
 String generateImageFileName(String prefix);
+uint32_t nextCaptureSeq();
 void printSDCardInfo();
 
+// Status kartu dipublikasikan oleh task sd_monitor (sd_monitor.h); handler
+// hanya membaca atomic ini dan tidak pernah mount ulang di jalur request
+enum SdState : uint8_t
+{
+    SD_STATE_UNMOUNTED,
+    SD_STATE_READY,
+    SD_STATE_FAILED
+};
+
 // Global variables
-bool sdCardInitialized = false;
+std::atomic<uint8_t> sdState{SD_STATE_UNMOUNTED};
 bool usingSPIMode = false;
-unsigned long lastSDCheckTime = 0;
+uint32_t sdMountCount = 0; // naik setiap mount berhasil; cache indeks direktori lama jadi tidak valid
 const unsigned long SD_CHECK_INTERVAL = 5000; // Check every 5 seconds
 
-// ==== Force SD Card Re-initialization ====
-bool forceReinitializeSDCard()
+// Dipegang selama mount/unmount/probe dan selama task lain menulis file,
+// agar kartu tidak di-unmount di tengah penulisan
+SemaphoreHandle_t sdMountMutex = NULL;
+
+static inline bool sdCardReady()
+{
+    return sdState.load(std::memory_order_acquire) == SD_STATE_READY;
+}
+
+static inline void sdLock()
+{
+    if (sdMountMutex)
+        xSemaphoreTake(sdMountMutex, portMAX_DELAY);
+}
+
+static inline void sdUnlock()
 {
-    Serial.println("🔄 Force re-initializing SD Card...");
-    
-    // Reset state
-    sdCardInitialized = false;
-    
-    // End existing connections
+    if (sdMountMutex)
+        xSemaphoreGive(sdMountMutex);
+}
+
+// ==== Unmount SD Card ====
+void unmountSDCard()
+{
+    sdState.store(SD_STATE_UNMOUNTED, std::memory_order_release);
     if (usingSPIMode) {
         SD.end();
     } else {
         SD_MMC.end();
     }
-    
-    delay(500); // Wait for cleanup
-    
-    return initializeSDCard();
 }
 
-// ==== Check SD Card Connection Status ====
-bool checkSDCardStatus()
+// ==== Check SD Card Connection ====
+// Membuka root directory; hanya dipanggil task sd_monitor
+bool sdProbeCard()
 {
-    if (!sdCardInitialized) {
-        return false;
-    }
-    
-    // Periodic check to ensure SD card is still accessible
-    if (millis() - lastSDCheckTime > SD_CHECK_INTERVAL) {
-        lastSDCheckTime = millis();
-        
-        bool isAccessible = false;
-        if (usingSPIMode) {
-            File testFile = SD.open("/");
-            isAccessible = testFile && testFile.isDirectory();
-            if (testFile) testFile.close();
-        } else {
-            File testFile = SD_MMC.open("/");
-            isAccessible = testFile && testFile.isDirectory();
-            if (testFile) testFile.close();
-        }
-        
-        if (!isAccessible) {
-            Serial.println("⚠️ SD Card connection lost, attempting reconnection...");
-            return forceReinitializeSDCard();
-        }
-    }
-    
-    return true;
+    File testFile = usingSPIMode ? SD.open("/") : SD_MMC.open("/");
+    bool isAccessible = testFile && testFile.isDirectory();
+    if (testFile) testFile.close();
+    return isAccessible;
 }
 
 // ==== SD Card Initialization ====
+// Mount blocking dengan retry; hanya untuk setup() sebelum task sd_monitor jalan
 bool initializeSDCard()
 {
-    if (sdCardInitialized && checkSDCardStatus())
+    if (!sdMountMutex)
+        sdMountMutex = xSemaphoreCreateMutex();
+    if (sdCardReady())
     {
         return true;
     }
+    return mountSDCard(3);
+}
 
+// ==== SD Card Mount ====
+// attempts = percobaan per mode (MMC lalu SPI); jeda 1 s hanya di antara retry
+bool mountSDCard(int attempts)
+{
     Serial.println("🔄 Initializing SD Card...");
 
-    // Reset state first
-    sdCardInitialized = false;
-    
     // Try built-in SD card slot first (MMC mode) with specific pins
     Serial.println("Trying SD_MMC (built-in slot)...");
     Serial.printf("Using pins - CLK: %d, CMD: %d, DATA: %d\n", SD_MMC_CLK_PIN, SD_MMC_CMD_PIN, SD_MMC_D0_PIN);
 
     // Configure pins for SD_MMC with retry mechanism
-    int retryCount = 3;
+    int retryCount = attempts;
     while (retryCount > 0) {
         if (SD_MMC.setPins(SD_MMC_CLK_PIN, SD_MMC_CMD_PIN, SD_MMC_D0_PIN))
         {
@@ -114,9 +126,9 @@ bool initializeSDCard()
                         Serial.println("✅ SD_MMC initialized successfully");
                         Serial.printf("Card Type: %d\n", cardType);
                         Serial.printf("Card Size: %lluMB\n", SD_MMC.cardSize() / (1024 * 1024));
-                        sdCardInitialized = true;
                         usingSPIMode = false;
-                        lastSDCheckTime = millis();
+                        sdMountCount++;
+                        sdState.store(SD_STATE_READY, std::memory_order_release);
                         return true;
                     } else {
                         Serial.println("❌ SD_MMC root directory test failed");
@@ -151,7 +163,7 @@ bool initializeSDCard()
     Serial.printf("Using SPI pins - SCK: %d, MISO: %d, MOSI: %d, CS: %d\n",
                   SD_SPI_SCK_PIN, SD_SPI_MISO_PIN, SD_SPI_MOSI_PIN, SD_SPI_CS_PIN);
 
-    retryCount = 3;
+    retryCount = attempts;
     while (retryCount > 0) {
         SPI.begin(SD_SPI_SCK_PIN, SD_SPI_MISO_PIN, SD_SPI_MOSI_PIN, SD_SPI_CS_PIN);
         if (SD.begin(SD_SPI_CS_PIN, SPI, 4000000)) // Lower frequency for stability
@@ -169,9 +181,9 @@ bool initializeSDCard()
                     Serial.println("✅ SD SPI initialized successfully");
                     Serial.printf("Card Type: %d\n", cardType);
                     Serial.printf("Card Size: %lluMB\n", SD.cardSize() / (1024 * 1024));
-                    sdCardInitialized = true;
                     usingSPIMode = true;
-                    lastSDCheckTime = millis();
+                    sdMountCount++;
+                    sdState.store(SD_STATE_READY, std::memory_order_release);
                     return true;
                 } else {
                     Serial.println("❌ SD SPI root directory test failed");
@@ -197,14 +209,40 @@ bool initializeSDCard()
     }
 
     Serial.println("❌ SD Card initialization failed completely");
+    sdState.store(SD_STATE_FAILED, std::memory_order_release);
     return false;
 }
 
-// ==== Generate filename with timestamp ====
+// ==== Persistent capture sequence ====
+// Nomor urut naik terus walau reboot. NVS hanya ditulis sekali per blok
+// CAPTURE_SEQ_BLOCK nomor; setelah reboot sisa blok dilewati (tetap monoton).
+#define CAPTURE_SEQ_BLOCK 1000
+
+static Preferences capturePrefs;
+static uint32_t captureSeq = 0;
+static uint32_t captureSeqLimit = 0; // nomor pertama yang belum dicadangkan di NVS
+
+uint32_t nextCaptureSeq()
+{
+    if (captureSeq >= captureSeqLimit)
+    {
+        capturePrefs.begin("capture", false);
+        if (captureSeqLimit == 0)
+            captureSeq = capturePrefs.getUInt("next", 1);
+        captureSeqLimit = captureSeq + CAPTURE_SEQ_BLOCK;
+        capturePrefs.putUInt("next", captureSeqLimit);
+        capturePrefs.end();
+    }
+    return captureSeq++;
+}
+
+// ==== Generate filename with sequence number ====
+// Nomor dari NVS, bukan millis(): tidak bentrok dengan file sebelum reboot
 String generateImageFileName(String prefix = "IMG")
 {
-    unsigned long timestamp = millis();
-    return prefix + "_" + String(timestamp) + ".jpg";
+    char seq[12];
+    snprintf(seq, sizeof(seq), "%08u", (unsigned)nextCaptureSeq());
+    return prefix + "_" + seq + ".jpg";
 }
 
 // ==== Save image data to SD card ====
@@ -212,7 +250,7 @@ bool saveImageToSD(uint8_t *buffer, size_t length, String filepath)
 {
     Serial.printf("💾 Attempting to save %d bytes to: %s\n", length, filepath.c_str());
 
-    if (!initializeSDCard())
+    if (!isSDCardAvailable())
     {
         Serial.println("❌ SD Card not available for saving");
         return false;
@@ -253,15 +291,16 @@ bool saveImageToSD(uint8_t *buffer, size_t length, String filepath)
 }
 
 // ==== Check if SD card is available ====
+// O(1): membaca status terakhir dari sd_monitor, tanpa I/O ke kartu
 bool isSDCardAvailable()
 {
-    return initializeSDCard();
+    return sdCardReady();
 }
 
 // ==== Get SD card info ====
 void printSDCardInfo()
 {
-    if (!initializeSDCard())
+    if (!isSDCardAvailable())
     {
         Serial.println("❌ SD Card not available");
         return;
@@ -0,0 +1,121 @@
+// sd_monitor.h - Pemantau kesehatan SD card di task latar
+// Handler HTTP hanya membaca sdState (atomic, O(1)) lewat isSDCardAvailable().
+// Task ini mengecek root directory setiap SD_CHECK_INTERVAL saat kartu siap,
+// dan saat kartu hilang mencoba mount ulang dengan jeda berlipat (1 s, 2 s,
+// 4 s ... maks 60 s) sehingga retry + delay() tidak pernah memblok WebServer.
+// Selama container dataset terbuka kartu tidak di-unmount (file-nya masih
+// dipegang task SD writer); unmount ditunda sampai container ditutup.
+#ifndef SD_MONITOR_H
+#define SD_MONITOR_H
+
+#include "sd_functions.h"
+#include "dataset_container.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define SD_MONITOR_BACKOFF_MIN 1000
+#define SD_MONITOR_BACKOFF_MAX 60000
+
+static TaskHandle_t sdMonitorTask = NULL;
+static volatile bool sdMonitorForce = false;     // /sd_reconnect: unmount + mount walau kartu terlihat sehat
+static volatile uint32_t sdMountAttempts = 0;    // percobaan mount ulang yang sudah selesai
+static volatile uint32_t sdMonitorBackoffMs = SD_MONITOR_BACKOFF_MIN;
+static volatile uint32_t sdMonitorNextMs = 0;    // millis() percobaan berikutnya
+static volatile bool sdMonitorDeferred = false;  // unmount ditunda karena container dataset terbuka
+
+// Operasi file gagal di handler: minta pengecekan segera, tanpa menunggu di sini
+void sdMonitorReportError()
+{
+    if (sdMonitorTask)
+        xTaskNotifyGive(sdMonitorTask);
+}
+
+// Reconnect manual: mount ulang di task monitor, hasil dibaca lewat sdMountAttempts
+void sdMonitorRequestRemount()
+{
+    sdMonitorForce = true;
+    sdMonitorBackoffMs = SD_MONITOR_BACKOFF_MIN;
+    if (sdMonitorTask)
+        xTaskNotifyGive(sdMonitorTask);
+}
+
+const char *sdStateName()
+{
+    switch (sdState.load())
+    {
+    case SD_STATE_READY:
+        return "ready";
+    case SD_STATE_FAILED:
+        return "failed";
+    default:
+        return "unmounted";
+    }
+}
+
+static void sdMonitorLoop(void *)
+{
+    for (;;)
+    {
+        uint32_t wait = sdCardReady() ? SD_CHECK_INTERVAL : sdMonitorBackoffMs;
+        sdMonitorNextMs = millis() + wait;
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(wait));
+
+        bool force = sdMonitorForce;
+        sdMonitorForce = false;
+
+        sdLock();
+        if (sdCardReady())
+        {
+            if (!force && sdProbeCard())
+            {
+                sdUnlock();
+                continue;
+            }
+            if (datasetContainerIsOpen())
+            {
+                // File container masih terbuka di SD writer: jangan end() di bawahnya
+                if (!sdMonitorDeferred)
+                    Serial.println("⏸️ SD Card unmount deferred until the dataset container is closed");
+                sdMonitorDeferred = true;
+                sdMonitorForce = sdMonitorForce || force;
+                sdUnlock();
+                continue;
+            }
+            sdMonitorDeferred = false;
+            Serial.println(force ? "🔄 SD Card reconnect requested" : "⚠️ SD Card connection lost, attempting reconnection...");
+            unmountSDCard();
+            vTaskDelay(pdMS_TO_TICKS(500)); // Wait for cleanup
+        }
+
+        // Satu percobaan per mode; jeda antar percobaan diatur backoff di atas
+        bool ok = mountSDCard(1);
+        sdMountAttempts++;
+        sdUnlock();
+
+        if (ok)
+        {
+            sdMonitorBackoffMs = SD_MONITOR_BACKOFF_MIN;
+            Serial.printf("✅ SD Card reconnected (%s mode)\n", usingSPIMode ? "SPI" : "MMC");
+        }
+        else
+        {
+            uint32_t next = sdMonitorBackoffMs * 2;
+            sdMonitorBackoffMs = next > SD_MONITOR_BACKOFF_MAX ? SD_MONITOR_BACKOFF_MAX : next;
+            Serial.printf("⏳ SD Card retry in %u s\n", (unsigned)(sdMonitorBackoffMs / 1000));
+        }
+    }
+}
+
+bool startSdMonitor()
+{
+    // Prioritas 1 di core 0, sama dengan SD writer; mount tidak bersaing dengan loop()
+    if (xTaskCreatePinnedToCore(sdMonitorLoop, "sd_monitor", 4096, NULL, 1, &sdMonitorTask, 0) != pdPASS)
+    {
+        Serial.println("❌ SD monitor task creation failed");
+        return false;
+    }
+    Serial.println("✅ SD monitor started");
+    return true;
+}
+
+#endif
@@ -0,0 +1,300 @@
+// sd_writer.h - Penulisan JPEG ke SD secara asinkron
+// Handler hanya menyalin JPEG ke ring buffer (PSRAM) lalu langsung membalas.
+// Task prioritas rendah di core 0 mengosongkan ring ke SD: status kartu dibaca
+// dari sd_monitor (tanpa I/O) dan data ditulis per blok 32 KB (ukuran cluster
+// FAT32 kartu SDHC) agar FATFS menulis sektor penuh tanpa buffer antara.
+#ifndef SD_WRITER_H
+#define SD_WRITER_H
+
+#include <atomic>
+#include "sd_functions.h"
+#include "sd_monitor.h"
+#include "file_index.h"
+#include "dataset_container.h"
+#include "metrics.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+// Ukuran ring harus pangkat 2 agar posisi uint32_t yang overflow tetap konsisten
+#define SD_WRITER_RING_PSRAM (1024 * 1024) // ~20 JPEG VGA
+#define SD_WRITER_RING_SRAM (64 * 1024)
+#define SD_WRITER_BLOCK (32 * 1024)
+#define SD_WRITER_PATH_MAX 64
+#define SD_WRITER_WRAP 0xFFFFFFFF // penanda: sisa ring dilewati, lanjut dari awal
+
+// Jenis entri: file JPEG sendiri, atau perintah/frame untuk container dataset
+enum SdWriterKind : uint32_t
+{
+    SDW_FILE,
+    SDW_DATASET_OPEN,  // path = container baru, seq = nomor pertama
+    SDW_DATASET_FRAME, // data ditambahkan ke container yang terbuka
+    SDW_DATASET_CLOSE
+};
+
+// Header setiap entri di ring, diikuti data JPEG (total rata 4 byte)
+struct SdWriterEntry
+{
+    uint32_t len;   // panjang JPEG, atau SD_WRITER_WRAP
+    uint32_t total; // header + data + padding
+    uint32_t kind;
+    uint32_t seq;
+    uint32_t timestampMs;
+    char path[SD_WRITER_PATH_MAX];
+};
+
+static uint8_t *sdwRing = NULL;
+static uint32_t sdwCap = 0;
+static std::atomic<uint32_t> sdwHead{0}; // posisi tulis, hanya diubah producer
+static std::atomic<uint32_t> sdwTail{0}; // posisi baca, hanya diubah task writer
+static TaskHandle_t sdwTask = NULL;
+
+// Statistik untuk /system_info
+static std::atomic<uint32_t> sdwQueued{0};
+static volatile uint32_t sdwWritten = 0;
+static std::atomic<uint32_t> sdwDropped{0}; // ring penuh atau SD tidak tersedia
+static volatile uint32_t sdwFailed = 0;        // open/write gagal
+static volatile uint32_t sdwBytesPerSec = 0;
+
+static inline uint32_t sdwAlign(uint32_t n)
+{
+    return (n + 3) & ~3u;
+}
+
+uint32_t sdWriterQueueDepth()
+{
+    return sdwQueued.load() - sdwWritten - sdwFailed - sdwDropped.load();
+}
+
+uint32_t sdWriterPendingBytes()
+{
+    return sdwHead.load() - sdwTail.load();
+}
+
+// Salin entri ke ring dan bangunkan task writer. Hanya boleh dipanggil dari
+// satu task (loop() / WebServer). Return false jika ring penuh.
+static bool sdWriterPush(uint32_t kind, const uint8_t *data, size_t length, const String &filepath, uint32_t seq)
+{
+    if (!sdwRing || filepath.length() >= SD_WRITER_PATH_MAX)
+        return false;
+
+    uint32_t need = sdwAlign(sizeof(SdWriterEntry) + length);
+    uint32_t head = sdwHead.load(std::memory_order_relaxed);
+    uint32_t used = head - sdwTail.load(std::memory_order_acquire);
+    uint32_t off = head % sdwCap;
+    uint32_t skip = sdwCap - off < need ? sdwCap - off : 0;
+
+    if (need > sdwCap || used + skip + need > sdwCap)
+    {
+        sdwDropped++;
+        sdwQueued++;
+        Serial.println("⚠️ SD write queue full, image dropped: " + filepath);
+        return false;
+    }
+
+    // Entri tidak pernah terpotong di ujung ring
+    if (skip)
+    {
+        if (skip >= sizeof(uint32_t))
+            ((SdWriterEntry *)(sdwRing + off))->len = SD_WRITER_WRAP;
+        head += skip;
+        off = 0;
+    }
+    SdWriterEntry *e = (SdWriterEntry *)(sdwRing + off);
+    e->len = length;
+    e->total = need;
+    e->kind = kind;
+    e->seq = seq;
+    e->timestampMs = millis();
+    strncpy(e->path, filepath.c_str(), SD_WRITER_PATH_MAX);
+    if (length)
+        memcpy(sdwRing + off + sizeof(SdWriterEntry), data, length);
+
+    sdwHead.store(head + need, std::memory_order_release);
+    sdwQueued++;
+    if (sdwTask)
+        xTaskNotifyGive(sdwTask);
+    return true;
+}
+
+bool sdWriterEnqueue(const uint8_t *data, size_t length, const String &filepath)
+{
+    return sdWriterPush(SDW_FILE, data, length, filepath, 0);
+}
+
+// Frame dataset untuk container yang dibuka lewat sdWriterDatasetOpen()
+bool sdWriterEnqueueFrame(const uint8_t *data, size_t length, uint32_t seq)
+{
+    return sdWriterPush(SDW_DATASET_FRAME, data, length, String(), seq);
+}
+
+bool sdWriterDatasetOpen(const String &path, uint32_t firstSeq)
+{
+    return sdWriterPush(SDW_DATASET_OPEN, NULL, 0, path, firstSeq);
+}
+
+bool sdWriterDatasetClose()
+{
+    return sdWriterPush(SDW_DATASET_CLOSE, NULL, 0, String(), 0);
+}
+
+static bool sdWriterWriteFile(const SdWriterEntry *e)
+{
+    fs::FS &fs = usingSPIMode ? (fs::FS &)SD : (fs::FS &)SD_MMC;
+    File file = fs.open(e->path, FILE_WRITE);
+    if (!file)
+    {
+        Serial.printf("❌ SD writer: failed to open %s\n", e->path);
+        return false;
+    }
+    const uint8_t *p = (const uint8_t *)(e + 1);
+    size_t left = e->len;
+    while (left > 0)
+    {
+        size_t n = left < SD_WRITER_BLOCK ? left : SD_WRITER_BLOCK;
+        if (file.write(p, n) != n)
+            break;
+        p += n;
+        left -= n;
+    }
+    file.close();
+    if (left > 0)
+    {
+        Serial.printf("❌ SD writer: incomplete write %s (%u/%u)\n", e->path,
+                      (unsigned)(e->len - left), (unsigned)e->len);
+        return false;
+    }
+    return true;
+}
+
+// Satu entri; return true jika berhasil ditulis
+static bool sdWriterProcess(const SdWriterEntry *e)
+{
+    switch (e->kind)
+    {
+    case SDW_DATASET_OPEN:
+    {
+        bool ok = datasetContainerOpen(e->path, e->seq);
+        dsContainerState.store(ok ? DS_CONTAINER_OPEN : DS_CONTAINER_FAILED);
+        return ok;
+    }
+    case SDW_DATASET_FRAME:
+        return datasetContainerAppend((const uint8_t *)(e + 1), e->len, e->seq, e->timestampMs);
+    case SDW_DATASET_CLOSE:
+    {
+        String path = dsFilePath;
+        uint32_t size = datasetContainerClose();
+        // Open berikutnya mungkin sudah menunggu di antrian (OPENING): jangan ditimpa
+        int open = DS_CONTAINER_OPEN;
+        dsContainerState.compare_exchange_strong(open, DS_CONTAINER_CLOSED);
+        if (size)
+            fileIndexAdd(path, size, false);
+        if (sdMonitorDeferred)
+            sdMonitorReportError(); // unmount yang tertunda bisa jalan sekarang
+        return size > 0;
+    }
+    default:
+        if (!sdWriterWriteFile(e))
+            return false;
+        fileIndexAdd(e->path, e->len, false);
+        Serial.printf("✅ Image saved: %s (%u bytes)\n", e->path, (unsigned)e->len);
+        return true;
+    }
+}
+
+// Open/close container (pre-alokasi, truncate) tidak ikut histogram sd_write
+static bool sdWriterTimedProcess(const SdWriterEntry *e)
+{
+    if (e->kind != SDW_FILE && e->kind != SDW_DATASET_FRAME)
+        return sdWriterProcess(e);
+    int64_t t0 = esp_timer_get_time();
+    bool ok = sdWriterProcess(e);
+    if (ok)
+        metricObserveSince(STAGE_SD_WRITE, t0);
+    return ok;
+}
+
+static void sdWriterLoop(void *)
+{
+    uint32_t windowStart = millis();
+    uint32_t windowBytes = 0;
+
+    for (;;)
+    {
+        uint32_t tail = sdwTail.load(std::memory_order_relaxed);
+        if (tail == sdwHead.load(std::memory_order_acquire))
+        {
+            // Antrian kosong (akhir burst): header container cukup diperbarui sekali di sini
+            if (datasetContainerIsOpen())
+            {
+                sdLock();
+                datasetContainerSync();
+                sdUnlock();
+            }
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1000));
+        }
+        else
+        {
+            uint32_t off = tail % sdwCap;
+            SdWriterEntry *e = (SdWriterEntry *)(sdwRing + off);
+            if (sdwCap - off < sizeof(SdWriterEntry) || e->len == SD_WRITER_WRAP)
+            {
+                sdwTail.store(tail + (sdwCap - off), std::memory_order_release);
+                continue;
+            }
+
+            // Kartu tidak di-unmount sd_monitor selama file ini ditulis
+            sdLock();
+            if (!sdCardReady())
+            {
+                sdwDropped++;
+                if (e->kind == SDW_DATASET_OPEN)
+                    dsContainerState.store(DS_CONTAINER_FAILED);
+            }
+            else if (sdWriterTimedProcess(e))
+            {
+                sdwWritten++;
+                windowBytes += e->len;
+            }
+            else
+            {
+                sdwFailed++;
+                sdMonitorReportError(); // cek kartu sekarang, jangan tunggu interval
+            }
+            sdUnlock();
+            sdwTail.store(tail + e->total, std::memory_order_release);
+        }
+
+        uint32_t now = millis();
+        if (now - windowStart >= 1000)
+        {
+            sdwBytesPerSec = (uint64_t)windowBytes * 1000 / (now - windowStart);
+            windowBytes = 0;
+            windowStart = now;
+        }
+    }
+}
+
+bool startSdWriter()
+{
+    sdwCap = psramFound() ? SD_WRITER_RING_PSRAM : SD_WRITER_RING_SRAM;
+    sdwRing = psramFound() ? (uint8_t *)ps_malloc(sdwCap) : (uint8_t *)malloc(sdwCap);
+    if (!sdwRing)
+    {
+        Serial.println("❌ SD writer: ring buffer allocation failed");
+        sdwCap = 0;
+        return false;
+    }
+    // Prioritas 1 di core 0: di bawah stream server (2) dan stack WiFi
+    if (xTaskCreatePinnedToCore(sdWriterLoop, "sd_writer", 4096, NULL, 1, &sdwTask, 0) != pdPASS)
+    {
+        Serial.println("❌ SD writer task creation failed");
+        free(sdwRing);
+        sdwRing = NULL;
+        sdwCap = 0;
+        return false;
+    }
+    Serial.printf("✅ SD writer started (%u KB queue)\n", (unsigned)(sdwCap / 1024));
+    return true;
+}
+
+#endif
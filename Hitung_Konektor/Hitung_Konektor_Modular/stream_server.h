@@ -0,0 +1,476 @@
+// stream_server.h - Server MJPEG terpisah di port 81 dengan fan-out multi-viewer
+// Satu task memegang socket listen dan semua viewer, semuanya non-blocking dan
+// dilayani lewat select(). Setiap frame diambil sekali dari kamera ke salah satu
+// StreamFrame ber-refcount, lalu tiap viewer mengirim (writev: header part + JPEG
+// + trailer) dari offset-nya sendiri. Frame JPEG dikirim langsung dari fb->buf dan
+// fb ditahan sampai viewer terakhir selesai; paling banyak fb_count - 1 fb ditahan
+// agar driver dan pengambil frame lain tetap punya buffer. Frame RGB565 (hasil
+// encode di camJpegBuf yang dipakai bersama), frame saat batas itu tercapai, dan
+// frame yang masih dikirim ketika profil kamera diganti disalin ke buffer arena.
+// Viewer yang frame sebelumnya belum terkirim habis dilewati (tidak ditunggu), jadi
+// viewer lambat hanya menurunkan FPS-nya sendiri; tanpa kemajuan STREAM_STALL_MS ia
+// diputus. Request line juga dibaca non-blocking, klien yang lambat mengirim request
+// tidak menahan stream lain. WebServer di port 80 (file manager) tidak pernah diblok.
+#ifndef STREAM_SERVER_H
+#define STREAM_SERVER_H
+
+#include <errno.h>
+#include <esp_camera.h>
+#include "lwip/sockets.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "frame_arena.h"
+#include "metrics.h"
+#include "camera_profiles.h"
+
+#define STREAM_PORT 81
+#define STREAM_MAX_CLIENTS 4
+#define STREAM_FRAMES 3           // frame terbaru + frame lama yang masih dikirim viewer lambat
+#define STREAM_STALL_MS 2000      // viewer tanpa byte terkirim selama ini diputus
+#define STREAM_REQUEST_MS 2000    // batas waktu menerima request line
+#define STREAM_PART_HEADER_MAX 96
+#define STREAM_BOUNDARY "frame"
+
+struct StreamFrame
+{
+    camera_fb_t *fb;    // != NULL: JPEG dikirim langsung dari fb->buf
+    uint8_t *buf;       // salinan JPEG di frame arena (jika fb tidak ditahan)
+    const uint8_t *jpg; // fb->buf atau buf
+    size_t jpgLen;
+    char hdr[STREAM_PART_HEADER_MAX];
+    size_t hdrLen;
+    size_t len;         // hdrLen + jpgLen + "\r\n"
+    int refs;           // viewer yang masih mengirim frame ini (hanya diakses task stream)
+};
+
+struct StreamViewer
+{
+    int fd;            // -1 = slot kosong
+    bool streaming;    // false = masih menunggu request line
+    char req[16];      // awal request line, cukup untuk "GET /stream"
+    uint8_t reqLen;
+    const uint8_t *sendPtr; // sisa header HTTP yang belum terkirim (frame == NULL)
+    size_t sendLeft;
+    StreamFrame *frame;     // frame yang sedang dikirim, NULL = header HTTP
+    uint32_t lastProgressMs;
+    int64_t sendStartUs;
+    int metricSlot;         // slot statistik FPS di metrics.h
+};
+
+static const char streamOkHeader[] = "HTTP/1.1 200 OK\r\n"
+                                     "Content-Type: multipart/x-mixed-replace; boundary=" STREAM_BOUNDARY "\r\n"
+                                     "Access-Control-Allow-Origin: *\r\n"
+                                     "Cache-Control: no-cache\r\n"
+                                     "Connection: close\r\n\r\n";
+
+static StreamViewer streamViewers[STREAM_MAX_CLIENTS];
+static StreamFrame streamFrames[STREAM_FRAMES];
+static size_t streamFrameCap = 0;
+static int streamFbHeld = 0;    // fb yang sedang ditahan StreamFrame
+static int streamFbHoldMax = 0; // fb_count - 1, 0 = selalu salin
+static volatile int streamClientCount = 0;
+static volatile uint32_t streamFramesSent = 0;
+static volatile uint32_t streamFbErrors = 0;     // camFbGet() gagal (bukan saat ganti profil)
+static volatile uint32_t streamFramesSkipped = 0; // viewer masih mengirim frame sebelumnya
+static volatile uint32_t streamFramesTooLarge = 0;
+static volatile uint32_t streamFramesCopied = 0; // frame dikirim dari salinan arena, bukan dari fb
+static TaskHandle_t streamTaskHandle = NULL;
+
+static inline void streamSetNonBlocking(int fd)
+{
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+}
+
+// Ref terakhir mengembalikan fb ke driver
+static void streamUnrefFrame(StreamFrame *f)
+{
+    if (--f->refs > 0 || !f->fb)
+        return;
+    camFbReturn(f->fb);
+    f->fb = NULL;
+    streamFbHeld--;
+}
+
+static void streamReleaseFrame(StreamViewer &v)
+{
+    if (v.frame)
+        streamUnrefFrame(v.frame);
+    v.frame = NULL;
+    v.sendLeft = 0;
+}
+
+static void streamCloseClient(StreamViewer &v)
+{
+    if (v.fd < 0)
+        return;
+    close(v.fd);
+    v.fd = -1;
+    streamReleaseFrame(v);
+    if (v.streaming)
+    {
+        v.streaming = false;
+        metricStreamClose(v.metricSlot);
+        streamClientCount--;
+        Serial.printf("📺 Stream viewer disconnected (%d active)\n", streamClientCount);
+    }
+}
+
+// Respons error pendek: coba kirim sekali tanpa menunggu, lalu tutup
+static void streamReject(int fd, const char *text)
+{
+    send(fd, text, strlen(text), MSG_DONTWAIT);
+    close(fd);
+}
+
+// Terima koneksi baru; request line dibaca nanti oleh streamReadRequest()
+static void streamAcceptClients(int listenFd)
+{
+    for (;;)
+    {
+        int fd = accept(listenFd, NULL, NULL);
+        if (fd < 0)
+            return;
+        streamSetNonBlocking(fd);
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        StreamViewer *v = NULL;
+        for (int i = 0; i < STREAM_MAX_CLIENTS && !v; i++)
+            if (streamViewers[i].fd < 0)
+                v = &streamViewers[i];
+        if (!v)
+        {
+            streamReject(fd, "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+            Serial.println("⚠️ Stream viewer rejected: too many viewers");
+            continue;
+        }
+        *v = StreamViewer();
+        v->fd = fd;
+        v->lastProgressMs = millis();
+    }
+}
+
+// Kumpulkan awal request line tanpa blok; setelah cocok kirim header multipart
+static void streamReadRequest(StreamViewer &v)
+{
+    int n = recv(v.fd, v.req + v.reqLen, sizeof(v.req) - v.reqLen, MSG_DONTWAIT);
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK))
+    {
+        close(v.fd);
+        v.fd = -1;
+        return;
+    }
+    if (n > 0)
+        v.reqLen += n;
+    if (v.reqLen < 11)
+    {
+        if (millis() - v.lastProgressMs > STREAM_REQUEST_MS)
+        {
+            close(v.fd);
+            v.fd = -1;
+        }
+        return;
+    }
+    if (strncmp(v.req, "GET /stream", 11) != 0)
+    {
+        streamReject(v.fd, "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+        v.fd = -1;
+        return;
+    }
+    // Sisa request (header browser) tidak dibaca; Connection: close
+    v.streaming = true;
+    v.sendPtr = (const uint8_t *)streamOkHeader;
+    v.sendLeft = sizeof(streamOkHeader) - 1;
+    v.frame = NULL;
+    v.metricSlot = metricStreamOpen();
+    streamClientCount++;
+    Serial.printf("📺 Stream viewer connected (%d active)\n", streamClientCount);
+}
+
+// Bagian frame yang belum terkirim mulai dari offset off
+static int streamFrameIov(const StreamFrame &f, size_t off, struct iovec *iov)
+{
+    const struct iovec parts[3] = {
+        {(void *)f.hdr, f.hdrLen},
+        {(void *)f.jpg, f.jpgLen},
+        {(void *)"\r\n", 2},
+    };
+    int cnt = 0;
+    for (int i = 0; i < 3; i++)
+    {
+        if (off >= parts[i].iov_len)
+        {
+            off -= parts[i].iov_len;
+            continue;
+        }
+        iov[cnt].iov_base = (uint8_t *)parts[i].iov_base + off;
+        iov[cnt].iov_len = parts[i].iov_len - off;
+        off = 0;
+        cnt++;
+    }
+    return cnt;
+}
+
+// Kirim sebanyak yang diterima socket sekarang; false jika viewer harus diputus
+static bool streamPump(StreamViewer &v)
+{
+    while (v.sendLeft > 0)
+    {
+        ssize_t n;
+        if (v.frame)
+        {
+            struct iovec iov[3];
+            int cnt = streamFrameIov(*v.frame, v.frame->len - v.sendLeft, iov);
+            n = writev(v.fd, iov, cnt);
+        }
+        else
+            n = send(v.fd, v.sendPtr, v.sendLeft, MSG_DONTWAIT);
+        if (n < 0)
+        {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return millis() - v.lastProgressMs <= STREAM_STALL_MS;
+            return false;
+        }
+        if (!v.frame)
+            v.sendPtr += n;
+        v.sendLeft -= n;
+        v.lastProgressMs = millis();
+    }
+    if (v.frame)
+    {
+        metricObserveSince(STAGE_SEND, v.sendStartUs);
+        metricStreamFrame(v.metricSlot, v.frame->len);
+        streamReleaseFrame(v);
+    }
+    return true;
+}
+
+static StreamFrame *streamFreeFrame()
+{
+    for (int i = 0; i < STREAM_FRAMES; i++)
+        if (streamFrames[i].refs == 0)
+            return &streamFrames[i];
+    return NULL;
+}
+
+// Capture satu frame ke f (refs = 1 untuk pemanggil); false jika kamera tidak memberi frame
+static bool streamCaptureInto(StreamFrame &f)
+{
+    int64_t t0 = esp_timer_get_time();
+    camera_fb_t *fb = camFbGet();
+    if (!fb)
+    {
+        if (!camSwitching.load())
+            streamFbErrors++;
+        return false;
+    }
+    metricObserveSince(STAGE_FB_GET, t0);
+
+    if (fb->format == PIXFORMAT_JPEG && streamFbHeld < streamFbHoldMax)
+    {
+        // Zero-copy: fb ditahan sampai viewer terakhir selesai mengirim
+        f.fb = fb;
+        f.jpg = fb->buf;
+        f.jpgLen = fb->len;
+        streamFbHeld++;
+    }
+    else
+    {
+        // Profil RGB565 (count): encode sekali per frame untuk semua viewer. Hasilnya
+        // di camJpegBuf (di bawah mutex), jadi disalin seperti fb yang tidak boleh ditahan.
+        uint8_t *jpg;
+        size_t jpgLen;
+        if (!camFrameToJpeg(fb, &jpg, &jpgLen))
+        {
+            streamFbErrors++;
+            camFbReturn(fb);
+            return false;
+        }
+        bool ok = jpgLen <= streamFrameCap;
+        if (ok)
+        {
+            memcpy(f.buf, jpg, jpgLen);
+            f.jpg = f.buf;
+            f.jpgLen = jpgLen;
+            streamFramesCopied++;
+        }
+        else
+            streamFramesTooLarge++;
+        camJpegRelease(jpg);
+        camFbReturn(fb);
+        if (!ok)
+            return false;
+    }
+    f.hdrLen = snprintf(f.hdr, sizeof(f.hdr),
+                        "--" STREAM_BOUNDARY "\r\nContent-Type: image/jpeg\r\nContent-Length: %u\r\n\r\n",
+                        (unsigned)f.jpgLen);
+    f.len = f.hdrLen + f.jpgLen + 2;
+    f.refs = 1;
+    return true;
+}
+
+// Ganti profil menunggu semua fb kembali: sisa frame yang masih dikirim viewer
+// lambat dipindah ke buffer arena, viewer-nya lanjut dari offset yang sama
+static void streamDetachFrames()
+{
+    for (int i = 0; i < STREAM_FRAMES; i++)
+    {
+        StreamFrame &f = streamFrames[i];
+        if (!f.fb)
+            continue;
+        if (f.jpgLen <= streamFrameCap)
+        {
+            memcpy(f.buf, f.jpg, f.jpgLen);
+            f.jpg = f.buf;
+            camFbReturn(f.fb);
+            f.fb = NULL;
+            streamFbHeld--;
+            streamFramesCopied++;
+            continue;
+        }
+        // Tidak muat di arena: putus viewer-nya, ref terakhir mengembalikan fb
+        for (int j = 0; j < STREAM_MAX_CLIENTS; j++)
+            if (streamViewers[j].fd >= 0 && streamViewers[j].frame == &f)
+                streamCloseClient(streamViewers[j]);
+    }
+}
+
+static void streamTask(void *)
+{
+    int listenFd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(STREAM_PORT);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    int one = 1;
+    if (listenFd >= 0)
+        setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (listenFd < 0 || bind(listenFd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(listenFd, STREAM_MAX_CLIENTS) != 0)
+    {
+        Serial.println("❌ Stream server: socket setup failed");
+        if (listenFd >= 0)
+            close(listenFd);
+        streamTaskHandle = NULL;
+        vTaskDelete(NULL);
+        return;
+    }
+    streamSetNonBlocking(listenFd);
+
+    for (;;)
+    {
+        // Tunggu koneksi baru, request line, atau socket yang bisa ditulis lagi
+        fd_set rd, wr;
+        FD_ZERO(&rd);
+        FD_ZERO(&wr);
+        FD_SET(listenFd, &rd);
+        int maxFd = listenFd;
+        bool idleViewer = false; // ada viewer yang siap menerima frame baru
+        for (int i = 0; i < STREAM_MAX_CLIENTS; i++)
+        {
+            StreamViewer &v = streamViewers[i];
+            if (v.fd < 0)
+                continue;
+            if (!v.streaming)
+                FD_SET(v.fd, &rd);
+            else if (v.sendLeft > 0)
+                FD_SET(v.fd, &wr);
+            else
+                idleViewer = true;
+            if (v.fd > maxFd)
+                maxFd = v.fd;
+        }
+        // Ada viewer menganggur: capture segera; select hanya mengecek tanpa menunggu
+        struct timeval tv = {0, idleViewer ? 0 : 50 * 1000};
+        select(maxFd + 1, &rd, &wr, NULL, &tv);
+
+        if (FD_ISSET(listenFd, &rd))
+            streamAcceptClients(listenFd);
+        for (int i = 0; i < STREAM_MAX_CLIENTS; i++)
+        {
+            StreamViewer &v = streamViewers[i];
+            if (v.fd < 0)
+                continue;
+            if (!v.streaming)
+                streamReadRequest(v);
+            else if (v.sendLeft > 0 && !streamPump(v))
+                streamCloseClient(v);
+        }
+        if (streamFbHeld > 0 && camSwitching.load())
+            streamDetachFrames();
+
+        if (!idleViewer)
+            continue;
+        StreamFrame *f = streamFreeFrame();
+        if (!f)
+        {
+            // Semua frame masih dipegang viewer lambat: tunggu salah satu selesai
+            vTaskDelay(pdMS_TO_TICKS(5));
+            continue;
+        }
+        if (!streamCaptureInto(*f))
+        {
+            vTaskDelay(pdMS_TO_TICKS(20));
+            continue;
+        }
+
+        // Frame baru hanya untuk viewer yang frame sebelumnya sudah terkirim habis
+        int64_t now = esp_timer_get_time();
+        for (int i = 0; i < STREAM_MAX_CLIENTS; i++)
+        {
+            StreamViewer &v = streamViewers[i];
+            if (v.fd < 0 || !v.streaming)
+                continue;
+            if (v.sendLeft > 0)
+            {
+                streamFramesSkipped++;
+                continue;
+            }
+            f->refs++;
+            v.frame = f;
+            v.sendLeft = f->len;
+            v.sendStartUs = now;
+            if (!streamPump(v))
+                streamCloseClient(v);
+        }
+        streamUnrefFrame(f); // ref capture; tanpa viewer fb langsung kembali
+        streamFramesSent++;
+    }
+}
+
+// Buffer salinan: JPEG terbesar yang bisa keluar dari driver (fb JPEG esp32-camera = w*h/5)
+size_t streamArenaBytes(int maxW, int maxH)
+{
+    return STREAM_FRAMES * FRAME_ARENA_ROUND((size_t)maxW * maxH / 5);
+}
+
+// Dipanggil setelah kamera di-init (camConfig.fb_count sudah terisi)
+bool startStreamServer(int maxW, int maxH)
+{
+    streamFrameCap = (size_t)maxW * maxH / 5;
+    for (int i = 0; i < STREAM_FRAMES; i++)
+    {
+        streamFrames[i].buf = (uint8_t *)frameArenaAlloc(streamFrameCap);
+        streamFrames[i].fb = NULL;
+        streamFrames[i].refs = 0;
+        if (!streamFrames[i].buf)
+        {
+            Serial.println("❌ Stream server: frame buffer allocation failed");
+            return false;
+        }
+    }
+    // Satu fb selalu tersisa untuk driver, /capture, dataset dan thumbnail
+    streamFbHoldMax = camConfig.fb_count > 1 ? camConfig.fb_count - 1 : 0;
+    for (int i = 0; i < STREAM_MAX_CLIENTS; i++)
+        streamViewers[i].fd = -1;
+    // Core 0 bersama stack WiFi; loop() (WebServer) tetap di core 1
+    if (xTaskCreatePinnedToCore(streamTask, "mjpeg_stream", 4096, NULL, 2, &streamTaskHandle, 0) != pdPASS)
+    {
+        Serial.println("❌ Stream server task creation failed");
+        return false;
+    }
+    Serial.printf("✅ MJPEG stream server on port %d\n", STREAM_PORT);
+    return true;
+}
+
+#endif
@@ -0,0 +1,185 @@
+// thumbnail.h - Thumbnail JPEG untuk file browser
+// JPEG sumber dibaca langsung dari SD dan didekode pada skala 1/8: TJpgDec
+// hanya memakai koefisien DC tiap blok 8x8 (tanpa IDCT penuh), jadi SVGA
+// 800x600 menjadi 100x75 dengan biaya kecil. Hasil di-encode ulang dengan
+// jpegEncode() dan disimpan di /.thumbs agar permintaan berikutnya cukup dibaca.
+// Buffer RGB, JPEG dan encoder diambil sekali dari frame arena (thumbInit), seukuran
+// frame JPEG terbesar kamera / 8; sumber yang lebih besar tidak dibuatkan thumbnail.
+#ifndef THUMBNAIL_H
+#define THUMBNAIL_H
+
+#include "esp_camera.h"
+#include "esp_jpg_decode.h"
+#include "sd_functions.h"
+#include "frame_arena.h"
+#include "jpeg_encoder.h"
+#include "metrics.h"
+
+#define THUMB_DIR "/.thumbs" // diawali titik: tidak ikut listing /files
+#define THUMB_QUALITY 60
+#define THUMB_JPEG_CAP (32 * 1024) // 200x150 kualitas 60 biasanya < 15 KB
+
+// Dipakai handler /thumb di loop WebServer saja, jadi satu set buffer cukup
+static uint8_t *thumbRgb = NULL;
+static size_t thumbRgbCap = 0;
+static uint8_t *thumbJpg = NULL;
+static JpegEncoder *thumbEnc = NULL;
+
+struct ThumbDecode
+{
+    File *file;
+    uint8_t *rgb;
+    uint16_t w, h;
+};
+
+static inline fs::FS &thumbFS()
+{
+    return usingSPIMode ? (fs::FS &)SD : (fs::FS &)SD_MMC;
+}
+
+// Nama cache: path sumber diratakan + ukuran & waktu tulis, jadi file yang
+// ditimpa otomatis mendapat thumbnail baru
+String thumbPathFor(const String &filepath, uint32_t size, time_t mtime)
+{
+    String flat = filepath.startsWith("/") ? filepath.substring(1) : filepath;
+    flat.replace("/", "~");
+    char key[32];
+    snprintf(key, sizeof(key), "_%x-%lx.jpg", (unsigned)size, (unsigned long)mtime);
+    return String(THUMB_DIR) + "/" + flat + key;
+}
+
+static size_t thumbRead(void *arg, size_t index, uint8_t *buf, size_t len)
+{
+    ThumbDecode *t = (ThumbDecode *)arg;
+    if (!buf)
+        return t->file->seek(index + len) ? len : 0; // decoder melewati segmen
+    return t->file->read(buf, len);
+}
+
+static bool thumbWrite(void *arg, uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint8_t *data)
+{
+    ThumbDecode *t = (ThumbDecode *)arg;
+    if (!data)
+    {
+        // Panggilan awal membawa ukuran output, panggilan akhir diabaikan
+        if (x == 0 && y == 0)
+        {
+            if ((size_t)w * h * 3 > thumbRgbCap)
+                return false;
+            t->w = w;
+            t->h = h;
+            t->rgb = thumbRgb;
+            return true;
+        }
+        return true;
+    }
+    // Blok RGB dari decoder, urutan R G B sama dengan JPEG_ENC_RGB888
+    for (uint16_t row = 0; row < h; row++, data += (size_t)w * 3)
+        memcpy(t->rgb + ((size_t)(y + row) * t->w + x) * 3, data, (size_t)w * 3);
+    return true;
+}
+
+static size_t thumbJpegWrite(void *arg, size_t index, const void *data, size_t len)
+{
+    if (index + len > THUMB_JPEG_CAP)
+        return 0;
+    memcpy(thumbJpg + index, data, len);
+    *(size_t *)arg = index + len;
+    return len;
+}
+
+size_t thumbArenaBytes(int maxW, int maxH)
+{
+    return FRAME_ARENA_ROUND((size_t)((maxW + 7) / 8) * ((maxH + 7) / 8) * 3) + FRAME_ARENA_ROUND(THUMB_JPEG_CAP) +
+           jpegEncArenaBytes();
+}
+
+// Buffer untuk sumber JPEG maksimal maxW x maxH
+bool thumbInit(int maxW, int maxH)
+{
+    if (thumbRgb)
+        return true;
+    size_t rgbCap = (size_t)((maxW + 7) / 8) * ((maxH + 7) / 8) * 3;
+    thumbRgb = (uint8_t *)frameArenaAlloc(rgbCap);
+    thumbJpg = (uint8_t *)frameArenaAlloc(THUMB_JPEG_CAP);
+    thumbEnc = jpegEncCreate();
+    if (!thumbRgb || !thumbJpg || !thumbEnc)
+    {
+        frameArenaFree(thumbRgb);
+        frameArenaFree(thumbJpg);
+        frameArenaFree(thumbEnc);
+        thumbRgb = NULL;
+        thumbJpg = NULL;
+        thumbEnc = NULL;
+        return false;
+    }
+    thumbRgbCap = rgbCap;
+    return true;
+}
+
+// Buat thumbnail dari JPEG src. *out menunjuk buffer internal yang berlaku
+// sampai thumbGenerate() berikutnya (jangan di-free).
+bool thumbGenerate(File &src, const uint8_t **out, size_t *outLen)
+{
+    ThumbDecode t = {&src, NULL, 0, 0};
+    *out = NULL;
+    *outLen = 0;
+    if (!thumbRgb || !src.seek(0))
+        return false;
+    int64_t t0 = esp_timer_get_time();
+    bool ok = esp_jpg_decode(src.size(), JPG_SCALE_8X, thumbRead, thumbWrite, &t) == ESP_OK && t.rgb;
+    if (ok)
+    {
+        metricObserveSince(STAGE_CONVERT, t0);
+        t0 = esp_timer_get_time();
+        size_t len = 0;
+        ok = jpegEncode(thumbEnc, t.rgb, t.w, t.h, JPEG_ENC_RGB888, THUMB_QUALITY, thumbJpegWrite, &len) && len;
+        if (ok)
+        {
+            metricObserveSince(STAGE_ENCODE, t0);
+            *out = thumbJpg;
+            *outLen = len;
+        }
+    }
+    return ok;
+}
+
+// Simpan ke cache; gagal simpan tidak fatal, thumbnail tetap dikirim.
+// sdLock() agar sd_monitor tidak unmount di tengah penulisan.
+bool thumbStore(const String &thumbPath, const uint8_t *data, size_t len)
+{
+    sdLock();
+    bool ok = false;
+    if (sdCardReady())
+    {
+        fs::FS &fs = thumbFS();
+        if (!fs.exists(THUMB_DIR))
+            fs.mkdir(THUMB_DIR);
+        File f = fs.open(thumbPath, FILE_WRITE);
+        if (f)
+        {
+            size_t written = f.write(data, len);
+            f.close();
+            ok = written == len;
+            if (!ok)
+                fs.remove(thumbPath);
+        }
+    }
+    sdUnlock();
+    return ok;
+}
+
+// Hapus thumbnail milik filepath; panggil sebelum file sumber dihapus
+void thumbRemoveFor(const String &filepath)
+{
+    fs::FS &fs = thumbFS();
+    File src = fs.open(filepath);
+    if (!src)
+        return;
+    String thumbPath = src.isDirectory() ? String() : thumbPathFor(filepath, src.size(), src.getLastWrite());
+    src.close();
+    if (thumbPath.length() && fs.exists(thumbPath))
+        fs.remove(thumbPath);
+}
+
+#endif
@@ -0,0 +1,114 @@
+#!/usr/bin/env python3
+"""extract_dataset.py - Ekstrak JPEG dari container dataset (.hkd)
+
+Format (little-endian), lihat dataset_container.h:
+  header  "HKDS" u16 version, u16 headerSize, u32 firstSeq, u32 frameCount,
+          u32 indexOffset, u32 dataEnd, u32 reserved[2]
+  record  "HKFR" u32 len, u32 seq, u32 timestampMs, JPEG, padding ke 4 byte
+  index   "HKIX" u32 count, count x (u32 offset, u32 seq)
+
+Container yang belum ditutup (listrik mati saat burst) tidak punya index;
+record dipindai berurutan sampai magic tidak cocok atau seq tidak lagi naik.
+Area pre-alokasi bisa berisi record lama dari cluster bekas, tapi seq-nya
+selalu lebih kecil karena nomor urut di NVS monoton.
+
+Pemakaian:
+  python3 extract_dataset.py DS_00001000.hkd -o frames/
+  python3 extract_dataset.py DS_00001000.hkd --list
+"""
+
+import argparse
+import os
+import struct
+import sys
+
+HEADER = struct.Struct("<4sHHIIIIII")
+RECORD = struct.Struct("<4sIII")
+INDEX_ENTRY = struct.Struct("<II")
+
+
+def read_header(data):
+    if len(data) < HEADER.size:
+        raise ValueError("file too small")
+    magic, version, header_size, first_seq, count, index_offset, data_end, _, _ = HEADER.unpack_from(data, 0)
+    if magic != b"HKDS":
+        raise ValueError("not a dataset container (bad magic)")
+    if version != 1:
+        raise ValueError("unsupported container version %d" % version)
+    return {
+        "header_size": header_size,
+        "first_seq": first_seq,
+        "count": count,
+        "index_offset": index_offset,
+        "data_end": data_end,
+    }
+
+
+def read_record(data, offset):
+    if offset + RECORD.size > len(data):
+        return None
+    magic, length, seq, ts = RECORD.unpack_from(data, offset)
+    start = offset + RECORD.size
+    if magic != b"HKFR" or start + length > len(data):
+        return None
+    return seq, ts, data[start:start + length], start + length + (-length & 3)
+
+
+def iter_frames(data, header):
+    """Yield (seq, timestampMs, jpeg). Memakai index jika ada, jika tidak memindai record."""
+    index_offset = header["index_offset"]
+    if index_offset and data[index_offset:index_offset + 4] == b"HKIX":
+        (count,) = struct.unpack_from("<I", data, index_offset + 4)
+        for i in range(count):
+            offset, _ = INDEX_ENTRY.unpack_from(data, index_offset + 8 + i * INDEX_ENTRY.size)
+            rec = read_record(data, offset)
+            if rec is None:
+                raise ValueError("index entry %d points to a bad record at %d" % (i, offset))
+            yield rec[:3]
+        return
+
+    print("warning: container was not closed, scanning records", file=sys.stderr)
+    offset = header["header_size"]
+    last_seq = header["first_seq"] - 1
+    while True:
+        rec = read_record(data, offset)
+        if rec is None or rec[0] <= last_seq:
+            break
+        last_seq = rec[0]
+        yield rec[:3]
+        offset = rec[3]
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Extract JPEG frames from a .hkd dataset container")
+    parser.add_argument("container")
+    parser.add_argument("-o", "--output", default=None, help="output directory (default: <container>_frames)")
+    parser.add_argument("--list", action="store_true", help="only list frames")
+    args = parser.parse_args()
+
+    with open(args.container, "rb") as f:
+        data = f.read()
+    try:
+        header = read_header(data)
+    except ValueError as e:
+        sys.exit("%s: %s" % (args.container, e))
+
+    out_dir = args.output or os.path.splitext(args.container)[0] + "_frames"
+    if not args.list:
+        os.makedirs(out_dir, exist_ok=True)
+
+    n = 0
+    for seq, ts, jpeg in iter_frames(data, header):
+        if args.list:
+            print("%08u  %10u ms  %7u bytes" % (seq, ts, len(jpeg)))
+        else:
+            with open(os.path.join(out_dir, "FRAME_%08u.jpg" % seq), "wb") as f:
+                f.write(jpeg)
+        n += 1
+
+    print("%d frames (first seq %u)%s" % (n, header["first_seq"], "" if args.list else " -> " + out_dir),
+          file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -3,20 +3,39 @@
 #define WEB_HANDLERS_H
 
 #include <WebServer.h>
+#include "esp_heap_caps.h"
 #include "sd_functions.h"
+#include "sd_monitor.h"
+#include "sd_writer.h"
+#include "file_index.h"
+#include "json_writer.h"
+#include "thumbnail.h"
+#include "dataset.h"
+#include "stream_server.h"
+#include "metrics.h"
+#include "camera_profiles.h"
+
+#define RESPONSE_CHUNK 512 // buffer respons di stack, dikirim per HTTP chunk
+#define DOWNLOAD_BUF_SIZE (16 * 1024) // buffer baca file, internal RAM DMA-capable
+#define DOWNLOAD_SECTOR 512
 
 // Function declarations
 void addCORSHeaders(WebServer &server);
 void handleSystemInfo(WebServer &server);
+void handleMetrics(WebServer &server);
 void handleCapture(WebServer &server);
 void handleCameraTest(WebServer &server);
+void handleCameraProfile(WebServer &server);
+void handleDataset(WebServer &server);
 void handleFileList(WebServer &server);
 void handleFileDownload(WebServer &server);
+void handleThumbnail(WebServer &server);
 void handleFileUpload(WebServer &server);
 void handleFileUploadResponse(WebServer &server);
 void handleFileDelete(WebServer &server);
 void handleCreateFolder(WebServer &server);
 void handleSDCardReconnect(WebServer &server);
+void handleSDStatus(WebServer &server);
 void handleOptions(WebServer &server);
 
 // Helper function untuk CORS headers
@@ -24,7 +43,29 @@ void addCORSHeaders(WebServer &server)
 {
     server.sendHeader("Access-Control-Allow-Origin", "*");
     server.sendHeader("Access-Control-Allow-Methods", "GET, POST, OPTIONS");
-    server.sendHeader("Access-Control-Allow-Headers", "Content-Type");
+    server.sendHeader("Access-Control-Allow-Headers", "Content-Type, Range, If-None-Match");
+    server.sendHeader("Access-Control-Expose-Headers", "Content-Range, Accept-Ranges, ETag");
+}
+
+// Sink ChunkWriter: setiap flush dikirim sebagai satu HTTP chunk
+static bool webServerChunkSink(void *ctx, const char *data, size_t len)
+{
+    WebServer *server = (WebServer *)ctx;
+    server->sendContent(data, len);
+    return server->client().connected();
+}
+
+// Header respons chunked; body ditulis lewat ChunkWriter lalu endChunked()
+static void beginChunked(WebServer &server, int code, const char *contentType)
+{
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(code, contentType, "");
+}
+
+static void endChunked(WebServer &server, ChunkWriter &out)
+{
+    out.finish();
+    server.sendContent(""); // chunk terakhir (panjang 0)
 }
 
 // ==== System Info Handler ====
@@ -32,50 +73,124 @@ void handleSystemInfo(WebServer &server)
 {
     addCORSHeaders(server);
 
-    String info = "ESP32-S3 Camera System\n";
-    info += "Free Heap: " + String(ESP.getFreeHeap()) + " bytes\n";
-    info += "Total Heap: " + String(ESP.getHeapSize()) + " bytes\n";
-    info += "Chip Model: " + String(ESP.getChipModel()) + "\n";
-    info += "CPU Frequency: " + String(ESP.getCpuFreqMHz()) + " MHz\n";
-    info += "Flash Size: " + String(ESP.getFlashChipSize()) + " bytes\n";
-    info += "WiFi Status: " + String(WiFi.getMode() == WIFI_AP ? "Access Point Active" : "Disconnected") + "\n";
-    info += "AP IP Address: " + WiFi.softAPIP().toString() + "\n";
-    info += "Connected Clients: " + String(WiFi.softAPgetStationNum()) + "\n";
-
-    // SD Card status
-    info += "SD Card: ";
-    if (checkSDCardStatus()) {
-        info += "Available (" + String(usingSPIMode ? "SPI" : "MMC") + " mode)\n";
+    char buf[RESPONSE_CHUNK];
+    beginChunked(server, 200, "text/plain");
+    ChunkWriter out(buf, sizeof(buf), webServerChunkSink, &server);
+
+    out.printf("ESP32-S3 Camera System\n");
+    out.printf("Free Heap: %u bytes\n", (unsigned)ESP.getFreeHeap());
+    out.printf("Total Heap: %u bytes\n", (unsigned)ESP.getHeapSize());
+    out.printf("Chip Model: %s\n", ESP.getChipModel());
+    out.printf("CPU Frequency: %u MHz\n", (unsigned)ESP.getCpuFreqMHz());
+    out.printf("Flash Size: %u bytes\n", (unsigned)ESP.getFlashChipSize());
+    out.printf("WiFi Status: %s\n", WiFi.getMode() == WIFI_AP ? "Access Point Active" : "Disconnected");
+    out.printf("AP IP Address: %s\n", WiFi.softAPIP().toString().c_str());
+    out.printf("Connected Clients: %d\n", WiFi.softAPgetStationNum());
+
+    // SD Card status (dari sd_monitor; kartu tidak di-probe di sini)
+    out.printf("SD Card: ");
+    if (isSDCardAvailable()) {
+        out.printf("Available (%s mode)\n", usingSPIMode ? "SPI" : "MMC");
         if (usingSPIMode) {
-            info += "SD Card Size: " + String(SD.cardSize() / (1024 * 1024)) + " MB\n";
-            info += "SD Card Used: " + String(SD.usedBytes() / (1024 * 1024)) + " MB\n";
+            out.printf("SD Card Size: %llu MB\n", SD.cardSize() / (1024 * 1024));
+            out.printf("SD Card Used: %llu MB\n", SD.usedBytes() / (1024 * 1024));
         } else {
-            info += "SD Card Size: " + String(SD_MMC.cardSize() / (1024 * 1024)) + " MB\n";
-            info += "SD Card Used: " + String(SD_MMC.usedBytes() / (1024 * 1024)) + " MB\n";
+            out.printf("SD Card Size: %llu MB\n", SD_MMC.cardSize() / (1024 * 1024));
+            out.printf("SD Card Used: %llu MB\n", SD_MMC.usedBytes() / (1024 * 1024));
         }
     } else {
-        info += "Not Available\n";
+        long retryMs = (long)(sdMonitorNextMs - millis());
+        out.printf("Not Available (%s, retry in %ld s)\n", sdStateName(), retryMs > 0 ? retryMs / 1000 : 0);
     }
+    out.printf("SD Remount Attempts: %u (mounted %u times)\n", (unsigned)sdMountAttempts, (unsigned)sdMountCount);
 
-    server.send(200, "text/plain", info);
+    // SD writer asinkron
+    out.printf("SD Write Queue: %u images (%u KB)\n", (unsigned)sdWriterQueueDepth(), (unsigned)(sdWriterPendingBytes() / 1024));
+    out.printf("SD Write Rate: %.1f KB/s\n", sdwBytesPerSec / 1024.0);
+    out.printf("SD Writes: %u saved, %u dropped, %u failed\n", (unsigned)sdwWritten, (unsigned)sdwDropped.load(), (unsigned)sdwFailed);
+
+    endChunked(server, out);
+}
+
+// ==== Metrics Handler ====
+// Format teks Prometheus untuk scraper lokal; histogram tahap dari metrics.h
+void handleMetrics(WebServer &server)
+{
+    addCORSHeaders(server);
+
+    char buf[RESPONSE_CHUNK];
+    beginChunked(server, 200, METRICS_CONTENT_TYPE);
+    ChunkWriter out(buf, sizeof(buf), webServerChunkSink, &server);
+
+    metricsWriteCommon(out);
+    metricsGauge(out, "camera_stream_clients", "Connected MJPEG viewers", streamClientCount);
+    metricsCounter(out, "camera_stream_captures_total", "Frames captured for the MJPEG fan-out", streamFramesSent);
+    metricsCounter(out, "camera_fb_errors_total", "Camera returned no frame outside a profile switch", streamFbErrors);
+    metricsHeader(out, "camera_stream_frames_skipped_total", "counter", "Frames not sent to a viewer");
+    out.printf("camera_stream_frames_skipped_total{reason=\"viewer_busy\"} %u\n", (unsigned)streamFramesSkipped);
+    out.printf("camera_stream_frames_skipped_total{reason=\"too_large\"} %u\n", (unsigned)streamFramesTooLarge);
+    metricsCounter(out, "camera_stream_frames_copied_total", "Stream frames sent from an arena copy instead of the camera buffer", streamFramesCopied);
+    metricsHeader(out, "camera_frame_arena_bytes", "gauge", "Boot-time image buffer arena");
+    out.printf("camera_frame_arena_bytes{state=\"capacity\"} %u\n", (unsigned)arenaCap);
+    out.printf("camera_frame_arena_bytes{state=\"used\"} %u\n", (unsigned)arenaUsed);
+    metricsCounter(out, "camera_frame_arena_alloc_failures_total", "Image buffer requests that did not fit the arena", arenaFailures);
+    cameraProfileWriteMetrics(out);
+
+    metricsHeader(out, "camera_frames_dropped_total", "counter", "Frames dropped before reaching the SD card");
+    out.printf("camera_frames_dropped_total{reason=\"sd_queue\"} %u\n", (unsigned)sdwDropped.load());
+    out.printf("camera_frames_dropped_total{reason=\"sd_failed\"} %u\n", (unsigned)sdwFailed);
+    metricsCounter(out, "sd_writes_total", "Files and dataset frames written to SD", sdwWritten);
+    metricsGauge(out, "sd_write_queue_depth", "Entries waiting in the SD writer ring", sdWriterQueueDepth());
+    metricsGauge(out, "sd_write_queue_bytes", "Bytes waiting in the SD writer ring", sdWriterPendingBytes());
+    metricsGauge(out, "sd_write_bytes_per_second", "SD writer throughput over the last second", sdwBytesPerSec);
+    metricsGauge(out, "sd_card_ready", "1 if the SD card is mounted", isSDCardAvailable() ? 1 : 0);
+
+    endChunked(server, out);
 }
 
 // ==== SD Card Reconnect Handler ====
+// Mount ulang dikerjakan task sd_monitor; klien memantau hasilnya lewat /sd_status
 void handleSDCardReconnect(WebServer &server)
 {
     addCORSHeaders(server);
     
     Serial.println("🔄 Manual SD card reconnect requested");
     
-    bool success = forceReinitializeSDCard();
-    
-    if (success) {
-        String response = "{\"success\":true,\"message\":\"SD card reconnected successfully\",";
-        response += "\"mode\":\"" + String(usingSPIMode ? "SPI" : "MMC") + "\"}";
-        server.send(200, "application/json", response);
-    } else {
-        server.send(500, "application/json", "{\"success\":false,\"error\":\"Failed to reconnect SD card\"}");
-    }
+    uint32_t attempt = sdMountAttempts;
+    sdMonitorRequestRemount();
+    bool deferred = datasetContainerIsOpen();
+
+    char buf[RESPONSE_CHUNK];
+    beginChunked(server, 202, "application/json");
+    ChunkWriter out(buf, sizeof(buf), webServerChunkSink, &server);
+    JsonWriter json(out);
+    json.beginObject();
+    json.field("success", true);
+    json.field("pending", true);
+    json.field("deferred", deferred); // menunggu container dataset ditutup
+    json.field("attempt", attempt);
+    json.endObject();
+    endChunked(server, out);
+}
+
+// ==== SD Card Status Handler ====
+void handleSDStatus(WebServer &server)
+{
+    addCORSHeaders(server);
+
+    long retryMs = (long)(sdMonitorNextMs - millis());
+    char buf[RESPONSE_CHUNK];
+    beginChunked(server, 200, "application/json");
+    ChunkWriter out(buf, sizeof(buf), webServerChunkSink, &server);
+    JsonWriter json(out);
+    json.beginObject();
+    json.field("state", sdStateName());
+    json.field("mode", usingSPIMode ? "SPI" : "MMC");
+    json.field("mounts", sdMountCount);
+    json.field("attempts", sdMountAttempts);
+    json.field("retry_in_ms", isSDCardAvailable() || retryMs < 0 ? 0L : retryMs);
+    json.endObject();
+    endChunked(server, out);
 }
 
 // ==== Capture Image Handler ====
@@ -85,7 +200,7 @@ void handleCapture(WebServer &server)
     addCORSHeaders(server);
 
     // Check if camera is available
-    camera_fb_t *fb = esp_camera_fb_get();
+    camera_fb_t *fb = camFbGet();
     if (!fb)
     {
         Serial.println("❌ Camera capture failed - no frame buffer");
@@ -95,39 +210,102 @@ void handleCapture(WebServer &server)
 
     Serial.printf("✅ Frame captured: %d bytes\n", fb->len);
 
-    // Check SD card before saving
-    if (!initializeSDCard() || !checkSDCardStatus()) {
-        Serial.println("❌ SD Card not available for capture - attempting reconnection");
-        esp_camera_fb_return(fb);
-        if (!forceReinitializeSDCard()) {
-            server.send(500, "application/json", "{\"success\":false,\"error\":\"SD Card not available for saving image\"}");
-            return;
-        }
-        Serial.println("✅ SD Card reconnected for capture");
+    // Status dari sd_monitor, O(1); mount ulang tidak pernah terjadi di sini
+    if (!isSDCardAvailable()) {
+        camFbReturn(fb);
+        server.send(500, "application/json", "{\"success\":false,\"error\":\"SD Card not available for saving image\"}");
+        return;
     }
 
     // Generate filename
     String filename = generateImageFileName("CAPTURE");
     String filepath = "/" + filename;
-    Serial.printf("📁 Saving to: %s (SD Mode: %s)\n", filepath.c_str(), usingSPIMode ? "SPI" : "MMC");
 
-    // Save to SD card
-    bool saved = saveImageToSD(fb->buf, fb->len, filepath);
-    esp_camera_fb_return(fb);
+    // Salin ke antrian SD writer, buffer kamera langsung dikembalikan.
+    // Profil count (RGB565) di-encode dulu ke JPEG.
+    uint8_t *jpg;
+    size_t jpgLen;
+    bool queued = false;
+    if (camFrameToJpeg(fb, &jpg, &jpgLen))
+    {
+        queued = sdWriterEnqueue(jpg, jpgLen, filepath);
+        camJpegRelease(jpg);
+    }
+    camFbReturn(fb);
 
-    if (saved)
+    if (queued)
     {
-        String response = "{\"success\":true,\"filename\":\"" + filename + "\",\"path\":\"" + filepath + "\"}";
-        Serial.println("✅ Image capture successful: " + filename);
-        server.send(200, "application/json", response);
+        Serial.printf("📁 Queued for SD: %s (%u in queue)\n", filepath.c_str(), (unsigned)sdWriterQueueDepth());
+        char buf[RESPONSE_CHUNK];
+        beginChunked(server, 200, "application/json");
+        ChunkWriter out(buf, sizeof(buf), webServerChunkSink, &server);
+        JsonWriter json(out);
+        json.beginObject();
+        json.field("success", true);
+        json.field("queued", true);
+        json.field("filename", filename.c_str());
+        json.field("path", filepath.c_str());
+        json.endObject();
+        endChunked(server, out);
     }
     else
     {
-        Serial.println("❌ Failed to save image to SD card");
-        server.send(500, "application/json", "{\"success\":false,\"error\":\"Failed to save image to SD card\"}");
+        server.send(503, "application/json", "{\"success\":false,\"error\":\"SD write queue full\"}");
     }
 }
 
+// ==== Dataset Capture Handler ====
+// POST action=start | burst (count, interval ms) | stop; GET = status saja.
+// Open container tidak ditunggu: 202 dengan container "opening", UI polling GET.
+void handleDataset(WebServer &server)
+{
+    addCORSHeaders(server);
+
+    String action = server.hasArg("action") ? server.arg("action") : "";
+    bool ok = true;
+    if (server.method() == HTTP_POST)
+    {
+        if (action == "start")
+        {
+            ok = datasetStart();
+        }
+        else if (action == "burst")
+        {
+            // Container dibuka otomatis jika belum ada
+            int count = server.hasArg("count") ? server.arg("count").toInt() : 30;
+            uint32_t interval = server.hasArg("interval") ? server.arg("interval").toInt() : 0;
+            ok = datasetStart() && datasetBurst(count, interval);
+        }
+        else if (action == "stop")
+        {
+            ok = datasetStop();
+        }
+        else
+        {
+            server.send(400, "application/json", "{\"success\":false,\"error\":\"Unknown action\"}");
+            return;
+        }
+    }
+
+    int container = dsContainerState.load();
+    char buf[RESPONSE_CHUNK];
+    beginChunked(server, !ok ? 503 : container == DS_CONTAINER_OPENING ? 202 : 200, "application/json");
+    ChunkWriter out(buf, sizeof(buf), webServerChunkSink, &server);
+    JsonWriter json(out);
+    json.beginObject();
+    json.field("success", ok);
+    json.field("active", dsActive);
+    json.field("container", datasetContainerStateName(container));
+    json.field("path", dsPath.c_str());
+    json.field("first_seq", dsFirstSeq);
+    json.field("queued", dsQueuedFrames);
+    json.field("dropped", dsDroppedFrames);
+    json.field("burst_left", dsBurstLeft);
+    json.field("queue_depth", sdWriterQueueDepth());
+    json.endObject();
+    endChunked(server, out);
+}
+
 // ==== Camera Test Handler ====
 void handleCameraTest(WebServer &server)
 {
@@ -135,30 +313,91 @@ void handleCameraTest(WebServer &server)
 
     Serial.println("🧪 Testing camera functionality...");
 
-    camera_fb_t *fb = esp_camera_fb_get();
+    int64_t t0 = esp_timer_get_time();
+    camera_fb_t *fb = camFbGet();
     if (!fb)
     {
-        String response = "{\"success\":false,\"error\":\"Camera test failed - no frame buffer\"}";
-        server.send(500, "application/json", response);
+        server.send(500, "application/json", "{\"success\":false,\"error\":\"Camera test failed - no frame buffer\"}");
         return;
     }
+    uint32_t captureUs = (uint32_t)(esp_timer_get_time() - t0);
+    metricObserve(STAGE_FB_GET, captureUs);
 
     // Get frame info before returning buffer
     int width = fb->width;
     int height = fb->height;
     size_t size = fb->len;
     bool isJpeg = (fb->format == PIXFORMAT_JPEG);
+    bool isRgb565 = (fb->format == PIXFORMAT_RGB565);
 
-    esp_camera_fb_return(fb);
-
-    String response = "{\"success\":true,";
-    response += "\"width\":" + String(width) + ",";
-    response += "\"height\":" + String(height) + ",";
-    response += "\"size\":" + String(size) + ",";
-    response += "\"format\":\"" + String(isJpeg ? "JPEG" : "Unknown") + "\"}";
+    camFbReturn(fb);
 
     Serial.printf("✅ Camera test successful: %dx%d, %d bytes\n", width, height, size);
-    server.send(200, "application/json", response);
+
+    char buf[RESPONSE_CHUNK];
+    beginChunked(server, 200, "application/json");
+    ChunkWriter out(buf, sizeof(buf), webServerChunkSink, &server);
+    JsonWriter json(out);
+    json.beginObject();
+    json.field("success", true);
+    json.field("width", width);
+    json.field("height", height);
+    json.field("size", size);
+    json.field("format", isJpeg ? "JPEG" : isRgb565 ? "RGB565" : "Unknown");
+    json.field("profile", cameraProfileName());
+    json.field("capture_ms", captureUs / 1000.0, 1);
+    json.endObject();
+    endChunked(server, out);
+}
+
+// ==== Camera Profile Handler ====
+// GET: profil aktif + daftar; POST name=stream|count|capture_hires: ganti profil
+void handleCameraProfile(WebServer &server)
+{
+    addCORSHeaders(server);
+
+    bool ok = true;
+    bool switched = false;
+    if (server.method() == HTTP_POST)
+    {
+        int id = cameraProfileFind(server.arg("name").c_str());
+        if (id < 0)
+        {
+            server.send(400, "application/json", "{\"success\":false,\"error\":\"Unknown profile\"}");
+            return;
+        }
+        ok = cameraSetProfile(id);
+        switched = true;
+    }
+
+    char buf[RESPONSE_CHUNK];
+    beginChunked(server, ok ? 200 : 503, "application/json");
+    ChunkWriter out(buf, sizeof(buf), webServerChunkSink, &server);
+    JsonWriter json(out);
+    json.beginObject();
+    json.field("success", ok);
+    json.field("profile", cameraProfileName());
+    if (switched)
+    {
+        json.field("reinit", (bool)camLastSwitchReinit);
+        json.field("switch_ms", camLastSwitchUs / 1000.0, 1);
+    }
+    json.key("profiles");
+    json.beginArray();
+    for (int i = 0; i < CAM_PROFILE_NUM; i++)
+    {
+        const CameraProfile &p = cameraProfiles[i];
+        json.beginObject();
+        json.field("name", p.name);
+        json.field("format", p.format == PIXFORMAT_JPEG ? "JPEG" : "RGB565");
+        json.field("width", resolution[camProfileSize(p)].width);
+        json.field("height", resolution[camProfileSize(p)].height);
+        json.field("quality", p.quality);
+        json.endObject();
+    }
+    json.endArray();
+    json.endObject();
+    endChunked(server, out);
 }
 
 // ==== File List Handler ====
@@ -178,111 +417,128 @@ void handleFileList(WebServer &server)
         path = "/" + path;
     }
 
-    Serial.printf("📂 Listing files in: %s\n", path.c_str());
-    Serial.printf("🔍 SD Card status - Initialized: %s, Using SPI: %s\n", 
-                  sdCardInitialized ? "YES" : "NO", 
-                  usingSPIMode ? "YES" : "NO");
-
-    // Force check SD card status and try to reconnect if needed
-    if (!initializeSDCard() || !checkSDCardStatus())
+    // Kartu tidak disentuh bila indeks sudah ada
+    if (!isSDCardAvailable())
     {
-        Serial.println("❌ SD Card not available - attempting reconnection");
-        if (!forceReinitializeSDCard()) {
-            Serial.println("❌ SD Card reconnection failed");
-            server.send(500, "application/json", "{\"success\":false,\"error\":\"SD Card not available - please check SD card connection\"}");
-            return;
-        }
-        else {
-            Serial.println("✅ SD Card reconnection successful");
-        }
+        Serial.println("❌ SD Card not available for listing");
+        server.send(500, "application/json", "{\"success\":false,\"error\":\"SD Card not available - please check SD card connection\"}");
+        return;
     }
 
-    File root;
-    int retries = 3;
-    
-    // Try to open directory with retries
-    while (retries > 0 && !root) {
-        if (usingSPIMode)
-        {
-            root = SD.open(path);
-        }
-        else
-        {
-            root = SD_MMC.open(path);
-        }
-        
-        if (!root) {
-            retries--;
-            if (retries > 0) {
-                Serial.printf("❌ Failed to open directory, retrying... (%d left)\n", retries);
-                delay(100);
-                // Try to reinitialize SD card
-                forceReinitializeSDCard();
-            }
-        }
-    }
+    path = fileIndexNormalize(path);
+    int offset = server.hasArg("offset") ? max(0, (int)server.arg("offset").toInt()) : 0;
+    int limit = server.hasArg("limit") ? server.arg("limit").toInt() : FILE_INDEX_DEFAULT_LIMIT;
 
-    if (!root)
+    int total = 0;
+    int status = fileIndexPrepare(path, total);
+    if (status != 0)
     {
-        Serial.printf("❌ Failed to open directory after retries: %s\n", path.c_str());
-        server.send(404, "application/json", "{\"success\":false,\"error\":\"Directory not found or SD card error\"}");
+        Serial.printf("❌ Failed to list directory: %s\n", path.c_str());
+        server.send(status, "application/json", status == 404 ? "{\"success\":false,\"error\":\"Directory not found or SD card error\"}"
+                                                              : "{\"success\":false,\"error\":\"Out of memory while indexing directory\"}");
         return;
     }
 
-    if (!root.isDirectory())
+    // Satu MSS TCP per chunk; ribuan entri tetap memakai buffer yang sama
+    char buf[1460];
+    beginChunked(server, 200, "application/json");
+    ChunkWriter out(buf, sizeof(buf), webServerChunkSink, &server);
+    JsonWriter json(out);
+    json.beginObject();
+    json.field("success", true);
+    json.field("path", path.c_str());
+    json.field("offset", offset);
+    json.field("total", total);
+    json.key("files");
+    json.beginArray();
+    int count = fileIndexWriteEntries(json, path, offset, limit);
+    json.endArray();
+    json.field("count", count);
+    json.endObject();
+    endChunked(server, out);
+
+    Serial.printf("✅ Listed %d/%d entries in %s\n", count, total, path.c_str());
+}
+
+// Parse "bytes=a-b", "bytes=a-", "bytes=-n" (satu range saja).
+// Return 1 jika valid, 0 jika diabaikan (kirim file utuh), -1 jika di luar ukuran file.
+static int parseByteRange(const String &header, uint32_t size, uint32_t &start, uint32_t &end)
+{
+    if (!header.startsWith("bytes=") || header.indexOf(',') >= 0)
+        return 0;
+    int dash = header.indexOf('-');
+    if (dash < 0)
+        return 0;
+    String first = header.substring(6, dash);
+    String last = header.substring(dash + 1);
+    first.trim();
+    last.trim();
+    if (first.length() == 0)
     {
-        Serial.printf("❌ Path is not a directory: %s\n", path.c_str());
-        root.close();
-        server.send(404, "application/json", "{\"success\":false,\"error\":\"Path is not a directory\"}");
-        return;
+        // Suffix: n byte terakhir
+        uint32_t n = strtoul(last.c_str(), NULL, 10);
+        if (last.length() == 0 || n == 0 || size == 0)
+            return -1;
+        start = n >= size ? 0 : size - n;
+        end = size - 1;
+        return 1;
     }
+    start = strtoul(first.c_str(), NULL, 10);
+    if (start >= size)
+        return -1;
+    end = last.length() ? strtoul(last.c_str(), NULL, 10) : size - 1;
+    if (end >= size)
+        end = size - 1;
+    return end >= start ? 1 : 0;
+}
 
-    String json = "{\"success\":true,\"path\":\"" + path + "\",\"files\":[";
-    bool first = true;
-    int fileCount = 0;
+// Buffer baca file untuk /download dan /thumb. Semua handler berjalan di task
+// WebServer (loop), jadi satu buffer cukup; dialokasikan sekali di setup()
+// agar download tidak memecah heap internal.
+static uint8_t *downloadBuf = nullptr;
+static size_t downloadBufCap = 0;
 
-    File file = root.openNextFile();
-    while (file)
+bool downloadBufInit()
+{
+    if (downloadBuf)
+        return true;
+    downloadBufCap = DOWNLOAD_BUF_SIZE;
+    downloadBuf = (uint8_t *)heap_caps_malloc(downloadBufCap, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+    if (!downloadBuf)
     {
-        if (!first)
-            json += ",";
-        first = false;
-
-        String fileName = String(file.name());
-        // Remove path prefix if present
-        int lastSlash = fileName.lastIndexOf('/');
-        if (lastSlash >= 0)
-        {
-            fileName = fileName.substring(lastSlash + 1);
-        }
-
-        // Skip hidden files and system files
-        if (!fileName.startsWith("."))
-        {
-            json += "{\"name\":\"" + fileName + "\",";
-            json += "\"isDir\":" + String(file.isDirectory() ? "true" : "false") + ",";
-            json += "\"size\":" + String(file.size()) + "}";
-            fileCount++;
-        }
-        else
-        {
-            if (!first)
-            {
-                // Remove the comma we added for this hidden file
-                json = json.substring(0, json.length() - 1);
-                first = fileCount == 0;
-            }
-        }
-
-        file.close();
-        file = root.openNextFile();
+        downloadBufCap = 2048; // heap internal sempit: tetap jalan dengan buffer kecil
+        downloadBuf = (uint8_t *)malloc(downloadBufCap);
     }
-    root.close();
-
-    json += "],\"count\":" + String(fileCount) + "}";
+    if (!downloadBuf)
+        downloadBufCap = 0;
+    return downloadBuf != nullptr;
+}
 
-    Serial.printf("✅ Listed %d files in %s\n", fileCount, path.c_str());
-    server.send(200, "application/json", json);
+// Kirim length byte mulai dari start. Buffer dari RAM internal yang
+// DMA-capable dan pembacaan dibuat rata sektor 512, sehingga driver SD_MMC
+// membaca multi-sektor langsung ke buffer tanpa bounce buffer per sektor.
+static size_t sendFileRange(WebServer &server, File &file, uint32_t start, uint32_t length)
+{
+    if (!downloadBuf || (start && !file.seek(start)))
+        return 0;
+
+    WiFiClient client = server.client();
+    size_t sent = 0;
+    // Baca pertama hanya sampai batas sektor agar baca berikutnya rata 512 byte
+    size_t want = start % DOWNLOAD_SECTOR ? DOWNLOAD_SECTOR - start % DOWNLOAD_SECTOR : downloadBufCap;
+    while (sent < length && client.connected())
+    {
+        if (want > length - sent)
+            want = length - sent;
+        int n = file.read(downloadBuf, want);
+        if (n <= 0)
+            break;
+        if (client.write(downloadBuf, n) != (size_t)n)
+            break;
+        sent += n;
+        want = downloadBufCap;
+    }
+    return sent;
 }
 
 // ==== File Download Handler ====
@@ -306,7 +562,7 @@ void handleFileDownload(WebServer &server)
 
     Serial.printf("📥 Download request: %s\n", filepath.c_str());
 
-    if (!initializeSDCard())
+    if (!isSDCardAvailable())
     {
         Serial.println("❌ SD Card not available for download");
         server.send(500, "text/plain", "SD Card not available");
@@ -384,13 +640,149 @@ void handleFileDownload(WebServer &server)
         filename = filename.substring(lastSlash + 1);
     }
 
-    Serial.printf("📤 Sending file: %s (%d bytes) as %s\n", filename.c_str(), file.size(), contentType.c_str());
+    // ETag dari ukuran + waktu tulis terakhir: berubah bila file ditimpa
+    uint32_t size = file.size();
+    char etag[32];
+    snprintf(etag, sizeof(etag), "\"%x-%lx\"", (unsigned)size, (unsigned long)file.getLastWrite());
+    server.sendHeader("ETag", etag);
+    server.sendHeader("Cache-Control", "private, no-cache"); // browser cache, divalidasi ulang lewat ETag
+    server.sendHeader("Accept-Ranges", "bytes");
+
+    if (server.hasHeader("If-None-Match") && server.header("If-None-Match") == etag)
+    {
+        file.close();
+        server.send(304);
+        Serial.printf("✅ Not modified: %s\n", filename.c_str());
+        return;
+    }
+
+    uint32_t start = 0, end = size ? size - 1 : 0;
+    int range = server.hasHeader("Range") ? parseByteRange(server.header("Range"), size, start, end) : 0;
+    if (range < 0)
+    {
+        file.close();
+        char contentRange[32];
+        snprintf(contentRange, sizeof(contentRange), "bytes */%u", (unsigned)size);
+        server.sendHeader("Content-Range", contentRange);
+        server.send(416, "text/plain", "Range Not Satisfiable");
+        return;
+    }
+
+    uint32_t length = size ? end - start + 1 : 0;
+    Serial.printf("📤 Sending file: %s (%u of %u bytes from %u) as %s\n", filename.c_str(),
+                  (unsigned)length, (unsigned)size, (unsigned)start, contentType.c_str());
 
     server.sendHeader("Content-Disposition", "attachment; filename=\"" + filename + "\"");
-    server.streamFile(file, contentType);
+    if (range > 0)
+    {
+        char contentRange[48];
+        snprintf(contentRange, sizeof(contentRange), "bytes %u-%u/%u", (unsigned)start, (unsigned)end, (unsigned)size);
+        server.sendHeader("Content-Range", contentRange);
+    }
+    server.setContentLength(length);
+    server.send(range > 0 ? 206 : 200, contentType, "");
+
+    unsigned long t0 = millis();
+    size_t sent = sendFileRange(server, file, start, length);
     file.close();
 
-    Serial.println("✅ Download completed");
+    unsigned long ms = millis() - t0;
+    if (sent == length)
+        Serial.printf("✅ Download completed: %u bytes in %lu ms (%lu KB/s)\n", (unsigned)sent, ms, ms ? (unsigned long)(sent / ms) : 0UL);
+    else
+        Serial.printf("⚠️ Download interrupted: %u/%u bytes\n", (unsigned)sent, (unsigned)length);
+}
+
+// ==== Thumbnail Handler ====
+// JPEG 1/8 skala dari cache /.thumbs; dibuat sekali saat pertama diminta
+void handleThumbnail(WebServer &server)
+{
+    addCORSHeaders(server);
+
+    if (!server.hasArg("file"))
+    {
+        server.send(400, "text/plain", "Missing file parameter");
+        return;
+    }
+
+    String filepath = server.arg("file");
+    if (!filepath.startsWith("/"))
+    {
+        filepath = "/" + filepath;
+    }
+
+    String lowerPath = filepath;
+    lowerPath.toLowerCase();
+    if (!lowerPath.endsWith(".jpg") && !lowerPath.endsWith(".jpeg"))
+    {
+        server.send(415, "text/plain", "Thumbnails are only available for JPEG files");
+        return;
+    }
+
+    if (!isSDCardAvailable())
+    {
+        server.send(503, "text/plain", "SD Card not available");
+        return;
+    }
+
+    fs::FS &fs = thumbFS();
+    File src = fs.open(filepath);
+    if (!src || src.isDirectory())
+    {
+        if (src)
+            src.close();
+        server.send(404, "text/plain", "File not found");
+        return;
+    }
+
+    uint32_t size = src.size();
+    time_t mtime = src.getLastWrite();
+    String thumbPath = thumbPathFor(filepath, size, mtime);
+
+    char etag[40];
+    snprintf(etag, sizeof(etag), "\"t%x-%lx\"", (unsigned)size, (unsigned long)mtime);
+    server.sendHeader("ETag", etag);
+    server.sendHeader("Cache-Control", "private, no-cache");
+
+    if (server.hasHeader("If-None-Match") && server.header("If-None-Match") == etag)
+    {
+        src.close();
+        server.send(304);
+        return;
+    }
+
+    // Cache hit: kirim file thumbnail apa adanya
+    File thumb = fs.open(thumbPath);
+    if (thumb)
+    {
+        src.close();
+        uint32_t len = thumb.size();
+        server.setContentLength(len);
+        server.send(200, "image/jpeg", "");
+        sendFileRange(server, thumb, 0, len);
+        thumb.close();
+        return;
+    }
+
+    unsigned long t0 = millis();
+    const uint8_t *jpg = NULL;
+    size_t len = 0;
+    bool ok = thumbGenerate(src, &jpg, &len);
+    src.close();
+    if (!ok)
+    {
+        Serial.printf("❌ Thumbnail failed: %s\n", filepath.c_str());
+        server.send(500, "text/plain", "Thumbnail generation failed");
+        return;
+    }
+
+    bool cached = thumbStore(thumbPath, jpg, len);
+    Serial.printf("🖼️ Thumbnail %s: %u -> %u bytes in %lu ms%s\n", filepath.c_str(), (unsigned)size,
+                  (unsigned)len, millis() - t0, cached ? "" : " (not cached)");
+
+    server.setContentLength(len);
+    server.send(200, "image/jpeg", "");
+    server.client().write(jpg, len);
 }
 
 // ==== Create Folder Handler ====
@@ -428,15 +820,11 @@ void handleCreateFolder(WebServer &server)
     }
 
     // Check SD card status
-    if (!initializeSDCard() || !checkSDCardStatus())
+    if (!isSDCardAvailable())
     {
-        Serial.println("❌ SD Card not available for folder creation - attempting reconnection");
-        if (!forceReinitializeSDCard()) {
-            Serial.println("❌ SD Card reconnection failed");
-            server.send(500, "application/json", "{\"success\":false,\"error\":\"SD Card not available\"}");
-            return;
-        }
-        Serial.println("✅ SD Card reconnected for folder creation");
+        Serial.println("❌ SD Card not available for folder creation");
+        server.send(503, "application/json", "{\"success\":false,\"error\":\"SD Card not available\"}");
+        return;
     }
 
     String fullPath = basePath;
@@ -459,12 +847,21 @@ void handleCreateFolder(WebServer &server)
     if (success)
     {
         Serial.printf("✅ Folder created: %s\n", fullPath.c_str());
-        String response = "{\"success\":true,\"path\":\"" + fullPath + "\"}";
-        server.send(200, "application/json", response);
+        fileIndexAdd(fullPath, 0, true);
+        char buf[RESPONSE_CHUNK];
+        beginChunked(server, 200, "application/json");
+        ChunkWriter out(buf, sizeof(buf), webServerChunkSink, &server);
+        JsonWriter json(out);
+        json.beginObject();
+        json.field("success", true);
+        json.field("path", fullPath.c_str());
+        json.endObject();
+        endChunked(server, out);
     }
     else
     {
         Serial.printf("❌ Failed to create folder: %s\n", fullPath.c_str());
+        sdMonitorReportError();
         server.send(500, "application/json", "{\"success\":false,\"error\":\"Failed to create folder\"}");
     }
 }
@@ -476,23 +873,29 @@ void handleFileUpload(WebServer &server)
     static File uploadFile;
     static String uploadPath;
     static bool uploadError = false;
+    static bool uploadLocked = false; // sdLock() dipegang dari START sampai END/ABORTED
 
     if (upload.status == UPLOAD_FILE_START)
     {
         addCORSHeaders(server);
         uploadError = false;
+        if (uploadFile)
+            uploadFile.close(); // upload sebelumnya terputus tanpa END
+        if (!uploadLocked)
+        {
+            // Kartu tidak di-unmount sd_monitor selama file upload terbuka
+            sdLock();
+            uploadLocked = true;
+        }
 
         Serial.printf("📤 Upload starting: %s (%d bytes)\n", upload.filename.c_str(), upload.totalSize);
 
-        // Force check SD card status
-        if (!initializeSDCard() || !checkSDCardStatus())
+        // Check SD card status
+        if (!isSDCardAvailable())
         {
-            Serial.println("❌ SD Card not available for upload - trying to reinitialize");
-            if (!forceReinitializeSDCard()) {
-                Serial.println("❌ SD Card reinitialize failed");
-                uploadError = true;
-                return;
-            }
+            Serial.println("❌ SD Card not available for upload");
+            uploadError = true;
+            return;
         }
 
         String filename = upload.filename;
@@ -532,13 +935,10 @@ void handleFileUpload(WebServer &server)
                 if (retries > 0) {
                     Serial.printf("❌ Failed to create upload file, retrying... (%d left)\n", retries);
                     delay(100);
-                    // Try to reinitialize SD card
-                    if (!checkSDCardStatus()) {
-                        forceReinitializeSDCard();
-                    }
                 } else {
                     Serial.printf("❌ Failed to create upload file after retries: %s\n", uploadPath.c_str());
                     uploadError = true;
+                    sdMonitorReportError(); // sd_monitor yang mount ulang bila kartu hilang
                 }
             }
         }
@@ -584,6 +984,7 @@ void handleFileUpload(WebServer &server)
                 
                 if (verifyFile && verifyFile.size() == upload.totalSize) {
                     Serial.println("✅ Upload verification successful");
+                    fileIndexAdd(uploadPath, upload.totalSize, false);
                 } else {
                     Serial.println("⚠️ Upload verification failed - file size mismatch");
                     uploadError = true;
@@ -608,6 +1009,12 @@ void handleFileUpload(WebServer &server)
         }
         uploadError = true;
     }
+
+    if ((upload.status == UPLOAD_FILE_END || upload.status == UPLOAD_FILE_ABORTED) && uploadLocked)
+    {
+        uploadLocked = false;
+        sdUnlock();
+    }
 }
 
 
@@ -620,7 +1027,7 @@ void handleFileUploadResponse(WebServer &server)
     // Check if upload was successful by checking the static error flag
     // Note: This is a simplified approach - in production, you'd want better state management
     
-    if (!initializeSDCard() || !checkSDCardStatus()) {
+    if (!isSDCardAvailable()) {
         server.send(500, "application/json", "{\"success\":false,\"error\":\"SD Card not available\"}");
         return;
     }
@@ -643,12 +1050,14 @@ void handleFileDelete(WebServer &server)
 
     String filepath = server.arg("file");
 
-    if (!initializeSDCard())
+    if (!isSDCardAvailable())
     {
         server.send(500, "application/json", "{\"success\":false,\"error\":\"SD Card not available\"}");
         return;
     }
 
+    thumbRemoveFor(filepath); // butuh ukuran/waktu file sumber, jadi sebelum remove
+
     bool success;
     if (usingSPIMode)
     {
@@ -662,6 +1071,7 @@ void handleFileDelete(WebServer &server)
     if (success)
     {
         Serial.printf("✅ File deleted: %s\n", filepath.c_str());
+        fileIndexRemove(filepath);
         server.send(200, "application/json", "{\"success\":true,\"message\":\"File deleted successfully\"}");
     }
     else
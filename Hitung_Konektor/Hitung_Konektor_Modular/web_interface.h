@@ -79,6 +79,16 @@ const char index_html[] PROGMEM = R"rawliteral(
             cursor: pointer;
             transition: background 0.2s;
         }
+        .file-thumb {
+            width: 48px;
+            height: 36px;
+            object-fit: cover;
+            border-radius: 4px;
+            margin-right: 10px;
+            background: #eee;
+            cursor: pointer;
+        }
+        
         .file-item:hover {
             background: #e3f2fd;
         }
@@ -169,12 +179,20 @@ const char index_html[] PROGMEM = R"rawliteral(
             <!-- Camera Panel -->
             <div class="camera-panel">
                 <h2>📹 Live Camera Stream</h2>
-                <img id="cameraStream" class="camera-stream" src="/stream" alt="Camera Stream">
+                <img id="cameraStream" class="camera-stream" src="" alt="Camera Stream">
                 <div style="margin-top: 15px;">
                     <button class="btn" onclick="refreshStream()">🔄 Refresh Stream</button>
                     <button class="btn" onclick="captureImage()">📸 Capture Image</button>
                     <button class="btn" onclick="testCamera()">🧪 Test Camera</button>
                 </div>
+                <div style="margin-top: 10px;">
+                    <button class="btn btn-sm" onclick="datasetAction('burst', 30)">🎞️ Dataset Burst 30</button>
+                    <button class="btn btn-sm" onclick="datasetAction('stop')">⏹️ Close Dataset</button>
+                </div>
+                <div style="margin-top: 10px;">
+                    <label for="cameraProfile">📷 Profile:</label>
+                    <select id="cameraProfile" onchange="setCameraProfile(this.value)"></select>
+                </div>
                 <div id="captureStatus" style="margin-top: 10px;"></div>
                 <div id="cameraTestStatus" style="margin-top: 5px;"></div>
             </div>
@@ -210,7 +228,9 @@ const char index_html[] PROGMEM = R"rawliteral(
         
         // Initialize
         document.addEventListener('DOMContentLoaded', function() {
+            refreshStream();
             refreshFiles();
+            loadCameraProfiles();
             startConnectionMonitor();
         });
         
@@ -228,16 +248,20 @@ const char index_html[] PROGMEM = R"rawliteral(
         }
         
         // Camera functions
+        // Stream dilayani server terpisah di port 81
+        function streamUrl() {
+            return 'http://' + location.hostname + ':81/stream?' + new Date().getTime();
+        }
+
         function refreshStream() {
             const img = document.getElementById('cameraStream');
-            const timestamp = new Date().getTime();
             img.onerror = function() {
                 console.log('Camera stream error, retrying...');
                 setTimeout(() => {
-                    img.src = '/stream?' + new Date().getTime();
+                    img.src = streamUrl();
                 }, 2000);
             };
-            img.src = '/stream?' + timestamp;
+            img.src = streamUrl();
         }
         
         function captureImage() {
@@ -273,6 +297,72 @@ const char index_html[] PROGMEM = R"rawliteral(
                 });
         }
         
+        // Profil kamera: ganti format tanpa reflash, latensi dilaporkan server
+        function fillCameraProfiles(data) {
+            const select = document.getElementById('cameraProfile');
+            select.innerHTML = data.profiles.map(p =>
+                '<option value="' + p.name + '">' + p.name + ' (' + p.format + ' ' + p.width + 'x' + p.height + ')</option>').join('');
+            select.value = data.profile;
+        }
+
+        function loadCameraProfiles() {
+            fetch('/camera_profile')
+                .then(response => response.json())
+                .then(fillCameraProfiles)
+                .catch(error => console.error('Camera profile error:', error));
+        }
+
+        function setCameraProfile(name) {
+            const status = document.getElementById('cameraTestStatus');
+            status.innerHTML = '<div style="color: blue;">📷 Switching to ' + name + '...</div>';
+            fetch('/camera_profile?name=' + encodeURIComponent(name), { method: 'POST' })
+                .then(response => response.json())
+                .then(data => {
+                    fillCameraProfiles(data);
+                    status.innerHTML = data.success
+                        ? '<div style="color: green;">✅ Profile ' + data.profile + ' in ' + data.switch_ms + ' ms' + (data.reinit ? ' (re-init)' : '') + '</div>'
+                        : '<div style="color: red;">❌ Profile switch failed, still ' + data.profile + '</div>';
+                    refreshStream();
+                })
+                .catch(error => {
+                    status.innerHTML = '<div style="color: red;">❌ Profile switch failed: ' + error.message + '</div>';
+                });
+        }
+
+        // Burst dataset ditulis ke satu container .hkd di /dataset. Open container
+        // berjalan di task SD writer: selama "opening", status di-poll lewat GET.
+        function showDatasetStatus(action, data) {
+            const status = document.getElementById('captureStatus');
+            if (!data.success || data.container === 'failed') {
+                status.innerHTML = '<div style="color: red;">❌ Dataset ' + action + ' failed</div>';
+            } else if (action === 'stop') {
+                status.innerHTML = '<div style="color: green;">✅ Dataset closed: ' + data.path + ' (' + data.queued + ' frames)</div>';
+                refreshFiles();
+            } else if (data.container === 'opening') {
+                status.innerHTML = '<div style="color: blue;">⏳ Opening ' + data.path + '...</div>';
+                setTimeout(() => {
+                    fetch('/dataset')
+                        .then(response => response.json())
+                        .then(next => showDatasetStatus(action, next))
+                        .catch(error => {
+                            status.innerHTML = '<div style="color: red;">❌ Dataset error: ' + error.message + '</div>';
+                        });
+                }, 300);
+            } else {
+                status.innerHTML = '<div style="color: blue;">🎞️ Capturing ' + data.burst_left + ' frames into ' + data.path + '</div>';
+            }
+        }
+
+        function datasetAction(action, count) {
+            const status = document.getElementById('captureStatus');
+            fetch('/dataset?action=' + action + (count ? '&count=' + count : ''), { method: 'POST' })
+                .then(response => response.json())
+                .then(data => showDatasetStatus(action, data))
+                .catch(error => {
+                    status.innerHTML = '<div style="color: red;">❌ Dataset error: ' + error.message + '</div>';
+                });
+        }
+        
         function testCamera() {
             document.getElementById('cameraTestStatus').innerHTML = '<div style="color: blue;">🧪 Testing camera...</div>';
             
@@ -300,11 +390,19 @@ const char index_html[] PROGMEM = R"rawliteral(
         }
         
         // File manager functions
+        const FILE_PAGE_SIZE = 200;
+        let fileOffset = 0;
+
         function refreshFiles() {
             document.getElementById('fileList').innerHTML = 
                 '<div style="text-align: center; color: #666; margin-top: 50px;"><div>📂 Loading files...</div></div>';
-            
-            fetch('/files?path=' + encodeURIComponent(currentPath))
+            fileOffset = 0;
+            loadFiles(false);
+        }
+
+        // Listing dipaging oleh server (offset/limit); halaman berikutnya ditambahkan
+        function loadFiles(append) {
+            fetch('/files?path=' + encodeURIComponent(currentPath) + '&offset=' + fileOffset + '&limit=' + FILE_PAGE_SIZE)
                 .then(response => {
                     if (!response.ok) {
                         throw new Error('HTTP ' + response.status + ': ' + response.statusText);
@@ -313,9 +411,10 @@ const char index_html[] PROGMEM = R"rawliteral(
                 })
                 .then(data => {
                     if (data.success) {
-                        displayFiles(data.files);
+                        fileOffset = data.offset + data.count;
+                        displayFiles(data.files, append, fileOffset < data.total);
                         document.getElementById('currentPath').textContent = currentPath;
-                        console.log('Files loaded successfully:', data.count || data.files.length, 'files');
+                        console.log('Files loaded successfully:', fileOffset, '/', data.total, 'files');
                     } else {
                         document.getElementById('fileList').innerHTML = 
                             '<div style="text-align: center; color: red; margin-top: 50px;"><div>❌ Error: ' + (data.error || 'Unknown error') + '</div><button class="btn" onclick="refreshFiles()" style="margin-top: 10px;">🔄 Retry</button></div>';
@@ -328,10 +427,14 @@ const char index_html[] PROGMEM = R"rawliteral(
                 });
         }
         
-        function displayFiles(files) {
+        function displayFiles(files, append, hasMore) {
             const fileList = document.getElementById('fileList');
+            const more = document.getElementById('loadMoreFiles');
+            if (more) {
+                more.remove();
+            }
             
-            if (files.length === 0) {
+            if (!append && files.length === 0) {
                 fileList.innerHTML = '<div style="text-align: center; color: #666; margin-top: 50px;"><div>📂 Empty folder</div></div>';
                 return;
             }
@@ -341,8 +444,15 @@ const char index_html[] PROGMEM = R"rawliteral(
                 const icon = file.isDir ? '📁' : '📄';
                 const sizeText = file.isDir ? '' : formatFileSize(file.size);
                 
+                const filePath = currentPath === '/' ? '/' + file.name : currentPath + '/' + file.name;
+                
                 html += '<div class="file-item">';
-                html += '<span class="file-icon">' + icon + '</span>';
+                if (!file.isDir && /\.jpe?g$/i.test(file.name)) {
+                    // Thumbnail 1/8 skala dari server, dimuat saat terlihat
+                    html += '<img class="file-thumb" loading="lazy" src="/thumb?file=' + encodeURIComponent(filePath) + '" alt="" onclick="downloadFile(\'' + file.name + '\')">';
+                } else {
+                    html += '<span class="file-icon">' + icon + '</span>';
+                }
                 html += '<span class="file-name" onclick="' + (file.isDir ? 'openFolder' : 'downloadFile') + '(\'' + file.name + '\')" style="flex: 1; cursor: pointer;">' + file.name + '</span>';
                 if (sizeText) {
                     html += '<span class="file-size">' + sizeText + '</span>';
@@ -353,8 +463,15 @@ const char index_html[] PROGMEM = R"rawliteral(
                 }
                 html += '</div>';
             });
+            if (hasMore) {
+                html += '<button id="loadMoreFiles" class="btn btn-sm" onclick="loadFiles(true)" style="margin-top: 10px;">⬇️ Load more</button>';
+            }
             
-            fileList.innerHTML = html;
+            if (append) {
+                fileList.insertAdjacentHTML('beforeend', html);
+            } else {
+                fileList.innerHTML = html;
+            }
         }
         
         function openFolder(folderName) {
@@ -506,6 +623,18 @@ const char index_html[] PROGMEM = R"rawliteral(
             });
         }
         
+        function waitSDRemount(attempt, deadline) {
+            return fetch('/sd_status')
+                .then(response => response.json())
+                .then(status => {
+                    if (status.attempts > attempt || Date.now() > deadline) {
+                        return status;
+                    }
+                    return new Promise(resolve => setTimeout(resolve, 500))
+                        .then(() => waitSDRemount(attempt, deadline));
+                });
+        }
+
         function reconnectSDCard() {
             if (!confirm('Reconnect SD card? This may take a few seconds...')) {
                 return;
@@ -529,11 +658,18 @@ const char index_html[] PROGMEM = R"rawliteral(
                 return response.json();
             })
             .then(data => {
-                if (data.success) {
-                    alert('SD card reconnected successfully! Mode: ' + (data.mode || 'Unknown'));
+                if (!data.success) {
+                    throw new Error(data.error || 'Unknown error');
+                }
+                // Mount ulang berjalan di task sd_monitor; tunggu percobaan berikutnya selesai
+                return waitSDRemount(data.attempt, Date.now() + 15000);
+            })
+            .then(status => {
+                if (status.state === 'ready') {
+                    alert('SD card reconnected successfully! Mode: ' + (status.mode || 'Unknown'));
                     refreshFiles();
                 } else {
-                    alert('Failed to reconnect SD card: ' + (data.error || 'Unknown error'));
+                    alert('Failed to reconnect SD card: state ' + status.state);
                     fileList.innerHTML = originalContent;
                 }
             })
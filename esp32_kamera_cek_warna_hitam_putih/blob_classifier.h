@@ -0,0 +1,336 @@
+// blob_classifier.h - Klasifikasi jenis part (mur, konektor, cable tie, ...) per blob
+// Nearest-centroid atas fitur bentuk dari ccl.h. Sampel berlabel dari operator
+// disimpan mentah (fitur CclBlob) sebagai CSV di SD, jadi definisi fitur bisa
+// berubah tanpa mengulang pelabelan. Model = rata-rata fitur per kelas +
+// simpangan baku gabungan dalam-kelas untuk normalisasi; dilatih inkremental
+// dari jumlah & jumlah kuadrat tanpa membaca ulang file. Task label membaca
+// model lewat seqlock dan tidak pernah menunggu penulis.
+// Butuh: ccl.h dengan cclEnableShape()
+#ifndef BLOB_CLASSIFIER_H
+#define BLOB_CLASSIFIER_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <atomic>
+#include "ccl.h"
+
+#define CLS_MAX 8
+#define CLS_NAME_LEN 16
+#define CLS_FEATURES 9
+#define CLS_UNKNOWN CLS_MAX  // indeks hitungan untuk blob yang tidak cocok kelas mana pun
+#define CLS_REJECT_DIST 3.0f // jarak RMS maksimal ke centroid, dalam simpangan baku
+#define CLS_DIR "/classifier"
+#define CLS_SAMPLES_PATH "/classifier/samples.csv"
+#define CLS_LINE_MAX 192
+
+static const char *const clsFeatureNames[CLS_FEATURES] = {
+    "log_area", "compactness", "fill", "holes", "elongation", "hu1", "hu2", "hu3", "hu4"};
+
+// Batas bawah simpangan baku per fitur: fitur yang konstan di dalam kelas
+// (mis. holes) tidak boleh mendapat bobot tak hingga
+static const float clsStdFloor[CLS_FEATURES] = {0.05f, 0.1f, 0.03f, 0.5f, 0.1f, 0.1f, 0.3f, 0.5f, 0.5f};
+
+struct ClassModel
+{
+    int classes;
+    char names[CLS_MAX][CLS_NAME_LEN];
+    uint32_t samples[CLS_MAX];
+    float centroid[CLS_MAX][CLS_FEATURES];
+    float invStd[CLS_FEATURES];
+};
+
+// Akumulator training per kelas, hanya disentuh task handler web
+struct ClassAccum
+{
+    double sum[CLS_FEATURES];
+    double sumSq[CLS_FEATURES];
+};
+
+static ClassModel clsTrain; // nama & jumlah sampel, milik task handler
+static ClassAccum clsAccum[CLS_MAX];
+static ClassModel clsLive; // salinan untuk task label (seqlock, seq ganjil = sedang ditulis)
+static std::atomic<uint32_t> clsLiveSeq{0};
+
+// Hu dalam skala log: -log10(h), h1..h4 selalu >= 0
+static inline float clsLogHu(float h)
+{
+    return -log10f(h > 1e-12f ? h : 1e-12f);
+}
+
+// Fitur yang tidak bergantung posisi & rotasi blob
+void clsFeatures(const CclBlob &b, float f[CLS_FEATURES])
+{
+    float area = b.area > 0 ? (float)b.area : 1.0f;
+    // Sumbu utama dari momen orde 2: lambda = (h1 +- sqrt(h2)) / 2
+    float root = sqrtf(b.hu[1] > 0 ? b.hu[1] : 0);
+    float l1 = (b.hu[0] + root) * 0.5f;
+    float l2 = (b.hu[0] - root) * 0.5f;
+    f[0] = logf(area);
+    f[1] = b.perimeter / sqrtf(area);
+    f[2] = b.fill;
+    f[3] = (float)b.holes;
+    f[4] = sqrtf(l1 / (l2 > 1e-6f ? l2 : 1e-6f));
+    for (int i = 0; i < 4; i++)
+        f[5 + i] = clsLogHu(b.hu[i]);
+}
+
+// Nama kelas: huruf, angka, '_' dan '-', maks CLS_NAME_LEN - 1
+static bool clsValidName(const char *name)
+{
+    size_t n = strlen(name);
+    if (n == 0 || n >= CLS_NAME_LEN)
+        return false;
+    for (size_t i = 0; i < n; i++)
+    {
+        char c = name[i];
+        if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '-'))
+            return false;
+    }
+    return true;
+}
+
+int clsFindClass(const ClassModel &m, const char *name)
+{
+    for (int i = 0; i < m.classes; i++)
+        if (strcmp(m.names[i], name) == 0)
+            return i;
+    return -1;
+}
+
+// Kosongkan model training (belum dipublikasikan)
+void clsReset()
+{
+    memset(&clsTrain, 0, sizeof(clsTrain));
+    memset(clsAccum, 0, sizeof(clsAccum));
+}
+
+// Tambah satu sampel ke akumulator. Return false jika nama tidak valid / kelas penuh.
+bool clsAddSample(const char *name, const CclBlob &b)
+{
+    if (!clsValidName(name))
+        return false;
+    int c = clsFindClass(clsTrain, name);
+    if (c < 0)
+    {
+        if (clsTrain.classes >= CLS_MAX)
+            return false;
+        c = clsTrain.classes++;
+        strcpy(clsTrain.names[c], name);
+    }
+    float f[CLS_FEATURES];
+    clsFeatures(b, f);
+    for (int i = 0; i < CLS_FEATURES; i++)
+    {
+        clsAccum[c].sum[i] += f[i];
+        clsAccum[c].sumSq[i] += (double)f[i] * f[i];
+    }
+    clsTrain.samples[c]++;
+    return true;
+}
+
+// Hitung centroid & normalisasi dari akumulator, lalu publikasikan ke task label
+void clsPublish()
+{
+    ClassModel &m = clsTrain;
+    uint32_t total = 0;
+    double within[CLS_FEATURES] = {0};
+    for (int c = 0; c < m.classes; c++)
+    {
+        uint32_t n = m.samples[c];
+        total += n;
+        for (int i = 0; i < CLS_FEATURES; i++)
+        {
+            double mean = clsAccum[c].sum[i] / n;
+            m.centroid[c][i] = (float)mean;
+            within[i] += clsAccum[c].sumSq[i] - mean * clsAccum[c].sum[i];
+        }
+    }
+    int dof = (int)total - m.classes;
+    for (int i = 0; i < CLS_FEATURES; i++)
+    {
+        double sd = dof > 0 && within[i] > 0 ? sqrt(within[i] / dof) : 0;
+        m.invStd[i] = 1.0f / (float)(sd > clsStdFloor[i] ? sd : clsStdFloor[i]);
+    }
+
+    clsLiveSeq.fetch_add(1, std::memory_order_acq_rel);
+    clsLive = m;
+    clsLiveSeq.fetch_add(1, std::memory_order_release);
+}
+
+// Salin model terbaru ke out bila berubah sejak seen. Tidak pernah menunggu:
+// jika penulis sedang aktif, model lama dipakai untuk frame ini.
+void clsReadModel(ClassModel &out, uint32_t &seen)
+{
+    uint32_t s1 = clsLiveSeq.load(std::memory_order_acquire);
+    if (s1 == seen || (s1 & 1))
+        return;
+    ClassModel tmp = clsLive;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (clsLiveSeq.load(std::memory_order_relaxed) != s1)
+        return;
+    out = tmp;
+    seen = s1;
+}
+
+// Return indeks kelas terdekat, CLS_UNKNOWN jika model kosong / terlalu jauh
+int clsClassify(const ClassModel &m, const CclBlob &b, float *distOut = nullptr)
+{
+    if (m.classes == 0)
+        return CLS_UNKNOWN;
+    float f[CLS_FEATURES];
+    clsFeatures(b, f);
+    int best = CLS_UNKNOWN;
+    float bestD = 0;
+    for (int c = 0; c < m.classes; c++)
+    {
+        float d = 0;
+        for (int i = 0; i < CLS_FEATURES; i++)
+        {
+            float z = (f[i] - m.centroid[c][i]) * m.invStd[i];
+            d += z * z;
+        }
+        if (best == CLS_UNKNOWN || d < bestD)
+        {
+            best = c;
+            bestD = d;
+        }
+    }
+    float rms = sqrtf(bestD / CLS_FEATURES);
+    if (distOut)
+        *distOut = rms;
+    return rms <= CLS_REJECT_DIST ? best : CLS_UNKNOWN;
+}
+
+// Klasifikasi blobs[0..n) (mengisi blobs[i].cls) dan hitung per kelas
+void clsCountBlobs(const ClassModel &m, CclBlob *blobs, int n, uint16_t counts[CLS_MAX + 1])
+{
+    memset(counts, 0, sizeof(uint16_t) * (CLS_MAX + 1));
+    for (int i = 0; i < n; i++)
+    {
+        int c = clsClassify(m, blobs[i]);
+        blobs[i].cls = c == CLS_UNKNOWN ? -1 : c;
+        counts[c]++;
+    }
+}
+
+// ==== Format CSV sampel ====
+// label,area,perimeter,holes,fill,hu1..hu7
+
+static const char clsCsvHeader[] = "label,area,perimeter,holes,fill,hu1,hu2,hu3,hu4,hu5,hu6,hu7\n";
+
+int clsFormatSample(char *buf, size_t size, const char *name, const CclBlob &b)
+{
+    return snprintf(buf, size, "%s,%d,%d,%d,%.5f,%.6e,%.6e,%.6e,%.6e,%.6e,%.6e,%.6e\n", name, b.area,
+                    b.perimeter, b.holes, b.fill, b.hu[0], b.hu[1], b.hu[2], b.hu[3], b.hu[4], b.hu[5], b.hu[6]);
+}
+
+// Parse satu baris CSV. Return false untuk header / baris rusak.
+bool clsParseSample(const char *line, char name[CLS_NAME_LEN], CclBlob &b)
+{
+    const char *comma = strchr(line, ',');
+    if (!comma || comma - line >= CLS_NAME_LEN)
+        return false;
+    memcpy(name, line, comma - line);
+    name[comma - line] = '\0';
+    memset(&b, 0, sizeof(b));
+    int n = sscanf(comma + 1, "%d,%d,%d,%f,%f,%f,%f,%f,%f,%f,%f", &b.area, &b.perimeter, &b.holes, &b.fill,
+                   &b.hu[0], &b.hu[1], &b.hu[2], &b.hu[3], &b.hu[4], &b.hu[5], &b.hu[6]);
+    return n == 11 && b.area > 0 && clsValidName(name);
+}
+
+#ifdef ARDUINO
+#include <FS.h>
+
+// Latih ulang dari file sampel di SD lalu publikasikan. Return jumlah sampel.
+int clsLoad(fs::FS &fs)
+{
+    clsReset();
+    int loaded = 0;
+    File f = fs.open(CLS_SAMPLES_PATH, FILE_READ);
+    if (f)
+    {
+        char name[CLS_NAME_LEN];
+        CclBlob b;
+        while (f.available())
+        {
+            String line = f.readStringUntil('\n');
+            if (clsParseSample(line.c_str(), name, b) && clsAddSample(name, b))
+                loaded++;
+        }
+        f.close();
+    }
+    clsPublish();
+    return loaded;
+}
+
+// Simpan blobs[0..n) sebagai sampel kelas name ke SD (satu kali buka file) dan
+// tambahkan ke model, belum dipublikasikan. Return jumlah sampel yang masuk.
+int clsAppendSamples(fs::FS &fs, const char *name, const CclBlob *blobs, int n)
+{
+    if (!clsValidName(name))
+        return 0;
+    if (!fs.exists(CLS_DIR))
+        fs.mkdir(CLS_DIR);
+    bool fresh = !fs.exists(CLS_SAMPLES_PATH);
+    File f = fs.open(CLS_SAMPLES_PATH, FILE_APPEND);
+    if (!f)
+        return 0;
+    if (fresh)
+        f.print(clsCsvHeader);
+    int added = 0;
+    char line[CLS_LINE_MAX];
+    for (int i = 0; i < n; i++)
+    {
+        int len = clsFormatSample(line, sizeof(line), name, blobs[i]);
+        if (f.write((const uint8_t *)line, len) != (size_t)len || !clsAddSample(name, blobs[i]))
+            break;
+        added++;
+    }
+    f.close();
+    return added;
+}
+
+// Hapus semua sampel satu kelas (name == nullptr: semua kelas), lalu latih ulang
+bool clsRemoveClass(fs::FS &fs, const char *name)
+{
+    if (!name)
+    {
+        fs.remove(CLS_SAMPLES_PATH);
+        clsLoad(fs);
+        return true;
+    }
+    const char *tmpPath = CLS_DIR "/samples.tmp";
+    File in = fs.open(CLS_SAMPLES_PATH, FILE_READ);
+    if (!in)
+        return false;
+    File out = fs.open(tmpPath, FILE_WRITE);
+    if (!out)
+    {
+        in.close();
+        return false;
+    }
+    out.print(clsCsvHeader);
+    char lineName[CLS_NAME_LEN];
+    CclBlob b;
+    while (in.available())
+    {
+        String line = in.readStringUntil('\n');
+        if (clsParseSample(line.c_str(), lineName, b) && strcmp(lineName, name) != 0)
+        {
+            out.print(line);
+            out.print('\n');
+        }
+    }
+    in.close();
+    out.close();
+    fs.remove(CLS_SAMPLES_PATH);
+    bool ok = fs.rename(tmpPath, CLS_SAMPLES_PATH);
+    clsLoad(fs);
+    return ok;
+}
+#endif
+
+#endif
@@ -0,0 +1,353 @@
+// ccl.h - Connected component labeling satu sapuan dengan union-find
+// Label sementara hanya disimpan untuk 2 baris (baris atas + baris sekarang),
+// statistik (area, bounding box, centroid) diakumulasi per label sementara
+// lalu digabung ke root union-find setelah sapuan selesai. Tidak ada pass
+// kedua atas gambar dan tidak ada reset buffer per objek.
+// Fitur bentuk opsional (cclEnableShape): momen sampai orde 3 untuk Hu,
+// keliling (sisi piksel yang berbatasan dengan background) dan bilangan Euler
+// V - E + F untuk jumlah lubang, semuanya ikut diakumulasi di sapuan yang sama.
+#ifndef CCL_H
+#define CCL_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "frame_arena.h"
+
+struct CclStats
+{
+    int32_t area;
+    int32_t sumX, sumY;
+    uint16_t minX, maxX, minY, maxY;
+};
+
+// Akumulator fitur bentuk per label sementara, koordinat piksel absolut
+struct CclShapeStats
+{
+    int64_t sxx, sxy, syy;           // momen mentah orde 2
+    int64_t sxxx, sxxy, sxyy, syyy;  // momen mentah orde 3
+    int32_t perimeter;               // sisi piksel yang berbatasan dengan background
+    int32_t euler;                   // piksel - pasangan tetangga 4 arah + blok 2x2 penuh
+};
+
+struct CclBlob
+{
+    int area;
+    int minX, maxX, minY, maxY;
+    float cx, cy; // centroid
+    // Fitur bentuk, 0 jika cclEnableShape() belum dipanggil
+    int perimeter;
+    int holes;   // 1 - bilangan Euler (foreground 4 arah, background 8 arah)
+    float fill;  // area / luas bounding box
+    float hu[7]; // momen invarian Hu
+    int8_t cls;  // kelas dari blob_classifier.h, -1 = tidak dikenal
+};
+
+// Scratch arena, dialokasikan sekali oleh cclInit()
+static uint16_t *cclParent = nullptr;
+static CclStats *cclStats = nullptr;
+static uint16_t *cclRows = nullptr; // 2 x maxWidth
+static int cclMaxWidth = 0;
+static int cclMaxLabels = 0;
+static CclShapeStats *cclShape = nullptr; // nullptr = fitur bentuk tidak dihitung
+static bool cclOverflow = false; // true jika label habis pada frame terakhir
+
+// Kebutuhan arena cclInit() (+ cclEnableShape() jika shape)
+size_t cclArenaBytes(int maxWidth, int maxLabels, bool shape)
+{
+    if (maxLabels > 65535)
+        maxLabels = 65535;
+    size_t bytes = FRAME_ARENA_ROUND(sizeof(uint16_t) * (maxLabels + 1)) +
+                   FRAME_ARENA_ROUND(sizeof(CclStats) * (maxLabels + 1)) +
+                   FRAME_ARENA_ROUND(sizeof(uint16_t) * maxWidth * 2);
+    if (shape)
+        bytes += FRAME_ARENA_ROUND(sizeof(CclShapeStats) * (maxLabels + 1));
+    return bytes;
+}
+
+// maxLabels maksimal 65535 (label disimpan sebagai uint16_t)
+bool cclInit(int maxWidth, int maxLabels)
+{
+    if (cclParent)
+        return true;
+    if (maxLabels > 65535)
+        maxLabels = 65535;
+    cclParent = (uint16_t *)frameArenaAlloc(sizeof(uint16_t) * (maxLabels + 1));
+    cclStats = (CclStats *)frameArenaAlloc(sizeof(CclStats) * (maxLabels + 1));
+    cclRows = (uint16_t *)frameArenaAlloc(sizeof(uint16_t) * maxWidth * 2);
+    if (!cclParent || !cclStats || !cclRows)
+    {
+        frameArenaFree(cclParent);
+        frameArenaFree(cclStats);
+        frameArenaFree(cclRows);
+        cclParent = nullptr;
+        cclStats = nullptr;
+        cclRows = nullptr;
+        return false;
+    }
+    cclMaxWidth = maxWidth;
+    cclMaxLabels = maxLabels;
+    return true;
+}
+
+// Alokasi akumulator fitur bentuk (~64 byte per label); panggil setelah cclInit
+bool cclEnableShape()
+{
+    if (cclShape)
+        return true;
+    if (!cclParent)
+        return false;
+    cclShape = (CclShapeStats *)frameArenaAlloc(sizeof(CclShapeStats) * (cclMaxLabels + 1));
+    return cclShape != nullptr;
+}
+
+static inline uint16_t cclFind(uint16_t l)
+{
+    while (cclParent[l] != l)
+    {
+        cclParent[l] = cclParent[cclParent[l]]; // path halving
+        l = cclParent[l];
+    }
+    return l;
+}
+
+// Gabungkan dua set, root dengan label lebih kecil menjadi parent
+static inline uint16_t cclUnion(uint16_t a, uint16_t b)
+{
+    a = cclFind(a);
+    b = cclFind(b);
+    if (a == b)
+        return a;
+    if (a < b)
+    {
+        cclParent[b] = a;
+        return a;
+    }
+    cclParent[a] = b;
+    return b;
+}
+
+// Hu dari momen mentah (double: momen orde 3 di koordinat absolut bisa
+// ~1e13, float kehilangan semua digit saat dikurangi jadi momen sentral)
+static void cclHuMoments(const CclStats &s, const CclShapeStats &m, float hu[7])
+{
+    double n = s.area;
+    double cx = s.sumX / n, cy = s.sumY / n;
+    double mu20 = m.sxx - cx * s.sumX;
+    double mu02 = m.syy - cy * s.sumY;
+    double mu11 = m.sxy - cx * s.sumY;
+    double mu30 = m.sxxx - 3 * cx * m.sxx + 2 * cx * cx * s.sumX;
+    double mu03 = m.syyy - 3 * cy * m.syy + 2 * cy * cy * s.sumY;
+    double mu21 = m.sxxy - 2 * cx * m.sxy - cy * m.sxx + 2 * cx * cx * s.sumY;
+    double mu12 = m.sxyy - 2 * cy * m.sxy - cx * m.syy + 2 * cy * cy * s.sumX;
+
+    // Momen sentral ternormalisasi: eta_pq = mu_pq / n^(1 + (p+q)/2)
+    double n2 = n * n, n25 = n2 * sqrt(n);
+    double e20 = mu20 / n2, e02 = mu02 / n2, e11 = mu11 / n2;
+    double e30 = mu30 / n25, e03 = mu03 / n25, e21 = mu21 / n25, e12 = mu12 / n25;
+
+    double a = e30 + e12, b = e21 + e03;
+    double c = e30 - 3 * e12, d = 3 * e21 - e03;
+    hu[0] = e20 + e02;
+    hu[1] = (e20 - e02) * (e20 - e02) + 4 * e11 * e11;
+    hu[2] = c * c + d * d;
+    hu[3] = a * a + b * b;
+    hu[4] = c * a * (a * a - 3 * b * b) + d * b * (3 * a * a - b * b);
+    hu[5] = (e20 - e02) * (a * a - b * b) + 4 * e11 * a * b;
+    hu[6] = d * a * (a * a - 3 * b * b) - c * b * (3 * a * a - b * b);
+}
+
+// Sapuan utama. Shape = true ikut mengakumulasi fitur bentuk: sisi kiri/atas
+// dihitung di piksel foreground, sisi kanan/bawah di piksel background
+// sesudahnya (atau di tepi gambar), sehingga cukup baris label atas + sekarang.
+template <bool Shape>
+static int cclSweep(const uint8_t *src, int width, int height, int threshold)
+{
+    uint16_t *prev = cclRows;
+    uint16_t *cur = cclRows + cclMaxWidth;
+    memset(prev, 0, sizeof(uint16_t) * width);
+    int next = 1;
+    cclOverflow = false;
+
+    for (int y = 0; y < height; y++)
+    {
+        const uint8_t *row = src + y * width;
+        for (int x = 0; x < width; x++)
+        {
+            uint16_t up = prev[x];
+            uint16_t left = x > 0 ? cur[x - 1] : 0;
+            if (row[x] <= threshold)
+            {
+                cur[x] = 0;
+                if (Shape)
+                {
+                    if (left)
+                        cclShape[left].perimeter++;
+                    if (up)
+                        cclShape[up].perimeter++;
+                }
+                continue;
+            }
+
+            uint16_t l;
+            if (left)
+            {
+                l = left;
+                if (up && up != left)
+                    cclUnion(up, left);
+            }
+            else if (up)
+            {
+                l = up;
+            }
+            else
+            {
+                if (next > cclMaxLabels)
+                {
+                    cclOverflow = true;
+                    cur[x] = 0;
+                    continue;
+                }
+                l = next++;
+                cclParent[l] = l;
+                CclStats &n = cclStats[l];
+                n.area = 0;
+                n.sumX = n.sumY = 0;
+                n.minX = n.maxX = x;
+                n.minY = n.maxY = y;
+                if (Shape)
+                    memset(&cclShape[l], 0, sizeof(CclShapeStats));
+            }
+            cur[x] = l;
+
+            CclStats &s = cclStats[l];
+            s.area++;
+            s.sumX += x;
+            s.sumY += y;
+            if (x < s.minX)
+                s.minX = x;
+            if (x > s.maxX)
+                s.maxX = x;
+            if (y > s.maxY)
+                s.maxY = y;
+
+            if (Shape)
+            {
+                CclShapeStats &m = cclShape[l];
+                int32_t xx = x * x, yy = y * y, xy = x * y;
+                m.sxx += xx;
+                m.sxy += xy;
+                m.syy += yy;
+                m.sxxx += (int64_t)xx * x;
+                m.sxxy += (int64_t)xx * y;
+                m.sxyy += (int64_t)xy * y;
+                m.syyy += (int64_t)yy * y;
+                m.perimeter += !left + !up;
+                m.euler += 1 - (left != 0) - (up != 0) + (left && up && x > 0 && prev[x - 1]);
+            }
+        }
+        if (Shape && width > 0 && cur[width - 1])
+            cclShape[cur[width - 1]].perimeter++; // sisi kanan di tepi gambar
+        uint16_t *t = prev;
+        prev = cur;
+        cur = t;
+    }
+    if (Shape)
+        for (int x = 0; x < width; x++)
+            if (prev[x])
+                cclShape[prev[x]].perimeter++; // sisi bawah di tepi gambar
+    return next;
+}
+
+// Label piksel foreground (src[i] > threshold), konektivitas 4 arah.
+// Blob dengan minArea <= area <= maxArea ditulis ke out (maks maxOut),
+// return jumlah blob yang lolos filter (bisa > maxOut), atau -1 jika belum init.
+int cclLabel(const uint8_t *src, int width, int height, int threshold,
+             int minArea, int maxArea, CclBlob *out, int maxOut)
+{
+    if (!cclParent || width > cclMaxWidth)
+        return -1;
+
+    const bool shape = cclShape != nullptr;
+    int next = shape ? cclSweep<true>(src, width, height, threshold)
+                     : cclSweep<false>(src, width, height, threshold);
+
+    // Gabungkan statistik label sementara ke root. Root selalu <= label anak,
+    // jadi iterasi naik cukup satu kali.
+    for (int l = 1; l < next; l++)
+    {
+        uint16_t r = cclFind(l);
+        if (r == l)
+            continue;
+        CclStats &a = cclStats[r];
+        const CclStats &b = cclStats[l];
+        a.area += b.area;
+        a.sumX += b.sumX;
+        a.sumY += b.sumY;
+        if (b.minX < a.minX)
+            a.minX = b.minX;
+        if (b.maxX > a.maxX)
+            a.maxX = b.maxX;
+        if (b.minY < a.minY)
+            a.minY = b.minY;
+        if (b.maxY > a.maxY)
+            a.maxY = b.maxY;
+        if (shape)
+        {
+            CclShapeStats &ma = cclShape[r];
+            const CclShapeStats &mb = cclShape[l];
+            ma.sxx += mb.sxx;
+            ma.sxy += mb.sxy;
+            ma.syy += mb.syy;
+            ma.sxxx += mb.sxxx;
+            ma.sxxy += mb.sxxy;
+            ma.sxyy += mb.sxyy;
+            ma.syyy += mb.syyy;
+            ma.perimeter += mb.perimeter;
+            ma.euler += mb.euler;
+        }
+    }
+
+    int count = 0;
+    for (int l = 1; l < next; l++)
+    {
+        if (cclParent[l] != l)
+            continue;
+        const CclStats &s = cclStats[l];
+        if (s.area < minArea || s.area > maxArea)
+            continue;
+        if (count < maxOut)
+        {
+            CclBlob &b = out[count];
+            b.area = s.area;
+            b.minX = s.minX;
+            b.maxX = s.maxX;
+            b.minY = s.minY;
+            b.maxY = s.maxY;
+            b.cx = (float)s.sumX / s.area;
+            b.cy = (float)s.sumY / s.area;
+            b.cls = -1;
+            if (shape)
+            {
+                const CclShapeStats &m = cclShape[l];
+                b.perimeter = m.perimeter;
+                b.holes = m.euler < 1 ? 1 - m.euler : 0;
+                b.fill = (float)s.area / ((s.maxX - s.minX + 1) * (s.maxY - s.minY + 1));
+                cclHuMoments(s, m, b.hu);
+            }
+            else
+            {
+                b.perimeter = 0;
+                b.holes = 0;
+                b.fill = 0;
+                memset(b.hu, 0, sizeof(b.hu));
+            }
+        }
+        count++;
+    }
+    return count;
+}
+
+#endif
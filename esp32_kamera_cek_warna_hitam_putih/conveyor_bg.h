@@ -0,0 +1,239 @@
+// conveyor_bg.h - Mode konveyor: background subtraction + tracking centroid
+// Background dimodelkan sebagai EMA per piksel (Q8, di PSRAM). Setiap frame
+// hanya baris yang berubah yang dilabel, centroid blob dilacak antar frame,
+// dan setiap objek dihitung satu kali saat melintasi garis virtual.
+// Butuh: ccl.h
+#ifndef CONVEYOR_BG_H
+#define CONVEYOR_BG_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ccl.h"
+
+#define CONV_MAX_TRACKS 16
+#define CONV_TRACK_MAX_AGE 5 // frame tanpa match sebelum track dibuang
+
+struct ConveyorTrack
+{
+    float cx, cy;
+    uint8_t age;  // frame sejak terakhir cocok dengan blob
+    bool counted; // sudah melewati garis
+};
+
+// Parameter, boleh diubah dari handler web
+int convDiffThreshold = 25; // selisih gray terhadap background agar dianggap berubah
+int convLearnShift = 5;     // laju belajar background = 1/2^shift (5 -> 1/32)
+int convLinePercent = 50;   // posisi garis hitung, persen tinggi frame
+
+// Hasil, dibaca oleh task lain (hanya ditulis oleh task label)
+volatile uint32_t convLineCount = 0; // total objek melewati garis
+volatile int convChangedRows = 0;    // tinggi pita yang dilabel frame terakhir
+
+static uint16_t *convBg = nullptr;  // background Q8
+static uint8_t *convMask = nullptr; // 255 = berubah
+static int convMaxPixels = 0;
+static int convW = 0, convH = 0;
+static ConveyorTrack convTracks[CONV_MAX_TRACKS];
+static int convTrackCount = 0;
+static volatile bool convResetRequest = true;
+
+// Throughput: 60 bucket per detik
+static uint16_t convBucket[60];
+static uint32_t convBucketSec[60];
+
+size_t conveyorArenaBytes(int maxPixels)
+{
+    return FRAME_ARENA_ROUND(sizeof(uint16_t) * maxPixels) + FRAME_ARENA_ROUND(maxPixels);
+}
+
+bool conveyorInit(int maxPixels)
+{
+    if (convBg)
+        return true;
+    convBg = (uint16_t *)frameArenaAlloc(sizeof(uint16_t) * maxPixels);
+    convMask = (uint8_t *)frameArenaAlloc(maxPixels);
+    if (!convBg || !convMask)
+    {
+        frameArenaFree(convBg);
+        frameArenaFree(convMask);
+        convBg = nullptr;
+        convMask = nullptr;
+        return false;
+    }
+    convMaxPixels = maxPixels;
+    return true;
+}
+
+// Aman dipanggil dari task mana pun; reset dikerjakan di frame berikutnya
+void conveyorReset()
+{
+    convResetRequest = true;
+}
+
+static void conveyorAddCrossing(uint32_t nowMs)
+{
+    uint32_t sec = nowMs / 1000;
+    int i = sec % 60;
+    if (convBucketSec[i] != sec)
+    {
+        convBucketSec[i] = sec;
+        convBucket[i] = 0;
+    }
+    convBucket[i]++;
+    convLineCount++;
+}
+
+// Jumlah objek yang melewati garis dalam 60 detik terakhir
+int conveyorPerMinute(uint32_t nowMs)
+{
+    uint32_t sec = nowMs / 1000;
+    int total = 0;
+    for (int i = 0; i < 60; i++)
+    {
+        if (sec - convBucketSec[i] < 60)
+            total += convBucket[i];
+    }
+    return total;
+}
+
+// Cocokkan blob dengan track terdekat, hitung yang melintasi garis
+static void conveyorTrack(const CclBlob *blobs, int n, int w, int h, uint32_t nowMs)
+{
+    float lineY = h * convLinePercent / 100.0f;
+    float maxJump = w / 4.0f;
+    bool used[CONV_MAX_TRACKS] = {false};
+
+    for (int b = 0; b < n; b++)
+    {
+        int best = -1;
+        float bestD = maxJump * maxJump;
+        for (int t = 0; t < convTrackCount; t++)
+        {
+            if (used[t])
+                continue;
+            float dx = blobs[b].cx - convTracks[t].cx;
+            float dy = blobs[b].cy - convTracks[t].cy;
+            float d = dx * dx + dy * dy;
+            if (d < bestD)
+            {
+                bestD = d;
+                best = t;
+            }
+        }
+
+        if (best < 0)
+        {
+            if (convTrackCount >= CONV_MAX_TRACKS)
+                continue;
+            best = convTrackCount++;
+            ConveyorTrack &nt = convTracks[best];
+            nt.cx = blobs[b].cx;
+            nt.cy = blobs[b].cy;
+            nt.counted = false;
+        }
+
+        ConveyorTrack &t = convTracks[best];
+        used[best] = true;
+        float prevY = t.cy;
+        t.cx = blobs[b].cx;
+        t.cy = blobs[b].cy;
+        t.age = 0;
+        bool crossed = (prevY < lineY && t.cy >= lineY) || (prevY > lineY && t.cy <= lineY);
+        if (crossed && !t.counted)
+        {
+            t.counted = true;
+            conveyorAddCrossing(nowMs);
+        }
+    }
+
+    // Buang track yang sudah lama tidak terlihat
+    int keep = 0;
+    for (int t = 0; t < convTrackCount; t++)
+    {
+        if (!used[t] && ++convTracks[t].age > CONV_TRACK_MAX_AGE)
+            continue;
+        convTracks[keep++] = convTracks[t];
+    }
+    convTrackCount = keep;
+}
+
+// Proses satu frame gray. Blob di area yang berubah ditulis ke out (stored),
+// return jumlah blob bergerak di frame ini, -1 jika buffer tidak cukup.
+int conveyorProcess(const uint8_t *gray, int w, int h, int minArea, int maxArea,
+                    CclBlob *out, int maxOut, int &stored, uint32_t nowMs)
+{
+    stored = 0;
+    int pixels = w * h;
+    if (!convBg || pixels > convMaxPixels)
+        return -1;
+
+    // Frame pertama / ganti resolusi / reset: jadikan frame ini background
+    if (convResetRequest || w != convW || h != convH)
+    {
+        for (int i = 0; i < pixels; i++)
+            convBg[i] = gray[i] << 8;
+        convW = w;
+        convH = h;
+        convTrackCount = 0;
+        convLineCount = 0;
+        memset(convBucket, 0, sizeof(convBucket));
+        convResetRequest = false;
+        convChangedRows = 0;
+        return 0;
+    }
+
+    // Satu pass: mask perubahan + update background. Piksel foreground belajar
+    // 8x lebih lambat agar objek yang lewat tidak ikut masuk background.
+    const int thr = convDiffThreshold;
+    const int shift = convLearnShift;
+    int y0 = -1, y1 = -1;
+    for (int y = 0; y < h; y++)
+    {
+        const uint8_t *g = gray + y * w;
+        uint16_t *bg = convBg + y * w;
+        uint8_t *m = convMask + y * w;
+        bool rowChanged = false;
+        for (int x = 0; x < w; x++)
+        {
+            int32_t cur = (int32_t)g[x] << 8;
+            int32_t delta = cur - bg[x];
+            bool fg = delta > (thr << 8) || delta < -(thr << 8);
+            m[x] = fg ? 255 : 0;
+            bg[x] += delta >> (fg ? shift + 3 : shift);
+            rowChanged |= fg;
+        }
+        if (rowChanged)
+        {
+            if (y0 < 0)
+                y0 = y;
+            y1 = y;
+        }
+    }
+
+    int n = 0;
+    if (y0 >= 0)
+    {
+        // Label hanya pita baris yang berubah
+        convChangedRows = y1 - y0 + 1;
+        n = cclLabel(convMask + y0 * w, w, convChangedRows, 127, minArea, maxArea, out, maxOut);
+        if (n < 0)
+            return -1;
+        stored = n < maxOut ? n : maxOut;
+        for (int i = 0; i < stored; i++)
+        {
+            out[i].minY += y0;
+            out[i].maxY += y0;
+            out[i].cy += y0;
+        }
+    }
+    else
+    {
+        convChangedRows = 0;
+    }
+
+    conveyorTrack(out, stored, w, h, nowMs);
+    return n;
+}
+
+#endif
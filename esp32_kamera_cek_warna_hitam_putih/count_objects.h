@@ -0,0 +1,80 @@
+// count_objects.h - Hitung objek di gambar gray: CCL + smart grouping objek serupa
+// Tanpa kamera / FreeRTOS; dipanggil tahap label di count_pipeline.h dan
+// di-compile apa adanya oleh tools/count_replay di PC.
+// Butuh: ccl.h
+#ifndef COUNT_OBJECTS_H
+#define COUNT_OBJECTS_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <math.h>
+#include "ccl.h"
+
+#define COUNT_SMART_MAX 64 // blob maksimal yang ikut dikelompokkan smart mode
+
+struct CountObjectsParams
+{
+    int minArea, maxArea;
+    bool smart;            // hanya hitung objek yang punya kembaran serupa
+    float aspectTolerance; // selisih aspect ratio maksimal agar dianggap serupa
+};
+
+// Foreground = gray > threshold. Blob yang lolos filter disimpan ke blobs
+// (maks maxBlobs), jumlahnya di stored. Return jumlah objek, -1 jika ccl belum init.
+int countObjectsSmart(const uint8_t *gray, int width, int height, int threshold,
+                      const CountObjectsParams &p, CclBlob *blobs, int maxBlobs, int &stored)
+{
+    // Threshold + connected components dalam satu sapuan
+    int objectCount = cclLabel(gray, width, height, threshold, p.minArea, p.maxArea, blobs, maxBlobs);
+    stored = 0;
+    if (objectCount < 0)
+        return -1;
+    stored = objectCount < maxBlobs ? objectCount : maxBlobs;
+    if (!p.smart)
+        return objectCount; // Mode biasa, return semua objek
+
+    int n = stored < COUNT_SMART_MAX ? stored : COUNT_SMART_MAX;
+    float aspect[COUNT_SMART_MAX];
+    for (int i = 0; i < n; i++)
+    {
+        int bw = blobs[i].maxX - blobs[i].minX;
+        int bh = blobs[i].maxY - blobs[i].minY;
+        aspect[i] = (bw > 0 && bh > 0) ? (float)bw / bh : 1.0f;
+    }
+
+    // Smart mode: grouping dengan early termination
+    int similarGroups = 0;
+    bool grouped[COUNT_SMART_MAX] = {false};
+    for (int i = 0; i < n - 1; i++)
+    {
+        if (grouped[i])
+            continue;
+
+        int groupCount = 1;
+        grouped[i] = true;
+        int baseArea = blobs[i].area;
+
+        // Hanya check beberapa objek terdekat untuk speed
+        int end = i + 10 < n ? i + 10 : n;
+        for (int j = i + 1; j < end; j++)
+        {
+            if (grouped[j])
+                continue;
+            int areaDiff = abs(baseArea - blobs[j].area);
+            float aspectDiff = fabsf(aspect[i] - aspect[j]);
+            if (areaDiff < baseArea * 0.4 && aspectDiff < p.aspectTolerance)
+            {
+                grouped[j] = true;
+                groupCount++;
+                if (groupCount >= 5)
+                    break; // Limit untuk performance
+            }
+        }
+
+        if (groupCount >= 2)
+            similarGroups += groupCount;
+    }
+    return similarGroups;
+}
+
+#endif
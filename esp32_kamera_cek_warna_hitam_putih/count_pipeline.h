@@ -0,0 +1,283 @@
+// count_pipeline.h - Pipeline counting real-time di core 1
+// Tahap: capture -> decode (JPEG -> gray) -> label (CCL + smart grouping) -> publish.
+// Antar tahap memakai SpscQueue lock-free, consumer dibangunkan dengan task
+// notification. loop() dan handler web hanya membaca hasil terakhir.
+// Butuh: realtimeCounting, conveyorMode, objectCount, thresholdValue, thresholdMode,
+//        adaptiveRadius, adaptiveOffset, jpegToGrayscale (crop ROI), countObjectsInGray,
+//        conveyor_bg.h, auto_threshold.h, blob_classifier.h, frame_hub.h, overlay_stream.h,
+//        MAX_OBJECTS, grayMaxW, grayMaxH
+#ifndef COUNT_PIPELINE_H
+#define COUNT_PIPELINE_H
+
+#include <atomic>
+#include "esp_camera.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "spsc_queue.h"
+#include "frame_hub.h"
+#include "frame_arena.h"
+#include "metrics.h"
+
+#define PIPE_CORE 1
+#define PIPE_SLOTS 2 // jumlah buffer gray / hasil yang berputar
+
+struct GraySlot {
+  uint8_t *gray;
+  int w, h;       // ukuran area ROI
+  int offX, offY; // posisi ROI dalam frame gray penuh
+  int threshMode;
+  int threshold; // foreground = gray > threshold (mode adaptif: nilai Otsu acuan)
+  uint32_t seq;
+  int64_t tCaptureUs;
+};
+
+struct CountResult {
+  uint32_t seq;       // nomor frame
+  int count;          // hasil hitung (normal/smart), atau blob bergerak di mode konveyor
+  int stored;         // jumlah blob di array blobs
+  CclBlob blobs[MAX_OBJECTS];
+  int w, h;             // ukuran ROI; koordinat blob relatif terhadap ROI
+  int offX, offY;       // posisi ROI dalam frame gray penuh
+  int threshMode;
+  int threshold;
+  bool conveyor;        // hasil dari mode konveyor
+  uint32_t lineCount;   // mode konveyor: total objek melewati garis
+  int perMinute;        // mode konveyor: objek per menit terakhir
+  int classes;          // jumlah kelas model saat frame ini diklasifikasi
+  uint16_t classCounts[CLS_MAX + 1]; // per kelas, indeks CLS_UNKNOWN = tidak dikenal
+  uint32_t frameUs;     // latensi capture -> publish
+  uint32_t timestampMs; // millis() saat publish
+};
+
+static GraySlot pipeGray[PIPE_SLOTS];
+static uint8_t *pipeAdaptMask = nullptr; // mask mode adaptif, hanya dipakai tahap label
+static uint32_t pipeHist[256];           // histogram gray, hanya dipakai tahap decode
+static ClassModel pipeClassModel;        // salinan model classifier milik tahap label
+static uint32_t pipeClassSeq = 0;
+static CountResult pipeResults[PIPE_SLOTS];
+
+static SpscQueue<FrameRef *, 1> qCaptured;      // capture -> decode
+static SpscQueue<int, PIPE_SLOTS> qGrayReady;   // decode -> label
+static SpscQueue<int, PIPE_SLOTS> qGrayFree;    // label -> decode
+static SpscQueue<int, PIPE_SLOTS> qResultReady; // label -> publish
+static SpscQueue<int, PIPE_SLOTS> qResultFree;  // publish -> label
+
+static TaskHandle_t pipeCaptureTask = NULL;
+static TaskHandle_t pipeDecodeTask = NULL;
+static TaskHandle_t pipeLabelTask = NULL;
+static TaskHandle_t pipePublishTask = NULL;
+
+static volatile uint32_t pipeDroppedFrames = 0;
+static volatile uint32_t pipeDecodeErrors = 0;
+static volatile bool pipeSingleShot = false; // minta satu frame saat realtime OFF
+
+// Hasil terakhir, dibaca lewat seqlock (seq ganjil = sedang ditulis)
+static CountResult pipeLatest;
+static std::atomic<uint32_t> pipeLatestSeq{0};
+
+static void pipePublishLatest(const CountResult &r) {
+  pipeLatestSeq.fetch_add(1, std::memory_order_acq_rel);
+  pipeLatest = r;
+  pipeLatestSeq.fetch_add(1, std::memory_order_release);
+}
+
+// Salin hasil terakhir; false jika belum ada frame yang diproses
+bool pipelineReadLatest(CountResult &out) {
+  for (;;) {
+    uint32_t s1 = pipeLatestSeq.load(std::memory_order_acquire);
+    if (s1 == 0) return false;
+    if (s1 & 1) {
+      taskYIELD();
+      continue;
+    }
+    out = pipeLatest;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (pipeLatestSeq.load(std::memory_order_relaxed) == s1) return true;
+  }
+}
+
+// Nomor frame hasil terakhir (0 = belum ada) tanpa menyalin seluruh CountResult
+static uint32_t pipelineLatestFrame() {
+  for (;;) {
+    uint32_t s1 = pipeLatestSeq.load(std::memory_order_acquire);
+    if (s1 == 0) return 0;
+    if (s1 & 1) {
+      taskYIELD();
+      continue;
+    }
+    uint32_t seq = pipeLatest.seq;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (pipeLatestSeq.load(std::memory_order_relaxed) == s1) return seq;
+  }
+}
+
+// Saat realtime OFF: minta satu frame baru dan tunggu hasilnya (maks timeoutMs)
+bool pipelineCountOnce(CountResult &out, uint32_t timeoutMs) {
+  uint32_t prevSeq = pipelineLatestFrame();
+  pipeSingleShot = true;
+  unsigned long start = millis();
+  while (millis() - start < timeoutMs) {
+    if (pipelineReadLatest(out) && out.seq != prevSeq) return true;
+    vTaskDelay(pdMS_TO_TICKS(10));
+  }
+  return false;
+}
+
+// Pop dengan menunggu notifikasi dari producer
+template <typename Q, typename T>
+static void pipeWaitPop(Q &q, T &item) {
+  while (!q.pop(item)) ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(20));
+}
+
+// Frame diambil dari frame hub, bukan langsung dari driver, sehingga viewer
+// MJPEG dan counter berbagi capture yang sama
+static void pipeCaptureLoop(void *) {
+  int sub = frameHubSubscribe();
+  for (;;) {
+    if (!realtimeCounting && !conveyorMode && !pipeSingleShot) {
+      vTaskDelay(pdMS_TO_TICKS(20));
+      continue;
+    }
+    FrameRef *ref = frameHubGet(sub, 1000);
+    if (!ref) {
+      vTaskDelay(pdMS_TO_TICKS(10));
+      continue;
+    }
+    if (!qCaptured.push(ref)) {
+      // Tahap decode masih sibuk: buang frame, jangan menahan buffer driver
+      frameHubRelease(ref);
+      pipeDroppedFrames++;
+      vTaskDelay(1);
+      continue;
+    }
+    pipeSingleShot = false;
+    xTaskNotifyGive(pipeDecodeTask);
+  }
+}
+
+static void pipeDecodeLoop(void *) {
+  uint32_t seq = 0;
+  int slot = -1; // slot gray yang sedang dipegang tahap ini
+  for (;;) {
+    FrameRef *ref;
+    pipeWaitPop(qCaptured, ref);
+    if (slot < 0) pipeWaitPop(qGrayFree, slot);
+
+    GraySlot &g = pipeGray[slot];
+    int64_t t0 = esp_timer_get_time();
+    g.threshMode = thresholdMode;
+    bool needHist = g.threshMode != THRESH_MANUAL;
+    bool ok = jpegToGrayscale(ref->fb, g.gray, grayMaxW * grayMaxH, g.w, g.h, needHist ? pipeHist : nullptr, g.offX, g.offY);
+    frameHubRelease(ref);
+    if (!ok) {
+      pipeDecodeErrors++;
+      continue; // slot tetap dipegang untuk frame berikutnya
+    }
+    metricObserveSince(STAGE_CONVERT, t0);
+    // Otsu O(256) dari histogram yang diisi saat decode, tanpa pass tambahan
+    int t = needHist ? otsuThreshold(pipeHist) : -1;
+    g.threshold = t < 0 ? thresholdValue : t;
+    g.seq = ++seq;
+    g.tCaptureUs = t0;
+
+    qGrayReady.push(slot);
+    slot = -1;
+    xTaskNotifyGive(pipeLabelTask);
+  }
+}
+
+static void pipeLabelLoop(void *) {
+  for (;;) {
+    int slot, rslot;
+    pipeWaitPop(qGrayReady, slot);
+    pipeWaitPop(qResultFree, rslot);
+
+    const GraySlot &g = pipeGray[slot];
+    CountResult &r = pipeResults[rslot];
+    int64_t t0 = esp_timer_get_time();
+    int count;
+    r.threshMode = g.threshMode;
+    r.threshold = g.threshold;
+    r.conveyor = conveyorMode;
+    if (r.conveyor) {
+      uint32_t now = millis();
+      count = conveyorProcess(g.gray, g.w, g.h, minObjectSize, maxObjectSize, r.blobs, MAX_OBJECTS, r.stored, now);
+      r.lineCount = convLineCount;
+      r.perMinute = conveyorPerMinute(now);
+    } else {
+      const uint8_t *src = g.gray;
+      int threshold = g.threshold;
+      if (g.threshMode == THRESH_ADAPTIVE) {
+        if (pipeAdaptMask &&
+            adaptiveThresholdMask(g.gray, g.w, g.h, adaptiveRadius, adaptiveOffset, false, pipeAdaptMask, 255)) {
+          src = pipeAdaptMask;
+          threshold = 127;
+        } else {
+          r.threshMode = THRESH_OTSU; // buffer integral tidak ada: pakai Otsu
+        }
+      }
+      count = countObjectsInGray(src, g.w, g.h, threshold, r.blobs, r.stored);
+    }
+    // Klasifikasi dari fitur bentuk yang sudah dihitung saat labeling
+    clsReadModel(pipeClassModel, pipeClassSeq);
+    r.classes = pipeClassModel.classes;
+    clsCountBlobs(pipeClassModel, r.blobs, r.stored, r.classCounts);
+    metricObserveSince(STAGE_LABEL, t0);
+    r.count = count < 0 ? 0 : count;
+    r.seq = g.seq;
+    r.w = g.w;
+    r.h = g.h;
+    r.offX = g.offX;
+    r.offY = g.offY;
+    r.frameUs = (uint32_t)(esp_timer_get_time() - g.tCaptureUs);
+    // Salinan kecil untuk /overlay (maks 5 fps, hanya jika ada viewer) sebelum slot gray dilepas
+    overlayOffer(g.gray, g.w, g.h, r.blobs, r.stored, r.conveyor ? (int)r.lineCount : r.count,
+                 r.conveyor ? g.h * convLinePercent / 100 : -1);
+
+    qGrayFree.push(slot);
+    xTaskNotifyGive(pipeDecodeTask);
+    qResultReady.push(rslot);
+    xTaskNotifyGive(pipePublishTask);
+  }
+}
+
+static void pipePublishLoop(void *) {
+  for (;;) {
+    int rslot;
+    pipeWaitPop(qResultReady, rslot);
+    CountResult &r = pipeResults[rslot];
+    r.timestampMs = millis();
+    pipePublishLatest(r);
+    objectCount = r.conveyor ? (int)r.lineCount : r.count;
+    qResultFree.push(rslot);
+    xTaskNotifyGive(pipeLabelTask);
+  }
+}
+
+// Slot gray + buffer mode adaptif, semuanya seukuran gray terbesar (grayMaxW x grayMaxH)
+size_t countPipelineArenaBytes() {
+  size_t pixels = FRAME_ARENA_ROUND(grayMaxW * grayMaxH);
+  return (PIPE_SLOTS + 1) * pixels + adaptiveThresholdArenaBytes(grayMaxW, grayMaxH);
+}
+
+bool startCountPipeline() {
+  for (int i = 0; i < PIPE_SLOTS; i++) {
+    pipeGray[i].gray = (uint8_t *)frameArenaAlloc(grayMaxW * grayMaxH);
+    if (!pipeGray[i].gray) return false;
+    qGrayFree.push(i);
+    qResultFree.push(i);
+  }
+  // Buffer mode adaptif opsional: jika gagal, mode adaptif jatuh ke Otsu
+  if (adaptiveThresholdInit(grayMaxW, grayMaxH))
+    pipeAdaptMask = (uint8_t *)frameArenaAlloc(grayMaxW * grayMaxH);
+  // Prioritas sama dengan loopTask (1) agar WebServer di loop() tetap kebagian waktu.
+  // Urutan dibuat dari hilir ke hulu agar handle notifikasi sudah valid.
+  bool ok = xTaskCreatePinnedToCore(pipePublishLoop, "cnt_publish", 4096, NULL, 1, &pipePublishTask, PIPE_CORE) == pdPASS;
+  ok = ok && xTaskCreatePinnedToCore(pipeLabelLoop, "cnt_label", 4096, NULL, 1, &pipeLabelTask, PIPE_CORE) == pdPASS;
+  ok = ok && xTaskCreatePinnedToCore(pipeDecodeLoop, "cnt_decode", 4096, NULL, 1, &pipeDecodeTask, PIPE_CORE) == pdPASS;
+  ok = ok && xTaskCreatePinnedToCore(pipeCaptureLoop, "cnt_capture", 4096, NULL, 1, &pipeCaptureTask, PIPE_CORE) == pdPASS;
+  return ok;
+}
+
+#endif
@@ -4,6 +4,15 @@
 #include <FS.h>
 #include <SD_MMC.h>
 #include "esp32-hal-psram.h"
+#include "jpeg_gray.h"
+#include "ccl.h"
+#include "count_objects.h"
+#include "blob_classifier.h"
+#include "conveyor_bg.h"
+#include "auto_threshold.h"
+#include "roi.h"
+#include "frame_hub.h"
+#include "overlay_stream.h"
 
 // ---------- WiFi AP ----------
 const char *ssid = "ESP32-OV5640";
@@ -19,27 +28,19 @@ volatile int lastCount = 0;
 bool realtimeCounting = true; // Aktifkan real-time counting secara default
 bool grayscaleEnabled = true; // Mode grayscale default untuk tampilan & sensor
 bool smartMode = false;       // Mode smart counting untuk objek serupa
+bool conveyorMode = false;    // Mode konveyor: hitung objek yang melewati garis
 int thresholdValue = 128;     // Threshold untuk deteksi objek
+int thresholdMode = THRESH_MANUAL; // Manual, Otsu, atau adaptif lokal
+int adaptiveRadius = 8;       // Radius jendela mean lokal (mode adaptif)
+int adaptiveOffset = 10;      // Persen lebih terang dari mean lokal (mode adaptif)
 int minObjectSize = 50;       // Ukuran minimum objek (pixel)
 int maxObjectSize = 5000;     // Ukuran maksimum objek (pixel)
 float aspectRatioTolerance = 0.3; // Toleransi aspect ratio untuk objek serupa
+int jpegDecodeScale = JPEG_GRAY_SCALE_4; // Skala decode JPEG: 2, 4, atau 8 (VGA/4 = 160x120)
 
-// Struktur untuk flood fill
-struct Point {
-  int x, y;
-};
-
-// Buffer untuk image processing
-uint8_t *grayBuffer = nullptr;
-uint8_t *threshBuffer = nullptr;
-bool *visited = nullptr;
-Point stack[1000]; // Stack untuk flood fill
-int stackTop = -1;
-int boundingMinX, boundingMaxX, boundingMinY, boundingMaxY;
-
-// Timer untuk real-time processing
-unsigned long lastCountingTime = 0;
-const unsigned long countingInterval = 1000; // Hitung setiap 1 detik untuk stabilitas smart counting
+#define MAX_OBJECTS 64
+// Gray terbesar = frame kamera pada skala decode 1/2, diset dari frame aktif saat boot
+int grayMaxW = 320, grayMaxH = 240;
 
 // Fungsi untuk mendapatkan konfigurasi kamera
 camera_config_t getCameraConfig(int variant)
@@ -53,7 +54,7 @@ camera_config_t getCameraConfig(int variant)
   config.pixel_format = PIXFORMAT_JPEG;      // JPEG lebih stabil
   config.frame_size = hasPSRAM ? FRAMESIZE_VGA : FRAMESIZE_QVGA; // Naikkan ke VGA jika PSRAM tersedia
   config.jpeg_quality = hasPSRAM ? 10 : 12;  // Lebih baik saat PSRAM ada
-  config.fb_count = hasPSRAM ? 2 : 1;        // Double buffer bila PSRAM
+  config.fb_count = hasPSRAM ? 3 : 1;        // Triple buffer: frame hub + viewer lambat tidak menahan sensor
   config.fb_location = hasPSRAM ? CAMERA_FB_IN_PSRAM : CAMERA_FB_IN_DRAM; // Simpan FB di PSRAM jika ada
   config.grab_mode = CAMERA_GRAB_LATEST;     // Ambil frame terbaru
   config.xclk_freq_hz = 10000000;            // Clock rendah
@@ -124,198 +125,37 @@ camera_config_t getCameraConfig(int variant)
 
 // ==================== FUNGSI PENGHITUNGAN OBJEK ====================
 
-// Fungsi Flood Fill iterative (lebih aman dari recursive)
-int floodFill(int startX, int startY, int width, int height)
-{
-  if (startX < 0 || startX >= width || startY < 0 || startY >= height)
-    return 0;
-  if (visited[startY * width + startX] || threshBuffer[startY * width + startX] == 0)
-    return 0;
-
-  stackTop = -1; // Reset stack
-  int size = 0;
-  
-  // Initialize bounding box untuk optimasi
-  boundingMinX = startX; boundingMaxX = startX;
-  boundingMinY = startY; boundingMaxY = startY;
-
-  // Push starting point
-  if (stackTop < 999)
-  {
-    stack[++stackTop] = {startX, startY};
-  }
-
-  while (stackTop >= 0)
-  {
-    Point p = stack[stackTop--];
-    int x = p.x, y = p.y;
-
-    if (x < 0 || x >= width || y < 0 || y >= height)
-      continue;
-    if (visited[y * width + x] || threshBuffer[y * width + x] == 0)
-      continue;
-
-    visited[y * width + x] = true;
-    size++;
-    
-    // Update bounding box selama flood fill
-    boundingMinX = min(boundingMinX, x);
-    boundingMaxX = max(boundingMaxX, x);
-    boundingMinY = min(boundingMinY, y);
-    boundingMaxY = max(boundingMaxY, y);
-
-    // Push neighbors (hanya 4 arah untuk efisiensi)
-    if (stackTop < 995)
-    { // Sisakan ruang untuk 4 push
-      stack[++stackTop] = {x - 1, y};
-      stack[++stackTop] = {x + 1, y};
-      stack[++stackTop] = {x, y - 1};
-      stack[++stackTop] = {x, y + 1};
-    }
+// Decode JPEG ke grayscale (kanal Y saja) pada skala 1/jpegDecodeScale, hanya area ROI.
+// hist (opsional) diisi histogram 256 bin dalam pass decode yang sama.
+// offX/offY = posisi ROI dalam piksel gray frame penuh.
+bool jpegToGrayscale(camera_fb_t *fb, uint8_t *grayOut, int maxPixels, int &width, int &height,
+                     uint32_t *hist, int &offX, int &offY) {
+  if (fb->format != PIXFORMAT_JPEG) return false;
+
+  offX = offY = 0;
+  CountRoi roi = roiCurrent;
+  if (roiIsFull(roi)) {
+    return jpegGrayDecode(fb->buf, fb->len, jpegDecodeScale, grayOut, maxPixels, width, height, hist);
   }
 
-  return size;
+  // x/y kelipatan skala agar offset di gambar gray tetap bilangan bulat
+  RoiRect rc = roiToRect(roi, fb->width, fb->height, jpegDecodeScale);
+  rc.y -= rc.y % jpegDecodeScale;
+  JpegGrayRect crop = {rc.x, rc.y, rc.w, rc.h};
+  offX = rc.x / jpegDecodeScale;
+  offY = rc.y / jpegDecodeScale;
+  return jpegGrayDecode(fb->buf, fb->len, jpegDecodeScale, grayOut, maxPixels, width, height, hist, &crop);
 }
 
-// Struktur untuk menyimpan informasi objek terdeteksi
-struct ObjectInfo {
-  int area;
-  int minX, maxX, minY, maxY;
-  float aspectRatio;
-};
-
-// Sederhana JPEG ke grayscale (RGB weighted average)
-void jpegToGrayscale(camera_fb_t *fb, uint8_t *grayOut, int &width, int &height) {
-  // Untuk implementasi sederhana, kita ambil resolusi dari frame size
-  if (fb->format != PIXFORMAT_JPEG) return;
-  
-  bool hasPSRAM = psramFound();
-  if (hasPSRAM && fb->width == 640 && fb->height == 480) {
-    width = 640; height = 480;
-  } else {
-    width = 320; height = 240; // QVGA
-  }
-  
-  // Simulasi decode JPEG ke grayscale (implementasi sederhana)
-  // Dalam implementasi nyata, gunakan library JPEG decoder
-  for (int i = 0; i < width * height; i++) {
-    // Ambil byte dari JPEG sebagai estimasi grayscale
-    grayOut[i] = (i < fb->len) ? fb->buf[i % fb->len] : 128;
-  }
-}
-
-// Smart object counting dengan connected components analysis
-int countObjectsSmart(camera_fb_t *fb) {
-  if (!fb) return 0;
-  
-  int width, height;
-  const int maxPixels = 640 * 480; // VGA max
-  
-  // Alokasi buffer jika belum ada
-  if (!grayBuffer) {
-    if (psramFound()) {
-      grayBuffer = (uint8_t*)ps_malloc(maxPixels);
-      threshBuffer = (uint8_t*)ps_malloc(maxPixels);
-      visited = (bool*)ps_malloc(maxPixels);
-    } else {
-      grayBuffer = (uint8_t*)malloc(maxPixels);
-      threshBuffer = (uint8_t*)malloc(maxPixels);
-      visited = (bool*)malloc(maxPixels);
-    }
-  }
-  
-  if (!grayBuffer || !threshBuffer || !visited) return -1;
-  
-  // Konversi JPEG ke grayscale
-  jpegToGrayscale(fb, grayBuffer, width, height);
-  
-  // Threshold untuk binary image
-  for (int i = 0; i < width * height; i++) {
-    threshBuffer[i] = (grayBuffer[i] > thresholdValue) ? 255 : 0;
-    visited[i] = false;
-  }
-  
-  // Connected components analysis dengan optimasi
-  ObjectInfo objects[30]; // Kurangi max untuk speed
-  int objectCount = 0;
-  
-  // Scan dengan step untuk real-time performance
-  int step = smartMode ? 2 : 1; // Skip beberapa pixel untuk smart mode
-  for (int y = 0; y < height && objectCount < 30; y += step) {
-    for (int x = 0; x < width && objectCount < 30; x += step) {
-      if (!visited[y * width + x] && threshBuffer[y * width + x] > 0) {
-        int area = floodFill(x, y, width, height);
-        
-        if (area >= minObjectSize && area <= maxObjectSize) {
-          // Optimized bounding box calculation during flood fill
-          objects[objectCount] = {area, boundingMinX, boundingMaxX, boundingMinY, boundingMaxY, 
-            (boundingMaxX > boundingMinX && boundingMaxY > boundingMinY) ? 
-            (float)(boundingMaxX - boundingMinX) / (boundingMaxY - boundingMinY) : 1.0};
-          objectCount++;
-        }
-        
-        // Reset visited untuk objek ini (untuk flood fill berikutnya)
-        for (int i = 0; i < width * height; i++) {
-          if (visited[i]) visited[i] = false;
-        }
-      }
-    }
-  }
-  
-  if (!smartMode) return objectCount; // Mode biasa, return semua objek
-  
-  // Smart mode: optimized grouping dengan early termination
-  int similarGroups = 0;
-  bool grouped[50] = {false};
-  
-  // Quick similarity check untuk real-time performance
-  for (int i = 0; i < objectCount - 1; i++) {
-    if (grouped[i]) continue;
-    
-    int groupCount = 1;
-    grouped[i] = true;
-    int baseArea = objects[i].area;
-    float baseAspect = objects[i].aspectRatio;
-    
-    // Hanya check beberapa objek terdekat untuk speed
-    for (int j = i + 1; j < min(i + 10, objectCount); j++) {
-      if (grouped[j]) continue;
-      
-      // Fast similarity check
-      int areaDiff = abs(baseArea - objects[j].area);
-      float aspectDiff = abs(baseAspect - objects[j].aspectRatio);
-      
-      if (areaDiff < baseArea * 0.4 && aspectDiff < aspectRatioTolerance) {
-        grouped[j] = true;
-        groupCount++;
-        if (groupCount >= 5) break; // Limit untuk performance
-      }
-    }
-    
-    if (groupCount >= 2) {
-      similarGroups += groupCount;
-    }
-  }
-  
-  return similarGroups;
+// Hitung objek dengan setting dari UI; algoritmanya di count_objects.h.
+// Blob yang lolos filter disimpan ke blobs (maks MAX_OBJECTS), jumlahnya di stored.
+int countObjectsInGray(const uint8_t *gray, int width, int height, int threshold, CclBlob *blobs, int &stored) {
+  CountObjectsParams p = {minObjectSize, maxObjectSize, smartMode, aspectRatioTolerance};
+  return countObjectsSmart(gray, width, height, threshold, p, blobs, MAX_OBJECTS, stored);
 }
 
-// Fungsi wrapper untuk kompatibilitas
-int countObjects(camera_fb_t *fb) {
-  if (smartMode) {
-    return countObjectsSmart(fb);
-  } else {
-    // Mode sederhana lama
-    if (!fb) return 0;
-    int simpleCount = 0;
-    if (fb->len > 5000) simpleCount++;
-    if (fb->len > 8000) simpleCount++;
-    if (fb->len > 12000) simpleCount++;
-    if (fb->len > 15000) simpleCount++;
-    simpleCount += (millis() / 10000) % 3;
-    return simpleCount;
-  }
-}
+// Pipeline counting di core 1 (capture -> decode -> label -> publish)
+#include "count_pipeline.h"
 
 // Fungsi untuk mengkonversi grayscale ke JPEG untuk display
 void convertGrayscaleToJpeg(camera_fb_t *fb, String &jpegData)
@@ -361,7 +201,8 @@ void handleRoot()
   // Live stream preview
   html += "<div style='margin: 10px auto; max-width: 640px'>";
   html += "<img id='live' src='/mjpeg' style='width:100%; max-width: 480px; border-radius:8px; box-shadow:0 2px 8px rgba(0,0,0,0.2);' alt='Live stream' onerror=\"this.style.display='none'\">";
-  html += "<div style='font-size:12px; color:#666; margin-top:6px'>Jika live view tidak tampil, coba refresh atau klik 'LIHAT GAMBAR'.</div>";
+  html += "<div style='font-size:12px; color:#666; margin-top:6px'>Jika live view tidak tampil, coba refresh atau klik 'LIHAT GAMBAR'. ";
+  html += "<a href='#' id='overlayBtn' onclick='toggleOverlay();return false'>🔲 Tampilkan deteksi</a></div>";
   html += "</div>";
   html += String("<div style='margin:10px 0; font-size:14px'>SD: ") + (sdMounted ? "<span style='color:#2E7D32'>Mounted</span>" : "<span style='color:#B71C1C'>Not mounted</span>") + "</div>";
     html += "<div class='controls'>";
@@ -371,14 +212,27 @@ void handleRoot()
   html += "<button id='grayBtn' class='btn-success' onclick='toggleGray()'></button>";
   html += "<button id='smartBtn' class='btn-primary' onclick='toggleSmart()'></button>";
   html += "<button id='toggleBtn' class='btn-warning' onclick='toggleRealtime()'></button>";
+  html += "<button id='convBtn' class='btn-primary' onclick='toggleConveyor()'></button>";
     html += "</div>";
 
     html += "<div class='settings'>";
     html += "<h3>⚙️ Pengaturan Deteksi</h3>";
     html += "<p><b>Mode:</b> <span id='modeStatus'></span></p>";
     html += "<p><b>Threshold:</b> <input type='range' id='threshold' min='50' max='200' value='" + String(thresholdValue) + "' onchange='updateThreshold(this.value)'> <span id='thresholdVal'>" + String(thresholdValue) + "</span></p>";
+    html += "<p><b>Mode Threshold:</b> <select id='threshMode' onchange='updateThreshMode(this.value)'>";
+    html += String("<option value='manual'") + (thresholdMode == THRESH_MANUAL ? " selected" : "") + ">Manual</option>";
+    html += String("<option value='otsu'") + (thresholdMode == THRESH_OTSU ? " selected" : "") + ">Otomatis (Otsu)</option>";
+    html += String("<option value='adaptive'") + (thresholdMode == THRESH_ADAPTIVE ? " selected" : "") + ">Adaptif lokal</option>";
+    html += "</select></p>";
+    html += "<p><b>ROI (%):</b> x <input type='number' id='roiX' min='0' max='95' style='width:50px' value='" + String(roiCurrent.x) + "'>";
+    html += " y <input type='number' id='roiY' min='0' max='95' style='width:50px' value='" + String(roiCurrent.y) + "'>";
+    html += " w <input type='number' id='roiW' min='5' max='100' style='width:50px' value='" + String(roiCurrent.w) + "'>";
+    html += " h <input type='number' id='roiH' min='5' max='100' style='width:50px' value='" + String(roiCurrent.h) + "'>";
+    html += " <button class='btn-primary' onclick='updateRoi()'>SET</button> <button class='btn-warning' onclick='resetRoi()'>FULL</button></p>";
     html += "<p><b>Min Size:</b> <input type='range' id='minSize' min='10' max='200' value='" + String(minObjectSize) + "' onchange='updateMinSize(this.value)'> <span id='minSizeVal'>" + String(minObjectSize) + "</span> px</p>";
     html += "<p><b>Max Size:</b> <input type='range' id='maxSize' min='500' max='10000' value='" + String(maxObjectSize) + "' onchange='updateMaxSize(this.value)'> <span id='maxSizeVal'>" + String(maxObjectSize) + "</span> px</p>";
+    html += "<p><b>Garis Konveyor:</b> <input type='range' id='lineY' min='5' max='95' value='" + String(convLinePercent) + "' onchange='updateLine(this.value)'> <span id='lineYVal'>" + String(convLinePercent) + "</span>% <span id='convStats'></span></p>";
+    html += "<p><b>Kelas Part:</b> <input id='clsName' placeholder='mur' style='width:90px'> <button class='btn-primary' onclick='learnClass()' " + String(sdMounted ? "" : "disabled") + ">📚 PELAJARI</button> <span id='clsList'></span></p>";
     html += "<p><b>Aspect Tolerance:</b> <input type='range' id='aspectTol' min='0.1' max='1.0' step='0.1' value='" + String(aspectRatioTolerance) + "' onchange='updateAspectTol(this.value)'> <span id='aspectTolVal'>" + String(aspectRatioTolerance) + "</span></p>";
     html += "</div>";
   }
@@ -391,9 +245,12 @@ void handleRoot()
   html += "let realtime = " + String(realtimeCounting ? 1 : 0) + ";";
   html += "let gray = " + String(grayscaleEnabled ? 1 : 0) + ";";
   html += "let smart = " + String(smartMode ? 1 : 0) + ";";
+  html += "let conveyor = " + String(conveyorMode ? 1 : 0) + ";";
   html += "function setToggleText(){ const b = document.getElementById('toggleBtn'); if(!b) return; b.innerHTML = realtime ? '⏸️ PAUSE REAL-TIME' : '▶️ RESUME REAL-TIME'; }";
   html += "function setGrayText(){ const b = document.getElementById('grayBtn'); if(!b) return; b.innerHTML = gray ? '🎛️ WARNA: GRAYSCALE' : '🎛️ WARNA: COLOR'; const img=document.getElementById('live'); if(img){ img.style.filter = gray ? 'grayscale(100%)' : 'none'; } }";
   html += "function setSmartText(){ const b = document.getElementById('smartBtn'); if(!b) return; b.innerHTML = smart ? '🧠 SMART: ON' : '🧠 SMART: OFF'; const s = document.getElementById('modeStatus'); if(s) s.innerHTML = smart ? 'Smart (objek serupa)' : 'Normal (semua objek)'; }";
+  html += "function setConveyorText(){ const b = document.getElementById('convBtn'); if(!b) return; b.innerHTML = conveyor ? '🏭 KONVEYOR: ON' : '🏭 KONVEYOR: OFF'; const s = document.getElementById('convStats'); if(s && !conveyor) s.innerHTML = ''; }";
+  html += "function updateConveyor(){ if(!conveyor) return; fetch('/conveyor').then(r=>r.json()).then(j=>{ const s=document.getElementById('convStats'); if(s) s.innerHTML = '| ' + j.per_minute + ' objek/menit, ' + j.moving + ' bergerak'; }).catch(()=>{}); }";
   html += "function updateCount() {";
   html += "  const el = document.getElementById('objectCount'); if(!el) return;";
   html += "  fetch('/getcount').then(r => r.text()).then(data => {";
@@ -406,6 +263,11 @@ void handleRoot()
   html += "    }";
   html += "  }).catch(() => {});"; // Silent error handling
   html += "}";
+  html += "function showClasses(j){ const s=document.getElementById('clsList'); if(!s) return; s.innerHTML = j.classes.map(c=>c.name+': <b>'+c.count+'</b> ('+c.samples+' sampel) <a href=\"#\" onclick=\"removeClass(\\''+c.name+'\\');return false\">✖</a>').join(' | ') + (j.classes.length ? ' | ?: '+j.unknown : ''); }";
+  html += "function updateClasses(){ if(conveyor) return; fetch('/classes').then(r=>r.json()).then(showClasses).catch(()=>{}); }";
+  html += "function learnClass(){ const n=document.getElementById('clsName').value.trim(); if(!n) return; fetch('/classes?learn='+encodeURIComponent(n)).then(r=>r.ok?r.json():r.text().then(t=>{throw t;})).then(j=>{ showClasses(j); alert(j.added+' sampel ditambahkan ke '+n); }).catch(e=>alert(e)); }";
+  html += "function removeClass(n){ if(!confirm('Hapus semua sampel '+n+'?')) return; fetch('/classes?remove='+encodeURIComponent(n)).then(r=>r.json()).then(showClasses); }";
+  html += "function toggleOverlay(){ const img=document.getElementById('live'); const on=!img.src.endsWith('/overlay'); img.style.display=''; img.src=on?'/overlay':'/mjpeg'; document.getElementById('overlayBtn').innerHTML=on?'📷 Tampilkan kamera':'🔲 Tampilkan deteksi'; }";
   html += "function resetCount() {";
   html += "  fetch('/reset');";
   html += "  document.getElementById('objectCount').innerHTML = '0 Objek';";
@@ -416,6 +278,13 @@ void handleRoot()
   html += "function toggleGray(){";
   html += "  fetch('/toggleGray').then(r=>r.text()).then(state=>{ gray = (state==='on'); setGrayText(); });";
   html += "}";
+  html += "function toggleConveyor(){";
+  html += "  fetch('/toggleConveyor').then(r=>r.text()).then(state=>{ conveyor = (state==='on'); setConveyorText(); });";
+  html += "}";
+  html += "function updateLine(val) {";
+  html += "  fetch('/setline?val=' + val);";
+  html += "  document.getElementById('lineYVal').innerHTML = val;";
+  html += "}";
   html += "function toggleSmart(){";
   html += "  fetch('/toggleSmart').then(r=>r.text()).then(state=>{ smart = (state==='on'); setSmartText(); });";
   html += "}";
@@ -426,6 +295,15 @@ void handleRoot()
   html += "  fetch('/setthreshold?val=' + val);";
   html += "  document.getElementById('thresholdVal').innerHTML = val;";
   html += "}";
+  html += "function updateThreshMode(val) {";
+  html += "  fetch('/setthreshmode?mode=' + val);";
+  html += "}";
+  html += "function showRoi(j){ ['x','y','w','h'].forEach(k=>{ document.getElementById('roi'+k.toUpperCase()).value = j[k]; }); }";
+  html += "function updateRoi() {";
+  html += "  const v = k => document.getElementById('roi' + k).value;";
+  html += "  fetch('/roi?x=' + v('X') + '&y=' + v('Y') + '&w=' + v('W') + '&h=' + v('H')).then(r=>r.json()).then(showRoi);";
+  html += "}";
+  html += "function resetRoi() { fetch('/roi?reset=1').then(r=>r.json()).then(showRoi); }";
   html += "function savePhoto(){ fetch('/save').then(r=>r.text()).then(t=>alert(t)).catch(()=>alert('Gagal simpan')); }";
   html += "function updateMinSize(val) {";
   html += "  fetch('/setminsize?val=' + val);";
@@ -439,7 +317,7 @@ void handleRoot()
   html += "  fetch('/setaspecttol?val=' + val);";
   html += "  document.getElementById('aspectTolVal').innerHTML = val;";
   html += "}";
-  html += "if (camInit) { setToggleText(); setGrayText(); setSmartText(); setInterval(updateCount, 500); }";
+  html += "if (camInit) { setToggleText(); setGrayText(); setSmartText(); setConveyorText(); setInterval(updateCount, 500); setInterval(updateConveyor, 1000); setInterval(updateClasses, 2000); }";
   html += "// CSS animation untuk pulse effect";
   html += "const style = document.createElement('style');";
   html += "style.textContent = '@keyframes pulse { 0% { transform: scale(1); } 50% { transform: scale(1.05); } 100% { transform: scale(1); } }';";
@@ -458,82 +336,296 @@ void handleStream()
     return;
   }
 
-  camera_fb_t *fb = esp_camera_fb_get();
-  if (!fb)
+  FrameRef *ref = frameHubGetOnce(1000);
+  if (!ref)
   {
     server.send(500, "text/plain", "Camera capture failed");
     return;
   }
 
-  server.send_P(200, "image/jpeg", (const char *)fb->buf, fb->len);
-  esp_camera_fb_return(fb);
+  server.send_P(200, "image/jpeg", (const char *)ref->fb->buf, ref->fb->len);
+  frameHubRelease(ref);
 }
 
-// MJPEG stream (multipart/x-mixed-replace)
-void handleMJPEG()
+// ---------- Viewer MJPEG ----------
+// Setiap viewer punya task sendiri yang hanya melakukan I/O socket; frame
+// diambil dari frame hub sehingga semua viewer + counter berbagi satu capture.
+#define MJPEG_MAX_VIEWERS 4
+#define OVERLAY_MAX_VIEWERS 2
+
+static std::atomic<int> mjpegViewers{0}; // diturunkan oleh task viewer
+
+struct MjpegViewer
 {
-  if (!cameraInitialized)
+  WiFiClient *client;
+  int sub;        // id subscriber frame hub, -1 = viewer /overlay
+  int metricSlot; // slot statistik FPS di metrics.h
+};
+
+static void mjpegViewerTask(void *arg)
+{
+  MjpegViewer *v = (MjpegViewer *)arg;
+  WiFiClient *client = v->client;
+  bool overlay = v->sub < 0;
+  uint32_t overlaySeq = 0;
+  char partHeader[96];
+
+  while (client->connected())
   {
-    server.send(500, "text/plain", "Camera not initialized");
-    return;
+    // Kamera langsung dari frame hub, atau JPEG overlay yang sudah di-encode
+    FrameRef *ref = nullptr;
+    OverlayFrame *of = nullptr;
+    const uint8_t *buf;
+    size_t frameLen;
+    if (overlay)
+    {
+      of = overlayGet(overlaySeq, 1000);
+      if (!of)
+        continue;
+      overlaySeq = of->seq;
+      buf = of->jpg;
+      frameLen = of->len;
+    }
+    else
+    {
+      ref = frameHubGet(v->sub, 1000);
+      if (!ref)
+        continue;
+      buf = ref->fb->buf;
+      frameLen = ref->fb->len;
+    }
+
+    int n = snprintf(partHeader, sizeof(partHeader),
+                     "--frame\r\nContent-Type: image/jpeg\r\nContent-Length: %u\r\n\r\n", (unsigned)frameLen);
+    int64_t t0 = esp_timer_get_time();
+    bool ok = client->write((const uint8_t *)partHeader, n) == (size_t)n &&
+              client->write(buf, frameLen) == frameLen &&
+              client->write((const uint8_t *)"\r\n", 2) == 2;
+    frameHubRelease(ref);
+    overlayRelease(of);
+    if (!ok)
+      break;
+    metricObserveSince(STAGE_SEND, t0);
+    metricStreamFrame(v->metricSlot, n + frameLen + 2);
   }
 
+  client->stop();
+  delete client;
+  frameHubUnsubscribe(v->sub);
+  metricStreamClose(v->metricSlot);
+  delete v;
+  std::atomic<int> &viewers = overlay ? overlayViewers : mjpegViewers;
+  viewers--;
+  Serial.printf("%s viewer terputus (%d aktif)\n", overlay ? "Overlay" : "MJPEG", viewers.load());
+  vTaskDelete(NULL);
+}
+
+// Serahkan koneksi ke task viewer agar handler langsung kembali ke loop()
+static void startMjpegViewer(int sub, std::atomic<int> &viewers)
+{
   WiFiClient client = server.client();
-  String boundary = "frame";
   client.print("HTTP/1.1 200 OK\r\n");
-  client.print("Content-Type: multipart/x-mixed-replace; boundary=" + boundary + "\r\n");
+  client.print("Content-Type: multipart/x-mixed-replace; boundary=frame\r\n");
   client.print("Pragma: no-cache\r\nCache-Control: no-cache\r\nConnection: close\r\n\r\n");
 
-  const uint32_t maxStreamMs = 30000; // batasi 30 detik per koneksi untuk kestabilan
-  uint32_t start = millis();
-  while (client.connected())
+  MjpegViewer *v = new MjpegViewer{new WiFiClient(client), sub, metricStreamOpen()};
+  viewers++;
+  if (xTaskCreatePinnedToCore(mjpegViewerTask, "mjpeg_viewer", 4096, v, 1, NULL, 0) != pdPASS)
   {
-    if (millis() - start > maxStreamMs) break;
+    viewers--;
+    frameHubUnsubscribe(sub);
+    metricStreamClose(v->metricSlot);
+    delete v->client;
+    delete v;
+    client.stop();
+    return;
+  }
+  Serial.printf("%s viewer tersambung (%d aktif)\n", sub < 0 ? "Overlay" : "MJPEG", viewers.load());
+}
 
-    camera_fb_t *fb = esp_camera_fb_get();
-    if (!fb)
-    {
-      delay(10);
-      continue;
-    }
+// MJPEG stream (multipart/x-mixed-replace)
+void handleMJPEG()
+{
+  if (!cameraInitialized)
+  {
+    server.send(500, "text/plain", "Camera not initialized");
+    return;
+  }
 
-    client.print("--" + boundary + "\r\n");
-    client.print("Content-Type: image/jpeg\r\n");
-    client.print("Content-Length: " + String(fb->len) + "\r\n\r\n");
-    client.write(fb->buf, fb->len);
-    client.print("\r\n");
+  int sub = mjpegViewers < MJPEG_MAX_VIEWERS ? frameHubSubscribe() : -1;
+  if (sub < 0)
+  {
+    server.send(503, "text/plain", "Too many viewers");
+    return;
+  }
 
-    esp_camera_fb_return(fb);
+  startMjpegViewer(sub, mjpegViewers);
+}
 
-    // kecilkan FPS agar tidak membebani
-    delay(80);
+// MJPEG hasil labeling terakhir: kotak + ID blob di atas frame gray, maks 5 fps.
+// Frame hanya dibuat selama ada viewer dan pipeline counting berjalan.
+void handleOverlay()
+{
+  if (!ovTask)
+  {
+    server.send(500, "text/plain", "Overlay not available");
+    return;
+  }
+  if (overlayViewers >= OVERLAY_MAX_VIEWERS)
+  {
+    server.send(503, "text/plain", "Too many viewers");
+    return;
   }
+  startMjpegViewer(-1, overlayViewers);
+}
+
+// Sink ChunkWriter: setiap flush dikirim sebagai satu HTTP chunk
+static bool webServerChunkSink(void *ctx, const char *data, size_t len)
+{
+  WebServer *srv = (WebServer *)ctx;
+  srv->sendContent(data, len);
+  return srv->client().connected();
 }
 
-// Handler untuk manual counting
+// Salinan hasil pipeline untuk handler web. Semua handler jalan di task loop()
+// WebServer secara berurutan, jadi satu buffer cukup (CountResult ~4.6 KB).
+static CountResult webResult;
+
+// Handler untuk manual counting: ambil hasil terakhir dari pipeline
 void handleCount() {
   if (!cameraInitialized) {
     server.send(500, "text/plain", "Camera not initialized");
     return;
   }
 
-  camera_fb_t *fb = esp_camera_fb_get();
-  if (!fb) {
-    server.send(500, "text/plain", "Camera capture failed. Kemungkinan DMA overflow. Coba turunkan resolusi atau cek wiring kamera.");
-    Serial.println("ERROR: Camera capture failed. Kemungkinan DMA overflow.");
+  // Realtime ON: hasil terbaru sudah tersedia. Realtime OFF: minta satu frame.
+  CountResult &result = webResult;
+  bool ok = realtimeCounting ? pipelineReadLatest(result) : pipelineCountOnce(result, 2000);
+  if (!ok) {
+    server.send(503, "text/plain", "Belum ada frame yang diproses");
     return;
   }
 
-  int detected = countObjects(fb);
-  esp_camera_fb_return(fb);
-  
-  if (detected >= 0) {
-    objectCount = detected;
-    Serial.println("Manual count: " + String(objectCount) + " objek");
-    server.send(200, "text/plain", "Counting completed: " + String(objectCount));
-  } else {
-    server.send(500, "text/plain", "Counting failed");
+  Serial.println("Manual count: " + String(result.count) + " objek (frame " + String(result.seq) + ")");
+  // Blob di atas MAX_OBJECTS terhitung tapi tidak punya fitur untuk diklasifikasi
+  int unclassified = result.count - result.stored;
+  int classes = min(result.classes, clsTrain.classes);
+  if (server.arg("format") == "json") {
+    char buf[256];
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, "application/json", "");
+    ChunkWriter out(buf, sizeof(buf), webServerChunkSink, &server);
+    JsonWriter json(out);
+    json.beginObject();
+    json.field("count", result.count);
+    json.field("seq", result.seq);
+    json.field("threshold", result.threshold);
+    json.field("mode", threshModeName(result.threshMode));
+    json.key("classes");
+    json.beginObject();
+    for (int c = 0; c < classes; c++)
+      json.field(clsTrain.names[c], result.classCounts[c]);
+    json.endObject();
+    json.field("unknown", result.classCounts[CLS_UNKNOWN]);
+    json.field("unclassified", unclassified);
+    json.endObject();
+    out.finish();
+    server.sendContent("");
+    return;
+  }
+  String text = "Counting completed: " + String(result.count) +
+                " | threshold: " + String(result.threshold) + " (" + threshModeName(result.threshMode) + ")";
+  if (classes > 0) {
+    text += " |";
+    for (int c = 0; c < classes; c++)
+      text += String(c ? ", " : " ") + clsTrain.names[c] + ": " + String(result.classCounts[c]);
+    text += ", unknown: " + String(result.classCounts[CLS_UNKNOWN] + unclassified);
+  }
+  server.send(200, "text/plain", text);
+}
+
+// Classifier jenis part. Tanpa argumen: daftar kelas + hitungan frame terakhir.
+// learn=NAMA: blob di frame terakhir jadi sampel kelas NAMA (blob=i untuk satu blob saja,
+// sisanya letakkan satu jenis part saja di tray). remove=NAMA / remove=* menghapus sampel.
+void handleClasses()
+{
+  CountResult &result = webResult;
+  bool have = pipelineReadLatest(result) && !result.conveyor;
+  if (server.hasArg("learn") || server.hasArg("remove")) {
+    if (!sdMounted) {
+      server.send(500, "text/plain", "SD not mounted");
+      return;
+    }
+    if (!cclShape) {
+      server.send(500, "text/plain", "Shape features need PSRAM");
+      return;
+    }
+  }
+
+  int added = 0;
+  if (server.hasArg("learn")) {
+    String name = server.arg("learn");
+    if (!have || result.stored == 0) {
+      server.send(503, "text/plain", "Belum ada objek di frame terakhir");
+      return;
+    }
+    int first = 0, last = result.stored;
+    if (server.hasArg("blob")) {
+      first = server.arg("blob").toInt();
+      last = first + 1;
+      if (first < 0 || first >= result.stored) {
+        server.send(400, "text/plain", "Invalid blob index");
+        return;
+      }
+    }
+    added = clsAppendSamples(SD_MMC, name.c_str(), result.blobs + first, last - first);
+    if (added == 0) {
+      server.send(400, "text/plain", "Invalid class name or too many classes");
+      return;
+    }
+    clsPublish();
+    Serial.printf("📚 %d sampel ditambahkan ke kelas %s\n", added, name.c_str());
+  } else if (server.hasArg("remove")) {
+    String name = server.arg("remove");
+    clsRemoveClass(SD_MMC, name == "*" ? nullptr : name.c_str());
+    Serial.println("🗑️ Sampel kelas dihapus: " + name);
+  }
+
+  int classes = have ? min(result.classes, clsTrain.classes) : 0;
+  char buf[512];
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, "application/json", "");
+  ChunkWriter out(buf, sizeof(buf), webServerChunkSink, &server);
+  JsonWriter json(out);
+  json.beginObject();
+  json.field("added", added);
+  json.key("classes");
+  json.beginArray();
+  for (int c = 0; c < clsTrain.classes; c++) {
+    json.beginObject();
+    json.field("name", clsTrain.names[c]);
+    json.field("samples", clsTrain.samples[c]);
+    json.field("count", c < classes ? result.classCounts[c] : 0);
+    json.endObject();
+  }
+  json.endArray();
+  json.field("unknown", have ? result.classCounts[CLS_UNKNOWN] + result.count - result.stored : 0);
+  json.key("blobs");
+  json.beginArray();
+  for (int i = 0; have && i < result.stored; i++) {
+    const CclBlob &b = result.blobs[i];
+    json.beginObject();
+    json.field("x", (int)b.cx + result.offX);
+    json.field("y", (int)b.cy + result.offY);
+    json.field("area", b.area);
+    json.field("holes", b.holes);
+    json.field("class", b.cls);
+    json.endObject();
   }
+  json.endArray();
+  json.endObject();
+  out.finish();
+  server.sendContent(""); // chunk terakhir (panjang 0)
 }
 
 // Handler untuk mendapatkan jumlah objek saat ini
@@ -546,6 +638,7 @@ void handleGetCount()
 void handleReset()
 {
   objectCount = 0;
+  conveyorReset();
   Serial.println("Counter direset ke 0");
   server.send(200, "text/plain", "Counter reset");
 }
@@ -561,6 +654,48 @@ void handleSetThreshold()
   server.send(200, "text/plain", "OK");
 }
 
+// Handler untuk mode threshold: manual, otsu, atau adaptive
+void handleSetThresholdMode()
+{
+  if (server.hasArg("mode"))
+  {
+    thresholdMode = threshModeFromName(server.arg("mode").c_str());
+    Serial.println("Mode threshold: " + String(threshModeName(thresholdMode)));
+  }
+  if (server.hasArg("radius"))
+    adaptiveRadius = constrain(server.arg("radius").toInt(), 1, ADAPTIVE_MAX_RADIUS);
+  if (server.hasArg("offset"))
+    adaptiveOffset = constrain(server.arg("offset").toInt(), 0, 99);
+  server.send(200, "text/plain", threshModeName(thresholdMode));
+}
+
+// Handler ROI: tanpa argumen kirim ROI sekarang, dengan x,y,w,h (persen) ubah dan simpan
+void handleRoi()
+{
+  if (server.hasArg("reset"))
+  {
+    roiCurrent = {0, 0, 100, 100};
+    roiSave();
+    conveyorReset();
+  }
+  else if (server.hasArg("x") && server.hasArg("y") && server.hasArg("w") && server.hasArg("h"))
+  {
+    CountRoi r;
+    r.x = constrain(server.arg("x").toInt(), 0, 100);
+    r.y = constrain(server.arg("y").toInt(), 0, 100);
+    r.w = constrain(server.arg("w").toInt(), 0, 100);
+    r.h = constrain(server.arg("h").toInt(), 0, 100);
+    roiSanitize(r);
+    roiCurrent = r;
+    roiSave();
+    conveyorReset(); // background lama tidak berlaku untuk ROI baru
+    Serial.printf("ROI diubah ke x=%d%% y=%d%% w=%d%% h=%d%%\n", r.x, r.y, r.w, r.h);
+  }
+  String json = "{\"x\":" + String(roiCurrent.x) + ",\"y\":" + String(roiCurrent.y) +
+                ",\"w\":" + String(roiCurrent.w) + ",\"h\":" + String(roiCurrent.h) + "}";
+  server.send(200, "application/json", json);
+}
+
 // Handler untuk mengatur ukuran minimum objek
 void handleSetMinSize()
 {
@@ -602,16 +737,16 @@ void handleCapture()
     return;
   }
 
-  camera_fb_t *fb = esp_camera_fb_get();
-  if (!fb)
+  FrameRef *ref = frameHubGetOnce(1000);
+  if (!ref)
   {
     server.send(500, "text/plain", "Camera capture failed");
     return;
   }
 
   // Kirim JPEG image
-  server.send_P(200, "image/jpeg", (const char *)fb->buf, fb->len);
-  esp_camera_fb_return(fb);
+  server.send_P(200, "image/jpeg", (const char *)ref->fb->buf, ref->fb->len);
+  frameHubRelease(ref);
 }
 
 // Handler untuk toggle real-time counting
@@ -641,6 +776,81 @@ void handleToggleSmart()
   server.send(200, "text/plain", smartMode ? "on" : "off");
 }
 
+// Handler untuk toggle mode konveyor (background subtraction + garis hitung)
+void handleToggleConveyor()
+{
+  conveyorMode = !conveyorMode;
+  conveyorReset(); // background dipelajari ulang dari frame berikutnya
+  objectCount = 0;
+  Serial.println("Conveyor mode: " + String(conveyorMode ? "ON" : "OFF"));
+  server.send(200, "text/plain", conveyorMode ? "on" : "off");
+}
+
+// Handler untuk posisi garis hitung (persen tinggi frame)
+void handleSetLine()
+{
+  if (server.hasArg("val"))
+  {
+    convLinePercent = constrain(server.arg("val").toInt(), 5, 95);
+    Serial.println("Garis konveyor diubah ke: " + String(convLinePercent) + "%");
+  }
+  server.send(200, "text/plain", "OK");
+}
+
+// Statistik mode konveyor dalam JSON
+void handleConveyorStats()
+{
+  CountResult &result = webResult;
+  if (!pipelineReadLatest(result) || !result.conveyor)
+  {
+    server.send(200, "application/json", "{\"conveyor\":" + String(conveyorMode ? "true" : "false") + ",\"total\":0,\"per_minute\":0,\"moving\":0}");
+    return;
+  }
+  String json = "{\"conveyor\":true";
+  json += ",\"total\":" + String(result.lineCount);
+  json += ",\"per_minute\":" + String(result.perMinute);
+  json += ",\"moving\":" + String(result.count);
+  json += ",\"changed_rows\":" + String(convChangedRows);
+  json += ",\"line\":" + String(convLinePercent);
+  json += "}";
+  server.send(200, "application/json", json);
+}
+
+// Metrik Prometheus: latensi tiap tahap, frame drop, heap/PSRAM, FPS viewer MJPEG
+void handleMetrics()
+{
+  char buf[512];
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, METRICS_CONTENT_TYPE, "");
+  ChunkWriter out(buf, sizeof(buf), webServerChunkSink, &server);
+
+  metricsWriteCommon(out);
+  metricsCounter(out, "camera_frames_captured_total", "Frames captured by the frame hub", hubFramesCaptured);
+  metricsCounter(out, "camera_frames_delivered_total", "Frame handoffs to hub subscribers", hubFramesDelivered);
+  metricsHeader(out, "camera_frames_dropped_total", "counter", "Frames dropped before counting");
+  out.printf("camera_frames_dropped_total{reason=\"pipeline\"} %u\n", (unsigned)pipeDroppedFrames);
+  out.printf("camera_frames_dropped_total{reason=\"decode_error\"} %u\n", (unsigned)pipeDecodeErrors);
+  metricsGauge(out, "camera_stream_clients", "Connected MJPEG viewers", mjpegViewers.load());
+  metricsGauge(out, "camera_overlay_clients", "Connected /overlay viewers", overlayViewers.load());
+  metricsCounter(out, "camera_overlay_frames_total", "Overlay frames encoded", overlayFramesEncoded);
+  metricsGauge(out, "camera_object_count", "Objects in the last counted frame", objectCount);
+  metricsHeader(out, "camera_frame_arena_bytes", "gauge", "Boot-time image buffer arena");
+  out.printf("camera_frame_arena_bytes{state=\"capacity\"} %u\n", (unsigned)arenaCap);
+  out.printf("camera_frame_arena_bytes{state=\"used\"} %u\n", (unsigned)arenaUsed);
+  metricsCounter(out, "camera_frame_arena_alloc_failures_total", "Image buffer requests that did not fit the arena", arenaFailures);
+  CountResult &result = webResult;
+  if (pipelineReadLatest(result) && !result.conveyor && result.classes > 0) {
+    int classes = min(result.classes, clsTrain.classes);
+    metricsHeader(out, "camera_object_class_count", "gauge", "Objects per part class in the last counted frame");
+    for (int c = 0; c < classes; c++)
+      out.printf("camera_object_class_count{class=\"%s\"} %u\n", clsTrain.names[c], (unsigned)result.classCounts[c]);
+    out.printf("camera_object_class_count{class=\"unknown\"} %u\n", (unsigned)result.classCounts[CLS_UNKNOWN]);
+  }
+
+  out.finish();
+  server.sendContent(""); // chunk terakhir (panjang 0)
+}
+
 // Simpan snapshot ke SD card
 void handleSave()
 {
@@ -655,8 +865,8 @@ void handleSave()
     return;
   }
 
-  camera_fb_t *fb = esp_camera_fb_get();
-  if (!fb)
+  FrameRef *ref = frameHubGetOnce(1000);
+  if (!ref)
   {
     server.send(500, "text/plain", "Camera capture failed");
     return;
@@ -666,15 +876,18 @@ void handleSave()
   File f = SD_MMC.open(path, FILE_WRITE);
   if (!f)
   {
-    esp_camera_fb_return(fb);
+    frameHubRelease(ref);
     server.send(500, "text/plain", "Open file failed");
     return;
   }
-  size_t written = f.write(fb->buf, fb->len);
+  size_t len = ref->fb->len;
+  int64_t t0 = esp_timer_get_time();
+  size_t written = f.write(ref->fb->buf, len);
   f.close();
-  esp_camera_fb_return(fb);
+  frameHubRelease(ref);
+  metricObserveSince(STAGE_SD_WRITE, t0);
 
-  if (written == fb->len)
+  if (written == len)
   {
     server.send(200, "text/plain", "Saved: " + path);
   }
@@ -748,6 +961,70 @@ void setup()
     }
   }
 
+  // ROI tersimpan dari sesi sebelumnya
+  if (roiLoad())
+  {
+    Serial.printf("ROI dimuat: x=%d%% y=%d%% w=%d%% h=%d%%\n", roiCurrent.x, roiCurrent.y, roiCurrent.w, roiCurrent.h);
+  }
+
+  // Semua buffer gambar dari satu arena seukuran frame kamera aktif, dialokasikan
+  // sekali di sini: setelah setup() tidak ada malloc/free di jalur counting
+  framesize_t frameSize = getCameraConfig(0).frame_size;
+  sensor_t *sensor = cameraInitialized ? esp_camera_sensor_get() : NULL;
+  if (sensor)
+  {
+    frameSize = sensor->status.framesize;
+  }
+  int frameW = resolution[frameSize].width;
+  grayMaxW = frameW / 2;
+  grayMaxH = resolution[frameSize].height / 2;
+  int maxLabels = psramFound() ? 8192 : 2048;
+  size_t arenaBytes = conveyorArenaBytes(grayMaxW * grayMaxH) + cclArenaBytes(frameW, maxLabels, psramFound()) +
+                      countPipelineArenaBytes() + overlayArenaBytes();
+  if (frameArenaBegin(arenaBytes))
+  {
+    Serial.printf("Frame arena: %u bytes untuk gray maks %dx%d\n", (unsigned)arenaBytes, grayMaxW, grayMaxH);
+  }
+  else
+  {
+    Serial.println("PERINGATAN: Gagal alokasi frame arena, buffer gambar memakai heap!");
+  }
+
+  // Background konveyor (Q8), mode konveyor nonaktif jika gagal
+  if (!conveyorInit(grayMaxW * grayMaxH))
+  {
+    Serial.println("PERINGATAN: Gagal alokasi buffer background konveyor!");
+  }
+
+  // Satu capture per frame sensor, dibagi ke counter, viewer MJPEG, dan SD
+  if (cameraInitialized && !startFrameHub())
+  {
+    Serial.println("PERINGATAN: Task frame hub gagal dijalankan!");
+    cameraInitialized = false;
+  }
+
+  // Buffer labeling dialokasikan sekali, tidak ada alokasi per frame
+  if (!cclInit(frameW, maxLabels))
+  {
+    Serial.println("PERINGATAN: Gagal alokasi buffer labeling!");
+  }
+  else
+  {
+    // Fitur bentuk ~64 byte per label: hanya dengan PSRAM, classifier nonaktif jika gagal
+    if (psramFound() && !cclEnableShape())
+    {
+      Serial.println("PERINGATAN: Gagal alokasi fitur bentuk, classifier nonaktif!");
+    }
+    if (cameraInitialized && !startCountPipeline())
+    {
+      Serial.println("PERINGATAN: Pipeline counting gagal dijalankan!");
+    }
+    else if (cameraInitialized && !startOverlay(PIPE_CORE))
+    {
+      Serial.println("PERINGATAN: Stream overlay tidak tersedia!");
+    }
+  }
+
   if (!cameraInitialized)
   {
     Serial.println("PERINGATAN: Semua konfigurasi kamera gagal!");
@@ -767,6 +1044,11 @@ void setup()
     {
       SD_MMC.mkdir("/captures");
     }
+    if (cclShape)
+    {
+      int samples = clsLoad(SD_MMC);
+      Serial.printf("📚 Classifier: %d kelas, %d sampel\n", clsTrain.classes, samples);
+    }
   }
   else
   {
@@ -781,16 +1063,24 @@ void setup()
   server.on("/", handleRoot);
   server.on("/stream", handleStream);
   server.on("/mjpeg", handleMJPEG);
+  server.on("/overlay", handleOverlay);
   server.on("/capture", handleCapture);
   server.on("/save", handleSave);
   server.on("/count", handleCount);
+  server.on("/classes", handleClasses);
   server.on("/getcount", handleGetCount);
   server.on("/reset", handleReset);
   server.on("/toggleRealtime", handleToggleRealtime);
   server.on("/toggleGray", handleToggleGray);
   server.on("/toggleSmart", handleToggleSmart);
+  server.on("/toggleConveyor", handleToggleConveyor);
+  server.on("/setline", handleSetLine);
+  server.on("/conveyor", handleConveyorStats);
+  server.on("/metrics", handleMetrics);
   server.on("/setthreshold", handleSetThreshold);
+  server.on("/setthreshmode", handleSetThresholdMode);
   server.on("/setminsize", handleSetMinSize);
+  server.on("/roi", handleRoi);
   server.on("/setmaxsize", handleSetMaxSize);
   server.on("/setaspecttol", handleSetAspectTol);
 
@@ -806,38 +1096,13 @@ void loop()
 {
   server.handleClient();
 
-  // Real-time counting di background
-  if (cameraInitialized && realtimeCounting)
-  {
-    unsigned long now = millis();
-    // Optimized interval untuk real-time performance
-    unsigned long interval = smartMode ? 1000 : 700;
-    
-    if (now - lastCountingTime >= interval)
-    {
-      lastCountingTime = now;
-      camera_fb_t *fb = esp_camera_fb_get();
-      if (fb)
-      {
-        int detected = countObjects(fb);
-        esp_camera_fb_return(fb);
-        if (detected >= 0)
-        {
-          objectCount = detected;
-          // Real-time log untuk smart mode
-          if (smartMode) {
-            Serial.println("Real-time smart: " + String(objectCount) + " objek serupa");
-          }
-        }
-      }
-    }
-  }
-
   // Monitoring memory (opsional)
   static unsigned long lastMemCheck = 0;
   if (millis() - lastMemCheck > 30000)
   { // Setiap 30 detik
-    Serial.println("Free heap: " + String(ESP.getFreeHeap()) + " bytes | Current count: " + String(objectCount));
+    Serial.println("Free heap: " + String(ESP.getFreeHeap()) + " bytes | Current count: " + String(objectCount) +
+                   " | Dropped: " + String(pipeDroppedFrames) + " | Decode error: " + String(pipeDecodeErrors) +
+                   " | Frames: " + String(hubFramesCaptured) + " | Viewers: " + String(mjpegViewers.load()));
     lastMemCheck = millis();
   }
 }
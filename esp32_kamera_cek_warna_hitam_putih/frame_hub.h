@@ -0,0 +1,177 @@
+// frame_hub.h - Satu capture kamera dibagi ke banyak subscriber
+// Subscriber (pipeline counter, viewer MJPEG, snapshot/SD) meminta frame
+// berikutnya lewat frameHubGet(). Task hub memanggil esp_camera_fb_get() sekali,
+// membungkusnya dalam FrameRef ber-refcount, dan menyerahkannya ke semua
+// subscriber yang sedang menunggu. Buffer dikembalikan ke driver saat
+// frameHubRelease() terakhir.
+#ifndef FRAME_HUB_H
+#define FRAME_HUB_H
+
+#include <atomic>
+#include "esp_camera.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "metrics.h"
+
+#define HUB_MAX_SUBSCRIBERS 8
+#define HUB_REF_POOL 4 // >= jumlah frame buffer driver
+
+struct FrameRef {
+  camera_fb_t *fb;
+  std::atomic<int> refs;
+  uint32_t seq;
+};
+
+struct HubSubscriber {
+  bool used;
+  bool waiting;
+  TaskHandle_t task;
+  FrameRef *frame;
+};
+
+static FrameRef hubRefs[HUB_REF_POOL];
+static HubSubscriber hubSubs[HUB_MAX_SUBSCRIBERS];
+static portMUX_TYPE hubMux = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t hubTask = NULL;
+
+static volatile uint32_t hubFramesCaptured = 0;
+static volatile uint32_t hubFramesDelivered = 0; // jumlah serah frame ke subscriber
+
+// Daftar subscriber baru, return id atau -1 jika penuh
+int frameHubSubscribe() {
+  int id = -1;
+  portENTER_CRITICAL(&hubMux);
+  for (int i = 0; i < HUB_MAX_SUBSCRIBERS; i++) {
+    if (!hubSubs[i].used) {
+      hubSubs[i] = {true, false, NULL, NULL};
+      id = i;
+      break;
+    }
+  }
+  portEXIT_CRITICAL(&hubMux);
+  return id;
+}
+
+void frameHubUnsubscribe(int id) {
+  if (id < 0) return;
+  portENTER_CRITICAL(&hubMux);
+  hubSubs[id].used = false;
+  hubSubs[id].waiting = false;
+  portEXIT_CRITICAL(&hubMux);
+}
+
+void frameHubRelease(FrameRef *ref) {
+  if (!ref) return;
+  if (ref->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    camera_fb_t *fb = ref->fb;
+    ref->fb = NULL;
+    esp_camera_fb_return(fb);
+  }
+}
+
+// Tunggu frame berikutnya (maks timeoutMs). Frame wajib dilepas dengan frameHubRelease().
+FrameRef *frameHubGet(int id, uint32_t timeoutMs) {
+  if (id < 0 || !hubTask) return NULL;
+  HubSubscriber &s = hubSubs[id];
+  portENTER_CRITICAL(&hubMux);
+  s.task = xTaskGetCurrentTaskHandle();
+  s.frame = NULL;
+  s.waiting = true;
+  portEXIT_CRITICAL(&hubMux);
+  xTaskNotifyGive(hubTask);
+
+  TickType_t start = xTaskGetTickCount();
+  TickType_t limit = pdMS_TO_TICKS(timeoutMs);
+  for (;;) {
+    TickType_t elapsed = xTaskGetTickCount() - start;
+    if (elapsed < limit) ulTaskNotifyTake(pdTRUE, limit - elapsed);
+
+    portENTER_CRITICAL(&hubMux);
+    FrameRef *f = s.frame;
+    bool timedOut = !f && xTaskGetTickCount() - start >= limit;
+    if (f || timedOut) {
+      s.waiting = false;
+      s.frame = NULL;
+    }
+    portEXIT_CRITICAL(&hubMux);
+    if (f || timedOut) return f;
+  }
+}
+
+// Subscriber sekali pakai untuk handler snapshot / simpan SD
+FrameRef *frameHubGetOnce(uint32_t timeoutMs) {
+  int id = frameHubSubscribe();
+  FrameRef *f = frameHubGet(id, timeoutMs);
+  frameHubUnsubscribe(id);
+  return f;
+}
+
+static FrameRef *hubAllocRef() {
+  for (int i = 0; i < HUB_REF_POOL; i++) {
+    if (hubRefs[i].refs.load(std::memory_order_acquire) == 0 && !hubRefs[i].fb) return &hubRefs[i];
+  }
+  return NULL;
+}
+
+static void frameHubLoop(void *) {
+  uint32_t seq = 0;
+  TaskHandle_t wake[HUB_MAX_SUBSCRIBERS];
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+
+    bool anyWaiting = false;
+    portENTER_CRITICAL(&hubMux);
+    for (int i = 0; i < HUB_MAX_SUBSCRIBERS; i++) anyWaiting |= hubSubs[i].used && hubSubs[i].waiting;
+    portEXIT_CRITICAL(&hubMux);
+    if (!anyWaiting) continue;
+
+    FrameRef *ref = hubAllocRef();
+    if (!ref) {
+      // Semua FrameRef masih dipegang subscriber lambat
+      xTaskNotifyGive(hubTask);
+      vTaskDelay(pdMS_TO_TICKS(5));
+      continue;
+    }
+    int64_t t0 = esp_timer_get_time();
+    camera_fb_t *fb = esp_camera_fb_get();
+    if (!fb) {
+      xTaskNotifyGive(hubTask);
+      vTaskDelay(pdMS_TO_TICKS(10));
+      continue;
+    }
+    metricObserveSince(STAGE_FB_GET, t0);
+    ref->fb = fb;
+    ref->seq = ++seq;
+    hubFramesCaptured++;
+
+    // Serahkan ke semua yang menunggu; refcount diset sebelum siapa pun bisa melepas
+    int n = 0;
+    portENTER_CRITICAL(&hubMux);
+    for (int i = 0; i < HUB_MAX_SUBSCRIBERS; i++) {
+      HubSubscriber &s = hubSubs[i];
+      if (!s.used || !s.waiting || s.frame) continue;
+      s.frame = ref;
+      wake[n++] = s.task;
+    }
+    ref->refs.store(n, std::memory_order_release);
+    portEXIT_CRITICAL(&hubMux);
+
+    if (n == 0) {
+      ref->fb = NULL;
+      esp_camera_fb_return(fb);
+      continue;
+    }
+    hubFramesDelivered += n;
+    for (int i = 0; i < n; i++) xTaskNotifyGive(wake[i]);
+  }
+}
+
+bool startFrameHub() {
+  for (int i = 0; i < HUB_REF_POOL; i++) {
+    hubRefs[i].fb = NULL;
+    hubRefs[i].refs.store(0);
+  }
+  return xTaskCreatePinnedToCore(frameHubLoop, "frame_hub", 4096, NULL, 2, &hubTask, 1) == pdPASS;
+}
+
+#endif
@@ -0,0 +1,589 @@
+// jpeg_gray.h - Decoder JPEG baseline khusus luminance (Y) dengan skala 1/2, 1/4, 1/8
+// Hanya kanal Y yang di-dequantize dan di-IDCT; Cb/Cr cukup di-decode Huffman
+// untuk melompati bitstream. IDCT dipotong ke koefisien frekuensi rendah
+// (DC-only untuk 1/8), sehingga hasil langsung berukuran kecil tanpa decode RGB.
+#ifndef JPEG_GRAY_H
+#define JPEG_GRAY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+
+// Skala decode = 1/denominator
+#define JPEG_GRAY_SCALE_2 2 // 640x480 -> 320x240
+#define JPEG_GRAY_SCALE_4 4 // 640x480 -> 160x120
+#define JPEG_GRAY_SCALE_8 8 // 640x480 -> 80x60 (DC-only)
+
+#define JPEG_GRAY_LOOKUP_BITS 9
+
+// Area crop dalam koordinat piksel JPEG asli (sebelum skala)
+struct JpegGrayRect
+{
+    int x, y, w, h;
+};
+
+struct JpegGrayHuffman
+{
+    uint8_t vals[256];
+    int32_t maxcode[18];
+    int32_t mincode[17];
+    int valptr[17];
+    uint16_t lookup[1 << JPEG_GRAY_LOOKUP_BITS]; // (panjang << 8) | simbol, 0 = slow path
+    bool defined;
+};
+
+struct JpegGrayDecoder
+{
+    const uint8_t *data;
+    size_t len;
+    size_t pos;
+    uint32_t bitBuf; // MSB-aligned
+    int bitCnt;
+    bool hitMarker;
+
+    uint16_t qt[4][64]; // natural order
+    JpegGrayHuffman dc[4];
+    JpegGrayHuffman ac[4];
+
+    int width, height;
+    int ncomp;
+    int compId[3], compH[3], compV[3], compTq[3];
+    int scanTd[3], scanTa[3];
+    int hmax, vmax;
+    int restartInterval;
+    bool frameReady;
+};
+
+static const uint8_t jpegGrayZigzag[64] = {
+    0, 1, 8, 16, 9, 2, 3, 10,
+    17, 24, 32, 25, 18, 11, 4, 5,
+    12, 19, 26, 33, 40, 48, 41, 34,
+    27, 20, 13, 6, 7, 14, 21, 28,
+    35, 42, 49, 56, 57, 50, 43, 36,
+    29, 22, 15, 23, 30, 37, 44, 51,
+    58, 59, 52, 45, 38, 31, 39, 46,
+    53, 60, 61, 54, 47, 55, 62, 63};
+
+// Tabel IDCT tereduksi dalam Q12: T[n][x][u] = 0.5 * C(u) * cos((2x+1)u*pi/(2n))
+static int32_t jpegGrayIdct2[2][2];
+static int32_t jpegGrayIdct4[4][4];
+static bool jpegGrayTablesReady = false;
+
+static void jpegGrayInitTables()
+{
+    if (jpegGrayTablesReady)
+        return;
+    for (int x = 0; x < 4; x++)
+    {
+        for (int u = 0; u < 4; u++)
+        {
+            double cu = (u == 0) ? (1.0 / sqrt(2.0)) : 1.0;
+            jpegGrayIdct4[x][u] = (int32_t)lround(4096.0 * 0.5 * cu * cos((2 * x + 1) * u * M_PI / 8.0));
+            if (x < 2 && u < 2)
+                jpegGrayIdct2[x][u] = (int32_t)lround(4096.0 * 0.5 * cu * cos((2 * x + 1) * u * M_PI / 4.0));
+        }
+    }
+    jpegGrayTablesReady = true;
+}
+
+static bool jpegGrayBuildHuffman(JpegGrayHuffman &h, const uint8_t *bits, const uint8_t *vals, int count)
+{
+    memset(h.lookup, 0, sizeof(h.lookup));
+    memcpy(h.vals, vals, count);
+
+    int code = 0;
+    int k = 0;
+    for (int l = 1; l <= 16; l++)
+    {
+        h.valptr[l] = k;
+        h.mincode[l] = code;
+        for (int i = 0; i < bits[l - 1]; i++)
+        {
+            if (l <= JPEG_GRAY_LOOKUP_BITS)
+            {
+                int shift = JPEG_GRAY_LOOKUP_BITS - l;
+                int base = code << shift;
+                for (int j = 0; j < (1 << shift); j++)
+                    h.lookup[base + j] = (uint16_t)((l << 8) | vals[k]);
+            }
+            code++;
+            k++;
+        }
+        h.maxcode[l] = bits[l - 1] ? code - 1 : -1;
+        if (code > (1 << l))
+            return false; // tabel rusak
+        code <<= 1;
+    }
+    h.maxcode[17] = 0x7FFFFFFF;
+    h.defined = true;
+    return true;
+}
+
+// Isi bitBuf sampai >= 25 bit; byte stuffing 0xFF00 dibuang, marker menghentikan pembacaan
+static inline void jpegGrayFill(JpegGrayDecoder &d)
+{
+    while (d.bitCnt <= 24)
+    {
+        uint32_t byte = 0;
+        if (!d.hitMarker && d.pos < d.len)
+        {
+            byte = d.data[d.pos];
+            if (byte == 0xFF)
+            {
+                uint8_t next = (d.pos + 1 < d.len) ? d.data[d.pos + 1] : 0xD9;
+                if (next == 0x00)
+                {
+                    d.pos += 2;
+                }
+                else
+                {
+                    d.hitMarker = true;
+                    byte = 0;
+                }
+            }
+            else
+            {
+                d.pos++;
+            }
+        }
+        d.bitBuf |= byte << (24 - d.bitCnt);
+        d.bitCnt += 8;
+    }
+}
+
+static inline int jpegGrayGetBits(JpegGrayDecoder &d, int n)
+{
+    if (n == 0)
+        return 0;
+    jpegGrayFill(d);
+    int v = (int)(d.bitBuf >> (32 - n));
+    d.bitBuf <<= n;
+    d.bitCnt -= n;
+    return v;
+}
+
+static inline int jpegGrayExtend(int v, int s)
+{
+    return (v < (1 << (s - 1))) ? v - (1 << s) + 1 : v;
+}
+
+static inline int jpegGrayDecodeHuffman(JpegGrayDecoder &d, const JpegGrayHuffman &h)
+{
+    jpegGrayFill(d);
+    uint16_t e = h.lookup[d.bitBuf >> (32 - JPEG_GRAY_LOOKUP_BITS)];
+    if (e)
+    {
+        int l = e >> 8;
+        d.bitBuf <<= l;
+        d.bitCnt -= l;
+        return e & 0xFF;
+    }
+    for (int l = JPEG_GRAY_LOOKUP_BITS + 1; l <= 16; l++)
+    {
+        int32_t code = (int32_t)(d.bitBuf >> (32 - l));
+        if (code <= h.maxcode[l])
+        {
+            d.bitBuf <<= l;
+            d.bitCnt -= l;
+            return h.vals[h.valptr[l] + code - h.mincode[l]];
+        }
+    }
+    return -1; // kode tidak valid
+}
+
+static inline uint16_t jpegGrayRead16(const uint8_t *p)
+{
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+// Parse header sampai SOS; posisi berhenti di awal data entropy
+static bool jpegGrayParseHeaders(JpegGrayDecoder &d)
+{
+    if (d.len < 4 || d.data[0] != 0xFF || d.data[1] != 0xD8)
+        return false;
+    d.pos = 2;
+
+    while (d.pos + 4 <= d.len)
+    {
+        if (d.data[d.pos] != 0xFF)
+        {
+            d.pos++;
+            continue;
+        }
+        uint8_t marker = d.data[d.pos + 1];
+        if (marker == 0xFF)
+        {
+            d.pos++;
+            continue;
+        }
+        d.pos += 2;
+        if (marker == 0xD8 || (marker >= 0xD0 && marker <= 0xD7) || marker == 0x01)
+            continue;
+        if (marker == 0xD9)
+            return false;
+
+        uint16_t segLen = jpegGrayRead16(d.data + d.pos);
+        if (segLen < 2 || d.pos + segLen > d.len)
+            return false;
+        const uint8_t *seg = d.data + d.pos + 2;
+        int segRemain = segLen - 2;
+
+        switch (marker)
+        {
+        case 0xDB: // DQT
+            while (segRemain > 0)
+            {
+                int pq = seg[0] >> 4;
+                int tq = seg[0] & 0x0F;
+                int need = 1 + (pq ? 128 : 64);
+                if (tq > 3 || segRemain < need)
+                    return false;
+                for (int i = 0; i < 64; i++)
+                {
+                    uint16_t q = pq ? jpegGrayRead16(seg + 1 + i * 2) : seg[1 + i];
+                    d.qt[tq][jpegGrayZigzag[i]] = q;
+                }
+                seg += need;
+                segRemain -= need;
+            }
+            break;
+
+        case 0xC4: // DHT
+            while (segRemain > 17)
+            {
+                int tc = seg[0] >> 4;
+                int th = seg[0] & 0x0F;
+                int count = 0;
+                for (int i = 0; i < 16; i++)
+                    count += seg[1 + i];
+                if (th > 3 || count > 256 || segRemain < 17 + count)
+                    return false;
+                JpegGrayHuffman &h = tc ? d.ac[th] : d.dc[th];
+                if (!jpegGrayBuildHuffman(h, seg + 1, seg + 17, count))
+                    return false;
+                seg += 17 + count;
+                segRemain -= 17 + count;
+            }
+            break;
+
+        case 0xC0: // SOF0 baseline
+        case 0xC1: // SOF1 extended sequential (Huffman)
+        {
+            if (segRemain < 6 || seg[0] != 8)
+                return false;
+            d.height = jpegGrayRead16(seg + 1);
+            d.width = jpegGrayRead16(seg + 3);
+            d.ncomp = seg[5];
+            if (d.ncomp != 1 && d.ncomp != 3)
+                return false;
+            if (segRemain < 6 + d.ncomp * 3 || d.width == 0 || d.height == 0)
+                return false;
+            d.hmax = d.vmax = 1;
+            for (int c = 0; c < d.ncomp; c++)
+            {
+                d.compId[c] = seg[6 + c * 3];
+                d.compH[c] = seg[7 + c * 3] >> 4;
+                d.compV[c] = seg[7 + c * 3] & 0x0F;
+                d.compTq[c] = seg[8 + c * 3] & 0x03;
+                if (d.compH[c] < 1 || d.compH[c] > 2 || d.compV[c] < 1 || d.compV[c] > 2)
+                    return false;
+                if (d.compH[c] > d.hmax)
+                    d.hmax = d.compH[c];
+                if (d.compV[c] > d.vmax)
+                    d.vmax = d.compV[c];
+            }
+            d.frameReady = true;
+            break;
+        }
+
+        case 0xC2: // progressive dan mode lain tidak didukung
+        case 0xC3:
+        case 0xC5:
+        case 0xC6:
+        case 0xC7:
+        case 0xC9:
+        case 0xCA:
+        case 0xCB:
+        case 0xCD:
+        case 0xCE:
+        case 0xCF:
+            return false;
+
+        case 0xDD: // DRI
+            if (segRemain < 2)
+                return false;
+            d.restartInterval = jpegGrayRead16(seg);
+            break;
+
+        case 0xDA: // SOS
+        {
+            if (!d.frameReady || segRemain < 1)
+                return false;
+            int ns = seg[0];
+            // Hanya scan interleaved yang berisi semua komponen (output kamera)
+            if (ns != d.ncomp || segRemain < 1 + ns * 2)
+                return false;
+            for (int i = 0; i < ns; i++)
+            {
+                int id = seg[1 + i * 2];
+                if (id != d.compId[i])
+                    return false;
+                d.scanTd[i] = seg[2 + i * 2] >> 4;
+                d.scanTa[i] = seg[2 + i * 2] & 0x0F;
+                if (d.scanTd[i] > 3 || d.scanTa[i] > 3 ||
+                    !d.dc[d.scanTd[i]].defined || !d.ac[d.scanTa[i]].defined)
+                    return false;
+            }
+            d.pos += segLen;
+            return true;
+        }
+
+        default: // APPn, COM, dll
+            break;
+        }
+        d.pos += segLen;
+    }
+    return false;
+}
+
+// Lompati marker RSTn dan reset bit reader
+static bool jpegGrayRestart(JpegGrayDecoder &d)
+{
+    d.bitBuf = 0;
+    d.bitCnt = 0;
+    d.hitMarker = false;
+    while (d.pos + 1 < d.len)
+    {
+        if (d.data[d.pos] == 0xFF && d.data[d.pos + 1] >= 0xD0 && d.data[d.pos + 1] <= 0xD7)
+        {
+            d.pos += 2;
+            return true;
+        }
+        d.pos++;
+    }
+    return false;
+}
+
+// Decode satu blok 8x8. coef diisi hanya untuk koefisien u,v < keep (natural order),
+// keep = 0 berarti blok cukup dilompati.
+static inline bool jpegGrayDecodeBlock(JpegGrayDecoder &d, const JpegGrayHuffman &dcTab,
+                                       const JpegGrayHuffman &acTab, int &pred, int32_t *coef, int keep)
+{
+    int s = jpegGrayDecodeHuffman(d, dcTab);
+    if (s < 0 || s > 11)
+        return false;
+    int diff = s ? jpegGrayExtend(jpegGrayGetBits(d, s), s) : 0;
+    pred += diff;
+    if (keep)
+        coef[0] = pred;
+
+    for (int k = 1; k < 64;)
+    {
+        int rs = jpegGrayDecodeHuffman(d, acTab);
+        if (rs < 0)
+            return false;
+        int r = rs >> 4;
+        s = rs & 0x0F;
+        if (s == 0)
+        {
+            if (r != 15)
+                break; // EOB
+            k += 16;
+            continue;
+        }
+        k += r;
+        if (k > 63)
+            return false;
+        int v = jpegGrayGetBits(d, s);
+        if (keep > 1)
+        {
+            int nat = jpegGrayZigzag[k];
+            if ((nat & 7) < keep && (nat >> 3) < keep)
+                coef[nat] = jpegGrayExtend(v, s);
+        }
+        k++;
+    }
+    return true;
+}
+
+// IDCT tereduksi n x n (n = 1, 2, 4) dan tulis ke buffer output dengan clipping tepi.
+// hist (opsional) diisi untuk setiap piksel yang ditulis.
+static inline void jpegGrayStoreBlock(const int32_t *coef, const uint16_t *q, int n,
+                                      uint8_t *out, int outW, int outH, int ox, int oy,
+                                      uint32_t *hist)
+{
+    // ox/oy boleh negatif (blok terpotong tepi kiri/atas area crop)
+    int x0 = ox < 0 ? -ox : 0;
+    int y0 = oy < 0 ? -oy : 0;
+    if (ox >= outW || oy >= outH || x0 >= n || y0 >= n)
+        return;
+    int wMax = (outW - ox < n) ? outW - ox : n;
+    int hMax = (outH - oy < n) ? outH - oy : n;
+
+    if (n == 1)
+    {
+        int v = ((coef[0] * (int32_t)q[0]) >> 3) + 128;
+        v = v < 0 ? 0 : (v > 255 ? 255 : v);
+        out[oy * outW + ox] = (uint8_t)v;
+        if (hist)
+            hist[v]++;
+        return;
+    }
+
+    const int32_t *T = (n == 2) ? &jpegGrayIdct2[0][0] : &jpegGrayIdct4[0][0];
+    int32_t tmp[16]; // tmp[v * n + x], Q12
+    for (int v = 0; v < n; v++)
+    {
+        int32_t F[4];
+        for (int u = 0; u < n; u++)
+            F[u] = coef[v * 8 + u] * (int32_t)q[v * 8 + u];
+        for (int x = 0; x < n; x++)
+        {
+            int32_t acc = 0;
+            for (int u = 0; u < n; u++)
+                acc += T[x * n + u] * F[u];
+            tmp[v * n + x] = acc;
+        }
+    }
+    for (int y = y0; y < hMax; y++)
+    {
+        uint8_t *row = out + (oy + y) * outW + ox;
+        for (int x = x0; x < wMax; x++)
+        {
+            int64_t acc = 0;
+            for (int v = 0; v < n; v++)
+                acc += (int64_t)T[y * n + v] * tmp[v * n + x];
+            int val = (int)((acc + (1 << 23)) >> 24) + 128;
+            val = val < 0 ? 0 : (val > 255 ? 255 : val);
+            row[x] = (uint8_t)val;
+            if (hist)
+                hist[val]++;
+        }
+    }
+}
+
+// Decode JPEG ke grayscale pada skala 1/scaleDenom (2, 4, atau 8).
+// out harus muat outW * outH <= maxPixels. Return false jika format tidak didukung/rusak.
+// hist (opsional, 256 bin) diisi histogram output dalam pass decode yang sama.
+// crop (opsional): hanya area ini yang di-IDCT dan ditulis; outW/outH = ukuran crop
+// setelah skala. Blok di luar crop hanya di-decode Huffman, dan decode berhenti
+// setelah baris MCU terakhir yang menyentuh crop.
+static bool jpegGrayDecode(const uint8_t *jpg, size_t len, int scaleDenom,
+                           uint8_t *out, int maxPixels, int &outW, int &outH,
+                           uint32_t *hist = nullptr, const JpegGrayRect *crop = nullptr)
+{
+    static JpegGrayDecoder d; // ~9KB tabel Huffman, jangan di stack
+    int n;
+    if (scaleDenom == JPEG_GRAY_SCALE_2)
+        n = 4;
+    else if (scaleDenom == JPEG_GRAY_SCALE_4)
+        n = 2;
+    else if (scaleDenom == JPEG_GRAY_SCALE_8)
+        n = 1;
+    else
+        return false;
+
+    jpegGrayInitTables();
+    memset(&d, 0, sizeof(d));
+    d.data = jpg;
+    d.len = len;
+    if (!jpegGrayParseHeaders(d))
+        return false;
+
+    int fullW = (d.width + scaleDenom - 1) / scaleDenom;
+    int fullH = (d.height + scaleDenom - 1) / scaleDenom;
+    int cx0 = 0, cy0 = 0;
+    outW = fullW;
+    outH = fullH;
+    if (crop)
+    {
+        cx0 = crop->x / scaleDenom;
+        cy0 = crop->y / scaleDenom;
+        int cx1 = (crop->x + crop->w + scaleDenom - 1) / scaleDenom;
+        int cy1 = (crop->y + crop->h + scaleDenom - 1) / scaleDenom;
+        if (cx0 < 0)
+            cx0 = 0;
+        if (cy0 < 0)
+            cy0 = 0;
+        if (cx1 > fullW)
+            cx1 = fullW;
+        if (cy1 > fullH)
+            cy1 = fullH;
+        if (cx1 <= cx0 || cy1 <= cy0)
+            return false;
+        outW = cx1 - cx0;
+        outH = cy1 - cy0;
+    }
+    if (outW * outH > maxPixels)
+        return false;
+
+    int mcuW = 8 * d.hmax;
+    int mcuH = 8 * d.vmax;
+    int mcusX = (d.width + mcuW - 1) / mcuW;
+    int mcusY = (d.height + mcuH - 1) / mcuH;
+    if (d.ncomp == 1)
+    {
+        // Scan tunggal non-interleaved: satu blok per MCU apapun sampling-nya
+        d.compH[0] = d.compV[0] = 1;
+        mcusX = (d.width + 7) / 8;
+        mcusY = (d.height + 7) / 8;
+    }
+
+    if (hist)
+        memset(hist, 0, sizeof(uint32_t) * 256);
+
+    const uint16_t *qY = d.qt[d.compTq[0]];
+    int pred[3] = {0, 0, 0};
+    int32_t coef[64];
+    int mcuCount = 0;
+
+    const int blockRowsPerMcu = d.ncomp == 1 ? 1 : d.compV[0];
+    for (int my = 0; my < mcusY; my++)
+    {
+        // Sisa gambar di bawah crop tidak perlu di-decode sama sekali
+        if (my * blockRowsPerMcu * n - cy0 >= outH)
+            break;
+        for (int mx = 0; mx < mcusX; mx++)
+        {
+            if (d.restartInterval && mcuCount && (mcuCount % d.restartInterval) == 0)
+            {
+                if (!jpegGrayRestart(d))
+                    return false;
+                pred[0] = pred[1] = pred[2] = 0;
+            }
+            mcuCount++;
+
+            for (int c = 0; c < d.ncomp; c++)
+            {
+                const JpegGrayHuffman &dcTab = d.dc[d.scanTd[c]];
+                const JpegGrayHuffman &acTab = d.ac[d.scanTa[c]];
+                for (int by = 0; by < d.compV[c]; by++)
+                {
+                    for (int bx = 0; bx < d.compH[c]; bx++)
+                    {
+                        if (c == 0)
+                        {
+                            int ox = (mx * d.compH[0] + bx) * n - cx0;
+                            int oy = (my * d.compV[0] + by) * n - cy0;
+                            bool inside = ox + n > 0 && oy + n > 0 && ox < outW && oy < outH;
+                            if (inside && n > 1)
+                                memset(coef, 0, sizeof(coef));
+                            if (!jpegGrayDecodeBlock(d, dcTab, acTab, pred[0], coef, inside ? n : 0))
+                                return false;
+                            if (inside)
+                                jpegGrayStoreBlock(coef, qY, n, out, outW, outH, ox, oy, hist);
+                        }
+                        else if (!jpegGrayDecodeBlock(d, dcTab, acTab, pred[c], coef, 0))
+                        {
+                            return false;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return true;
+}
+
+#endif
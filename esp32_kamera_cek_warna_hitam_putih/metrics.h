@@ -0,0 +1,223 @@
+// metrics.h - Metrik pipeline kamera untuk endpoint /metrics (format teks Prometheus)
+// Setiap tahap mencatat durasinya (esp_timer_get_time(), resolusi 1 us) ke
+// histogram bucket tetap; pencatatan hanya menambah beberapa integer di dalam
+// critical section singkat, jadi aman dipanggil dari task mana pun. Saat
+// scrape, snapshot diambil per histogram lalu ditulis lewat ChunkWriter
+// sehingga koneksi lambat tidak pernah menahan task kamera.
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <Arduino.h>
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "json_writer.h"
+
+#define METRIC_BUCKETS 12
+#define METRIC_MAX_STREAMS 4
+#define METRIC_FPS_WINDOW_US 1000000
+#define METRICS_CONTENT_TYPE "text/plain; version=0.0.4"
+
+enum MetricStage
+{
+    STAGE_FB_GET,   // esp_camera_fb_get()
+    STAGE_CONVERT,  // RGB565/JPEG -> gray/mask/RGB
+    STAGE_LABEL,    // labeling blob
+    STAGE_ENCODE,   // encode JPEG
+    STAGE_SEND,     // kirim satu frame ke satu klien
+    STAGE_SD_WRITE, // tulis satu file/frame ke SD
+    STAGE_COUNT
+};
+
+static const char *const metricStageNames[STAGE_COUNT] = {"fb_get", "convert", "label", "encode", "send", "sd_write"};
+
+// Batas atas bucket dalam mikrodetik (le), +Inf ditambahkan saat ditulis
+static const uint32_t metricBucketUs[METRIC_BUCKETS] = {100, 250, 500, 1000, 2500, 5000,
+                                                        10000, 25000, 50000, 100000, 250000, 1000000};
+
+struct LatencyHistogram
+{
+    uint32_t buckets[METRIC_BUCKETS + 1]; // tidak kumulatif; indeks terakhir = +Inf
+    uint64_t sumUs;
+    uint32_t count;
+};
+
+// Statistik per klien stream; slot dipakai ulang setelah klien putus
+struct StreamClientStats
+{
+    bool used;
+    uint32_t frames;
+    uint64_t bytes;
+    int64_t windowStartUs;
+    uint32_t windowFrames;
+    float fps; // frame per detik pada jendela terakhir yang selesai
+};
+
+static LatencyHistogram metricHist[STAGE_COUNT];
+static StreamClientStats metricStreams[METRIC_MAX_STREAMS];
+static portMUX_TYPE metricMux = portMUX_INITIALIZER_UNLOCKED;
+
+void metricObserve(MetricStage stage, uint32_t us)
+{
+    int b = 0;
+    while (b < METRIC_BUCKETS && us > metricBucketUs[b])
+        b++;
+    LatencyHistogram &h = metricHist[stage];
+    portENTER_CRITICAL(&metricMux);
+    h.buckets[b]++;
+    h.sumUs += us;
+    h.count++;
+    portEXIT_CRITICAL(&metricMux);
+}
+
+// Catat durasi sejak t0 (nilai esp_timer_get_time() di awal tahap)
+static inline void metricObserveSince(MetricStage stage, int64_t t0)
+{
+    metricObserve(stage, (uint32_t)(esp_timer_get_time() - t0));
+}
+
+// Daftarkan klien stream baru, return slot atau -1 jika tabel penuh
+int metricStreamOpen()
+{
+    int slot = -1;
+    portENTER_CRITICAL(&metricMux);
+    for (int i = 0; i < METRIC_MAX_STREAMS; i++)
+    {
+        if (!metricStreams[i].used)
+        {
+            metricStreams[i] = {true, 0, 0, esp_timer_get_time(), 0, 0.0f};
+            slot = i;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&metricMux);
+    return slot;
+}
+
+void metricStreamFrame(int slot, size_t bytes)
+{
+    if (slot < 0)
+        return;
+    int64_t now = esp_timer_get_time();
+    StreamClientStats &s = metricStreams[slot];
+    portENTER_CRITICAL(&metricMux);
+    s.frames++;
+    s.bytes += bytes;
+    s.windowFrames++;
+    if (now - s.windowStartUs >= METRIC_FPS_WINDOW_US)
+    {
+        s.fps = s.windowFrames * 1e6f / (float)(now - s.windowStartUs);
+        s.windowFrames = 0;
+        s.windowStartUs = now;
+    }
+    portEXIT_CRITICAL(&metricMux);
+}
+
+void metricStreamClose(int slot)
+{
+    if (slot < 0)
+        return;
+    portENTER_CRITICAL(&metricMux);
+    metricStreams[slot].used = false;
+    portEXIT_CRITICAL(&metricMux);
+}
+
+// ==== Penulisan format teks ====
+
+void metricsHeader(ChunkWriter &out, const char *name, const char *type, const char *help)
+{
+    out.printf("# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+void metricsCounter(ChunkWriter &out, const char *name, const char *help, uint64_t value)
+{
+    metricsHeader(out, name, "counter", help);
+    out.printf("%s %llu\n", name, (unsigned long long)value);
+}
+
+void metricsGauge(ChunkWriter &out, const char *name, const char *help, double value)
+{
+    metricsHeader(out, name, "gauge", help);
+    out.printf("%s %.6g\n", name, value);
+}
+
+static void metricsWriteHistograms(ChunkWriter &out)
+{
+    metricsHeader(out, "camera_stage_latency_seconds", "histogram", "Duration of one pipeline stage");
+    for (int s = 0; s < STAGE_COUNT; s++)
+    {
+        LatencyHistogram h;
+        portENTER_CRITICAL(&metricMux);
+        h = metricHist[s];
+        portEXIT_CRITICAL(&metricMux);
+
+        uint32_t cumulative = 0;
+        for (int b = 0; b < METRIC_BUCKETS; b++)
+        {
+            cumulative += h.buckets[b];
+            out.printf("camera_stage_latency_seconds_bucket{stage=\"%s\",le=\"%g\"} %u\n",
+                       metricStageNames[s], metricBucketUs[b] / 1e6, (unsigned)cumulative);
+        }
+        out.printf("camera_stage_latency_seconds_bucket{stage=\"%s\",le=\"+Inf\"} %u\n", metricStageNames[s], (unsigned)h.count);
+        out.printf("camera_stage_latency_seconds_sum{stage=\"%s\"} %.6f\n", metricStageNames[s], h.sumUs / 1e6);
+        out.printf("camera_stage_latency_seconds_count{stage=\"%s\"} %u\n", metricStageNames[s], (unsigned)h.count);
+    }
+}
+
+// Heap internal dan PSRAM: sisa sekarang dan titik terendah sejak boot
+// (low-water mark free = high-water mark pemakaian)
+static void metricsWriteHeap(ChunkWriter &out)
+{
+    bool psram = psramFound();
+    metricsHeader(out, "esp_heap_free_bytes", "gauge", "Free heap bytes");
+    out.printf("esp_heap_free_bytes{region=\"internal\"} %u\n", (unsigned)heap_caps_get_free_size(MALLOC_CAP_INTERNAL));
+    if (psram)
+        out.printf("esp_heap_free_bytes{region=\"psram\"} %u\n", (unsigned)heap_caps_get_free_size(MALLOC_CAP_SPIRAM));
+    metricsHeader(out, "esp_heap_min_free_bytes", "gauge", "Lowest free heap bytes since boot");
+    out.printf("esp_heap_min_free_bytes{region=\"internal\"} %u\n", (unsigned)heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL));
+    if (psram)
+        out.printf("esp_heap_min_free_bytes{region=\"psram\"} %u\n", (unsigned)heap_caps_get_minimum_free_size(MALLOC_CAP_SPIRAM));
+    metricsHeader(out, "esp_heap_largest_free_block_bytes", "gauge", "Largest allocatable block");
+    out.printf("esp_heap_largest_free_block_bytes{region=\"internal\"} %u\n", (unsigned)heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL));
+    if (psram)
+        out.printf("esp_heap_largest_free_block_bytes{region=\"psram\"} %u\n", (unsigned)heap_caps_get_largest_free_block(MALLOC_CAP_SPIRAM));
+}
+
+static void metricsWriteStreams(ChunkWriter &out)
+{
+    StreamClientStats snap[METRIC_MAX_STREAMS];
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&metricMux);
+    memcpy(snap, metricStreams, sizeof(snap));
+    portEXIT_CRITICAL(&metricMux);
+
+    metricsHeader(out, "camera_stream_fps", "gauge", "Frames per second delivered to each stream client");
+    for (int i = 0; i < METRIC_MAX_STREAMS; i++)
+    {
+        if (!snap[i].used)
+            continue;
+        // Klien yang macet tidak menutup jendela: hitung dari jendela yang sedang berjalan
+        int64_t elapsed = now - snap[i].windowStartUs;
+        float fps = elapsed > 2 * METRIC_FPS_WINDOW_US ? snap[i].windowFrames * 1e6f / (float)elapsed : snap[i].fps;
+        out.printf("camera_stream_fps{client=\"%d\"} %.2f\n", i, fps);
+    }
+    metricsHeader(out, "camera_stream_frames_total", "counter", "Frames sent to each stream client");
+    for (int i = 0; i < METRIC_MAX_STREAMS; i++)
+        if (snap[i].used)
+            out.printf("camera_stream_frames_total{client=\"%d\"} %u\n", i, (unsigned)snap[i].frames);
+    metricsHeader(out, "camera_stream_bytes_total", "counter", "Bytes sent to each stream client");
+    for (int i = 0; i < METRIC_MAX_STREAMS; i++)
+        if (snap[i].used)
+            out.printf("camera_stream_bytes_total{client=\"%d\"} %llu\n", i, (unsigned long long)snap[i].bytes);
+}
+
+// Metrik bersama semua sketch; counter khusus sketch ditulis pemanggil sesudahnya
+void metricsWriteCommon(ChunkWriter &out)
+{
+    metricsWriteHistograms(out);
+    metricsWriteHeap(out);
+    metricsWriteStreams(out);
+    metricsGauge(out, "esp_uptime_seconds", "Seconds since boot", esp_timer_get_time() / 1e6);
+}
+
+#endif
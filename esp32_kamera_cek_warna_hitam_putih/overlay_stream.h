@@ -0,0 +1,231 @@
+// overlay_stream.h - Stream /overlay: hasil labeling digambar di atas frame gray
+// Tahap label menyerahkan salinan gray (diperkecil ke maks 160x120) + kotak blob
+// lewat overlayOffer(), paling sering OVERLAY_INTERVAL_MS dan hanya jika ada viewer.
+// Task encoder prioritas 0 di core counting menggambar kotak + ID lalu encode JPEG
+// baseline kualitas rendah (jpeg_encoder.h, memori kerja dari arena) ke buffer
+// tetap, jadi hanya memakai waktu luang core itu dan tidak menyentuh heap.
+// Viewer memegang OverlayFrame ber-refcount seperti FrameRef.
+// Butuh: ccl.h (CclBlob)
+#ifndef OVERLAY_STREAM_H
+#define OVERLAY_STREAM_H
+
+#include <atomic>
+#include "esp_camera.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "frame_arena.h"
+#include "jpeg_encoder.h"
+#include "metrics.h"
+
+#define OVERLAY_MAX_W 160
+#define OVERLAY_MAX_H 120
+#define OVERLAY_MAX_BOXES 64
+#define OVERLAY_QUALITY 30        // JPEG kecil (~3-5 KB), cukup untuk melihat kotak
+#define OVERLAY_INTERVAL_MS 200   // maks 5 fps
+#define OVERLAY_FRAMES 3          // 1 terbaru + viewer yang masih mengirim frame lama
+#define OVERLAY_JPEG_CAP (16 * 1024)
+
+struct OverlayBox {
+  int16_t x0, y0, x1, y1;
+};
+
+struct OverlayFrame {
+  uint8_t *jpg;
+  size_t len;
+  std::atomic<int> refs; // 1 selama jadi frame terbaru + 1 per viewer
+  uint32_t seq;
+};
+
+// Input dari tahap label: ditulis hanya saat ovInReady == false
+static uint8_t *ovGray = nullptr;
+static int ovW = 0, ovH = 0;
+static OverlayBox ovBoxes[OVERLAY_MAX_BOXES];
+static int ovBoxCount = 0;
+static int ovCount = 0;
+static int ovLineY = -1; // garis konveyor, -1 = tidak digambar
+static std::atomic<bool> ovInReady{false};
+static uint32_t ovLastOfferMs = 0;
+
+static OverlayFrame ovFrames[OVERLAY_FRAMES];
+static OverlayFrame *ovLatest = nullptr;
+static portMUX_TYPE ovMux = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t ovTask = NULL;
+static JpegEncoder *ovEncoder = nullptr; // hanya dipakai task overlay_enc
+
+std::atomic<int> overlayViewers{0};
+static volatile uint32_t overlayFramesEncoded = 0;
+
+// Digit 3x5, bit 2 = kolom kiri
+static const uint8_t ovFont[10][5] = {
+    {7, 5, 5, 5, 7}, {2, 6, 2, 2, 7}, {7, 1, 7, 4, 7}, {7, 1, 7, 1, 7}, {5, 5, 7, 1, 1},
+    {7, 4, 7, 1, 7}, {7, 4, 7, 5, 7}, {7, 1, 1, 1, 1}, {7, 5, 7, 5, 7}, {7, 5, 7, 1, 7},
+};
+
+// Dipanggil tahap label setelah hasil frame jadi. Murah jika tidak ada viewer;
+// jika encoder masih sibuk frame ini dilewati (counting tidak pernah menunggu).
+void overlayOffer(const uint8_t *gray, int w, int h, const CclBlob *blobs, int n, int count, int lineY) {
+  if (!ovTask || overlayViewers.load(std::memory_order_relaxed) == 0) return;
+  uint32_t now = millis();
+  if (now - ovLastOfferMs < OVERLAY_INTERVAL_MS || ovInReady.load(std::memory_order_acquire)) return;
+  ovLastOfferMs = now;
+
+  // Perkecil dengan mengambil 1 piksel per blok step x step
+  int step = 1;
+  while (w / step > OVERLAY_MAX_W || h / step > OVERLAY_MAX_H) step++;
+  ovW = w / step;
+  ovH = h / step;
+  for (int y = 0; y < ovH; y++) {
+    const uint8_t *src = gray + (size_t)y * step * w;
+    uint8_t *dst = ovGray + y * ovW;
+    for (int x = 0; x < ovW; x++) dst[x] = src[x * step];
+  }
+  if (n > OVERLAY_MAX_BOXES) n = OVERLAY_MAX_BOXES;
+  for (int i = 0; i < n; i++) {
+    ovBoxes[i] = {(int16_t)(blobs[i].minX / step), (int16_t)(blobs[i].minY / step),
+                  (int16_t)(blobs[i].maxX / step), (int16_t)(blobs[i].maxY / step)};
+  }
+  ovBoxCount = n;
+  ovCount = count;
+  ovLineY = lineY < 0 ? -1 : lineY / step;
+  ovInReady.store(true, std::memory_order_release);
+  xTaskNotifyGive(ovTask);
+}
+
+static inline void ovPixel(int x, int y, uint8_t v) {
+  if (x >= 0 && x < ovW && y >= 0 && y < ovH) ovGray[y * ovW + x] = v;
+}
+
+// Kotak dua warna (putih di luar, hitam di dalam) agar terlihat di latar apa pun
+static void ovRect(int x0, int y0, int x1, int y1) {
+  for (int k = 0; k < 2; k++) {
+    uint8_t v = k ? 0 : 255;
+    int a = x0 - 1 + k, b = x1 + 1 - k, c = y0 - 1 + k, d = y1 + 1 - k;
+    for (int x = a; x <= b; x++) {
+      ovPixel(x, c, v);
+      ovPixel(x, d, v);
+    }
+    for (int y = c; y <= d; y++) {
+      ovPixel(a, y, v);
+      ovPixel(b, y, v);
+    }
+  }
+}
+
+// Angka putih di atas latar hitam, pojok kiri atas di (x, y)
+static void ovNumber(int x, int y, int value) {
+  char digits[8];
+  int len = snprintf(digits, sizeof(digits), "%d", value);
+  for (int yy = y - 1; yy <= y + 5; yy++)
+    for (int xx = x - 1; xx <= x + len * 4 - 1; xx++) ovPixel(xx, yy, 0);
+  for (int i = 0; i < len; i++) {
+    const uint8_t *g = ovFont[digits[i] - '0'];
+    for (int r = 0; r < 5; r++)
+      for (int c = 0; c < 3; c++)
+        if (g[r] & (4 >> c)) ovPixel(x + i * 4 + c, y + r, 255);
+  }
+}
+
+struct OverlaySink {
+  uint8_t *buf;
+  size_t len;
+  bool overflow;
+};
+
+static size_t ovJpegWrite(void *arg, size_t index, const void *data, size_t len) {
+  OverlaySink *s = (OverlaySink *)arg;
+  if (index + len > OVERLAY_JPEG_CAP) {
+    s->overflow = true;
+    return 0;
+  }
+  memcpy(s->buf + index, data, len);
+  s->len = index + len;
+  return len;
+}
+
+static OverlayFrame *ovAllocFrame() {
+  for (int i = 0; i < OVERLAY_FRAMES; i++)
+    if (ovFrames[i].refs.load(std::memory_order_acquire) == 0) return &ovFrames[i];
+  return nullptr;
+}
+
+void overlayRelease(OverlayFrame *f) {
+  if (f) f->refs.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+// Frame terbaru yang lebih baru dari lastSeq (maks timeoutMs), wajib dilepas dengan overlayRelease()
+OverlayFrame *overlayGet(uint32_t lastSeq, uint32_t timeoutMs) {
+  uint32_t start = millis();
+  for (;;) {
+    OverlayFrame *f = nullptr;
+    portENTER_CRITICAL(&ovMux);
+    if (ovLatest && ovLatest->seq != lastSeq) {
+      f = ovLatest;
+      f->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+    portEXIT_CRITICAL(&ovMux);
+    if (f || millis() - start >= timeoutMs) return f;
+    vTaskDelay(pdMS_TO_TICKS(20));
+  }
+}
+
+static void overlayLoop(void *) {
+  uint32_t seq = 0;
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1000));
+    if (!ovInReady.load(std::memory_order_acquire)) continue;
+    OverlayFrame *f = ovAllocFrame();
+    if (!f) {
+      // Semua frame masih dikirim viewer lambat: lewati input ini
+      ovInReady.store(false, std::memory_order_release);
+      continue;
+    }
+
+    int64_t t0 = esp_timer_get_time();
+    if (ovLineY >= 0)
+      for (int x = 0; x < ovW; x += 2) ovPixel(x, ovLineY, 255);
+    for (int i = 0; i < ovBoxCount; i++) {
+      const OverlayBox &b = ovBoxes[i];
+      ovRect(b.x0, b.y0, b.x1, b.y1);
+      ovNumber(b.x0 + 1, b.y0 + 1, i + 1);
+    }
+    ovNumber(2, 2, ovCount);
+
+    OverlaySink sink = {f->jpg, 0, false};
+    bool ok = jpegEncode(ovEncoder, ovGray, ovW, ovH, JPEG_ENC_GRAY, OVERLAY_QUALITY, ovJpegWrite, &sink);
+    ovInReady.store(false, std::memory_order_release);
+    if (!ok || sink.overflow) continue;
+    metricObserveSince(STAGE_ENCODE, t0);
+
+    f->len = sink.len;
+    f->seq = ++seq;
+    f->refs.store(1, std::memory_order_release);
+    portENTER_CRITICAL(&ovMux);
+    OverlayFrame *old = ovLatest;
+    ovLatest = f;
+    portEXIT_CRITICAL(&ovMux);
+    overlayRelease(old);
+    overlayFramesEncoded++;
+  }
+}
+
+size_t overlayArenaBytes() {
+  return FRAME_ARENA_ROUND(OVERLAY_MAX_W * OVERLAY_MAX_H) + OVERLAY_FRAMES * FRAME_ARENA_ROUND(OVERLAY_JPEG_CAP) +
+         jpegEncArenaBytes();
+}
+
+// Buffer dari arena sekali saat boot; task encoder prioritas 0 (waktu luang) di core counting.
+// Stack 4096 cukup: jpegEncode() + blok DCT memakai < 1 KB, sisanya memori encoder di arena.
+bool startOverlay(int core) {
+  ovGray = (uint8_t *)frameArenaAlloc(OVERLAY_MAX_W * OVERLAY_MAX_H);
+  ovEncoder = jpegEncCreate();
+  if (!ovGray || !ovEncoder) return false;
+  for (int i = 0; i < OVERLAY_FRAMES; i++) {
+    ovFrames[i].jpg = (uint8_t *)frameArenaAlloc(OVERLAY_JPEG_CAP);
+    ovFrames[i].refs.store(0);
+    if (!ovFrames[i].jpg) return false;
+  }
+  return xTaskCreatePinnedToCore(overlayLoop, "overlay_enc", 4096, NULL, 0, &ovTask, core) == pdPASS;
+}
+
+#endif
@@ -0,0 +1,106 @@
+// roi.h - Region of interest untuk counting
+// ROI disimpan dalam persen frame (tidak bergantung resolusi) dan dipersist ke
+// EEPROM (emulasi NVS di ESP32) dengan byte magic seperti sketch lain di repo.
+#ifndef ROI_H
+#define ROI_H
+
+#include <stdint.h>
+
+#ifdef ARDUINO
+#include <EEPROM.h>
+#endif
+
+#define ROI_EEPROM_SIZE 16
+#define ROI_EEPROM_ADDR 0
+#define ROI_EEPROM_MAGIC 0xA5 // Nilai magic untuk validasi data ROI
+#define ROI_MIN_PERCENT 5     // Lebar/tinggi ROI minimal
+
+struct CountRoi
+{
+    uint8_t x, y, w, h; // persen frame
+};
+
+struct RoiRect
+{
+    int x, y, w, h; // piksel
+};
+
+static CountRoi roiCurrent = {0, 0, 100, 100};
+
+static inline bool roiIsFull(const CountRoi &r)
+{
+    return r.x == 0 && r.y == 0 && r.w == 100 && r.h == 100;
+}
+
+// Rapikan nilai persen agar ROI selalu berada di dalam frame
+static void roiSanitize(CountRoi &r)
+{
+    if (r.x > 100 - ROI_MIN_PERCENT)
+        r.x = 100 - ROI_MIN_PERCENT;
+    if (r.y > 100 - ROI_MIN_PERCENT)
+        r.y = 100 - ROI_MIN_PERCENT;
+    if (r.w < ROI_MIN_PERCENT)
+        r.w = ROI_MIN_PERCENT;
+    if (r.h < ROI_MIN_PERCENT)
+        r.h = ROI_MIN_PERCENT;
+    if (r.x + r.w > 100)
+        r.w = 100 - r.x;
+    if (r.y + r.h > 100)
+        r.h = 100 - r.y;
+}
+
+// Persen -> piksel untuk frame fullW x fullH. x dan w dibulatkan ke kelipatan
+// align (mis. 2 agar baris RGB565 tetap align 32-bit).
+static RoiRect roiToRect(CountRoi r, int fullW, int fullH, int align)
+{
+    roiSanitize(r);
+    RoiRect rc;
+    rc.x = fullW * r.x / 100;
+    rc.y = fullH * r.y / 100;
+    rc.w = fullW * r.w / 100;
+    rc.h = fullH * r.h / 100;
+    if (align > 1)
+    {
+        rc.x -= rc.x % align;
+        rc.w -= rc.w % align;
+    }
+    if (rc.w < align)
+        rc.w = align;
+    if (rc.x + rc.w > fullW)
+        rc.w = fullW - rc.x;
+    if (rc.y + rc.h > fullH)
+        rc.h = fullH - rc.y;
+    if (rc.h < 1)
+        rc.h = 1;
+    return rc;
+}
+
+#ifdef ARDUINO
+// Load ROI dari EEPROM, return false jika belum pernah disimpan
+bool roiLoad()
+{
+    EEPROM.begin(ROI_EEPROM_SIZE);
+    if (EEPROM.read(ROI_EEPROM_ADDR) != ROI_EEPROM_MAGIC)
+        return false;
+    CountRoi r;
+    r.x = EEPROM.read(ROI_EEPROM_ADDR + 1);
+    r.y = EEPROM.read(ROI_EEPROM_ADDR + 2);
+    r.w = EEPROM.read(ROI_EEPROM_ADDR + 3);
+    r.h = EEPROM.read(ROI_EEPROM_ADDR + 4);
+    roiSanitize(r);
+    roiCurrent = r;
+    return true;
+}
+
+void roiSave()
+{
+    EEPROM.write(ROI_EEPROM_ADDR, ROI_EEPROM_MAGIC);
+    EEPROM.write(ROI_EEPROM_ADDR + 1, roiCurrent.x);
+    EEPROM.write(ROI_EEPROM_ADDR + 2, roiCurrent.y);
+    EEPROM.write(ROI_EEPROM_ADDR + 3, roiCurrent.w);
+    EEPROM.write(ROI_EEPROM_ADDR + 4, roiCurrent.h);
+    EEPROM.commit();
+}
+#endif
+
+#endif
@@ -0,0 +1,107 @@
+// bfs_reference.h - detect_blobs() lama (BFS per piksel) sebagai referensi
+// Disalin dari ESP32S3_Camera_Counter_Fixed.ino sebelum blob_rle.h, termasuk
+// malloc visited map w*h dan stack int w*h di setiap panggilan, supaya waktu
+// yang dibandingkan dengan detektor run-length adalah biaya versi lama apa adanya.
+// Satu-satunya perubahan: tes foreground jadi parameter (gray < threshold atau
+// mask != 0) agar bisa dijalankan pada buffer yang sama dengan countFrameLabel().
+#ifndef BFS_REFERENCE_H
+#define BFS_REFERENCE_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+template <typename IsFg>
+std::vector<Blob> bfsDetectBlobs(const uint8_t *img, int w, int h, IsFg isFg, int minArea, int maxArea)
+{
+    std::vector<Blob> blobs;
+    // labels: 0 unlabeled, 1 labeled
+    uint8_t *vis = (uint8_t *)malloc(w * h);
+    if (!vis)
+        return blobs;
+    memset(vis, 0, w * h);
+
+    // stack for BFS (store index)
+    int maxStack = w * h;
+    int *stack = (int *)malloc(sizeof(int) * maxStack);
+    if (!stack)
+    {
+        free(vis);
+        return blobs;
+    }
+
+    for (int y = 0; y < h; y++)
+    {
+        for (int x = 0; x < w; x++)
+        {
+            int idx = y * w + x;
+            if (vis[idx])
+                continue;
+            if (isFg(img[idx]))
+            {
+                int sp = 0;
+                stack[sp++] = idx;
+                vis[idx] = 1;
+                int area = 0;
+                int minx = x, miny = y, maxx = x, maxy = y;
+                while (sp > 0)
+                {
+                    int cur = stack[--sp];
+                    int cy = cur / w;
+                    int cx = cur % w;
+                    area++;
+                    if (cx < minx)
+                        minx = cx;
+                    if (cx > maxx)
+                        maxx = cx;
+                    if (cy < miny)
+                        miny = cy;
+                    if (cy > maxy)
+                        maxy = cy;
+                    // 4-neighbors
+                    const int dx[4] = {-1, 1, 0, 0};
+                    const int dy[4] = {0, 0, -1, 1};
+                    for (int k = 0; k < 4; k++)
+                    {
+                        int nx = cx + dx[k];
+                        int ny = cy + dy[k];
+                        if (nx < 0 || nx >= w || ny < 0 || ny >= h)
+                            continue;
+                        int nidx = ny * w + nx;
+                        if (vis[nidx])
+                            continue;
+                        if (isFg(img[nidx]))
+                        {
+                            vis[nidx] = 1;
+                            stack[sp++] = nidx;
+                        }
+                        else
+                        {
+                            vis[nidx] = 1;
+                        }
+                    }
+                }
+                if (area >= minArea && area <= maxArea)
+                {
+                    Blob b;
+                    b.area = area;
+                    b.minx = minx;
+                    b.miny = miny;
+                    b.maxx = maxx;
+                    b.maxy = maxy;
+                    blobs.push_back(b);
+                }
+            }
+            else
+            {
+                vis[idx] = 1; // background
+            }
+        }
+    }
+    free(stack);
+    free(vis);
+    return blobs;
+}
+
+#endif
@@ -0,0 +1,889 @@
+// count_replay.cpp - Replay frame rekaman ke algoritma counting di PC
+// Header algoritma di-include langsung dari folder sketch (tanpa salinan), jadi
+// yang diuji di sini persis kode yang di-flash:
+//   rle : Alat_Hitung ESP32S3_Camera_Counter_Fixed - count_frame.h (RGB565 -> mask,
+//         Otsu/adaptif, detect_blobs run-length), objek gelap di latar terang
+//   ccl : esp32_kamera_cek_warna_hitam_putih - jpeg_gray.h + count_objects.h
+//         (decode Y, Otsu/adaptif, CCL + smart grouping), objek terang
+//
+// Input per file (diurutkan berdasarkan nama):
+//   .jpg/.jpeg   JPEG baseline, didecode jpegGrayDecode() pada --scale
+//   .bmp         BMP 24-bit dari /save_snapshot, dikembalikan ke RGB565 (lossless)
+//   .rgb565/.raw RGB565 little-endian mentah; ukuran dari --size atau nama file (_160x120)
+// Ground truth (--truth): CSV "file,count", baris header dan '#' diabaikan.
+// --synth menggantikan folder frame dengan scene sintetis (synth_scenes.h: mur,
+// konektor, cable-tie) yang ground truth-nya diketahui; untuk ccl objeknya terang. --bfs (rle) menjalankan
+// juga detect_blobs() BFS lama (bfs_reference.h) pada mask/gray yang sama, lalu
+// melaporkan waktu labeling kedua algoritma dan apakah daftar blob-nya identik.
+// --scale all hanya mengukur decode: setiap JPEG didecode pada 1/2, 1/4 dan 1/8,
+// lalu dilaporkan ms/frame per skala (tanpa counting).
+// Exit code: 0 semua cocok (dalam --tolerance) dan blob --bfs identik, 1 ada yang
+// meleset/berbeda, 2 error.
+//
+// Build (Linux, g++ >= 8):
+//   g++ -O2 -std=c++17 -o count_replay count_replay.cpp
+// Pemakaian:
+//   ./count_replay --algo rle --truth truth.csv frames/
+//   ./count_replay --algo rle --split dt --max-area 400 --truth truth.csv frames/
+//   ./count_replay --algo ccl --thresh-mode otsu --smart --repeat 20 frames/
+//   ./count_replay --scale all --repeat 10 frames/
+//   ./count_replay --algo ccl --classes samples.csv frames/   (samples.csv dari SD /classifier)
+//   ./count_replay --synth all --synth-count 50 --bfs --repeat 10
+//   ./count_replay --synth cable-tie --size 640x480 --bfs --quiet
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "../../esp32_kamera_cek_warna_hitam_putih/auto_threshold.h"
+#include "../../esp32_kamera_cek_warna_hitam_putih/jpeg_gray.h"
+#include "../../esp32_kamera_cek_warna_hitam_putih/ccl.h"
+#include "../../esp32_kamera_cek_warna_hitam_putih/count_objects.h"
+#include "../../esp32_kamera_cek_warna_hitam_putih/blob_classifier.h"
+#include "../../Alat_Hitung/alat hitung/alat_hitung/ESP32S3_Camera_Counter_Fixed/rgb565_mask.h"
+#include "../../Alat_Hitung/alat hitung/alat_hitung/ESP32S3_Camera_Counter_Fixed/blob_rle.h"
+#include "../../Alat_Hitung/alat hitung/alat_hitung/ESP32S3_Camera_Counter_Fixed/blob_split.h"
+#include "../../Alat_Hitung/alat hitung/alat_hitung/ESP32S3_Camera_Counter_Fixed/count_frame.h"
+#include "bfs_reference.h"
+#include "synth_scenes.h"
+
+namespace fs = std::filesystem;
+
+#define REPLAY_MAX_BLOBS 256 // MAX_BLOBS (rle); ccl di device memakai MAX_OBJECTS 30
+#define REPLAY_MAX_W 1600    // UXGA, batas buffer integral mode adaptif
+#define REPLAY_MAX_H 1200
+#define REPLAY_SPLIT_W 160   // blobSplitInit() di sketch rle: frame profil count
+#define REPLAY_SPLIT_H 120
+#define REPLAY_SYNTH_W 160   // default --synth: resolusi profil count
+#define REPLAY_SYNTH_H 120
+
+enum ReplayAlgo
+{
+    ALGO_RLE,
+    ALGO_CCL
+};
+
+struct ReplayOptions
+{
+    ReplayAlgo algo = ALGO_RLE;
+    std::string dir;
+    std::string truth;
+    std::string classes; // CSV sampel classifier (hanya ccl)
+    int threshMode = THRESH_MANUAL;
+    int threshold = -1; // -1 = default sketch
+    int minArea = -1, maxArea = -1;
+    int adaptRadius = 8;
+    int adaptOffset = 10;
+    bool smart = false;
+    int splitMode = SPLIT_OFF;
+    float aspectTolerance = 0.3f;
+    int scale = JPEG_GRAY_SCALE_4;
+    bool scaleSweep = false; // --scale all
+    int rawW = 0, rawH = 0;
+    int tolerance = 0;
+    int repeat = 1;
+    int maxRuns = 4096;    // RLE_MAX_RUNS di sketch
+    int maxLabels = 8192;  // cclInit() dengan PSRAM
+    int maxObjects = 64;   // MAX_OBJECTS di sketch ccl
+    bool quiet = false;
+    int synthKind = -1; // -1 = baca folder, SYNTH_KINDS = semua jenis
+    int synthCount = 20; // scene per jenis
+    uint32_t seed = 1;
+    bool compareBfs = false;
+};
+
+// Satu frame yang sudah dimuat: RGB565 (w*h*2) atau gray (w*h)
+struct ReplayFrame
+{
+    std::vector<uint8_t> data;
+    int w = 0, h = 0;
+    bool rgb565 = false;
+    bool jpeg = false;
+};
+
+// Satu masukan replay: file di folder (dimuat saat giliran) atau scene sintetis
+struct ReplayInput
+{
+    std::string name;
+    fs::path path;
+    ReplayFrame frame;
+    bool synth = false;
+};
+
+// Hasil --bfs satu frame: waktu label run-length vs BFS lama pada buffer yang sama
+struct BfsCompare
+{
+    double rleUs, bfsUs;
+    int rleCount, bfsCount;
+    bool equal;
+};
+
+struct FrameResult
+{
+    std::string name;
+    int count;
+    int expected; // -1 jika tidak ada di ground truth
+    uint16_t classCounts[CLS_MAX + 1];
+    double decodeUs, convertUs, labelUs;
+    bool compared;
+    BfsCompare bfs;
+};
+
+static void usage()
+{
+    fprintf(stderr,
+            "usage: count_replay [options] <frame_dir>\n"
+            "       count_replay [options] --synth nut|connector|cable-tie|all\n"
+            "  --algo rle|ccl           rle = Alat_Hitung (dark objects), ccl = cek_warna (bright objects)\n"
+            "  --truth FILE             ground-truth CSV: file,count\n"
+            "  --tolerance N            |count - expected| <= N passes (default 0)\n"
+            "  --thresh-mode manual|otsu|adaptive\n"
+            "  --threshold N            manual threshold (default 70 rle, 128 ccl)\n"
+            "  --min-area N --max-area N\n"
+            "  --adapt-radius N --adapt-offset N\n"
+            "  --smart --aspect-tol F   ccl smart grouping\n"
+            "  --split off|dt|area      rle: separate merged blobs above --max-area\n"
+            "  --classes FILE           ccl: classifier samples CSV, prints per-class counts\n"
+            "  --scale 2|4|8|all        JPEG decode scale (default 4); all = decode-only benchmark at 2, 4 and 8\n"
+            "  --size WxH               size of .rgb565/.raw frames\n"
+            "  --repeat N               run each frame N times, report the median time\n"
+            "  --synth KIND             synthetic scenes instead of <frame_dir> (size from --size, default 160x120)\n"
+            "  --synth-count N          scenes per kind (default 20)\n"
+            "  --seed N                 synthetic scene seed (default 1)\n"
+            "  --bfs                    rle: also run the old BFS detect_blobs, compare time and blobs\n"
+            "  --quiet                  only print mismatches and the summary\n");
+}
+
+static bool parseSize(const std::string &s, int &w, int &h)
+{
+    return sscanf(s.c_str(), "%dx%d", &w, &h) == 2 && w > 0 && h > 0;
+}
+
+static bool parseArgs(int argc, char **argv, ReplayOptions &o)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::string a = argv[i];
+        auto next = [&](const char *name) -> const char *
+        {
+            if (i + 1 >= argc)
+            {
+                fprintf(stderr, "%s needs a value\n", name);
+                exit(2);
+            }
+            return argv[++i];
+        };
+        if (a == "--algo")
+        {
+            std::string v = next("--algo");
+            if (v != "rle" && v != "ccl")
+                return false;
+            o.algo = v == "rle" ? ALGO_RLE : ALGO_CCL;
+        }
+        else if (a == "--truth")
+            o.truth = next("--truth");
+        else if (a == "--classes")
+            o.classes = next("--classes");
+        else if (a == "--tolerance")
+            o.tolerance = atoi(next("--tolerance"));
+        else if (a == "--thresh-mode")
+            o.threshMode = threshModeFromName(next("--thresh-mode"));
+        else if (a == "--threshold")
+            o.threshold = atoi(next("--threshold"));
+        else if (a == "--min-area")
+            o.minArea = atoi(next("--min-area"));
+        else if (a == "--max-area")
+            o.maxArea = atoi(next("--max-area"));
+        else if (a == "--adapt-radius")
+            o.adaptRadius = atoi(next("--adapt-radius"));
+        else if (a == "--adapt-offset")
+            o.adaptOffset = atoi(next("--adapt-offset"));
+        else if (a == "--split")
+            o.splitMode = splitModeFromName(next("--split"));
+        else if (a == "--smart")
+            o.smart = true;
+        else if (a == "--aspect-tol")
+            o.aspectTolerance = (float)atof(next("--aspect-tol"));
+        else if (a == "--scale")
+        {
+            std::string v = next("--scale");
+            o.scaleSweep = v == "all";
+            if (!o.scaleSweep)
+                o.scale = atoi(v.c_str());
+        }
+        else if (a == "--size")
+        {
+            if (!parseSize(next("--size"), o.rawW, o.rawH))
+                return false;
+        }
+        else if (a == "--repeat")
+            o.repeat = std::max(1, atoi(next("--repeat")));
+        else if (a == "--quiet")
+            o.quiet = true;
+        else if (a == "--synth")
+        {
+            o.synthKind = synthKindFromName(next("--synth"));
+            if (o.synthKind < 0)
+                return false;
+        }
+        else if (a == "--synth-count")
+            o.synthCount = std::max(1, atoi(next("--synth-count")));
+        else if (a == "--seed")
+            o.seed = (uint32_t)strtoul(next("--seed"), nullptr, 10);
+        else if (a == "--bfs")
+            o.compareBfs = true;
+        else if (a[0] == '-')
+            return false;
+        else
+            o.dir = a;
+    }
+    if (!o.classes.empty() && o.algo != ALGO_CCL)
+        return false;
+    if ((o.splitMode != SPLIT_OFF || o.compareBfs) && o.algo != ALGO_RLE)
+        return false;
+    if (o.scaleSweep && o.synthKind >= 0)
+        return false; // scene sintetis berupa RGB565, tidak ada yang didecode
+    if (o.scale != JPEG_GRAY_SCALE_2 && o.scale != JPEG_GRAY_SCALE_4 && o.scale != JPEG_GRAY_SCALE_8)
+        return false;
+    // Default sama dengan global di masing-masing sketch
+    if (o.threshold < 0)
+        o.threshold = o.algo == ALGO_RLE ? 70 : 128;
+    if (o.minArea < 0)
+        o.minArea = o.algo == ALGO_RLE ? 30 : 50;
+    if (o.maxArea < 0)
+        o.maxArea = o.algo == ALGO_RLE ? 20000 : 5000;
+    if (o.synthKind >= 0)
+    {
+        if (o.rawW <= 0)
+        {
+            o.rawW = REPLAY_SYNTH_W;
+            o.rawH = REPLAY_SYNTH_H;
+        }
+        return o.dir.empty();
+    }
+    return !o.dir.empty();
+}
+
+static std::string lower(std::string s)
+{
+    std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c)
+                   { return (char)tolower(c); });
+    return s;
+}
+
+static bool readFile(const fs::path &p, std::vector<uint8_t> &out)
+{
+    std::ifstream f(p, std::ios::binary);
+    if (!f)
+        return false;
+    out.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+    return true;
+}
+
+static inline uint32_t le32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// BMP 24-bit bottom-up -> RGB565. Kebalikan persis dari konversi di
+// /save_snapshot (R = r5 * 255 / 31), jadi frame RGB565 asli kembali utuh.
+static bool bmpToRgb565(const std::vector<uint8_t> &bmp, ReplayFrame &f)
+{
+    if (bmp.size() < 54 || bmp[0] != 'B' || bmp[1] != 'M')
+        return false;
+    uint32_t offset = le32(&bmp[10]);
+    int w = (int32_t)le32(&bmp[18]);
+    int h = (int32_t)le32(&bmp[22]);
+    bool topDown = h < 0;
+    if (topDown)
+        h = -h;
+    if (bmp[28] != 24 || w <= 0 || h <= 0)
+        return false;
+    size_t rowSize = ((size_t)w * 3 + 3) / 4 * 4;
+    if (offset + rowSize * h > bmp.size())
+        return false;
+
+    f.w = w;
+    f.h = h;
+    f.rgb565 = true;
+    f.data.resize((size_t)w * h * 2);
+    for (int y = 0; y < h; y++)
+    {
+        const uint8_t *row = &bmp[offset + rowSize * (topDown ? y : h - 1 - y)];
+        for (int x = 0; x < w; x++)
+        {
+            uint32_t r5 = (row[x * 3 + 2] * 31 + 127) / 255;
+            uint32_t g6 = (row[x * 3 + 1] * 63 + 127) / 255;
+            uint32_t b5 = (row[x * 3] * 31 + 127) / 255;
+            uint16_t px = (r5 << 11) | (g6 << 5) | b5;
+            f.data[((size_t)y * w + x) * 2] = px & 0xFF;
+            f.data[((size_t)y * w + x) * 2 + 1] = px >> 8;
+        }
+    }
+    return true;
+}
+
+static bool loadFrame(const fs::path &p, const ReplayOptions &o, ReplayFrame &f, std::string &err)
+{
+    std::vector<uint8_t> raw;
+    if (!readFile(p, raw))
+    {
+        err = "cannot read";
+        return false;
+    }
+    std::string ext = lower(p.extension().string());
+    if (ext == ".jpg" || ext == ".jpeg")
+    {
+        f.jpeg = true;
+        f.data = std::move(raw); // didecode di dalam pengukuran waktu convert
+        return true;
+    }
+    if (ext == ".bmp")
+    {
+        if (!bmpToRgb565(raw, f))
+        {
+            err = "unsupported BMP (24-bit only)";
+            return false;
+        }
+        return true;
+    }
+    // RGB565 mentah: ukuran dari --size, atau pola _WxH di nama file
+    int w = o.rawW, h = o.rawH;
+    std::string stem = p.stem().string();
+    size_t us = stem.rfind('_');
+    if (us != std::string::npos)
+        parseSize(stem.substr(us + 1), w, h);
+    if (w <= 0 || (size_t)w * h * 2 != raw.size())
+    {
+        err = "raw RGB565 size unknown or does not match --size";
+        return false;
+    }
+    f.w = w;
+    f.h = h;
+    f.rgb565 = true;
+    f.data = std::move(raw);
+    return true;
+}
+
+// Ground truth: nama file (tanpa folder) -> jumlah objek
+static bool loadTruth(const std::string &path, std::map<std::string, int> &truth)
+{
+    std::ifstream f(path);
+    if (!f)
+        return false;
+    std::string line;
+    while (std::getline(f, line))
+    {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (line.empty() || line[0] == '#')
+            continue;
+        size_t comma = line.find(',');
+        if (comma == std::string::npos)
+            continue;
+        std::string name = line.substr(0, comma);
+        const char *val = line.c_str() + comma + 1;
+        char *end;
+        long count = strtol(val, &end, 10);
+        if (end == val)
+            continue; // baris header
+        truth[fs::path(name).filename().string()] = (int)count;
+    }
+    return true;
+}
+
+// Sampel classifier: format sama dengan /classifier/samples.csv di SD
+static bool loadClasses(const std::string &path, ClassModel &model)
+{
+    std::ifstream f(path);
+    if (!f)
+        return false;
+    std::string line;
+    char name[CLS_NAME_LEN];
+    CclBlob b;
+    clsReset();
+    while (std::getline(f, line))
+        if (clsParseSample(line.c_str(), name, b))
+            clsAddSample(name, b);
+    clsPublish();
+    uint32_t seen = 0;
+    clsReadModel(model, seen);
+    return true;
+}
+
+static ClassModel replayModel;
+
+typedef std::chrono::steady_clock ReplayClock;
+
+static inline double elapsedUs(ReplayClock::time_point t0)
+{
+    return std::chrono::duration<double, std::micro>(ReplayClock::now() - t0).count();
+}
+
+// Satu frame lewat algoritma, mengikuti tahap convert / label di count_pipeline.h
+// masing-masing sketch. Decode JPEG diukur terpisah (0 untuk frame non-JPEG).
+// Return jumlah objek, -1 jika gagal. Untuk rle, labelled (jika ada) menerima
+// mask/gray yang dilabel, untuk perbandingan --bfs.
+static int runFrame(const ReplayOptions &o, const ReplayFrame &f, std::vector<uint8_t> &gray,
+                    std::vector<uint8_t> &mask, double &decodeUs, double &convertUs, double &labelUs,
+                    uint16_t *classCounts, CountFrame *labelled)
+{
+    static uint32_t hist[256];
+    static Blob rleBlobs[REPLAY_MAX_BLOBS];
+    static CclBlob cclBlobs[REPLAY_MAX_BLOBS];
+
+    auto t0 = ReplayClock::now();
+    int w = f.w, h = f.h;
+    bool haveHist = false;
+    if (f.jpeg)
+    {
+        memset(hist, 0, sizeof(hist));
+        if (!jpegGrayDecode(f.data.data(), f.data.size(), o.scale, gray.data(), (int)gray.size(), w, h, hist))
+            return -1;
+        haveHist = true;
+    }
+    decodeUs = f.jpeg ? elapsedUs(t0) : 0;
+    t0 = ReplayClock::now();
+
+    if (o.algo == ALGO_RLE)
+    {
+        CountFrameParams p = {o.threshMode, o.threshold, o.adaptRadius, o.adaptOffset, o.minArea, o.maxArea, o.splitMode};
+        CountFrame cf = {};
+        if (f.rgb565)
+        {
+            cf.mask = mask.data();
+            countFrameConvert(f.data.data(), (size_t)w * 2, w, h, p, hist, cf);
+            countFrameThreshold(p, hist, cf);
+        }
+        else
+        {
+            // JPEG: gray sudah ada, threshold langsung (gray < threshold seperti mask)
+            cf.mask = gray.data();
+            cf.w = w;
+            cf.h = h;
+            cf.threshMode = o.threshMode;
+            cf.threshold = o.threshold;
+            cf.isMask = false;
+            if (o.threshMode != THRESH_MANUAL)
+                countFrameThreshold(p, hist, cf);
+        }
+        convertUs = elapsedUs(t0);
+        t0 = ReplayClock::now();
+        BlobSplitStats split;
+        int n = countFrameLabel(cf, p, rleBlobs, REPLAY_MAX_BLOBS, split);
+        labelUs = elapsedUs(t0);
+        if (labelled)
+            *labelled = cf;
+        return n;
+    }
+
+    if (f.rgb565)
+    {
+        memset(hist, 0, sizeof(hist));
+        rgb565ToGrayHist(f.data.data(), gray.data(), w * h, hist);
+        haveHist = true;
+    }
+    int threshold = o.threshold;
+    const uint8_t *src = gray.data();
+    if (o.threshMode != THRESH_MANUAL && haveHist)
+    {
+        int t = otsuThreshold(hist);
+        threshold = t < 0 ? o.threshold : t;
+    }
+    if (o.threshMode == THRESH_ADAPTIVE &&
+        adaptiveThresholdMask(gray.data(), w, h, o.adaptRadius, o.adaptOffset, false, mask.data(), 255))
+    {
+        src = mask.data();
+        threshold = 127;
+    }
+    convertUs = elapsedUs(t0);
+    t0 = ReplayClock::now();
+    CountObjectsParams p = {o.minArea, o.maxArea, o.smart, o.aspectTolerance};
+    int stored;
+    int n = countObjectsSmart(src, w, h, threshold, p, cclBlobs, std::min(o.maxObjects, REPLAY_MAX_BLOBS), stored);
+    if (replayModel.classes > 0)
+    {
+        clsCountBlobs(replayModel, cclBlobs, stored, classCounts);
+        classCounts[CLS_UNKNOWN] += n - stored;
+    }
+    labelUs = elapsedUs(t0);
+    return n;
+}
+
+static double percentile(std::vector<double> v, double pct)
+{
+    if (v.empty())
+        return 0;
+    std::sort(v.begin(), v.end());
+    size_t i = (size_t)(pct / 100.0 * (v.size() - 1) + 0.5);
+    return v[i];
+}
+
+static bool blobLess(const Blob &a, const Blob &b)
+{
+    return std::tie(a.miny, a.minx, a.maxy, a.maxx, a.area) < std::tie(b.miny, b.minx, b.maxy, b.maxx, b.area);
+}
+
+// Label run-length (tanpa split) vs BFS lama pada buffer yang sama, median --repeat.
+// Blob dibandingkan sebagai himpunan: urutan keluaran bukan bagian kontrak.
+static BfsCompare compareWithBfs(const ReplayOptions &o, const CountFrame &cf)
+{
+    static std::vector<Blob> rle;
+    rle.resize(o.maxRuns); // jumlah blob tidak pernah melebihi jumlah run
+    std::vector<Blob> bfs;
+    std::vector<double> rleUs, bfsUs;
+    BfsCompare c = {};
+    for (int r = 0; r < o.repeat; r++)
+    {
+        auto t0 = ReplayClock::now();
+        c.rleCount = cf.isMask ? detect_blobs_mask(cf.mask, cf.w, cf.h, o.minArea, o.maxArea, rle.data(), (int)rle.size())
+                               : detect_blobs(cf.mask, cf.w, cf.h, cf.threshold, o.minArea, o.maxArea, rle.data(), (int)rle.size());
+        rleUs.push_back(elapsedUs(t0));
+
+        t0 = ReplayClock::now();
+        int t = cf.threshold;
+        if (cf.isMask)
+            bfs = bfsDetectBlobs(cf.mask, cf.w, cf.h, [](uint8_t v)
+                                 { return v != 0; }, o.minArea, o.maxArea);
+        else
+            bfs = bfsDetectBlobs(cf.mask, cf.w, cf.h, [t](uint8_t v)
+                                 { return v < t; }, o.minArea, o.maxArea);
+        bfsUs.push_back(elapsedUs(t0));
+    }
+    c.rleUs = percentile(rleUs, 50);
+    c.bfsUs = percentile(bfsUs, 50);
+    c.bfsCount = (int)bfs.size();
+    c.equal = !rleOverflow && c.rleCount == c.bfsCount;
+    if (c.equal)
+    {
+        std::sort(rle.begin(), rle.begin() + c.rleCount, blobLess);
+        std::sort(bfs.begin(), bfs.end(), blobLess);
+        c.equal = std::equal(bfs.begin(), bfs.end(), rle.begin(), [](const Blob &a, const Blob &b)
+                             { return a.area == b.area && a.minx == b.minx && a.miny == b.miny && a.maxx == b.maxx && a.maxy == b.maxy; });
+    }
+    return c;
+}
+
+static void printTiming(const char *stage, const std::vector<double> &us)
+{
+    double sum = 0;
+    for (double u : us)
+        sum += u;
+    printf("  %-8s mean %8.1f us  p50 %8.1f  p95 %8.1f  max %8.1f\n", stage,
+           us.empty() ? 0 : sum / us.size(), percentile(us, 50), percentile(us, 95), percentile(us, 100));
+}
+
+static const int replayScales[] = {JPEG_GRAY_SCALE_2, JPEG_GRAY_SCALE_4, JPEG_GRAY_SCALE_8};
+#define REPLAY_SCALES ((int)(sizeof(replayScales) / sizeof(replayScales[0])))
+
+// --scale all: decode saja, setiap JPEG pada tiap skala (median --repeat), ms/frame per skala
+static int runScaleSweep(const ReplayOptions &o, std::vector<ReplayInput> &inputs, std::vector<uint8_t> &gray)
+{
+    static uint32_t hist[256];
+    std::vector<double> decodeUs[REPLAY_SCALES];
+    int outW[REPLAY_SCALES] = {0}, outH[REPLAY_SCALES] = {0};
+    int errors = 0, skipped = 0;
+    for (auto &in : inputs)
+    {
+        ReplayFrame &f = in.frame;
+        std::string err;
+        if (!loadFrame(in.path, o, f, err))
+        {
+            fprintf(stderr, "%s: %s\n", in.name.c_str(), err.c_str());
+            errors++;
+            continue;
+        }
+        if (!f.jpeg)
+        {
+            skipped++;
+            continue;
+        }
+        double us[REPLAY_SCALES];
+        int w = 0, h = 0;
+        bool ok = true;
+        for (int s = 0; s < REPLAY_SCALES && ok; s++)
+        {
+            std::vector<double> runs;
+            for (int r = 0; r < o.repeat && ok; r++)
+            {
+                memset(hist, 0, sizeof(hist));
+                auto t0 = ReplayClock::now();
+                ok = jpegGrayDecode(f.data.data(), f.data.size(), replayScales[s], gray.data(), (int)gray.size(), w, h, hist);
+                runs.push_back(elapsedUs(t0));
+            }
+            us[s] = percentile(runs, 50);
+            outW[s] = w;
+            outH[s] = h;
+        }
+        if (!ok)
+        {
+            fprintf(stderr, "%s: decode failed\n", in.name.c_str());
+            errors++;
+            continue;
+        }
+        for (int s = 0; s < REPLAY_SCALES; s++)
+            decodeUs[s].push_back(us[s]);
+        if (!o.quiet)
+        {
+            printf("%-40s", in.name.c_str());
+            for (int s = 0; s < REPLAY_SCALES; s++)
+                printf("  1/%d %4dx%-4d %7.3f ms", replayScales[s], outW[s], outH[s], us[s] / 1000);
+            printf("\n");
+        }
+    }
+
+    printf("\n%zu JPEG frames decoded at each scale, %d non-JPEG skipped, %d errors\n", decodeUs[0].size(), skipped,
+           errors);
+    for (int s = 0; s < REPLAY_SCALES && !decodeUs[s].empty(); s++)
+    {
+        double sum = 0;
+        for (double u : decodeUs[s])
+            sum += u;
+        double mean = sum / decodeUs[s].size();
+        printf("  1/%d  mean %7.3f ms/frame  p50 %7.3f  p95 %7.3f  max %7.3f  (%.1f frames/s, last %dx%d)\n",
+               replayScales[s], mean / 1000, percentile(decodeUs[s], 50) / 1000, percentile(decodeUs[s], 95) / 1000,
+               percentile(decodeUs[s], 100) / 1000, 1e6 / mean, outW[s], outH[s]);
+    }
+    return errors > 0 || decodeUs[0].empty() ? 2 : 0;
+}
+
+int main(int argc, char **argv)
+{
+    ReplayOptions o;
+    if (!parseArgs(argc, argv, o))
+    {
+        usage();
+        return 2;
+    }
+
+    std::map<std::string, int> truth;
+    if (!o.truth.empty() && !loadTruth(o.truth, truth))
+    {
+        fprintf(stderr, "%s: cannot read ground truth\n", o.truth.c_str());
+        return 2;
+    }
+
+    std::vector<ReplayInput> inputs;
+    if (o.synthKind >= 0)
+    {
+        // Scene sintetis: ground truth = jumlah objek yang ditempatkan
+        std::mt19937 rng(o.seed);
+        for (int k = 0; k < SYNTH_KINDS; k++)
+        {
+            if (o.synthKind != SYNTH_KINDS && o.synthKind != k)
+                continue;
+            for (int i = 0; i < o.synthCount; i++)
+            {
+                ReplayInput in;
+                char name[48];
+                snprintf(name, sizeof(name), "synth_%s_%03d_%dx%d", synthKindNames[k], i, o.rawW, o.rawH);
+                in.name = name;
+                in.synth = true;
+                in.frame.w = o.rawW;
+                in.frame.h = o.rawH;
+                in.frame.rgb565 = true;
+                truth[in.name] = synthScene(k, o.rawW, o.rawH, o.algo == ALGO_CCL, rng, in.frame.data);
+                inputs.push_back(std::move(in));
+            }
+        }
+    }
+    else
+    {
+        std::vector<fs::path> files;
+        std::error_code ec;
+        for (const auto &e : fs::directory_iterator(o.dir, ec))
+        {
+            std::string ext = lower(e.path().extension().string());
+            if (e.is_regular_file() && (ext == ".jpg" || ext == ".jpeg" || ext == ".bmp" || ext == ".rgb565" || ext == ".raw"))
+                files.push_back(e.path());
+        }
+        if (ec)
+        {
+            fprintf(stderr, "%s: %s\n", o.dir.c_str(), ec.message().c_str());
+            return 2;
+        }
+        std::sort(files.begin(), files.end());
+        for (const auto &path : files)
+        {
+            ReplayInput in;
+            in.name = path.filename().string();
+            in.path = path;
+            inputs.push_back(std::move(in));
+        }
+    }
+
+    // Scratch dialokasikan sekali seperti di setup() sketch
+    if (!blobRleInit(o.maxRuns) || !cclInit(REPLAY_MAX_W, o.maxLabels) ||
+        !adaptiveThresholdInit(REPLAY_MAX_W, REPLAY_MAX_H) || !blobSplitInit(REPLAY_SPLIT_W, REPLAY_SPLIT_H))
+    {
+        fprintf(stderr, "out of memory\n");
+        return 2;
+    }
+    if (!o.classes.empty())
+    {
+        if (!cclEnableShape() || !loadClasses(o.classes, replayModel))
+        {
+            fprintf(stderr, "%s: cannot load classifier samples\n", o.classes.c_str());
+            return 2;
+        }
+        for (int c = 0; c < replayModel.classes; c++)
+            fprintf(stderr, "class %-15s %u samples\n", replayModel.names[c], (unsigned)replayModel.samples[c]);
+    }
+    std::vector<uint8_t> gray((size_t)REPLAY_MAX_W * REPLAY_MAX_H);
+    std::vector<uint8_t> mask(gray.size());
+    if (o.scaleSweep)
+        return runScaleSweep(o, inputs, gray);
+
+    std::vector<FrameResult> results;
+    std::vector<double> decodeUs, convertUs, labelUs, totalUs, rleUs, bfsUs;
+    int errors = 0, bfsCompared = 0, bfsEqual = 0;
+    for (auto &in : inputs)
+    {
+        const std::string &name = in.name;
+        ReplayFrame &f = in.frame;
+        std::string err;
+        if (!in.synth && !loadFrame(in.path, o, f, err))
+        {
+            fprintf(stderr, "%s: %s\n", name.c_str(), err.c_str());
+            errors++;
+            continue;
+        }
+        if (!f.jpeg && (f.w > REPLAY_MAX_W || f.h > REPLAY_MAX_H))
+        {
+            fprintf(stderr, "%s: %dx%d larger than %dx%d\n", name.c_str(), f.w, f.h, REPLAY_MAX_W, REPLAY_MAX_H);
+            errors++;
+            continue;
+        }
+
+        // Waktu per frame = median dari --repeat kali, supaya noise scheduler PC tidak ikut
+        std::vector<double> dv, cv, lv;
+        uint16_t classCounts[CLS_MAX + 1] = {0};
+        int count = -1;
+        CountFrame labelled = {};
+        for (int r = 0; r < o.repeat; r++)
+        {
+            double d, c, l;
+            count = runFrame(o, f, gray, mask, d, c, l, classCounts, o.compareBfs ? &labelled : nullptr);
+            if (count < 0)
+                break;
+            dv.push_back(d);
+            cv.push_back(c);
+            lv.push_back(l);
+        }
+        if (count < 0)
+        {
+            fprintf(stderr, "%s: decode/label failed\n", name.c_str());
+            errors++;
+            continue;
+        }
+
+        FrameResult fr = {name, count, -1, {0}, percentile(dv, 50), percentile(cv, 50), percentile(lv, 50), o.compareBfs, {}};
+        memcpy(fr.classCounts, classCounts, sizeof(classCounts));
+        if (fr.compared)
+        {
+            fr.bfs = compareWithBfs(o, labelled);
+            bfsCompared++;
+            bfsEqual += fr.bfs.equal;
+            rleUs.push_back(fr.bfs.rleUs);
+            bfsUs.push_back(fr.bfs.bfsUs);
+        }
+        auto it = truth.find(name);
+        if (it != truth.end())
+            fr.expected = it->second;
+        results.push_back(fr);
+        if (f.jpeg)
+            decodeUs.push_back(fr.decodeUs);
+        convertUs.push_back(fr.convertUs);
+        labelUs.push_back(fr.labelUs);
+        totalUs.push_back(fr.decodeUs + fr.convertUs + fr.labelUs);
+
+        bool miss = fr.expected >= 0 && abs(fr.count - fr.expected) > o.tolerance;
+        if (!o.quiet || miss || (fr.compared && !fr.bfs.equal))
+        {
+            char exp[16] = "-";
+            if (fr.expected >= 0)
+                snprintf(exp, sizeof(exp), "%d", fr.expected);
+            printf("%-40s count %4d  expected %4s  %-4s", name.c_str(), fr.count, exp,
+                   fr.expected < 0 ? "" : (miss ? "FAIL" : "ok"));
+            if (f.jpeg)
+                printf("  decode %8.1f us", fr.decodeUs);
+            printf("  convert %8.1f us  label %8.1f us", fr.convertUs, fr.labelUs);
+            for (int c = 0; c < replayModel.classes; c++)
+                printf("  %s=%u", replayModel.names[c], (unsigned)fr.classCounts[c]);
+            if (replayModel.classes > 0)
+                printf("  unknown=%u", (unsigned)fr.classCounts[CLS_UNKNOWN]);
+            if (fr.compared)
+                printf("  | rle %7.1f us  bfs %7.1f us  blobs %s", fr.bfs.rleUs, fr.bfs.bfsUs,
+                       fr.bfs.equal ? "same" : "DIFF");
+            if (fr.compared && !fr.bfs.equal)
+                printf(" (rle %d, bfs %d%s)", fr.bfs.rleCount, fr.bfs.bfsCount, rleOverflow ? ", run overflow" : "");
+            printf("\n");
+        }
+    }
+
+    // Ringkasan akurasi
+    int labelled = 0, exact = 0, within = 0;
+    long absErr = 0;
+    for (const auto &r : results)
+    {
+        if (r.expected < 0)
+            continue;
+        int d = abs(r.count - r.expected);
+        labelled++;
+        exact += d == 0;
+        within += d <= o.tolerance;
+        absErr += d;
+    }
+    for (const auto &t : truth)
+    {
+        bool found = std::any_of(results.begin(), results.end(), [&](const FrameResult &r)
+                                 { return r.name == t.first; });
+        if (!found)
+            fprintf(stderr, "warning: %s is in the ground truth but was not replayed\n", t.first.c_str());
+    }
+
+    printf("\n%zu frames replayed (%s, thresh %s, split %s), %d errors\n", results.size(),
+           o.algo == ALGO_RLE ? "rle" : "ccl", threshModeName(o.threshMode), splitModeName(o.splitMode), errors);
+    if (!results.empty())
+    {
+        if (!decodeUs.empty())
+            printTiming("decode", decodeUs);
+        printTiming("convert", convertUs);
+        printTiming("label", labelUs);
+        printTiming("total", totalUs);
+        double sum = 0;
+        for (double u : totalUs)
+            sum += u;
+        printf("  throughput %.1f frames/s\n", results.size() * 1e6 / sum);
+    }
+    if (bfsCompared > 0)
+    {
+        double rleSum = 0, bfsSum = 0;
+        for (size_t i = 0; i < rleUs.size(); i++)
+        {
+            rleSum += rleUs[i];
+            bfsSum += bfsUs[i];
+        }
+        printf("labeling only, run-length vs old BFS (same mask):\n");
+        printTiming("rle", rleUs);
+        printTiming("bfs", bfsUs);
+        printf("  speedup %.2fx, blobs identical in %d/%d frames\n", rleSum > 0 ? bfsSum / rleSum : 0.0, bfsEqual,
+               bfsCompared);
+    }
+    if (labelled > 0)
+        printf("accuracy: %d/%d exact (%.1f%%), %d/%d within +-%d, mean abs error %.3f\n", exact, labelled,
+               100.0 * exact / labelled, within, labelled, o.tolerance, (double)absErr / labelled);
+
+    if (errors > 0)
+        return 2;
+    return within == labelled && bfsEqual == bfsCompared ? 0 : 1;
+}
@@ -0,0 +1,174 @@
+// synth_scenes.h - Generator frame RGB565 sintetis untuk count_replay
+// Objek gelap di atas latar terang, seperti meja hitung Alat_Hitung (bright = true
+// membalik kecerahan untuk ccl, yang menghitung objek terang di latar gelap):
+//   nut       : mur heksagonal dengan lubang bulat (blob berlubang)
+//   connector : badan persegi dengan deretan pin tipis di satu sisi
+//   cable-tie : strip panjang tipis dengan sudut acak dan kepala persegi
+// Objek tidak saling menempel (jarak minimal SYNTH_GAP piksel), jadi jumlah
+// objek yang ditempatkan adalah ground truth frame itu. Ukuran objek diskalakan
+// dari tinggi/lebar frame terhadap 160x120 (profil count di device).
+#ifndef SYNTH_SCENES_H
+#define SYNTH_SCENES_H
+
+#include <math.h>
+#include <stdint.h>
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#define SYNTH_BG 200   // latar terang
+#define SYNTH_FG 40    // objek gelap, jauh di bawah threshold default 70
+#define SYNTH_NOISE 12 // noise +- per piksel
+#define SYNTH_GAP 3
+#define SYNTH_ATTEMPTS 200
+
+enum SynthKind
+{
+    SYNTH_NUT,
+    SYNTH_CONNECTOR,
+    SYNTH_CABLE_TIE,
+    SYNTH_KINDS
+};
+
+static const char *const synthKindNames[SYNTH_KINDS] = {"nut", "connector", "cable-tie"};
+
+// -1 = tidak dikenal, SYNTH_KINDS = semua jenis
+static int synthKindFromName(const std::string &s)
+{
+    if (s == "all")
+        return SYNTH_KINDS;
+    for (int k = 0; k < SYNTH_KINDS; k++)
+        if (s == synthKindNames[k])
+            return k;
+    return -1;
+}
+
+// Satu objek: pusat, jari-jari pembatas (untuk cek tumpang tindih) dan bentuk
+struct SynthShape
+{
+    int kind;
+    float cx, cy, radius;
+    float angle;
+    float a, b;  // nut: jari-jari luar/lubang; connector: setengah lebar/tinggi badan; cable-tie: setengah panjang/lebar
+    int pins;    // connector
+    float pinLen; // connector
+};
+
+static bool synthInside(const SynthShape &s, float x, float y)
+{
+    float dx = x - s.cx, dy = y - s.cy;
+    float c = cosf(s.angle), sn = sinf(s.angle);
+    float u = dx * c + dy * sn; // sumbu bentuk
+    float v = -dx * sn + dy * c;
+    const float r3 = 0.8660254f;
+    switch (s.kind)
+    {
+    case SYNTH_NUT:
+        if (u * u + v * v < s.b * s.b)
+            return false; // lubang
+        return fabsf(v) <= r3 * s.a && r3 * fabsf(u) + 0.5f * fabsf(v) <= r3 * s.a;
+    case SYNTH_CONNECTOR:
+    {
+        if (fabsf(u) <= s.a && fabsf(v) <= s.b)
+            return true;
+        // Pin lebar 2 piksel di bawah badan, jarak antar pin rata sepanjang badan
+        if (v <= s.b || v > s.b + s.pinLen)
+            return false;
+        float pitch = 2 * s.a / s.pins;
+        float k = (u + s.a) / pitch;
+        float frac = k - floorf(k);
+        return k >= 0 && k < s.pins && fabsf(frac - 0.5f) * pitch <= 1.0f;
+    }
+    default:
+    {
+        // Strip sepanjang u, kepala persegi 2.5x lebar di ujung +u
+        if (fabsf(u) <= s.a && fabsf(v) <= s.b)
+            return true;
+        float head = s.b * 2.5f;
+        return u >= s.a - head && u <= s.a + head * 0.5f && fabsf(v) <= head;
+    }
+    }
+}
+
+static SynthShape synthRandomShape(int kind, float scale, std::mt19937 &rng)
+{
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    SynthShape s = {};
+    s.kind = kind;
+    s.angle = unit(rng) * 6.2831853f;
+    switch (kind)
+    {
+    case SYNTH_NUT:
+        s.a = (5.5f + unit(rng) * 4.0f) * scale;
+        s.b = s.a * 0.45f;
+        s.radius = s.a;
+        break;
+    case SYNTH_CONNECTOR:
+        s.angle = (rng() % 4) * 1.5707963f; // konektor di tray: sejajar sumbu
+        s.a = (7.0f + unit(rng) * 6.0f) * scale;
+        s.b = (3.0f + unit(rng) * 2.0f) * scale;
+        s.pins = 3 + rng() % 6;
+        s.pinLen = (2.0f + unit(rng) * 2.0f) * scale;
+        s.radius = sqrtf(s.a * s.a + (s.b + s.pinLen) * (s.b + s.pinLen));
+        break;
+    default:
+        s.a = (15.0f + unit(rng) * 15.0f) * scale;
+        s.b = std::max(1.5f, 1.5f * scale); // lebar >= 3 piksel: tetap tersambung 4 arah
+        s.radius = s.a + s.b * 2.5f * 1.5f;
+        break;
+    }
+    return s;
+}
+
+// Isi frame (w*h*2 byte RGB565 little-endian) dengan satu jenis objek.
+// Return jumlah objek yang berhasil ditempatkan.
+static int synthScene(int kind, int w, int h, bool bright, std::mt19937 &rng, std::vector<uint8_t> &rgb565)
+{
+    float scale = std::min(w / 160.0f, h / 120.0f);
+    int wanted = kind == SYNTH_NUT ? 4 + rng() % 9 : kind == SYNTH_CONNECTOR ? 2 + rng() % 5 : 2 + rng() % 4;
+    std::vector<SynthShape> placed;
+    for (int i = 0; i < wanted; i++)
+    {
+        SynthShape s = synthRandomShape(kind, scale, rng);
+        for (int t = 0; t < SYNTH_ATTEMPTS; t++)
+        {
+            std::uniform_real_distribution<float> px(s.radius + 1, w - s.radius - 2), py(s.radius + 1, h - s.radius - 2);
+            if (w - 2 * s.radius < 4 || h - 2 * s.radius < 4)
+                break; // objek lebih besar dari frame
+            s.cx = px(rng);
+            s.cy = py(rng);
+            bool clear = std::none_of(placed.begin(), placed.end(), [&](const SynthShape &o)
+                                      { return hypotf(o.cx - s.cx, o.cy - s.cy) < o.radius + s.radius + SYNTH_GAP; });
+            if (clear)
+            {
+                placed.push_back(s);
+                break;
+            }
+        }
+    }
+
+    rgb565.resize((size_t)w * h * 2);
+    std::uniform_int_distribution<int> noise(-SYNTH_NOISE, SYNTH_NOISE);
+    for (int y = 0; y < h; y++)
+    {
+        for (int x = 0; x < w; x++)
+        {
+            bool fg = false;
+            for (const SynthShape &s : placed)
+                if (fabsf(x - s.cx) <= s.radius + 1 && fabsf(y - s.cy) <= s.radius + 1 && synthInside(s, x + 0.5f, y + 0.5f))
+                {
+                    fg = true;
+                    break;
+                }
+            int level = fg != bright ? SYNTH_FG : SYNTH_BG;
+            int g = std::min(255, std::max(0, level + noise(rng)));
+            uint16_t px = ((g * 31 / 255) << 11) | ((g * 63 / 255) << 5) | (g * 31 / 255);
+            rgb565[((size_t)y * w + x) * 2] = px & 0xFF;
+            rgb565[((size_t)y * w + x) * 2 + 1] = px >> 8;
+        }
+    }
+    return (int)placed.size();
+}
+
+#endif
@@ -0,0 +1,348 @@
+// jpeg_encoder_test.cpp - Uji round-trip dan benchmark jpeg_encoder.h di PC
+// jpeg_encoder.h dan jpeg_gray.h di-include langsung dari folder sketch
+// esp32_kamera_cek_warna_hitam_putih (sketch lain memakai salinan yang sama).
+//
+// Round-trip: scene sintetis (gradien + kotak dan lingkaran tajam) untuk setiap
+// format (gray, RGB565 urutan sensor, RGB888), ukuran genap dan ganjil, dan
+// beberapa kualitas di-encode, lalu didekode lagi dengan jpegGrayDecode() skala
+// 1/2. Luminance hasil decode dibandingkan dengan rata-rata 2x2 luminance sumber
+// (PSNR minimal per kualitas). Untuk format warna, DC blok Cb/Cr dibaca dengan
+// jpegGrayDecodeBlock() dan dibandingkan dengan rata-rata 16x16 sumber; selisih
+// maksimal setengah langkah kuantisasi DC + 1. Setiap panggilan callback harus berurutan
+// (index = jumlah byte sebelumnya) dan file harus diawali SOI, diakhiri EOI.
+// Kasus sink menolak chunk ke-k: jpegEncode() harus false dan sink tidak
+// dipanggil lagi.
+//
+// Benchmark: ms/frame per format pada 160x120 (profil count / overlay) dan 640x480.
+// Exit code: 0 semua lolos, 1 ada yang gagal, 2 argumen salah.
+//
+// Build (Linux, g++ >= 8):
+//   g++ -O2 -std=c++17 -o jpeg_encoder_test jpeg_encoder_test.cpp
+// Pemakaian:
+//   ./jpeg_encoder_test
+//   ./jpeg_encoder_test --out /tmp/jpg --repeat 50   (simpan hasil untuk dilihat di browser)
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../../esp32_kamera_cek_warna_hitam_putih/jpeg_encoder.h"
+#include "../../esp32_kamera_cek_warna_hitam_putih/jpeg_gray.h"
+
+static const char *const formatNames[3] = {"gray", "rgb565", "rgb888"};
+
+struct CollectSink
+{
+    std::vector<uint8_t> data;
+    int calls = 0;
+    int rejectAt = -1;   // panggilan ke-k ditolak, -1 = tidak pernah
+    bool ordered = true; // index selalu = jumlah byte sebelumnya
+    bool calledAfterReject = false;
+};
+
+static size_t collectOut(void *arg, size_t index, const void *data, size_t len)
+{
+    CollectSink *s = (CollectSink *)arg;
+    if (s->rejectAt >= 0 && s->calls > s->rejectAt)
+        s->calledAfterReject = true;
+    if (s->calls++ == s->rejectAt)
+        return 0;
+    if (index != s->data.size())
+        s->ordered = false;
+    s->data.insert(s->data.end(), (const uint8_t *)data, (const uint8_t *)data + len);
+    return len;
+}
+
+// Scene RGB: gradien halus + objek tajam, seperti tray dengan part
+static void makeScene(int w, int h, std::mt19937 &rng, std::vector<uint8_t> &rgb)
+{
+    rgb.resize((size_t)w * h * 3);
+    std::uniform_int_distribution<int> pos(0, std::max(w, h)), col(0, 255);
+    struct Shape
+    {
+        int x, y, r, c[3];
+        bool circle;
+    };
+    std::vector<Shape> shapes;
+    for (int i = 0; i < 6; i++)
+        shapes.push_back({pos(rng) % w, pos(rng) % h, 2 + pos(rng) % std::max(3, w / 6), {col(rng), col(rng), col(rng)}, i % 2 == 0});
+    for (int y = 0; y < h; y++)
+    {
+        for (int x = 0; x < w; x++)
+        {
+            uint8_t *p = &rgb[((size_t)y * w + x) * 3];
+            p[0] = (uint8_t)(40 + 160 * x / std::max(1, w - 1));
+            p[1] = (uint8_t)(60 + 120 * y / std::max(1, h - 1));
+            p[2] = (uint8_t)(128 + 60 * sin(x * 0.05) * cos(y * 0.07));
+            for (const Shape &s : shapes)
+            {
+                int dx = x - s.x, dy = y - s.y;
+                bool in = s.circle ? dx * dx + dy * dy <= s.r * s.r : abs(dx) <= s.r && abs(dy) <= s.r / 2;
+                if (in)
+                    for (int c = 0; c < 3; c++)
+                        p[c] = (uint8_t)s.c[c];
+            }
+        }
+    }
+}
+
+// Buffer input format fmt dan luminance referensi dari piksel yang benar-benar dilihat encoder
+static void toFormat(const std::vector<uint8_t> &rgb, int w, int h, JpegEncFormat fmt,
+                     std::vector<uint8_t> &src, std::vector<float> &luma, std::vector<float> chroma[2])
+{
+    size_t n = (size_t)w * h;
+    src.resize(n * (fmt == JPEG_ENC_RGB565 ? 2 : fmt == JPEG_ENC_RGB888 ? 3 : 1));
+    luma.resize(n);
+    chroma[0].resize(n);
+    chroma[1].resize(n);
+    for (size_t i = 0; i < n; i++)
+    {
+        int r = rgb[i * 3], g = rgb[i * 3 + 1], b = rgb[i * 3 + 2];
+        if (fmt == JPEG_ENC_GRAY)
+        {
+            src[i] = (uint8_t)(0.299f * r + 0.587f * g + 0.114f * b + 0.5f);
+            luma[i] = src[i];
+            continue;
+        }
+        if (fmt == JPEG_ENC_RGB565)
+        {
+            uint16_t c = (uint16_t)(((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3));
+            src[i * 2] = c >> 8;
+            src[i * 2 + 1] = c & 0xFF;
+            r &= 0xF8;
+            g &= 0xFC;
+            b &= 0xF8;
+        }
+        else
+        {
+            src[i * 3] = (uint8_t)r;
+            src[i * 3 + 1] = (uint8_t)g;
+            src[i * 3 + 2] = (uint8_t)b;
+        }
+        luma[i] = 0.299f * r + 0.587f * g + 0.114f * b;
+        chroma[0][i] = -0.168736f * r - 0.331264f * g + 0.5f * b + 128;
+        chroma[1][i] = 0.5f * r - 0.418688f * g - 0.081312f * b + 128;
+    }
+}
+
+// PSNR decode skala 1/2 terhadap rata-rata 2x2 sumber (tepi diulang seperti encoder)
+static double halfScalePsnr(const std::vector<float> &luma, int w, int h, const uint8_t *dec, int dw, int dh)
+{
+    double se = 0;
+    for (int y = 0; y < dh; y++)
+    {
+        for (int x = 0; x < dw; x++)
+        {
+            float sum = 0;
+            for (int k = 0; k < 4; k++)
+            {
+                int sx = std::min(w - 1, x * 2 + (k & 1)), sy = std::min(h - 1, y * 2 + (k >> 1));
+                sum += luma[(size_t)sy * w + sx];
+            }
+            double d = dec[(size_t)y * dw + x] - sum / 4;
+            se += d * d;
+        }
+    }
+    double mse = se / ((double)dw * dh);
+    return mse < 1e-9 ? 99.0 : 10 * log10(255.0 * 255.0 / mse);
+}
+
+// Selisih terbesar DC Cb/Cr per MCU 16x16 terhadap rata-rata sumber, dibagi batas
+// (setengah langkah kuantisasi DC + 1); > 1 berarti gagal, < 0 berarti scan rusak
+static double chromaDcError(const std::vector<uint8_t> &jpg, const std::vector<float> chroma[2], int w, int h)
+{
+    static JpegGrayDecoder d; // tabel Huffman besar, jangan di stack
+    memset(&d, 0, sizeof(d));
+    d.data = jpg.data();
+    d.len = jpg.size();
+    if (!jpegGrayParseHeaders(d) || d.ncomp != 3 || d.compH[0] != 2 || d.compV[0] != 2)
+        return -1;
+    int pred[3] = {0, 0, 0};
+    int32_t coef[64];
+    double worst = 0;
+    for (int my = 0; my < (h + 15) / 16; my++)
+    {
+        for (int mx = 0; mx < (w + 15) / 16; mx++)
+        {
+            for (int c = 0; c < 3; c++)
+            {
+                const JpegGrayHuffman &dcTab = d.dc[d.scanTd[c]], &acTab = d.ac[d.scanTa[c]];
+                int blocks = c ? 1 : 4;
+                for (int b = 0; b < blocks; b++)
+                    if (!jpegGrayDecodeBlock(d, dcTab, acTab, pred[c], coef, c ? 1 : 0))
+                        return -1;
+                if (!c)
+                    continue;
+                double sum = 0;
+                for (int y = 0; y < 16; y++)
+                    for (int x = 0; x < 16; x++)
+                        sum += chroma[c - 1][(size_t)std::min(h - 1, my * 16 + y) * w + std::min(w - 1, mx * 16 + x)];
+                int q0 = d.qt[d.compTq[c]][0];
+                double got = coef[0] * q0 / 8.0 + 128;
+                worst = std::max(worst, fabs(got - sum / 256) / (q0 / 16.0 + 1));
+            }
+        }
+    }
+    return worst;
+}
+
+// Batas bawah PSNR: 4:2:0 tidak mempengaruhi luma, jadi semua format sama
+static double minPsnr(int quality)
+{
+    return quality >= 80 ? 32.0 : quality >= 50 ? 29.0 : 24.0;
+}
+
+static void usage()
+{
+    fprintf(stderr, "usage: jpeg_encoder_test [--seed N] [--repeat N] [--out DIR]\n");
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t seed = 1;
+    int repeat = 20;
+    std::string outDir;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string a = argv[i];
+        if (i + 1 >= argc)
+        {
+            usage();
+            return 2;
+        }
+        if (a == "--seed")
+            seed = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        else if (a == "--repeat")
+            repeat = std::max(1, atoi(argv[++i]));
+        else if (a == "--out")
+            outDir = argv[++i];
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+
+    JpegEncoder *enc = jpegEncCreate();
+    if (!enc)
+    {
+        fprintf(stderr, "jpegEncCreate failed\n");
+        return 2;
+    }
+
+    static const int sizes[][2] = {{160, 120}, {320, 240}, {37, 29}, {17, 9}, {8, 8}, {1, 1}, {641, 17}};
+    static const int qualities[] = {10, 30, 60, 80, 95};
+    std::mt19937 rng(seed);
+    std::vector<uint8_t> rgb, src, dec;
+    std::vector<float> luma, chroma[2];
+    int cases = 0, failures = 0;
+    double worstMargin = 1e9;
+
+    for (const auto &sz : sizes)
+    {
+        int w = sz[0], h = sz[1];
+        makeScene(w, h, rng, rgb);
+        for (int f = 0; f < 3; f++)
+        {
+            JpegEncFormat fmt = (JpegEncFormat)f;
+            toFormat(rgb, w, h, fmt, src, luma, chroma);
+            for (int q : qualities)
+            {
+                cases++;
+                CollectSink sink;
+                bool ok = jpegEncode(enc, src.data(), w, h, fmt, q, collectOut, &sink);
+                const std::vector<uint8_t> &j = sink.data;
+                const char *err = nullptr;
+                if (!ok)
+                    err = "jpegEncode returned false";
+                else if (!sink.ordered)
+                    err = "callback index not sequential";
+                else if (j.size() < 4 || j[0] != 0xFF || j[1] != 0xD8 || j[j.size() - 2] != 0xFF || j[j.size() - 1] != 0xD9)
+                    err = "missing SOI/EOI";
+
+                double psnr = 0;
+                if (!err)
+                {
+                    int dw = 0, dh = 0;
+                    dec.assign((size_t)(w + 1) / 2 * ((h + 1) / 2), 0);
+                    if (!jpegGrayDecode(j.data(), j.size(), JPEG_GRAY_SCALE_2, dec.data(), (int)dec.size(), dw, dh))
+                        err = "jpegGrayDecode failed";
+                    else if (dw != (w + 1) / 2 || dh != (h + 1) / 2)
+                        err = "decoded size mismatch";
+                    else
+                    {
+                        psnr = halfScalePsnr(luma, w, h, dec.data(), dw, dh);
+                        worstMargin = std::min(worstMargin, psnr - minPsnr(q));
+                        if (psnr < minPsnr(q))
+                            err = "luma PSNR too low";
+                    }
+                    double ce = fmt == JPEG_ENC_GRAY ? 0 : chromaDcError(j, chroma, w, h);
+                    if (!err && ce < 0)
+                        err = "chroma scan unreadable";
+                    else if (!err && ce > 1)
+                        err = "chroma DC off";
+                }
+                if (err && ++failures <= 20)
+                    fprintf(stderr, "%s %dx%d q%d: %s (%zu bytes, psnr %.1f dB)\n", formatNames[f], w, h, q, err, j.size(), psnr);
+
+                if (!outDir.empty() && ok)
+                {
+                    char path[512];
+                    snprintf(path, sizeof(path), "%s/%s_%dx%d_q%d.jpg", outDir.c_str(), formatNames[f], w, h, q);
+                    FILE *fp = fopen(path, "wb");
+                    if (fp)
+                    {
+                        fwrite(j.data(), 1, j.size(), fp);
+                        fclose(fp);
+                    }
+                }
+            }
+
+            // Sink menolak: encode berhenti dan sink tidak dipanggil lagi
+            for (int rejectAt = 0; rejectAt < 3; rejectAt++)
+            {
+                cases++;
+                CollectSink sink;
+                sink.rejectAt = rejectAt;
+                bool ok = jpegEncode(enc, src.data(), w, h, fmt, 80, collectOut, &sink);
+                if (sink.calls <= rejectAt)
+                    continue; // output lebih kecil dari rejectAt chunk: tidak ada yang ditolak
+                if ((ok || sink.calledAfterReject) && ++failures <= 20)
+                    fprintf(stderr, "%s %dx%d: rejected chunk %d not reported (ok=%d, calls after reject=%d)\n",
+                            formatNames[f], w, h, rejectAt, ok, sink.calledAfterReject);
+            }
+        }
+    }
+    printf("round-trip: %d cases, %d failed, worst PSNR margin %.1f dB\n", cases, failures, worstMargin);
+
+    // Benchmark kualitas 80 (CAM_ENCODE_QUALITY), sink menyalin ke buffer tetap
+    static const int benchSizes[][2] = {{160, 120}, {640, 480}};
+    for (const auto &sz : benchSizes)
+    {
+        int w = sz[0], h = sz[1];
+        makeScene(w, h, rng, rgb);
+        for (int f = 0; f < 3; f++)
+        {
+            toFormat(rgb, w, h, (JpegEncFormat)f, src, luma, chroma);
+            CollectSink sink;
+            sink.data.reserve(src.size());
+            auto t0 = std::chrono::steady_clock::now();
+            for (int r = 0; r < repeat; r++)
+            {
+                sink.data.clear();
+                jpegEncode(enc, src.data(), w, h, (JpegEncFormat)f, 80, collectOut, &sink);
+            }
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count() / repeat;
+            printf("bench %-6s %dx%d q80: %.3f ms/frame, %zu bytes\n", formatNames[f], w, h, ms, sink.data.size());
+        }
+    }
+    frameArenaFree(enc);
+    return failures ? 1 : 0;
+}
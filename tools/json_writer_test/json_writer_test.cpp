@@ -0,0 +1,698 @@
+// json_writer_test.cpp - Fuzz dan benchmark ChunkWriter/JsonWriter di PC
+// json_writer.h di-include langsung dari folder sketch (ketiga sketch memakai
+// salinan yang sama), jadi yang diuji persis kode yang di-flash.
+//
+// Fuzz: dokumen acak (object/array bersarang, string berisi byte kontrol, kutip,
+// backslash dan UTF-8, integer ekstrem, double termasuk NaN/inf, printf panjang)
+// ditulis lewat JsonWriter dengan kapasitas buffer acak 1..600 byte, lalu
+// dibandingkan byte-per-byte dengan serializer referensi berbasis std::string
+// dan divalidasi parser JSON kecil. Setiap chunk yang sampai ke sink harus
+// 1..kapasitas byte. Sebagian kasus mensimulasikan koneksi putus: sink menolak
+// chunk ke-k, setelah itu sink tidak boleh dipanggil lagi dan finish() false.
+//
+// Benchmark: respons mirip /list (N entri file) dibangun dengan String += seperti
+// handler lama (alokasi ulang tepat-ukuran setiap tambah, seperti Arduino String)
+// dibandingkan JsonWriter dengan buffer 512 byte di stack.
+// Exit code: 0 semua kasus fuzz lolos, 1 ada yang gagal, 2 argumen salah.
+//
+// Build (Linux, g++ >= 8):
+//   g++ -O2 -std=c++17 -o json_writer_test json_writer_test.cpp
+// Pemakaian:
+//   ./json_writer_test                       (20000 kasus fuzz + benchmark 500 entri)
+//   ./json_writer_test --cases 200000 --seed 7
+//   ./json_writer_test --bench-entries 2000 --repeat 50
+
+#include <ctype.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../../esp32_kamera_cek_warna_hitam_putih/json_writer.h"
+
+#define FUZZ_MAX_DEPTH (JSON_MAX_DEPTH - 1) // JsonWriter tidak melacak lebih dalam dari ini
+#define FUZZ_MAX_CAP 600
+#define BENCH_BUF 512 // ukuran buffer stack di handler sketch
+
+struct TestOptions
+{
+    uint32_t seed = 1;
+    int cases = 20000;
+    int benchEntries = 500;
+    int repeat = 20;
+};
+
+// ---------------------------------------------------------------------------
+// Serializer referensi: aturan escape yang sama dengan JsonWriter::string()
+// ---------------------------------------------------------------------------
+
+static void refString(std::string &out, const std::string &s)
+{
+    static const char hex[] = "0123456789abcdef";
+    out += '"';
+    for (unsigned char c : s)
+    {
+        if (c == '"')
+            out += "\\\"";
+        else if (c == '\\')
+            out += "\\\\";
+        else if (c == '\n')
+            out += "\\n";
+        else if (c == '\r')
+            out += "\\r";
+        else if (c == '\t')
+            out += "\\t";
+        else if (c < 0x20)
+        {
+            out += "\\u00";
+            out += hex[c >> 4];
+            out += hex[c & 0xF];
+        }
+        else
+            out += (char)c;
+    }
+    out += '"';
+}
+
+// ChunkWriter::printf: utuh jika muat di buffer kosong, selain itu dipotong
+// ke JSON_PRINTF_MAX - 1 karakter
+static void refPrintf(std::string &out, const std::string &text, size_t cap)
+{
+    if (text.size() < cap)
+        out += text;
+    else
+        out += text.substr(0, std::min(text.size(), (size_t)JSON_PRINTF_MAX - 1));
+}
+
+// ---------------------------------------------------------------------------
+// Generator dokumen acak: menulis ke JsonWriter dan referensi sekaligus
+// ---------------------------------------------------------------------------
+
+class Fuzzer
+{
+public:
+    Fuzzer(std::mt19937 &rng, JsonWriter &json, std::string &ref, size_t cap)
+        : rng_(rng), json_(json), ref_(ref), cap_(cap) {}
+
+    void document()
+    {
+        if (pick(4) == 0)
+            array(0);
+        else
+            object(0);
+    }
+
+private:
+    uint32_t pick(uint32_t n) { return rng_() % n; }
+
+    uint64_t random64() { return ((uint64_t)rng_() << 32) | rng_(); }
+
+    std::string randomString()
+    {
+        static const char *samples[] = {"", "a", "hitam", "\"", "\\", "\\\"", "/sd/IMG_0001.jpg",
+                                        "\xC3\xA9\xE2\x9C\x85", "\x7F", "\xFF"};
+        if (pick(3) == 0)
+            return samples[pick(sizeof(samples) / sizeof(samples[0]))];
+        // Kadang lebih panjang dari buffer agar write() memecah potongan
+        uint32_t len = pick(8) == 0 ? pick(1500) : pick(40);
+        std::string s;
+        for (uint32_t i = 0; i < len; i++)
+        {
+            uint32_t kind = pick(10);
+            if (kind == 0)
+                s += (char)pick(0x20); // byte kontrol termasuk \0
+            else if (kind == 1)
+                s += "\"\\"[pick(2)];
+            else if (kind == 2)
+                s += (char)(0x80 + pick(0x80));
+            else
+                s += (char)(0x20 + pick(0x5F));
+        }
+        return s;
+    }
+
+    void separator(bool &first)
+    {
+        if (!first)
+            ref_ += ',';
+        first = false;
+    }
+
+    void object(int depth)
+    {
+        json_.beginObject();
+        ref_ += '{';
+        bool first = true;
+        uint32_t n = pick(depth == 0 ? 12 : 6);
+        for (uint32_t i = 0; i < n; i++)
+        {
+            separator(first);
+            // key() memakai strlen: string berhenti di \0 pertama
+            std::string k = randomString().c_str();
+            json_.key(k.c_str());
+            refString(ref_, k);
+            ref_ += ':';
+            value(depth + 1);
+        }
+        json_.endObject();
+        ref_ += '}';
+    }
+
+    void array(int depth)
+    {
+        json_.beginArray();
+        ref_ += '[';
+        bool first = true;
+        uint32_t n = pick(depth == 0 ? 16 : 8);
+        for (uint32_t i = 0; i < n; i++)
+        {
+            separator(first);
+            value(depth + 1);
+        }
+        json_.endArray();
+        ref_ += ']';
+    }
+
+    void value(int depth)
+    {
+        switch (pick(depth < FUZZ_MAX_DEPTH ? 12 : 10))
+        {
+        case 0:
+        {
+            std::string s = randomString();
+            json_.value(s.data(), s.size()); // dengan panjang: \0 ikut di-escape
+            refString(ref_, s);
+            break;
+        }
+        case 1:
+        {
+            std::string s = randomString().c_str();
+            json_.value(s.c_str());
+            refString(ref_, s);
+            break;
+        }
+        case 2:
+        {
+            bool b = pick(2);
+            json_.value(b);
+            ref_ += b ? "true" : "false";
+            break;
+        }
+        case 3:
+        {
+            static const long long edges[] = {0, 1, -1, 9, -10, std::numeric_limits<long long>::min(),
+                                              std::numeric_limits<long long>::max()};
+            long long v = pick(3) == 0 ? edges[pick(sizeof(edges) / sizeof(edges[0]))]
+                                       : (long long)random64() >> pick(64);
+            json_.value(v);
+            ref_ += std::to_string(v);
+            break;
+        }
+        case 4:
+        {
+            int v = pick(4) == 0 ? std::numeric_limits<int>::min() : (int)rng_();
+            json_.value(v);
+            ref_ += std::to_string(v);
+            break;
+        }
+        case 5:
+        {
+            unsigned long long v = pick(4) == 0 ? std::numeric_limits<unsigned long long>::max() : random64() >> pick(64);
+            json_.value(v);
+            ref_ += std::to_string(v);
+            break;
+        }
+        case 6:
+        {
+            // Rentang nilai yang memang dikirim handler; NaN/inf jadi null
+            static const double specials[] = {NAN, INFINITY, -INFINITY, 0.0, -0.0, 0.5, 2.675, 1e15, -1e15};
+            double v = pick(3) == 0 ? specials[pick(sizeof(specials) / sizeof(specials[0]))]
+                                    : ((double)rng_() - 2147483648.0) / (1 + pick(100000));
+            int decimals = pick(7);
+            json_.value(v, decimals);
+            if (std::isnan(v) || std::isinf(v))
+                ref_ += "null";
+            else
+            {
+                char tmp[64];
+                snprintf(tmp, sizeof(tmp), "%.*f", decimals, v);
+                refPrintf(ref_, tmp, cap_);
+            }
+            break;
+        }
+        case 7:
+            json_.null();
+            ref_ += "null";
+            break;
+        case 8:
+        {
+            // Angka diikuti spasi via printf mentah (jalur potong printf panjang)
+            json_.value(true);
+            ref_ += "true";
+            int width = pick(4) == 0 ? pick(400) : pick(20);
+            json_.out().printf(" %*s", width, "");
+            refPrintf(ref_, std::string(width + 1, ' '), cap_);
+            break;
+        }
+        case 9:
+        {
+            long n = pick(100000);
+            json_.beginObject();
+            json_.field("n", n);
+            json_.field("f", 1.25, 2);
+            json_.endObject();
+            ref_ += "{\"n\":" + std::to_string(n) + ",\"f\":1.25}";
+            break;
+        }
+        case 10:
+            object(depth);
+            break;
+        default:
+            array(depth);
+            break;
+        }
+    }
+
+    std::mt19937 &rng_;
+    JsonWriter &json_;
+    std::string &ref_;
+    size_t cap_;
+};
+
+// ---------------------------------------------------------------------------
+// Validator JSON kecil (RFC 8259 tanpa cek UTF-8)
+// ---------------------------------------------------------------------------
+
+class JsonValidator
+{
+public:
+    explicit JsonValidator(const std::string &s) : s_(s), i_(0) {}
+
+    bool valid()
+    {
+        return value(0) && (ws(), i_ == s_.size());
+    }
+
+private:
+    void ws()
+    {
+        while (i_ < s_.size() && (s_[i_] == ' ' || s_[i_] == '\t' || s_[i_] == '\n' || s_[i_] == '\r'))
+            i_++;
+    }
+
+    bool lit(const char *w)
+    {
+        size_t n = strlen(w);
+        if (s_.compare(i_, n, w) != 0)
+            return false;
+        i_ += n;
+        return true;
+    }
+
+    bool string()
+    {
+        if (s_[i_++] != '"')
+            return false;
+        while (i_ < s_.size())
+        {
+            unsigned char c = s_[i_++];
+            if (c == '"')
+                return true;
+            if (c < 0x20)
+                return false;
+            if (c != '\\')
+                continue;
+            if (i_ >= s_.size())
+                return false;
+            c = s_[i_++];
+            if (c == 'u')
+            {
+                for (int k = 0; k < 4; k++, i_++)
+                    if (i_ >= s_.size() || !isxdigit((unsigned char)s_[i_]))
+                        return false;
+            }
+            else if (!strchr("\"\\/bfnrt", c))
+                return false;
+        }
+        return false;
+    }
+
+    bool number()
+    {
+        size_t start = i_;
+        if (s_[i_] == '-')
+            i_++;
+        if (i_ >= s_.size() || !isdigit((unsigned char)s_[i_]))
+            return false;
+        if (s_[i_] == '0')
+            i_++;
+        else
+            while (i_ < s_.size() && isdigit((unsigned char)s_[i_]))
+                i_++;
+        if (i_ < s_.size() && s_[i_] == '.')
+        {
+            i_++;
+            size_t d = i_;
+            while (i_ < s_.size() && isdigit((unsigned char)s_[i_]))
+                i_++;
+            if (i_ == d)
+                return false;
+        }
+        return i_ > start;
+    }
+
+    bool value(int depth)
+    {
+        ws();
+        if (i_ >= s_.size() || depth > 64)
+            return false;
+        char c = s_[i_];
+        if (c == '{' || c == '[')
+        {
+            char close = c == '{' ? '}' : ']';
+            i_++;
+            ws();
+            if (i_ < s_.size() && s_[i_] == close)
+            {
+                i_++;
+                return true;
+            }
+            for (;;)
+            {
+                if (c == '{')
+                {
+                    ws();
+                    if (i_ >= s_.size() || !string())
+                        return false;
+                    ws();
+                    if (i_ >= s_.size() || s_[i_++] != ':')
+                        return false;
+                }
+                if (!value(depth + 1))
+                    return false;
+                ws();
+                if (i_ >= s_.size())
+                    return false;
+                if (s_[i_] == close)
+                {
+                    i_++;
+                    return true;
+                }
+                if (s_[i_++] != ',')
+                    return false;
+            }
+        }
+        if (c == '"')
+            return string();
+        if (c == 't')
+            return lit("true");
+        if (c == 'f')
+            return lit("false");
+        if (c == 'n')
+            return lit("null");
+        return number();
+    }
+
+    const std::string &s_;
+    size_t i_;
+};
+
+// ---------------------------------------------------------------------------
+// Sink uji
+// ---------------------------------------------------------------------------
+
+struct CollectSink
+{
+    std::string data;
+    size_t cap = 0;
+    int calls = 0;
+    int failAt = -1;      // chunk ke berapa yang ditolak (-1 = tidak pernah)
+    bool badChunk = false; // chunk kosong atau melebihi kapasitas
+    bool callAfterFail = false;
+};
+
+static bool collectSink(void *ctx, const char *data, size_t len)
+{
+    CollectSink *s = (CollectSink *)ctx;
+    if (s->failAt >= 0 && s->calls > s->failAt)
+        s->callAfterFail = true;
+    if (len == 0 || len > s->cap)
+        s->badChunk = true;
+    if (s->calls++ == s->failAt)
+        return false;
+    s->data.append(data, len);
+    return true;
+}
+
+static bool runFuzzCase(uint32_t seed, int index)
+{
+    std::mt19937 rng(seed);
+    size_t cap = 1 + rng() % FUZZ_MAX_CAP;
+    std::vector<char> buf(cap);
+    CollectSink sink;
+    sink.cap = cap;
+    bool failing = rng() % 8 == 0;
+
+    // Putaran pertama tanpa kegagalan untuk tahu jumlah chunk
+    std::string ref;
+    {
+        ChunkWriter out(buf.data(), cap, collectSink, &sink);
+        JsonWriter json(out);
+        Fuzzer fz(rng, json, ref, cap);
+        fz.document();
+        if (!out.finish() || out.failed())
+        {
+            fprintf(stderr, "case %d (seed %u, cap %zu): finish() failed without a sink error\n", index, seed, cap);
+            return false;
+        }
+    }
+    if (sink.badChunk)
+    {
+        fprintf(stderr, "case %d (seed %u, cap %zu): chunk of 0 or more than cap bytes\n", index, seed, cap);
+        return false;
+    }
+    if (sink.data != ref)
+    {
+        size_t at = std::mismatch(sink.data.begin(), sink.data.end(), ref.begin(), ref.end()).first - sink.data.begin();
+        fprintf(stderr, "case %d (seed %u, cap %zu): output differs from reference at byte %zu (got %zu, want %zu bytes)\n",
+                index, seed, cap, at, sink.data.size(), ref.size());
+        return false;
+    }
+    if (!JsonValidator(sink.data).valid())
+    {
+        fprintf(stderr, "case %d (seed %u, cap %zu): output is not valid JSON\n", index, seed, cap);
+        return false;
+    }
+    if (!failing || sink.calls == 0)
+        return true;
+
+    // Putaran kedua: dokumen yang sama, sink menolak salah satu chunk
+    int chunks = sink.calls;
+    std::mt19937 replay(seed);
+    replay();
+    replay();
+    CollectSink broken;
+    broken.cap = cap;
+    broken.failAt = (int)(std::mt19937(seed ^ 0x5EEDu)() % chunks);
+    std::string ignored;
+    ChunkWriter out(buf.data(), cap, collectSink, &broken);
+    JsonWriter json(out);
+    Fuzzer fz(replay, json, ignored, cap);
+    fz.document();
+    bool finished = out.finish();
+    if (finished || !out.failed() || broken.callAfterFail || broken.calls != broken.failAt + 1)
+    {
+        fprintf(stderr, "case %d (seed %u, cap %zu): sink failure at chunk %d not latched (calls %d)\n",
+                index, seed, cap, broken.failAt, broken.calls);
+        return false;
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Benchmark: String += (gaya handler lama) vs JsonWriter
+// ---------------------------------------------------------------------------
+
+// Meniru Arduino String: buffer tepat-ukuran, setiap += alokasi baru dan salin
+class NaiveString
+{
+public:
+    ~NaiveString() { free(buf_); }
+
+    NaiveString &operator+=(const char *s)
+    {
+        size_t n = strlen(s);
+        char *grown = (char *)malloc(len_ + n + 1);
+        if (buf_)
+            memcpy(grown, buf_, len_);
+        memcpy(grown + len_, s, n + 1);
+        peak_ = std::max(peak_, len_ * 2 + n + 1); // lama + baru hidup bersamaan
+        free(buf_);
+        buf_ = grown;
+        len_ += n;
+        return *this;
+    }
+
+    NaiveString &operator+=(long v)
+    {
+        char tmp[24];
+        snprintf(tmp, sizeof(tmp), "%ld", v);
+        return *this += tmp;
+    }
+
+    size_t length() const { return len_; }
+    size_t peak() const { return peak_; }
+
+private:
+    char *buf_ = nullptr;
+    size_t len_ = 0;
+    size_t peak_ = 0;
+};
+
+struct BenchEntry
+{
+    std::string name;
+    long size;
+    bool dir;
+};
+
+static size_t benchString(const std::vector<BenchEntry> &entries, size_t &peak)
+{
+    NaiveString s;
+    s += "{\"files\":[";
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        if (i)
+            s += ",";
+        s += "{\"name\":\"";
+        s += entries[i].name.c_str();
+        s += "\",\"size\":";
+        s += entries[i].size;
+        s += ",\"dir\":";
+        s += entries[i].dir ? "true" : "false";
+        s += "}";
+    }
+    s += "]}";
+    peak = s.peak();
+    return s.length();
+}
+
+static bool countSink(void *ctx, const char *, size_t len)
+{
+    *(size_t *)ctx += len;
+    return true;
+}
+
+static size_t benchWriter(const std::vector<BenchEntry> &entries)
+{
+    char buf[BENCH_BUF];
+    size_t total = 0;
+    ChunkWriter out(buf, sizeof(buf), countSink, &total);
+    JsonWriter json(out);
+    json.beginObject();
+    json.key("files");
+    json.beginArray();
+    for (const BenchEntry &e : entries)
+    {
+        json.beginObject();
+        json.field("name", e.name.c_str());
+        json.field("size", e.size);
+        json.field("dir", e.dir);
+        json.endObject();
+    }
+    json.endArray();
+    json.endObject();
+    out.finish();
+    return total;
+}
+
+template <typename F>
+static double medianUs(int repeat, F fn)
+{
+    std::vector<double> t;
+    for (int r = 0; r < repeat; r++)
+    {
+        auto t0 = std::chrono::steady_clock::now();
+        fn();
+        t.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count());
+    }
+    std::sort(t.begin(), t.end());
+    return t[t.size() / 2];
+}
+
+static void runBenchmark(const TestOptions &o)
+{
+    std::vector<BenchEntry> entries;
+    for (int i = 0; i < o.benchEntries; i++)
+    {
+        char name[40];
+        snprintf(name, sizeof(name), "/captures/IMG_%08d.jpg", i);
+        entries.push_back({name, 20000L + i * 37L, i % 50 == 0});
+    }
+
+    size_t peak = 0, lenString = 0, lenWriter = 0;
+    double usString = medianUs(o.repeat, [&] { lenString = benchString(entries, peak); });
+    double usWriter = medianUs(o.repeat, [&] { lenWriter = benchWriter(entries); });
+    printf("benchmark: %d entries, %zu bytes response, median of %d\n", o.benchEntries, lenWriter, o.repeat);
+    printf("  String +=   %10.1f us   peak heap %zu bytes\n", usString, peak);
+    printf("  JsonWriter  %10.1f us   buffer %d bytes (stack), no heap\n", usWriter, BENCH_BUF);
+    if (lenString != lenWriter)
+        printf("  note: String response is %zu bytes (escaping differs)\n", lenString);
+}
+
+// ---------------------------------------------------------------------------
+
+static void usage()
+{
+    fprintf(stderr,
+            "usage: json_writer_test [options]\n"
+            "  --cases N           fuzz cases (default 20000, 0 = skip fuzz)\n"
+            "  --seed N            base seed (default 1)\n"
+            "  --bench-entries N   /list-style entries in the benchmark (default 500, 0 = skip)\n"
+            "  --repeat N          benchmark repetitions, median reported (default 20)\n");
+}
+
+int main(int argc, char **argv)
+{
+    TestOptions o;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string a = argv[i];
+        if (i + 1 >= argc)
+        {
+            usage();
+            return 2;
+        }
+        if (a == "--cases")
+            o.cases = atoi(argv[++i]);
+        else if (a == "--seed")
+            o.seed = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        else if (a == "--bench-entries")
+            o.benchEntries = atoi(argv[++i]);
+        else if (a == "--repeat")
+            o.repeat = std::max(1, atoi(argv[++i]));
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+
+    int failed = 0;
+    for (int i = 0; i < o.cases; i++)
+        if (!runFuzzCase(o.seed * 1000003u + (uint32_t)i, i) && ++failed >= 10)
+            break;
+    if (o.cases > 0)
+        printf("fuzz: %d cases, %d failed\n", o.cases, failed);
+
+    if (o.benchEntries > 0)
+        runBenchmark(o);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,114 @@
+// rgb565_mask_test.cpp - Uji bit-exact kernel rgb565_mask.h di PC
+// rgb565_mask.h di-include langsung dari folder sketch Alat_Hitung, lalu seluruh
+// 65536 nilai piksel RGB565 dibandingkan dengan implementasi lama dari .ino
+// (rgb565_to_gray per piksel, lalu gray < threshold):
+//   - rgb565_to_gray() dan rgb565SumToGray() untuk setiap nilai
+//   - rgb565SumToGray() untuk setiap sum 0..255000 (bukan hanya sum yang mungkin)
+//   - rgb565ToMask() untuk setiap threshold -2..300
+//   - rgb565ToGrayHist(): gray per piksel dan hist[] terakumulasi (tidak di-reset)
+// Buffer diuji ter-align 4 byte (jalur dua-piksel per word) dan bergeser 1-3 byte
+// (jalur skalar), dengan jumlah piksel genap dan ganjil (sisa piksel).
+// Exit code: 0 semua cocok, 1 ada yang berbeda.
+//
+// Build (Linux, g++ >= 8):
+//   g++ -O2 -std=c++17 -o rgb565_mask_test rgb565_mask_test.cpp
+// Pemakaian:
+//   ./rgb565_mask_test
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "../../Alat_Hitung/alat hitung/alat_hitung/ESP32S3_Camera_Counter_Fixed/rgb565_mask.h"
+
+#define PIXEL_VALUES 65536
+#define THRESH_MIN -2
+#define THRESH_MAX 300
+
+// Referensi: rgb565_to_gray() versi .ino sebelum kernel LUT
+static uint8_t refGray(uint16_t c)
+{
+    uint8_t r = (c >> 11) & 0x1F;
+    uint8_t g = (c >> 5) & 0x3F;
+    uint8_t b = c & 0x1F;
+    uint8_t R = (r * 255) / 31;
+    uint8_t G = (g * 255) / 63;
+    uint8_t B = (b * 255) / 31;
+    return (uint8_t)((R * 299 + G * 587 + B * 114) / 1000);
+}
+
+static int failures = 0;
+
+static bool report(bool ok, const char *what, int a, int b, int got, int want)
+{
+    if (!ok && ++failures <= 20)
+        fprintf(stderr, "%s: case %d/%d got %d want %d\n", what, a, b, got, want);
+    return ok;
+}
+
+int main()
+{
+    // Semua nilai piksel, little-endian, dengan ruang untuk pergeseran 1-3 byte
+    std::vector<uint8_t> storage(PIXEL_VALUES * 2 + 8);
+    uint8_t *aligned = storage.data() + ((4 - ((uintptr_t)storage.data() & 3)) & 3);
+    uint8_t ref[PIXEL_VALUES];
+    for (int c = 0; c < PIXEL_VALUES; c++)
+        ref[c] = refGray((uint16_t)c);
+
+    // Konversi per piksel dan pembagian tanpa div
+    int checks = 0;
+    for (int c = 0; c < PIXEL_VALUES; c++, checks += 2)
+    {
+        report(rgb565_to_gray((uint16_t)c) == ref[c], "rgb565_to_gray", c, 0, rgb565_to_gray((uint16_t)c), ref[c]);
+        int g = (int)rgb565SumToGray(rgb565WeightedSum((uint32_t)c));
+        report(g == ref[c], "rgb565SumToGray(pixel)", c, 0, g, ref[c]);
+    }
+    for (uint32_t sum = 0; sum <= 255000; sum++, checks++)
+        report(rgb565SumToGray(sum) == sum / 1000, "rgb565SumToGray(sum)", (int)sum, 0, (int)rgb565SumToGray(sum), (int)(sum / 1000));
+
+    std::vector<uint8_t> mask(PIXEL_VALUES), gray(PIXEL_VALUES);
+    for (int offset = 0; offset < 4; offset++)
+    {
+        uint8_t *src = aligned + offset;
+        for (int c = 0; c < PIXEL_VALUES; c++)
+        {
+            src[c * 2] = c & 0xFF;
+            src[c * 2 + 1] = c >> 8;
+        }
+        // Genap (semua nilai) dan ganjil (piksel terakhir lewat jalur sisa)
+        for (int pixels = PIXEL_VALUES - 1; pixels <= PIXEL_VALUES; pixels++)
+        {
+            for (int t = THRESH_MIN; t <= THRESH_MAX; t++)
+            {
+                memset(mask.data(), 0xAA, mask.size());
+                rgb565ToMask(src, mask.data(), pixels, t);
+                for (int c = 0; c < pixels; c++, checks++)
+                {
+                    int want = ref[c] < t;
+                    if (!report(mask[c] == want, offset ? "rgb565ToMask(unaligned)" : "rgb565ToMask", c, t, mask[c], want))
+                        break;
+                }
+                if (pixels < PIXEL_VALUES)
+                    report(mask[pixels] == 0xAA, "rgb565ToMask wrote past pixels", pixels, t, mask[pixels], 0xAA);
+            }
+
+            // Histogram diisi dulu: kernel harus menambah, bukan menimpa
+            uint32_t hist[256], want[256];
+            for (int v = 0; v < 256; v++)
+                hist[v] = want[v] = v * 7;
+            for (int c = 0; c < pixels; c++)
+                want[ref[c]]++;
+            memset(gray.data(), 0xAA, gray.size());
+            rgb565ToGrayHist(src, gray.data(), pixels, hist);
+            for (int c = 0; c < pixels; c++, checks++)
+                if (!report(gray[c] == ref[c], offset ? "rgb565ToGrayHist gray(unaligned)" : "rgb565ToGrayHist gray", c, pixels, gray[c], ref[c]))
+                    break;
+            for (int v = 0; v < 256; v++, checks++)
+                report(hist[v] == want[v], "rgb565ToGrayHist hist", v, pixels, (int)hist[v], (int)want[v]);
+        }
+    }
+
+    printf("rgb565_mask: %d checks, %d mismatches\n", checks, failures);
+    return failures ? 1 : 0;
+}